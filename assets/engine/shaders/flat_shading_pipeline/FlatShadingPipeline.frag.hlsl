@@ -14,9 +14,9 @@ struct Material
 {
     float4 color;
     int hasBaseColorTexture;
+    int textureIndex;
     int placeholder0;
     int placeholder1;
-    int placeholder2;
 };
 
 struct LightSource
@@ -31,13 +31,29 @@ ConstantBuffer <LightSource> lightSource : register(b1, space0);
 
 sampler textureSampler : register(s2, space0);
 
-ConstantBuffer <Material> material : register(b0, space1);
+StructuredBuffer <Material> materials : register(t3, space0);
+
+Texture2D textures[MAX_TEXTURE_COUNT] : register(t4, space0);
+
+struct PushConsts
+{
+    float4x4 model;
+    int materialIndex;
+    int placeholder0;
+    int placeholder1;
+    int placeholder2;
+};
 
-Texture2D baseColorTexture : register(t1, space1);
+[[vk::push_constant]]
+cbuffer {
+    PushConsts pushConsts;
+};
 
 PSOut main(PSIn input) {
     PSOut output;
 
+    Material material = materials[pushConsts.materialIndex];
+
     float3 color;
     float alpha;
     if (material.hasBaseColorTexture == 0)
@@ -47,7 +63,7 @@ PSOut main(PSIn input) {
     }
     else
     {
-        color = baseColorTexture.Sample(textureSampler, input.baseColorUV);
+        color = textures[material.textureIndex].Sample(textureSampler, input.baseColorUV).rgb;
         alpha = 1.0;
     }
     
@@ -19,6 +19,10 @@ ConstantBuffer <ViewProjectionBuffer> vpBuff: register(b0, space0);
 struct PushConsts
 {
     float4x4 model;
+    int materialIndex;
+    int placeholder0;
+    int placeholder1;
+    int placeholder2;
 };
 
 [[vk::push_constant]]
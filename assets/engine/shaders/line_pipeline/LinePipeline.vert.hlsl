@@ -1,9 +1,11 @@
 struct VSIn {
     float3 position : POSITION0;
+    float4 color : COLOR0;
 };
 
 struct VSOut {
     float4 position : SV_POSITION;
+    float4 color : COLOR0;
 };
 
 struct ViewProjectionBuffer {
@@ -15,7 +17,6 @@ ConstantBuffer <ViewProjectionBuffer> vpBuffer: register(b0, space0);
 struct PushConsts
 {
     float4x4 model;
-    float4 color : COLOR0;
 };
 
 [[vk::push_constant]]
@@ -28,6 +29,7 @@ VSOut main(VSIn input) {
 
     float4x4 mvpMatrix = mul(vpBuffer.viewProjection, pushConsts.model);
     output.position = mul(mvpMatrix, float4(input.position, 1.0));
+    output.color = input.color;
     
     return output;
 }
\ No newline at end of file
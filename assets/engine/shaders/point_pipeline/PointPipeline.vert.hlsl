@@ -1,9 +1,12 @@
 struct VSIn {
     float3 position : POSITION0;
+    float4 color : COLOR0;
+    float pointSize : PSIZE0;
 };
 
 struct VSOut {
     float4 position : SV_POSITION;
+    float4 color : COLOR0;
     [[vk::builtin("PointSize")]] float PSize : PSIZE;
 };
 
@@ -16,11 +19,6 @@ ConstantBuffer <ViewProjectionBuffer> mvpBuffer: register(b0, space0);
 struct PushConsts
 {    
     float4x4 model;
-    float4 color;
-    float pointSize;
-    float placeholder0;
-    float placeholder1;
-    float placeholder2;
 };
 
 [[vk::push_constant]]
@@ -33,7 +31,8 @@ VSOut main(VSIn input) {
 
     float4x4 mvpMatrix = mul(mvpBuffer.viewProjection, pushConsts.model);
     output.position = mul(mvpMatrix, float4(input.position, 1.0));
-    output.PSize = pushConsts.pointSize;
+    output.color = input.color;
+    output.PSize = input.pointSize;
 
     return output;
 }
\ No newline at end of file
@@ -8,6 +8,13 @@ namespace MFA::Asset::GLTF
 
     //-------------------------------------------------------------------------------------------------
 
+    glm::mat4 NodeTransform::LocalTransform() const
+    {
+        return extraTransform * Math::Translate(position) * glm::toMat4(rotation) * Math::Scale(scale);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     Node::Node() = default;
 
     //-------------------------------------------------------------------------------------------------
@@ -151,6 +158,26 @@ namespace MFA::Asset::GLTF
         ::memcpy(mVertexData->Ptr() + mNextVertexOffset, vertices, verticesSize);
         ::memcpy(mIndexData->Ptr() + mNextIndexOffset, indices, indicesSize);
 
+        InsertPrimitive(subMeshIndex, primitive);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void Mesh::InsertPrimitive(uint32_t const subMeshIndex, Primitive const & primitive)
+	{
+        MFA_ASSERT(primitive.vertexCount > 0);
+        MFA_ASSERT(primitive.indicesCount > 0);
+        MFA_ASSERT(primitive.verticesOffset == mNextVertexOffset);
+        MFA_ASSERT(primitive.indicesOffset == mNextIndexOffset);
+        MFA_ASSERT(primitive.verticesStartingIndex == mVerticesStartingIndex);
+        MFA_ASSERT(primitive.indicesStartingIndex == mIndicesStartingIndex);
+
+        uint32_t const verticesSize = sizeof(Vertex) * primitive.vertexCount;
+        uint32_t const indicesSize = sizeof(Index) * primitive.indicesCount;
+
+		MFA_ASSERT(mNextVertexOffset + verticesSize <= mVertexData->Len());
+        MFA_ASSERT(mNextIndexOffset + indicesSize <= mIndexData->Len());
+
         MFA_ASSERT(subMeshIndex < mData->subMeshes.size());
         auto& subMesh = mData->subMeshes[subMeshIndex];
 
@@ -189,8 +216,8 @@ namespace MFA::Asset::GLTF
 
         mNextVertexOffset += verticesSize;
         mNextIndexOffset += indicesSize;
-        mIndicesStartingIndex += indicesCount;
-        mVerticesStartingIndex += vertexCount;
+        mIndicesStartingIndex += primitive.indicesCount;
+        mVerticesStartingIndex += primitive.vertexCount;
 	}
 
     //-------------------------------------------------------------------------------------------------
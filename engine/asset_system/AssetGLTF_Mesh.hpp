@@ -1,7 +1,6 @@
 #pragma once
 
 #include "BedrockMemory.hpp"
-#include "Transform.hpp"
 
 #include <cstdint>
 #include <memory>
@@ -11,6 +10,7 @@
 
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 namespace MFA::Asset::GLTF
 {
@@ -122,6 +122,19 @@ namespace MFA::Asset::GLTF
 		std::vector<Primitive*> const& FindPrimitives(AlphaMode alphaMode) const;
 	};
 
+	// Local transform of a node as it is stored in the file. Nodes are shared by every instance of the mesh, so they
+	// are plain values instead of nodes of the TransformSystem and meshes can be imported on any thread.
+	struct NodeTransform
+	{
+		glm::vec3 position{0.0f, 0.0f, 0.0f};
+		glm::quat rotation = glm::identity<glm::quat>();
+		glm::vec3 scale{1.0f, 1.0f, 1.0f};
+		glm::mat4 extraTransform = glm::identity<glm::mat4>();
+
+		[[nodiscard]]
+		glm::mat4 LocalTransform() const;
+	};
+
 	struct Node
     {
         friend class Mesh;
@@ -136,7 +149,7 @@ namespace MFA::Asset::GLTF
 		int parent = -1;
         int skin = -1;
 
-		Transform transform{};
+		NodeTransform transform{};
 
         [[nodiscard]]
         bool hasSubMesh() const noexcept;
@@ -258,6 +271,10 @@ namespace MFA::Asset::GLTF
 			Index * indices
 		);
 
+		// Adds a primitive whose vertices and indices are already in the buffers, for example because the
+		// buffers were loaded from a cooked mesh. Primitives have to be inserted in the order of their offsets.
+		void InsertPrimitive(uint32_t subMeshIndex, Primitive const & primitive);
+
 		[[nodiscard]]
         Node & InsertNode() const;
 
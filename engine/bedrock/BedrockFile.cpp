@@ -2,11 +2,25 @@
 
 #include <filesystem>
 #include <fstream>
-#include <vector>
 
 #include "BedrockAssert.hpp"
 #include "BedrockLog.hpp"
+#include "BedrockPlatforms.hpp"
 
+#if defined(__PLATFORM_WIN__)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace MFA::File
 {
@@ -14,23 +28,20 @@ namespace MFA::File
     {
         if (MFA_VERIFY(std::filesystem::exists(path)))
 		{
-            std::ifstream file(path, std::ios::binary);
-			std::string line{};
-			
-            /*std::string data {};
-            while (std::getline(file, line))
-			{
-                data += line;
-			}*/
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
             std::shared_ptr<Blob> blob = nullptr;
             if (file.good())
             {
-                std::vector<uint8_t> data((
-                    std::istreambuf_iterator<char>(file)),
-                    (std::istreambuf_iterator<char>())
-                );
-
-                blob = Memory::Alloc(data.data(), data.size());
+                // Reads straight into the blob instead of growing a temporary buffer
+                auto const fileSize = static_cast<size_t>(file.tellg());
+                file.seekg(0, std::ios::beg);
+                blob = Memory::AllocSize(fileSize);
+                file.read(reinterpret_cast<char *>(blob->Ptr()), static_cast<std::streamsize>(fileSize));
+                if (file.good() == false)
+                {
+                    MFA_LOG_WARN("Failed to read %s", path.c_str());
+                    blob = nullptr;
+                }
             }
 
             file.close();
@@ -39,4 +50,130 @@ namespace MFA::File
         }
         return nullptr;
     }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Returns nullptr when the platform cannot map the file
+    static std::shared_ptr<Blob> MapFile(std::string const & path)
+    {
+#if defined(__PLATFORM_WIN__)
+        auto const file = CreateFileA(
+            path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr
+        );
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        void * memory = nullptr;
+        LARGE_INTEGER fileSize{};
+        if (GetFileSizeEx(file, &fileSize) != 0 && fileSize.QuadPart > 0)
+        {
+            auto const mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+            if (mapping != nullptr)
+            {
+                memory = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+                // The view keeps the mapping alive
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+
+        if (memory == nullptr)
+        {
+            return nullptr;
+        }
+
+        return Memory::View(
+            Alias{static_cast<uint8_t *>(memory), static_cast<size_t>(fileSize.QuadPart)},
+            std::shared_ptr<void const>(memory, [](void const * memory)->void
+            {
+                UnmapViewOfFile(memory);
+            })
+        );
+#else
+        auto const file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            return nullptr;
+        }
+
+        void * memory = MAP_FAILED;
+        struct stat fileStat{};
+        if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            memory = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        }
+        // The mapping stays valid after the descriptor is closed
+        close(file);
+
+        if (memory == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        auto const fileSize = static_cast<size_t>(fileStat.st_size);
+        // Importers parse the whole file from front to back
+        madvise(memory, fileSize, MADV_SEQUENTIAL);
+
+        return Memory::View(
+            Alias{static_cast<uint8_t *>(memory), fileSize},
+            std::shared_ptr<void const>(memory, [fileSize](void const * memory)->void
+            {
+                munmap(const_cast<void *>(memory), fileSize);
+            })
+        );
+#endif
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    std::shared_ptr<Blob> Map(std::string const & path)
+    {
+        if (MFA_VERIFY(std::filesystem::exists(path)) == false)
+        {
+            return nullptr;
+        }
+        auto blob = MapFile(path);
+        if (blob == nullptr)
+        {
+            blob = Read(path);
+        }
+        return blob;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool Write(std::string const & path, BaseBlob const & data)
+    {
+        auto const parentPath = std::filesystem::path(path).parent_path();
+        if (parentPath.empty() == false)
+        {
+            std::error_code errorCode{};
+            std::filesystem::create_directories(parentPath, errorCode);
+            if (errorCode)
+            {
+                MFA_LOG_WARN("Failed to create directory %s", parentPath.string().c_str());
+                return false;
+            }
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (file.good() == false)
+        {
+            MFA_LOG_WARN("Failed to open %s for writing", path.c_str());
+            return false;
+        }
+
+        file.write(reinterpret_cast<char const *>(data.Ptr()), static_cast<std::streamsize>(data.Len()));
+        file.close();
+
+        return file.good();
+    }
 }
\ No newline at end of file
@@ -7,4 +7,12 @@
 namespace MFA::File
 {
     std::shared_ptr<Blob> Read(std::string const & path);
+
+    // Maps the file into memory instead of reading it, the returned blob is a view that unmaps the file when
+    // it is destroyed. Pages are copy on write, so changing the memory never touches the file.
+    // Falls back to Read when the file cannot be mapped.
+    std::shared_ptr<Blob> Map(std::string const & path);
+
+    // Creates the parent directories if needed, returns false on failure
+    bool Write(std::string const & path, BaseBlob const & data);
 }
\ No newline at end of file
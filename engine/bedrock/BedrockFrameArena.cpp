@@ -0,0 +1,206 @@
+#include "BedrockFrameArena.hpp"
+
+#include "BedrockAssert.hpp"
+
+#include <new>
+
+namespace MFA
+{
+
+    // Blocks are aligned for anything that is put into a frame, including simd data
+    static constexpr size_t BlockAlignment = 64;
+    static constexpr size_t FirstBlockSize = 64 * 1024;
+
+    //-------------------------------------------------------------------------------------------------
+
+    FrameArena::ThreadArena::ThreadArena(std::atomic<uint64_t> const & frameNumber)
+        : _frameNumber(frameNumber)
+        , _lastFrameNumber(frameNumber.load(std::memory_order_relaxed))
+    {}
+
+    //-------------------------------------------------------------------------------------------------
+
+    FrameArena::ThreadArena::~ThreadArena()
+    {
+        for (auto const & block : _blocks)
+        {
+            ::operator delete(block.memory, std::align_val_t{BlockAlignment});
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    size_t FrameArena::ThreadArena::Capacity() const noexcept
+    {
+        return _capacity.load(std::memory_order_relaxed);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void * FrameArena::ThreadArena::do_allocate(size_t const bytes, size_t const alignment)
+    {
+        MFA_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= BlockAlignment);
+
+        auto const frameNumber = _frameNumber.load(std::memory_order_acquire);
+        if (frameNumber != _lastFrameNumber)
+        {
+            _lastFrameNumber = frameNumber;
+            Rewind();
+        }
+
+        while (true)
+        {
+            if (_blockIndex < _blocks.size())
+            {
+                auto const & block = _blocks[_blockIndex];
+                auto const alignedOffset = (_offset + alignment - 1) & ~(alignment - 1);
+                if (alignedOffset + bytes <= block.size)
+                {
+                    _offset = alignedOffset + bytes;
+                    return block.memory + alignedOffset;
+                }
+                if (_blockIndex + 1 < _blocks.size())
+                {
+                    ++_blockIndex;
+                    _offset = 0;
+                    continue;
+                }
+            }
+            AddBlock(bytes);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Everything is released at once when the frame ends
+    void FrameArena::ThreadArena::do_deallocate(void *, size_t, size_t)
+    {}
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool FrameArena::ThreadArena::do_is_equal(memory_resource const & other) const noexcept
+    {
+        return this == &other;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void FrameArena::ThreadArena::Rewind()
+    {
+        if (_blocks.size() > 1)
+        {
+            size_t totalSize = 0;
+            for (auto const & block : _blocks)
+            {
+                totalSize += block.size;
+                ::operator delete(block.memory, std::align_val_t{BlockAlignment});
+            }
+            _blocks.clear();
+            _capacity.store(0, std::memory_order_relaxed);
+            AddBlock(totalSize);
+        }
+        _blockIndex = 0;
+        _offset = 0;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void FrameArena::ThreadArena::AddBlock(size_t const minimumSize)
+    {
+        auto size = _blocks.empty() ? FirstBlockSize : _blocks.back().size * 2;
+        while (size < minimumSize)
+        {
+            size *= 2;
+        }
+        auto * memory = static_cast<std::byte *>(::operator new(size, std::align_val_t{BlockAlignment}));
+        _blocks.emplace_back(Block{.memory = memory, .size = size});
+        _blockIndex = _blocks.size() - 1;
+        _offset = 0;
+        _capacity.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    FrameArena & FrameArena::Instance()
+    {
+        // Containers of static objects can point into the arena, so it is created on first use and lives until exit
+        static FrameArena instance{};
+        return instance;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    FrameArena::FrameArena() = default;
+
+    //-------------------------------------------------------------------------------------------------
+
+    FrameArena::~FrameArena() = default;
+
+    //-------------------------------------------------------------------------------------------------
+
+    std::pmr::memory_resource * FrameArena::Resource()
+    {
+        struct ThreadArenaHandle
+        {
+            ~ThreadArenaHandle()
+            {
+                if (threadArena != nullptr)
+                {
+                    FrameArena::Instance().Release(threadArena);
+                }
+            }
+
+            ThreadArena * threadArena = nullptr;
+        };
+        // Only Instance can create an arena, so one handle per thread is enough and it belongs to that arena
+        MFA_ASSERT(this == &Instance());
+        static thread_local ThreadArenaHandle handle{};
+
+        if (handle.threadArena == nullptr)
+        {
+            std::lock_guard lock{ _threadArenaMutex };
+            if (_freeThreadArenas.empty() == false)
+            {
+                handle.threadArena = _freeThreadArenas.back();
+                _freeThreadArenas.pop_back();
+            }
+            else
+            {
+                handle.threadArena = _threadArenas.emplace_back(std::make_unique<ThreadArena>(_frameNumber)).get();
+            }
+        }
+        return handle.threadArena;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void FrameArena::Release(ThreadArena * threadArena)
+    {
+        MFA_ASSERT(threadArena != nullptr);
+        std::lock_guard lock{ _threadArenaMutex };
+        _freeThreadArenas.emplace_back(threadArena);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void FrameArena::EndFrame()
+    {
+        _frameNumber.fetch_add(1, std::memory_order_release);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    size_t FrameArena::Capacity() const
+    {
+        std::lock_guard lock{ _threadArenaMutex };
+        size_t capacity = 0;
+        for (auto const & threadArena : _threadArenas)
+        {
+            capacity += threadArena->Capacity();
+        }
+        return capacity;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace MFA
+{
+    // Linear allocator for data that only lives until the end of the frame.
+    // Every thread bumps a pointer inside its own sub-arena, so allocating never locks and freeing does nothing.
+    // EndFrame only advances the frame number. Each thread rewinds its sub-arena on its first allocation of the new
+    // frame, so no thread writes into the memory of another. A sub-arena that needed more than one block is merged
+    // into a single block of the total size when it rewinds, which means steady frames do not reach the heap.
+    class FrameArena
+    {
+    public:
+
+        // Memory resource of a single thread, only the owner thread may use it
+        class ThreadArena final : public std::pmr::memory_resource
+        {
+        public:
+
+            explicit ThreadArena(std::atomic<uint64_t> const & frameNumber);
+
+            ~ThreadArena() override;
+
+            ThreadArena(ThreadArena const &) noexcept = delete;
+            ThreadArena(ThreadArena &&) noexcept = delete;
+            ThreadArena & operator = (ThreadArena const &) noexcept = delete;
+            ThreadArena & operator = (ThreadArena &&) noexcept = delete;
+
+            [[nodiscard]]
+            size_t Capacity() const noexcept;
+
+        protected:
+
+            void * do_allocate(size_t bytes, size_t alignment) override;
+
+            void do_deallocate(void * pointer, size_t bytes, size_t alignment) override;
+
+            [[nodiscard]]
+            bool do_is_equal(memory_resource const & other) const noexcept override;
+
+        private:
+
+            struct Block
+            {
+                std::byte * memory = nullptr;
+                size_t size = 0;
+            };
+
+            void Rewind();
+
+            void AddBlock(size_t minimumSize);
+
+            std::atomic<uint64_t> const & _frameNumber;
+            uint64_t _lastFrameNumber = 0;
+
+            std::vector<Block> _blocks{};
+            size_t _blockIndex = 0;
+            size_t _offset = 0;
+            std::atomic<size_t> _capacity = 0;
+        };
+
+        // The only arena of the process, every thread keeps a single handle to its sub-arena of it
+        [[nodiscard]]
+        static FrameArena & Instance();
+
+        ~FrameArena();
+
+        FrameArena(FrameArena const &) noexcept = delete;
+        FrameArena(FrameArena &&) noexcept = delete;
+        FrameArena & operator = (FrameArena const &) noexcept = delete;
+        FrameArena & operator = (FrameArena &&) noexcept = delete;
+
+        // Sub-arena of the calling thread, memory from it is valid until the next EndFrame
+        [[nodiscard]]
+        std::pmr::memory_resource * Resource();
+
+        // Has to be called once per frame when no frame memory is in use anymore
+        void EndFrame();
+
+        // Bytes reserved by every thread together
+        [[nodiscard]]
+        size_t Capacity() const;
+
+        template<typename T>
+        [[nodiscard]]
+        std::pmr::vector<T> Vector(size_t const capacity = 0)
+        {
+            std::pmr::vector<T> vector{Resource()};
+            vector.reserve(capacity);
+            return vector;
+        }
+
+    private:
+
+        explicit FrameArena();
+
+        // Gives the sub-arena of an exiting thread to the next new thread
+        void Release(ThreadArena * threadArena);
+
+        std::atomic<uint64_t> _frameNumber = 0;
+
+        // Sub-arenas are kept until the end of the program
+        std::vector<std::unique_ptr<ThreadArena>> _threadArenas{};
+        std::vector<ThreadArena *> _freeThreadArenas{};
+        mutable std::mutex _threadArenaMutex{};
+    };
+}
@@ -0,0 +1,147 @@
+#include "BedrockMemory.hpp"
+
+#include <array>
+#include <mutex>
+#include <new>
+
+namespace MFA::Memory
+{
+
+    static constexpr size_t Alignment = 64;
+    // Blocks are rounded up to 64 bytes, 128 bytes, ... 1 MB
+    static constexpr size_t SmallestBlockSize = 64;
+    static constexpr size_t SizeClassCount = 15;
+    // Each size class keeps at most this many bytes, the rest goes back to the heap
+    static constexpr size_t MaxPooledBytesPerClass = 4 * 1024 * 1024;
+
+    //-------------------------------------------------------------------------------------------------
+
+    namespace
+    {
+        struct FreeBlock
+        {
+            FreeBlock * next = nullptr;
+        };
+
+        // Blobs are usually released by another thread than the one that allocated them, so the lists are shared
+        struct SizeClass
+        {
+            std::mutex mutex{};
+            FreeBlock * head = nullptr;
+            size_t count = 0;
+        };
+
+        struct Pool
+        {
+            ~Pool()
+            {
+                for (size_t sizeClass = 0; sizeClass < SizeClassCount; ++sizeClass)
+                {
+                    auto & freeList = sizeClasses[sizeClass];
+                    while (freeList.head != nullptr)
+                    {
+                        auto * block = freeList.head;
+                        freeList.head = block->next;
+                        ::operator delete(block, std::align_val_t{Alignment});
+                    }
+                }
+            }
+
+            std::array<SizeClass, SizeClassCount> sizeClasses{};
+        };
+
+        // Created on first use, so it is destroyed after the static objects that hold blobs
+        Pool & GetPool()
+        {
+            static Pool pool{};
+            return pool;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Returns SizeClassCount for blocks that are too large to be pooled
+    static size_t SizeClassOf(size_t const len)
+    {
+        size_t sizeClass = 0;
+        size_t classSize = SmallestBlockSize;
+        while (classSize < len && sizeClass < SizeClassCount)
+        {
+            classSize <<= 1;
+            ++sizeClass;
+        }
+        return sizeClass;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void * Allocate(size_t const len)
+    {
+        if (len == 0)
+        {
+            return nullptr;
+        }
+
+        auto const sizeClass = SizeClassOf(len);
+        if (sizeClass >= SizeClassCount)
+        {
+            return ::operator new(len, std::align_val_t{Alignment});
+        }
+
+        auto & freeList = GetPool().sizeClasses[sizeClass];
+        {
+            std::lock_guard lock{ freeList.mutex };
+            if (freeList.head != nullptr)
+            {
+                auto * block = freeList.head;
+                freeList.head = block->next;
+                --freeList.count;
+                return block;
+            }
+        }
+        return ::operator new(SmallestBlockSize << sizeClass, std::align_val_t{Alignment});
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void Free(void * ptr, size_t const len) noexcept
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+
+        auto const sizeClass = SizeClassOf(len);
+        if (sizeClass < SizeClassCount)
+        {
+            auto & freeList = GetPool().sizeClasses[sizeClass];
+            auto const maxCount = MaxPooledBytesPerClass / (SmallestBlockSize << sizeClass);
+            std::lock_guard lock{ freeList.mutex };
+            if (freeList.count < maxCount)
+            {
+                freeList.head = new (ptr) FreeBlock{freeList.head};
+                ++freeList.count;
+                return;
+            }
+        }
+        ::operator delete(ptr, std::align_val_t{Alignment});
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    size_t PooledBytes()
+    {
+        size_t pooledBytes = 0;
+        auto & pool = GetPool();
+        for (size_t sizeClass = 0; sizeClass < SizeClassCount; ++sizeClass)
+        {
+            auto & freeList = pool.sizeClasses[sizeClass];
+            std::lock_guard lock{ freeList.mutex };
+            pooledBytes += freeList.count * (SmallestBlockSize << sizeClass);
+        }
+        return pooledBytes;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
@@ -79,20 +79,35 @@ namespace MFA
         ~Alias() = default;
     };
 
+    namespace Memory
+    {
+        // Every block is 64 byte aligned. Blocks up to 1 MB are rounded up to a power of two and recycled
+        // through a free list of their size class, larger ones go straight to the heap.
+        [[nodiscard]]
+        void * Allocate(size_t len);
+
+        // len has to be the same value that was passed to Allocate
+        void Free(void * ptr, size_t len) noexcept;
+
+        // Bytes that are kept in the free lists
+        [[nodiscard]]
+        size_t PooledBytes();
+    }
+
     class Blob : public BaseBlob
     {
     public:
 
     	explicit Blob(size_t const len)
     	{
-            _ptr = new uint8_t[len];
+            _ptr = static_cast<uint8_t *>(Memory::Allocate(len));
             _len = len;
     	}
 
         explicit Blob(BaseBlob const & blob)
         {
             _len = blob.Len();
-            _ptr = new uint8_t[_len];
+            _ptr = static_cast<uint8_t *>(Memory::Allocate(_len));
             std::memcpy(_ptr, blob.Ptr(), _len);
         }
 
@@ -101,7 +116,7 @@ namespace MFA
         explicit Blob(T * ptr, size_t const count)
     	{
             _len = sizeof(T) * count;
-            _ptr = new uint8_t[_len];
+            _ptr = static_cast<uint8_t *>(Memory::Allocate(_len));
             std::memcpy(_ptr, ptr, _len);
     	}
 
@@ -109,19 +124,52 @@ namespace MFA
         explicit Blob(T const & data)
         {
             _len = sizeof(T);
-            _ptr = new uint8_t[_len];
+            _ptr = static_cast<uint8_t *>(Memory::Allocate(_len));
             std::memcpy(_ptr, &data, _len);
         }
 
+        // View of memory that the blob does not own, nothing is copied. The owner is kept alive as long as the blob
+        // and is responsible for releasing the memory. Without an owner, the caller has to keep the memory valid.
+        explicit Blob(BaseBlob const & memory, std::shared_ptr<void const> owner)
+            : _owner(std::move(owner))
+            , _isView(true)
+        {
+            _ptr = memory.Ptr();
+            _len = memory.Len();
+        }
+
         ~Blob()
     	{
-            std::free(_ptr);
+            if (_isView == false)
+            {
+                Memory::Free(_ptr, _len);
+            }
     	}
 
+        // Copies the memory, also when the other blob is a view
+        Blob(Blob const & blob)
+            : Blob(static_cast<BaseBlob const &>(blob))
+        {}
+
+        Blob(Blob &&) noexcept = delete;
+        Blob & operator = (Blob const &) noexcept = delete;
+        Blob & operator = (Blob &&) noexcept = delete;
+
+        [[nodiscard]]
+        bool IsView() const
+        {
+            return _isView;
+        }
+
         operator Alias() const {
             return Alias(_ptr, _len);
         }
 
+    private:
+
+        std::shared_ptr<void const> _owner{};
+        bool _isView = false;
+
     };
 
     namespace Memory
@@ -143,7 +191,14 @@ namespace MFA
         [[nodiscard]]
         inline std::unique_ptr<Blob> Alloc(T const & data)
         {
-            return std::make_unique<Blob>(data, true);
+            return std::make_unique<Blob>(data);
+        }
+
+        // Wraps memory of a mapped file, the frame arena or a third party library without copying it
+        [[nodiscard]]
+        inline std::unique_ptr<Blob> View(BaseBlob const & memory, std::shared_ptr<void const> owner = nullptr)
+        {
+            return std::make_unique<Blob>(memory, std::move(owner));
         }
 
         template<uint32_t Count, typename B, typename A>
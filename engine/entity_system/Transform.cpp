@@ -5,19 +5,94 @@
 
 namespace MFA
 {
-    
+
+	//-------------------------------------------------------------------------------------------------
+
+    Transform::Transform()
+		: mId(TransformSystem::Instance().Create(this))
+	{}
+
+	//-------------------------------------------------------------------------------------------------
+
+	Transform::~Transform()
+	{
+		if (mId != TransformSystem::InvalidId)
+		{
+			TransformSystem::Instance().Destroy(mId);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	Transform::Transform(Transform const & other)
+		: mId(TransformSystem::Instance().Create(this))
+	{
+		CopyLocalValues(other);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	Transform::Transform(Transform && other) noexcept
+		: mId(other.mId)
+		, mLocalRotation(other.mLocalRotation)
+	{
+		other.mId = TransformSystem::InvalidId;
+		if (mId != TransformSystem::InvalidId)
+		{
+			TransformSystem::Instance().SetOwner(mId, this);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	Transform & Transform::operator=(Transform const & other)
+	{
+		if (this != &other)
+		{
+			if (mId == TransformSystem::InvalidId)
+			{
+				mId = TransformSystem::Instance().Create(this);
+			}
+			CopyLocalValues(other);
+		}
+		return *this;
+	}
+
 	//-------------------------------------------------------------------------------------------------
 
-    Transform::Transform() = default;
-	
+	Transform & Transform::operator=(Transform && other) noexcept
+	{
+		if (this != &other)
+		{
+			auto & system = TransformSystem::Instance();
+			if (mId != TransformSystem::InvalidId)
+			{
+				system.Destroy(mId);
+			}
+			mId = other.mId;
+			mLocalRotation = other.mLocalRotation;
+			other.mId = TransformSystem::InvalidId;
+			if (mId != TransformSystem::InvalidId)
+			{
+				system.SetOwner(mId, this);
+			}
+			// The version of the node can be equal to the one that our caches were built with
+			mGlobalPositionVersion = 0;
+			mGlobalRotationVersion = 0;
+			mForwardVersion = 0;
+			mRightVersion = 0;
+			mUpVersion = 0;
+		}
+		return *this;
+	}
+
 	//-------------------------------------------------------------------------------------------------
 
 	bool Transform::SetEulerAngles(glm::vec3 const & eulerAngles)
 	{
-		mIsLocalTransformDirty |= mLocalRotation.SetEulerAngles(eulerAngles);
-		if (mIsLocalTransformDirty == true)
+		if (mLocalRotation.SetEulerAngles(eulerAngles) == true)
 		{
-			SetGlobalTransformDirty();
+			TransformSystem::Instance().SetLocalRotation(mId, mLocalRotation.GetQuaternion());
 			return true;
 		}
 		return false;
@@ -27,10 +102,9 @@ namespace MFA
 
 	bool Transform::SetLocalQuaternion(glm::quat const & quaternion)
 	{
-		mIsLocalTransformDirty |= mLocalRotation.SetQuaternion(quaternion);
-		if (mIsLocalTransformDirty == true)
+		if (mLocalRotation.SetQuaternion(quaternion) == true)
 		{
-			SetGlobalTransformDirty();
+			TransformSystem::Instance().SetLocalRotation(mId, mLocalRotation.GetQuaternion());
 			return true;
 		}
 		return false;
@@ -38,90 +112,147 @@ namespace MFA
 
 	//-------------------------------------------------------------------------------------------------
 
-	glm::mat4 const& Transform::LocalTransform()
+	bool Transform::SetLocalPosition(glm::vec3 const & position)
 	{
-		if (mIsLocalTransformDirty == true)
+		auto & system = TransformSystem::Instance();
+		if (system.LocalPosition(mId) == position)
 		{
-			mLocalTransform = mLocalExtraTransform * 
-				Math::Translate(mLocalPosition) * 
-				mLocalRotation.GetMatrix() *
-				Math::Scale(mLocalScale);
-
-			mIsLocalTransformDirty = false;
+			return false;
 		}
-		return mLocalTransform;
+		system.SetLocalPosition(mId, position);
+		return true;
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	glm::mat4 const& Transform::GlobalTransform()
+	glm::vec3 const & Transform::GetLocalPosition() const
 	{
-		if (mGlobalTransformDirty == true)
-		{
-			auto const & localTransform = LocalTransform();
-			mGlobalTransform = glm::identity<glm::mat4>();
-			if (mParent != nullptr)
-			{
-				mGlobalTransform *= mParent->GlobalTransform();
-			}
-			mGlobalTransform *= localTransform;
-			mGlobalTransformDirty = false;
-		}
-		return mGlobalTransform;
+		return TransformSystem::Instance().LocalPosition(mId);
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	Transform * Transform::Parent() const
+	bool Transform::SetLocalRotation(Rotation const & rotation)
 	{
-		return mParent;
+		if (mLocalRotation == rotation)
+		{
+			return false;
+		}
+		mLocalRotation = rotation;
+		TransformSystem::Instance().SetLocalRotation(mId, mLocalRotation.GetQuaternion());
+		return true;
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	std::set<Transform*> const& Transform::Children()
+	Rotation const & Transform::GetLocalRotation() const
 	{
-		return mChildren;
+		return mLocalRotation;
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	void Transform::SetParent(Transform* parent)
+	bool Transform::SetLocalScale(glm::vec3 const & scale)
 	{
-		if (mParent == parent)
+		auto & system = TransformSystem::Instance();
+		if (system.LocalScale(mId) == scale)
 		{
-			return;
+			return false;
 		}
-		if (mParent != nullptr)
+		system.SetLocalScale(mId, scale);
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::vec3 const & Transform::GetLocalScale() const
+	{
+		return TransformSystem::Instance().LocalScale(mId);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool Transform::SetLocalExtraTransform(glm::mat4 const & extraTransform)
+	{
+		auto & system = TransformSystem::Instance();
+		if (system.LocalExtraTransform(mId) == extraTransform)
 		{
-			mParent->RemoveChild(this);
+			return false;
 		}
-		mParent = parent;
-		mGlobalTransformDirty = true;
-		if (mParent != nullptr)
+		system.SetLocalExtraTransform(mId, extraTransform);
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::mat4 const & Transform::GetLocalExtraTransform() const
+	{
+		return TransformSystem::Instance().LocalExtraTransform(mId);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::mat4 const& Transform::LocalTransform() const
+	{
+		return TransformSystem::Instance().LocalTransform(mId);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::mat4 const& Transform::GlobalTransform() const
+	{
+		return TransformSystem::Instance().GlobalTransform(mId);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void Transform::UpdateNow()
+	{
+		TransformSystem::Instance().UpdateNow(mId);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	Transform * Transform::Parent() const
+	{
+		auto const & system = TransformSystem::Instance();
+		auto const parentId = system.Parent(mId);
+		return parentId != TransformSystem::InvalidId ? system.Owner(parentId) : nullptr;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::vector<Transform*> Transform::Children() const
+	{
+		auto const & system = TransformSystem::Instance();
+		std::vector<Transform *> children{};
+		for (auto id = system.FirstChild(mId); id != TransformSystem::InvalidId; id = system.NextSibling(id))
 		{
-			mParent->AddChild(this);
+			children.emplace_back(system.Owner(id));
 		}
+		return children;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void Transform::SetParent(Transform* parent)
+	{
+		TransformSystem::Instance().SetParent(mId, parent != nullptr ? parent->mId : TransformSystem::InvalidId);
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
 	void Transform::AddChild(Transform* child)
 	{
-		if (mChildren.contains(child) == false)
-		{
-			mChildren.emplace(child);
-			child->SetParent(this);
-		}
+		child->SetParent(this);
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
 	void Transform::RemoveChild(Transform* child)
 	{
-		if (mChildren.contains(child) == true)
+		if (child->Parent() == this)
 		{
-			mChildren.erase(child);
 			child->SetParent(nullptr);
 		}
 	}
@@ -130,10 +261,13 @@ namespace MFA
 
 	glm::vec3 const & Transform::Forward()
 	{
-		if (mForwardDirty == true)
+		UpdateNow();
+		auto const & globalTransform = GlobalTransform();
+		auto const version = TransformSystem::Instance().Version(mId);
+		if (mForwardVersion != version)
 		{
-			mForward = glm::normalize(GlobalTransform() * Math::ForwardVec4W0);
-			mForwardDirty = false;
+			mForward = glm::normalize(globalTransform * Math::ForwardVec4W0);
+			mForwardVersion = version;
 		}
 		return mForward;
 	}
@@ -142,10 +276,13 @@ namespace MFA
 
 	glm::vec3 const & Transform::Right()
 	{
-		if (mRightDirty == true)
+		UpdateNow();
+		auto const & globalTransform = GlobalTransform();
+		auto const version = TransformSystem::Instance().Version(mId);
+		if (mRightVersion != version)
 		{
-			mRight = glm::normalize(GlobalTransform() * Math::RightVec4W0);
-			mRightDirty = false;
+			mRight = glm::normalize(globalTransform * Math::RightVec4W0);
+			mRightVersion = version;
 		}
 		return mRight;
 	}
@@ -154,10 +291,13 @@ namespace MFA
 
 	glm::vec3 const & Transform::Up()
 	{
-		if (mUpDirty == true)
+		UpdateNow();
+		auto const & globalTransform = GlobalTransform();
+		auto const version = TransformSystem::Instance().Version(mId);
+		if (mUpVersion != version)
 		{
-			mUp = glm::normalize(GlobalTransform() * Math::UpVec4W0);
-			mUpDirty = false;
+			mUp = glm::normalize(globalTransform * Math::UpVec4W0);
+			mUpVersion = version;
 		}
 		return mUp;
 	}
@@ -166,10 +306,13 @@ namespace MFA
 
 	glm::vec3 const & Transform::GlobalPosition()
 	{
-		if (mGlobalPositionDirty == true)
+		UpdateNow();
+		auto const & globalTransform = GlobalTransform();
+		auto const version = TransformSystem::Instance().Version(mId);
+		if (mGlobalPositionVersion != version)
 		{
-			mGlobalPosition = GlobalTransform() * glm::vec4{0.0, 0.0, 0.0, 1.0f};
-			mGlobalPositionDirty = false;
+			mGlobalPosition = globalTransform * glm::vec4{0.0, 0.0, 0.0, 1.0f};
+			mGlobalPositionVersion = version;
 		}
 		return mGlobalPosition;
 	}
@@ -178,68 +321,59 @@ namespace MFA
 
 	Rotation const & Transform::GlobalRotation()
 	{
-		if (mGlobalRotationDirty == true)
+		auto const & forward = Forward();
+		auto const version = TransformSystem::Instance().Version(mId);
+		if (mGlobalRotationVersion != version)
 		{
-			mGlobalRotation.SetQuaternion(glm::quatLookAt(Forward(),Math::UpVec3));
-			mGlobalRotationDirty = false;
+			mGlobalRotation.SetQuaternion(glm::quatLookAt(forward, Math::UpVec3));
+			mGlobalRotationVersion = version;
 		}
 		return mGlobalRotation;
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	void Transform::DebugUI()
+	TransformSystem::Id Transform::GetId() const
 	{
-		bool isDirty = false;
+		return mId;
+	}
 
-		if(ImGui::InputFloat3("Position",reinterpret_cast<float *>(&mLocalPosition)))
+	//-------------------------------------------------------------------------------------------------
+
+	void Transform::DebugUI()
+	{
+		auto position = GetLocalPosition();
+		if(ImGui::InputFloat3("Position",reinterpret_cast<float *>(&position)))
 		{
-			isDirty = true;
+			SetLocalPosition(position);
 		}
 
 		{
 			glm::vec3 eulerAngles = mLocalRotation.GetEulerAngles();
 			if(ImGui::InputFloat3("Euler angles",reinterpret_cast<float *>(&eulerAngles)))
 			{
-				mLocalRotation.SetEulerAngles(eulerAngles);
-				isDirty = true;
+				SetEulerAngles(eulerAngles);
 			}
 		}
 
-		if (ImGui::InputFloat3("Scale", reinterpret_cast<float *>(&mLocalScale)))
+		auto scale = GetLocalScale();
+		if (ImGui::InputFloat3("Scale", reinterpret_cast<float *>(&scale)))
 		{
-			isDirty = true;
+			SetLocalScale(scale);
 		}
-
-		if (isDirty == true)
-		{
-			SetLocalTransformDirty();
-		}
-	}
-
-	//-------------------------------------------------------------------------------------------------
-
-	void Transform::SetLocalTransformDirty()
-	{
-		mIsLocalTransformDirty = true;
-		SetGlobalTransformDirty();
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	void Transform::SetGlobalTransformDirty()
+	void Transform::CopyLocalValues(Transform const & other)
 	{
-		mGlobalTransformDirty = true;
-		mGlobalPositionDirty = true;
-		mGlobalRotationDirty = true;
-		mForwardDirty = true;
-		mUpDirty = true;
-		mRightDirty = true;
-
-		for(auto * child : mChildren)
-		{
-			child->SetGlobalTransformDirty();
-		}
+		auto & system = TransformSystem::Instance();
+		system.SetLocalPosition(mId, other.GetLocalPosition());
+		system.SetLocalScale(mId, other.GetLocalScale());
+		system.SetLocalExtraTransform(mId, other.GetLocalExtraTransform());
+		mLocalRotation = other.mLocalRotation;
+		system.SetLocalRotation(mId, mLocalRotation.GetQuaternion());
+		system.SetParent(mId, system.Parent(other.mId));
 	}
 
 	//-------------------------------------------------------------------------------------------------
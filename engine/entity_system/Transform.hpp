@@ -2,11 +2,14 @@
 
 #include "BedrockRotation.hpp"
 #include "BedrockCommon.hpp"
+#include "TransformSystem.hpp"
 
-#include <set>
+#include <vector>
 
 namespace MFA
 {
+    // Handle to a node of the TransformSystem. Local and global matrices live in the system, the handle only keeps
+    // the editable rotation and the values that are derived from the global matrix.
     class Transform
     {
 
@@ -14,20 +17,54 @@ namespace MFA
 
         explicit Transform();
 
+        ~Transform();
+
+        // Copies the local values and the parent, children stay with the original transform
+        Transform(Transform const & other);
+        Transform(Transform && other) noexcept;
+        Transform & operator = (Transform const & other);
+        Transform & operator = (Transform && other) noexcept;
+
         bool SetEulerAngles(glm::vec3 const & eulerAngles);
 
         bool SetLocalQuaternion(glm::quat const & quaternion);
 
+        bool SetLocalPosition(glm::vec3 const & position);
+
+        [[nodiscard]]
+        glm::vec3 const & GetLocalPosition() const;
+
+        bool SetLocalRotation(Rotation const & rotation);
+
+        [[nodiscard]]
+        Rotation const & GetLocalRotation() const;
+
+        bool SetLocalScale(glm::vec3 const & scale);
+
+        [[nodiscard]]
+        glm::vec3 const & GetLocalScale() const;
+
+        bool SetLocalExtraTransform(glm::mat4 const & extraTransform);
+
         [[nodiscard]]
-        glm::mat4 const& LocalTransform();
+        glm::mat4 const & GetLocalExtraTransform() const;
+
+        // Safe to call from the render jobs, the matrices are computed by TransformSystem::Update. Throws when the
+        // node changed after that, gameplay code that moved it in the same frame calls UpdateNow first
+        [[nodiscard]]
+        glm::mat4 const& LocalTransform() const;
 
     	[[nodiscard]]
-    	glm::mat4 const& GlobalTransform();
+    	glm::mat4 const& GlobalTransform() const;
+
+        // For gameplay code that reads the matrices back in the frame that it changed them, see TransformSystem
+        void UpdateNow();
 
         [[nodiscard]]
         Transform * Parent() const;
 
-        std::set<Transform *> const & Children();
+        [[nodiscard]]
+        std::vector<Transform *> Children() const;
 
         void SetParent(Transform * parent);
 
@@ -35,6 +72,7 @@ namespace MFA
 
         void RemoveChild(Transform * child);
 
+        // Gameplay getters, they bring the node up to date first
     	[[nodiscard]]
         glm::vec3 const & Forward();
 
@@ -50,48 +88,35 @@ namespace MFA
         [[nodiscard]]
         Rotation const & GlobalRotation();
 
+        [[nodiscard]]
+        TransformSystem::Id GetId() const;
+
         void DebugUI();
 
     private:
 
-        void SetLocalTransformDirty();
-
-        void SetGlobalTransformDirty();
-
-        // Local position
-        MFA_VARIABLE3(LocalPosition, glm::vec3, glm::vec3(0.0f, 0.0f, 0.0f), SetLocalTransformDirty, m)
-        // Local rotation
-    	MFA_VARIABLE3(LocalRotation, Rotation, Rotation(glm::identity<glm::quat>()), SetLocalTransformDirty, m)
-        // Local scale
-    	MFA_VARIABLE3(LocalScale, glm::vec3, glm::vec3(1.0f, 1.0f, 1.0f), SetLocalTransformDirty, m)
-        // Local extra transform
-    	MFA_VARIABLE3(LocalExtraTransform, glm::mat4, glm::identity<glm::mat4>(), SetLocalTransformDirty, m)
-        
-        bool mIsLocalTransformDirty = true;
-        bool mGlobalTransformDirty = true;
+        void CopyLocalValues(Transform const & other);
 
-        // Note: Do not use this variable directly use the function instead
-        glm::mat4 mLocalTransform{};
-        // Note: Do not use this variable directly use the function instead
-        glm::mat4 mGlobalTransform{};
+        TransformSystem::Id mId = TransformSystem::InvalidId;
 
-        std::set<Transform *> mChildren{};
-        Transform * mParent = nullptr;
+        // Kept next to the handle so that euler angles survive round trips through the quaternion
+        Rotation mLocalRotation{glm::identity<glm::quat>()};
 
+        // Derived values are recomputed when the version of the node changes
         glm::vec3 mGlobalPosition{};
-        bool mGlobalPositionDirty = true;
+        uint32_t mGlobalPositionVersion = 0;
 
         Rotation mGlobalRotation{};
-        bool mGlobalRotationDirty = true;
+        uint32_t mGlobalRotationVersion = 0;
 
         glm::vec3 mForward{};
-        bool mForwardDirty = true;
+        uint32_t mForwardVersion = 0;
 
         glm::vec3 mRight{};
-        bool mRightDirty = true;
+        uint32_t mRightVersion = 0;
 
         glm::vec3 mUp{};
-        bool mUpDirty = true;
+        uint32_t mUpVersion = 0;
 
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,584 @@
+#include "TransformSystem.hpp"
+
+#include "BedrockAssert.hpp"
+#include "BedrockMath.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+
+namespace MFA
+{
+
+	// Below this number of nodes per level the cost of waking up the workers is higher than the work itself
+	static constexpr int ParallelThreshold = 256;
+
+#ifdef MFA_DEBUG
+	// Fails when a second thread starts to write while another one is still writing
+	class WriterCheck
+	{
+	public:
+
+		explicit WriterCheck(std::atomic<bool> & isWriting)
+			: mIsWriting(isWriting)
+		{
+			MFA_ASSERT(mIsWriting.exchange(true, std::memory_order_acquire) == false);
+		}
+
+		~WriterCheck()
+		{
+			mIsWriting.store(false, std::memory_order_release);
+		}
+
+		WriterCheck(WriterCheck const &) noexcept = delete;
+		WriterCheck(WriterCheck &&) noexcept = delete;
+		WriterCheck & operator = (WriterCheck const &) noexcept = delete;
+		WriterCheck & operator = (WriterCheck &&) noexcept = delete;
+
+	private:
+
+		std::atomic<bool> & mIsWriting;
+	};
+
+#define TRANSFORM_WRITER_CHECK() WriterCheck const writerCheck{mIsWriting};
+#else
+#define TRANSFORM_WRITER_CHECK()
+#endif
+
+	//-------------------------------------------------------------------------------------------------
+
+	TransformSystem & TransformSystem::Instance()
+	{
+		// Transforms can be members of objects with any lifetime, so the system is created on first use
+		static TransformSystem instance{};
+		return instance;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	TransformSystem::TransformSystem() = default;
+
+	//-------------------------------------------------------------------------------------------------
+
+	TransformSystem::~TransformSystem() = default;
+
+	//-------------------------------------------------------------------------------------------------
+
+	TransformSystem::Id TransformSystem::Create(Transform * owner)
+	{
+		TRANSFORM_WRITER_CHECK()
+
+		Id id = InvalidId;
+		if (mFreeIds.empty() == false)
+		{
+			id = mFreeIds.back();
+			mFreeIds.pop_back();
+		}
+		else
+		{
+			id = static_cast<Id>(mPositions.size());
+			mPositions.emplace_back();
+			mRotations.emplace_back();
+			mScales.emplace_back();
+			mExtraTransforms.emplace_back();
+			mLocalTransforms.emplace_back();
+			mGlobalTransforms.emplace_back();
+			mParents.emplace_back();
+			mLocalDirty.emplace_back();
+			mVersions.emplace_back(0);
+			mParentVersions.emplace_back();
+			mDepths.emplace_back();
+			mOwners.emplace_back();
+			mFirstChildren.emplace_back();
+			mNextSiblings.emplace_back();
+			mPrevSiblings.emplace_back();
+			mAlive.emplace_back();
+			mOrderIndices.emplace_back();
+		}
+
+		mPositions[id] = glm::vec3{0.0f, 0.0f, 0.0f};
+		mRotations[id] = glm::identity<glm::quat>();
+		mScales[id] = glm::vec3{1.0f, 1.0f, 1.0f};
+		mExtraTransforms[id] = glm::identity<glm::mat4>();
+		mLocalTransforms[id] = glm::identity<glm::mat4>();
+		mGlobalTransforms[id] = glm::identity<glm::mat4>();
+		mParents[id] = InvalidId;
+		// A reused id starts over, nothing may mistake the new node for the old one
+		mVersions[id] = 0;
+		mParentVersions[id] = 0;
+		mDepths[id] = 0;
+		mOwners[id] = owner;
+		mFirstChildren[id] = InvalidId;
+		mNextSiblings[id] = InvalidId;
+		mPrevSiblings[id] = InvalidId;
+		mAlive[id] = 1;
+
+		mOrderDirty = true;
+		MarkDirty(id);
+
+		return id;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::Destroy(Id const id)
+	{
+		TRANSFORM_WRITER_CHECK()
+
+		MFA_ASSERT(id >= 0 && id < static_cast<Id>(mAlive.size()) && mAlive[id] == 1);
+
+		// Children become roots instead of pointing to a dead node
+		Id childId = mFirstChildren[id];
+		while (childId != InvalidId)
+		{
+			auto const nextId = mNextSiblings[childId];
+			mParents[childId] = InvalidId;
+			mNextSiblings[childId] = InvalidId;
+			mPrevSiblings[childId] = InvalidId;
+			MarkDirty(childId);
+			childId = nextId;
+		}
+		mFirstChildren[id] = InvalidId;
+		UnlinkFromParent(id);
+
+		mAlive[id] = 0;
+		mOwners[id] = nullptr;
+		mParents[id] = InvalidId;
+		mFreeIds.emplace_back(id);
+		mOrderDirty = true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::SetOwner(Id const id, Transform * owner)
+	{
+		TRANSFORM_WRITER_CHECK()
+		mOwners[id] = owner;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	Transform * TransformSystem::Owner(Id const id) const
+	{
+		return mOwners[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::SetParent(Id const id, Id const parent)
+	{
+		TRANSFORM_WRITER_CHECK()
+
+		if (mParents[id] == parent)
+		{
+			return;
+		}
+#ifdef MFA_DEBUG
+		for (Id ancestor = parent; ancestor != InvalidId; ancestor = mParents[ancestor])
+		{
+			MFA_ASSERT(ancestor != id);
+		}
+#endif
+		UnlinkFromParent(id);
+		mParents[id] = parent;
+		LinkToParent(id);
+		mOrderDirty = true;
+		MarkDirty(id);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	TransformSystem::Id TransformSystem::Parent(Id const id) const
+	{
+		return mParents[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	TransformSystem::Id TransformSystem::FirstChild(Id const id) const
+	{
+		return mFirstChildren[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	TransformSystem::Id TransformSystem::NextSibling(Id const id) const
+	{
+		return mNextSiblings[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::SetLocalPosition(Id const id, glm::vec3 const & position)
+	{
+		TRANSFORM_WRITER_CHECK()
+		mPositions[id] = position;
+		MarkDirty(id);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::SetLocalRotation(Id const id, glm::quat const & rotation)
+	{
+		TRANSFORM_WRITER_CHECK()
+		mRotations[id] = rotation;
+		MarkDirty(id);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::SetLocalScale(Id const id, glm::vec3 const & scale)
+	{
+		TRANSFORM_WRITER_CHECK()
+		mScales[id] = scale;
+		MarkDirty(id);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::SetLocalExtraTransform(Id const id, glm::mat4 const & extraTransform)
+	{
+		TRANSFORM_WRITER_CHECK()
+		mExtraTransforms[id] = extraTransform;
+		MarkDirty(id);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::vec3 const & TransformSystem::LocalPosition(Id const id) const
+	{
+		return mPositions[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::quat const & TransformSystem::LocalRotation(Id const id) const
+	{
+		return mRotations[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::vec3 const & TransformSystem::LocalScale(Id const id) const
+	{
+		return mScales[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::mat4 const & TransformSystem::LocalExtraTransform(Id const id) const
+	{
+		return mExtraTransforms[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::mat4 const & TransformSystem::LocalTransform(Id const id) const
+	{
+		// Checked in every build, a release build would otherwise draw the matrix of the previous frame
+		if (mLocalDirty[id] == 1)
+		{
+			MFA_CRASH("Local transform of a node is read before Update or UpdateNow");
+		}
+		return mLocalTransforms[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	glm::mat4 const & TransformSystem::GlobalTransform(Id const id) const
+	{
+		if (IsUpToDate(id) == false)
+		{
+			MFA_CRASH("Global transform of a node is read before Update or UpdateNow");
+		}
+		return mGlobalTransforms[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::UpdateNow(Id const id)
+	{
+		TRANSFORM_WRITER_CHECK()
+		UpdateChain(id);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	uint32_t TransformSystem::Version(Id const id) const
+	{
+		return mVersions[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::Update()
+	{
+		TRANSFORM_WRITER_CHECK()
+
+		if (mOrderDirty == true)
+		{
+			RebuildOrder();
+		}
+
+		// Range of the level above that was visited, its children are visited on this level
+		int visitedBegin = 0;
+		int visitedEnd = 0;
+		auto const levelCount = static_cast<int>(mDirtyRanges.size());
+		for (int depth = 0; depth < levelCount; ++depth)
+		{
+			auto & [dirtyBegin, dirtyEnd] = mDirtyRanges[depth];
+			int begin = dirtyBegin;
+			int end = dirtyEnd;
+			if (visitedBegin < visitedEnd)
+			{
+				auto const childBegin = mChildOffsets[visitedBegin];
+				auto const childEnd = mChildOffsets[visitedEnd];
+				if (childBegin < childEnd && begin < end)
+				{
+					begin = std::min(begin, childBegin);
+					end = std::max(end, childEnd);
+				}
+				else if (childBegin < childEnd)
+				{
+					begin = childBegin;
+					end = childEnd;
+				}
+			}
+			dirtyBegin = 0;
+			dirtyEnd = 0;
+
+			visitedBegin = begin;
+			visitedEnd = end;
+			if (begin < end)
+			{
+				UpdateRange(begin, end);
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	int TransformSystem::Count() const
+	{
+		return static_cast<int>(mAlive.size() - mFreeIds.size());
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	int TransformSystem::Capacity() const
+	{
+		return static_cast<int>(mAlive.size());
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::MarkDirty(Id const id)
+	{
+		mLocalDirty[id] = 1;
+		// Positions are only valid while the order is, otherwise the rebuild marks every level anyway
+		if (mOrderDirty == true)
+		{
+			return;
+		}
+		auto const index = mOrderIndices[id];
+		auto & [begin, end] = mDirtyRanges[mDepths[id]];
+		if (begin < end)
+		{
+			begin = std::min(begin, index);
+			end = std::max(end, index + 1);
+		}
+		else
+		{
+			begin = index;
+			end = index + 1;
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::RebuildOrder()
+	{
+		auto const nodeCount = static_cast<Id>(mAlive.size());
+
+		// Breadth first, the roots come first and every node appends its children
+		mOrder.clear();
+		mOrder.reserve(nodeCount);
+		for (Id id = 0; id < nodeCount; ++id)
+		{
+			if (mAlive[id] == 1 && mParents[id] == InvalidId)
+			{
+				mDepths[id] = 0;
+				mOrder.emplace_back(id);
+			}
+		}
+
+		mLevelOffsets.assign(1, 0);
+		mChildOffsets.clear();
+		mChildOffsets.reserve(nodeCount + 1);
+		for (int index = 0; index < static_cast<int>(mOrder.size()); ++index)
+		{
+			auto const id = mOrder[index];
+			mOrderIndices[id] = index;
+			if (mDepths[id] == static_cast<int>(mLevelOffsets.size()))
+			{
+				mLevelOffsets.emplace_back(index);
+			}
+			mChildOffsets.emplace_back(static_cast<int>(mOrder.size()));
+			for (Id childId = mFirstChildren[id]; childId != InvalidId; childId = mNextSiblings[childId])
+			{
+				mDepths[childId] = mDepths[id] + 1;
+				mOrder.emplace_back(childId);
+			}
+		}
+		auto const orderSize = static_cast<int>(mOrder.size());
+		mChildOffsets.emplace_back(orderSize);
+		if (orderSize > 0)
+		{
+			mLevelOffsets.emplace_back(orderSize);
+		}
+		else
+		{
+			mLevelOffsets.clear();
+		}
+
+		// Every node has to be visited once after the order changed
+		auto const levelCount = std::max(static_cast<int>(mLevelOffsets.size()) - 1, 0);
+		mDirtyRanges.resize(levelCount);
+		for (int depth = 0; depth < levelCount; ++depth)
+		{
+			mDirtyRanges[depth] = {mLevelOffsets[depth], mLevelOffsets[depth + 1]};
+		}
+
+		mOrderDirty = false;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::UpdateRange(int const begin, int const end)
+	{
+		// Nodes of the same level never depend on each other
+		auto const updateRange = [this](int const rangeBegin, int const rangeEnd)->void
+		{
+			for (int i = rangeBegin; i < rangeEnd; ++i)
+			{
+				UpdateNode(mOrder[i]);
+			}
+		};
+		auto * jobSystem = JobSystem::Instance;
+		if (jobSystem != nullptr && end - begin >= ParallelThreshold)
+		{
+			jobSystem->ParallelFor(begin, end, updateRange, ParallelThreshold / 4);
+		}
+		else
+		{
+			updateRange(begin, end);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::UpdateChain(Id const id)
+	{
+		auto const parent = mParents[id];
+		if (parent != InvalidId)
+		{
+			UpdateChain(parent);
+		}
+		UpdateNode(id);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::UpdateNode(Id const id)
+	{
+		auto const parent = mParents[id];
+		bool const parentChanged = parent != InvalidId && mParentVersions[id] != mVersions[parent];
+		if (mLocalDirty[id] == 0 && parentChanged == false)
+		{
+			return;
+		}
+
+		if (mLocalDirty[id] == 1)
+		{
+			mLocalTransforms[id] = mExtraTransforms[id] *
+				Math::Translate(mPositions[id]) *
+				glm::toMat4(mRotations[id]) *
+				Math::Scale(mScales[id]);
+			mLocalDirty[id] = 0;
+		}
+
+		if (parent != InvalidId)
+		{
+			mGlobalTransforms[id] = mGlobalTransforms[parent] * mLocalTransforms[id];
+			mParentVersions[id] = mVersions[parent];
+		}
+		else
+		{
+			mGlobalTransforms[id] = mLocalTransforms[id];
+		}
+		++mVersions[id];
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool TransformSystem::IsUpToDate(Id const id) const
+	{
+		for (Id nodeId = id; nodeId != InvalidId; nodeId = mParents[nodeId])
+		{
+			auto const parent = mParents[nodeId];
+			if (mLocalDirty[nodeId] == 1 || (parent != InvalidId && mParentVersions[nodeId] != mVersions[parent]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::LinkToParent(Id const id)
+	{
+		auto const parent = mParents[id];
+		if (parent == InvalidId)
+		{
+			return;
+		}
+		auto const nextId = mFirstChildren[parent];
+		mNextSiblings[id] = nextId;
+		mPrevSiblings[id] = InvalidId;
+		if (nextId != InvalidId)
+		{
+			mPrevSiblings[nextId] = id;
+		}
+		mFirstChildren[parent] = id;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void TransformSystem::UnlinkFromParent(Id const id)
+	{
+		auto const parent = mParents[id];
+		if (parent == InvalidId)
+		{
+			return;
+		}
+		auto const prevId = mPrevSiblings[id];
+		auto const nextId = mNextSiblings[id];
+		if (prevId != InvalidId)
+		{
+			mNextSiblings[prevId] = nextId;
+		}
+		else
+		{
+			mFirstChildren[parent] = nextId;
+		}
+		if (nextId != InvalidId)
+		{
+			mPrevSiblings[nextId] = prevId;
+		}
+		mNextSiblings[id] = InvalidId;
+		mPrevSiblings[id] = InvalidId;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+}
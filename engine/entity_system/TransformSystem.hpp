@@ -0,0 +1,173 @@
+#pragma once
+
+#include "BedrockPlatforms.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace MFA
+{
+    class Transform;
+
+    // Owns the data of every transform in structure of arrays form. Nodes are sorted breadth first, so a linear walk
+    // over the order always visits parents before their children and the children of a range of nodes are a range
+    // of the next level. World matrices are recomputed in a single pass per frame that only visits the dirty ranges
+    // of every level and the ranges below them, instead of recursively invalidating each child.
+    // There is a single writer at a time: every call that changes the system, including UpdateNow and Update, has to
+    // be ordered against every other call, for example by the edges of the update graph. Reads can run in parallel
+    // once Update has run. Debug builds catch two writers that overlap.
+    class TransformSystem
+    {
+    public:
+
+        using Id = int;
+
+        inline static constexpr Id InvalidId = -1;
+
+        [[nodiscard]]
+        static TransformSystem & Instance();
+
+        explicit TransformSystem();
+
+        ~TransformSystem();
+
+        TransformSystem(TransformSystem const &) noexcept = delete;
+        TransformSystem(TransformSystem &&) noexcept = delete;
+        TransformSystem & operator = (TransformSystem const &) noexcept = delete;
+        TransformSystem & operator = (TransformSystem &&) noexcept = delete;
+
+        [[nodiscard]]
+        Id Create(Transform * owner);
+
+        void Destroy(Id id);
+
+        void SetOwner(Id id, Transform * owner);
+
+        [[nodiscard]]
+        Transform * Owner(Id id) const;
+
+        void SetParent(Id id, Id parent);
+
+        [[nodiscard]]
+        Id Parent(Id id) const;
+
+        // Children of a node form a linked list, InvalidId ends it
+        [[nodiscard]]
+        Id FirstChild(Id id) const;
+
+        [[nodiscard]]
+        Id NextSibling(Id id) const;
+
+        void SetLocalPosition(Id id, glm::vec3 const & position);
+
+        void SetLocalRotation(Id id, glm::quat const & rotation);
+
+        void SetLocalScale(Id id, glm::vec3 const & scale);
+
+        void SetLocalExtraTransform(Id id, glm::mat4 const & extraTransform);
+
+        [[nodiscard]]
+        glm::vec3 const & LocalPosition(Id id) const;
+
+        [[nodiscard]]
+        glm::quat const & LocalRotation(Id id) const;
+
+        [[nodiscard]]
+        glm::vec3 const & LocalScale(Id id) const;
+
+        [[nodiscard]]
+        glm::mat4 const & LocalExtraTransform(Id id) const;
+
+        // Reads never modify the system, so the render jobs can call them in parallel once Update has run.
+        // Reading a node that changed since then throws, call UpdateNow first. References stay valid until the next
+        // call to Create
+        [[nodiscard]]
+        glm::mat4 const & LocalTransform(Id id) const;
+
+        [[nodiscard]]
+        glm::mat4 const & GlobalTransform(Id id) const;
+
+        // Brings the node and its ancestors up to date before the next Update, for gameplay code that reads back an
+        // object that it moved in the same frame. Writes the shared arrays, so it must not run next to the readers.
+        void UpdateNow(Id id);
+
+        // Increases every time the global transform of the node is recomputed. Useful for caching derived values.
+        [[nodiscard]]
+        uint32_t Version(Id id) const;
+
+        // Recomputes the world matrix of every node whose own transform or one of its ancestors changed.
+        // Should be called once per frame after the gameplay update.
+        void Update();
+
+        [[nodiscard]]
+        int Count() const;
+
+        // Ids are always smaller than the capacity, dead ids have no owner
+        [[nodiscard]]
+        int Capacity() const;
+
+    private:
+
+        void MarkDirty(Id id);
+
+        void RebuildOrder();
+
+        void UpdateRange(int begin, int end);
+
+        void UpdateChain(Id id);
+
+        void UpdateNode(Id id);
+
+        [[nodiscard]]
+        bool IsUpToDate(Id id) const;
+
+        void LinkToParent(Id id);
+
+        void UnlinkFromParent(Id id);
+
+        // Hot data
+        std::vector<glm::vec3> mPositions{};
+        std::vector<glm::quat> mRotations{};
+        std::vector<glm::vec3> mScales{};
+        std::vector<glm::mat4> mExtraTransforms{};
+        std::vector<glm::mat4> mLocalTransforms{};
+        std::vector<glm::mat4> mGlobalTransforms{};
+        std::vector<Id> mParents{};
+        std::vector<uint8_t> mLocalDirty{};
+        // A node is out of date when its parent version differs from the one that it was computed with
+        std::vector<uint32_t> mVersions{};
+        std::vector<uint32_t> mParentVersions{};
+
+        // Cold data
+        std::vector<int> mDepths{};
+        std::vector<Transform *> mOwners{};
+        std::vector<Id> mFirstChildren{};
+        std::vector<Id> mNextSiblings{};
+        std::vector<Id> mPrevSiblings{};
+        std::vector<uint8_t> mAlive{};
+        std::vector<Id> mFreeIds{};
+        // Position of every alive node in mOrder
+        std::vector<int> mOrderIndices{};
+
+        // Alive ids in breadth first order, mLevelOffsets[d] is the first entry of depth d.
+        // The children of mOrder[i] are the entries in [mChildOffsets[i], mChildOffsets[i + 1]).
+        std::vector<Id> mOrder{};
+        std::vector<int> mLevelOffsets{};
+        std::vector<int> mChildOffsets{};
+        bool mOrderDirty = false;
+
+        // Range of mOrder per level that holds every node that changed since the last update, empty when begin >= end
+        std::vector<std::pair<int, int>> mDirtyRanges{};
+
+#ifdef MFA_DEBUG
+        std::atomic<bool> mIsWriting = false;
+#endif
+
+    };
+}
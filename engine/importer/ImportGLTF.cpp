@@ -1,9 +1,12 @@
 #include "ImportGLTF.hpp"
 
 #include "AssetTexture.hpp"
+#include "ImportMeshCache.hpp"
 #include "ImportTexture.hpp"
 #include "BedrockAssert.hpp"
+#include "BedrockFile.hpp"
 #include "BedrockMath.hpp"
+#include "JobSystem.hpp"
 
 #include "json.hpp"
 #include "stb_image.h"
@@ -186,7 +189,7 @@ namespace MFA::Importer
                     MFA_ASSERT(gltfNode.translation.size() == 3);
                     glm::dvec3 translate{};
                     Memory::Copy<3>(translate, gltfNode.translation.data());
-                    node.transform.SetLocalPosition(translate);
+                    node.transform.position = translate;
                 }
 
                 if (gltfNode.rotation.empty() == false)
@@ -194,7 +197,7 @@ namespace MFA::Importer
                     MFA_ASSERT(gltfNode.rotation.size() == 4);
                     glm::dquat rotation{};
                 	Memory::Copy<4>(rotation, gltfNode.rotation.data());
-                    node.transform.SetLocalQuaternion(rotation);
+                    node.transform.rotation = rotation;
                 }
 
                 if (gltfNode.scale.empty() == false)
@@ -202,14 +205,14 @@ namespace MFA::Importer
                     MFA_ASSERT(gltfNode.scale.size() == 3);
                     glm::dvec3 scale{};
                 	Memory::Copy<3>(scale, gltfNode.scale.data());
-                    node.transform.SetLocalScale(scale);
+                    node.transform.scale = scale;
                 }
 
                 if (gltfNode.matrix.empty() == false)
                 {
                     glm::dmat4 extraTransform{};
                     Memory::Copy<16>(extraTransform, gltfNode.matrix.data());
-                    node.transform.SetLocalExtraTransform(extraTransform);
+                    node.transform.extraTransform = extraTransform;
                 }
             }
         }
@@ -1113,11 +1116,56 @@ namespace MFA::Importer
 
 	//-------------------------------------------------------------------------------------------------
 
+    static std::shared_ptr<Model> GLTF_createModel(
+        std::string const & path,
+        std::shared_ptr<Mesh> mesh,
+        std::vector<std::string> const & imageUris
+    )
+    {
+        std::string const directoryPath = std::filesystem::path(path).parent_path().string();
+
+        std::vector<std::shared_ptr<AS::Texture>> textures{};
+        for (auto const & imageUri : imageUris)
+        {
+            auto const imagePath = directoryPath + "/" + imageUri;
+            auto const extension = std::filesystem::path(imagePath).extension().string();
+
+            std::shared_ptr<AS::Texture> texture{};
+            if (extension == ".png" || extension == ".jpg" || extension == ".jpeg")
+            {
+                texture = Importer::UncompressedImage(imagePath);
+            }
+            else
+            {
+                MFA_ASSERT(false);
+            }
+
+            MFA_ASSERT(texture != nullptr);
+            textures.emplace_back(texture);
+        }
+
+        auto model = std::make_shared<Model>();
+        model->mesh = std::move(mesh);
+        model->textures = std::move(textures);
+        return model;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     std::shared_ptr<MFA::Importer::Model> GLTF_Model(std::string const& path)
     {
         std::shared_ptr<Model> model = nullptr;
         if (MFA_VERIFY(path.empty() == false))
         {
+            {// Cooked mesh
+                std::vector<std::string> imageUris{};
+                auto mesh = MeshCache::Load(path, imageUris);
+                if (mesh != nullptr)
+                {
+                    return GLTF_createModel(path, mesh, imageUris);
+                }
+            }
+
             namespace TG = tinygltf;
             TG::TinyGLTF loader{};
             std::string error;
@@ -1125,25 +1173,38 @@ namespace MFA::Importer
             TG::Model gltfModel{};
 
             auto const extension = std::filesystem::path(path).extension().string();
+            // External buffers and images are resolved relative to the model
+            auto const baseDirectory = std::filesystem::path(path).parent_path().string();
+
+            // The loader parses straight from the mapped file, the mapping is released once the model is parsed
+            auto const file = File::Map(path);
 
             bool success = false;
 
-            if (extension == ".gltf")
+            if (file == nullptr)
             {
-                success = loader.LoadASCIIFromFile(
+                error = "Failed to open " + path;
+            }
+            else if (extension == ".gltf")
+            {
+                success = loader.LoadASCIIFromString(
                     &gltfModel,
                     &error,
                     &warning,
-                    path
+                    reinterpret_cast<char const *>(file->Ptr()),
+                    static_cast<unsigned int>(file->Len()),
+                    baseDirectory
                 );
             }
             else if (extension == ".glb")
             {
-                success = loader.LoadBinaryFromFile(
+                success = loader.LoadBinaryFromMemory(
                     &gltfModel,
                     &error,
                     &warning,
-                    path
+                    file->Ptr(),
+                    static_cast<unsigned int>(file->Len()),
+                    baseDirectory
                 );
             }
             else
@@ -1189,29 +1250,24 @@ namespace MFA::Importer
                 GLTF_extractAnimations(gltfModel, mesh.get());
                 mesh->FinalizeData();
 
-                std::vector<std::shared_ptr<AS::Texture>> textures{};
-                for (size_t i = 0; i < textureRefs.size(); ++i)
+                std::vector<std::string> imageUris{};
+                for (auto const & textureRef : textureRefs)
                 {
-                    auto const path = textureRefs[i].relativePath;
-                    auto const extension = std::filesystem::path(path).extension().string();
+                    imageUris.emplace_back(textureRef.gltfName);
+                }
 
-                    std::shared_ptr<AS::Texture> texture{};
-                    if (extension == ".png" || extension == ".jpg" || extension == ".jpeg")
-                    {
-                        texture = Importer::UncompressedImage(path);
-                    }
-                    else
+                // Buffers in separate files are part of the mesh as well, images are loaded from the model directory
+                std::vector<std::string> dependencies{};
+                for (auto const & buffer : gltfModel.buffers)
+                {
+                    if (buffer.uri.empty() == false && buffer.uri.rfind("data:", 0) != 0)
                     {
-                        MFA_ASSERT(false);
+                        dependencies.emplace_back(buffer.uri);
                     }
-
-                    MFA_ASSERT(texture != nullptr);
-                    textures.emplace_back(texture);
                 }
+                MeshCache::Cook(path, dependencies, *mesh, imageUris);
 
-                model = std::make_shared<Model>();
-                model->mesh = mesh;
-                model->textures = textures;
+                model = GLTF_createModel(path, mesh, imageUris);
             }
         }
         return model;
@@ -1219,4 +1275,13 @@ namespace MFA::Importer
 
     //-------------------------------------------------------------------------------------------------
 
+    // The path is taken by value because the coroutine outlives the caller's arguments
+    Task<std::shared_ptr<Model>> GLTF_ModelAsync(std::string path)
+    {
+        co_await JobSystem::Schedule();
+        co_return GLTF_Model(path);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "AssetGLTF_Mesh.hpp"
 #include "AssetGLTF_Model.hpp"
+#include "Task.hpp"
 
 #include <memory>
 #include <string>
@@ -21,4 +22,7 @@ namespace MFA::Importer
     using Skin = AS::GLTF::Skin;
 
     std::shared_ptr<Model> GLTF_Model(std::string const& path);
+
+    // Imports the model on a worker of the job system. Await several of them with WhenAll to load them in parallel.
+    Task<std::shared_ptr<Model>> GLTF_ModelAsync(std::string path);
 }
@@ -0,0 +1,753 @@
+#include "ImportMeshCache.hpp"
+
+#include "BedrockAssert.hpp"
+#include "BedrockFile.hpp"
+#include "BedrockLog.hpp"
+#include "BedrockString.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
+namespace MFA::Importer::MeshCache
+{
+
+    using Mesh = AS::GLTF::Mesh;
+    using Vertex = AS::GLTF::Vertex;
+    using Index = AS::GLTF::Index;
+    using Primitive = AS::GLTF::Primitive;
+    using Animation = AS::GLTF::Animation;
+    using NodeTransform = AS::GLTF::NodeTransform;
+
+    static constexpr char const * MeshCacheDirectory = "./cache/meshes";
+
+    static constexpr uint32_t CookedMeshMagic = 0x4853454D;    // "MESH"
+    // Has to be increased whenever the layout of the cooked file changes
+    static constexpr uint32_t CookedMeshVersion = 2;
+    // Vertices and indices start on their own cache line
+    static constexpr uint64_t SectionAlignment = 64;
+
+    static constexpr uint64_t HashOffsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t HashPrime = 1099511628211ull;
+
+    //-------------------------------------------------------------------------------------------------
+
+    namespace
+    {
+        struct Header
+        {
+            uint32_t magic = CookedMeshMagic;
+            uint32_t version = CookedMeshVersion;
+            // Contents of the sources, only hashed again when their sizes or modification times change
+            uint64_t sourceHash = 0;
+            // Sizes and modification times of the sources
+            uint64_t sourceStamp = 0;
+            // A cooked file of a build with other vertex or primitive types is not loaded
+            uint32_t vertexSize = sizeof(Vertex);
+            uint32_t indexSize = sizeof(Index);
+            uint32_t primitiveSize = sizeof(Primitive);
+            uint32_t vertexCount = 0;
+            uint32_t indexCount = 0;
+            uint32_t padding = 0;
+            uint64_t tableOffset = 0;
+            uint64_t tableSize = 0;
+            uint64_t verticesOffset = 0;
+            uint64_t indicesOffset = 0;
+        };
+
+        // Tables are a flat stream of values, arrays and strings are prefixed with their count
+        class TableWriter
+        {
+        public:
+
+            template<typename T>
+            void Write(T const & value)
+            {
+                static_assert(std::is_trivially_copyable_v<T>);
+                auto const * bytes = reinterpret_cast<uint8_t const *>(&value);
+                mData.insert(mData.end(), bytes, bytes + sizeof(T));
+            }
+
+            template<typename T>
+            void Write(std::vector<T> const & values)
+            {
+                static_assert(std::is_trivially_copyable_v<T>);
+                Write(static_cast<uint32_t>(values.size()));
+                auto const * bytes = reinterpret_cast<uint8_t const *>(values.data());
+                mData.insert(mData.end(), bytes, bytes + values.size() * sizeof(T));
+            }
+
+            void Write(std::string const & value)
+            {
+                Write(static_cast<uint32_t>(value.size()));
+                mData.insert(mData.end(), value.begin(), value.end());
+            }
+
+            void Write(std::vector<std::string> const & values)
+            {
+                Write(static_cast<uint32_t>(values.size()));
+                for (auto const & value : values)
+                {
+                    Write(value);
+                }
+            }
+
+            [[nodiscard]]
+            std::vector<uint8_t> const & Data() const
+            {
+                return mData;
+            }
+
+        private:
+
+            std::vector<uint8_t> mData{};
+        };
+
+        // Every read fails instead of running past the end of a truncated or corrupted table
+        class TableReader
+        {
+        public:
+
+            explicit TableReader(uint8_t const * data, size_t const size)
+                : mData(data)
+                , mRemaining(size)
+            {}
+
+            template<typename T>
+            [[nodiscard]]
+            bool Read(T & outValue)
+            {
+                static_assert(std::is_trivially_copyable_v<T>);
+                if (mRemaining < sizeof(T))
+                {
+                    return false;
+                }
+                std::memcpy(&outValue, mData, sizeof(T));
+                Skip(sizeof(T));
+                return true;
+            }
+
+            template<typename T>
+            [[nodiscard]]
+            bool Read(std::vector<T> & outValues)
+            {
+                static_assert(std::is_trivially_copyable_v<T>);
+                uint32_t count = 0;
+                if (Read(count) == false || mRemaining / sizeof(T) < count)
+                {
+                    return false;
+                }
+                outValues.resize(count);
+                if (count > 0)
+                {
+                    std::memcpy(outValues.data(), mData, count * sizeof(T));
+                    Skip(count * sizeof(T));
+                }
+                return true;
+            }
+
+            [[nodiscard]]
+            bool Read(std::string & outValue)
+            {
+                uint32_t length = 0;
+                if (Read(length) == false || mRemaining < length)
+                {
+                    return false;
+                }
+                outValue.assign(reinterpret_cast<char const *>(mData), length);
+                Skip(length);
+                return true;
+            }
+
+            [[nodiscard]]
+            bool Read(std::vector<std::string> & outValues)
+            {
+                uint32_t count = 0;
+                if (Read(count) == false)
+                {
+                    return false;
+                }
+                outValues.clear();
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    if (Read(outValues.emplace_back()) == false)
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+        private:
+
+            void Skip(size_t const size)
+            {
+                mData += size;
+                mRemaining -= size;
+            }
+
+            uint8_t const * mData = nullptr;
+            size_t mRemaining = 0;
+        };
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // FNV-1a over 8 byte words, folded after each word so that high bits reach the low ones.
+    // Source files can be large, they are only hashed when their stamp changed.
+    static uint64_t HashBytes(uint8_t const * data, size_t const size, uint64_t hash)
+    {
+        size_t offset = 0;
+        for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, data + offset, sizeof(uint64_t));
+            hash = (hash ^ word) * HashPrime;
+            hash ^= hash >> 32;
+        }
+        for (; offset < size; ++offset)
+        {
+            hash = (hash ^ data[offset]) * HashPrime;
+        }
+        return hash;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    static bool HashFile(std::string const & path, uint64_t & hash)
+    {
+        if (std::filesystem::exists(path) == false)
+        {
+            return false;
+        }
+        auto const file = File::Map(path);
+        if (file == nullptr)
+        {
+            return false;
+        }
+        // The size separates files whose contents only differ in trailing zeros
+        hash = (hash ^ file->Len()) * HashPrime;
+        hash = HashBytes(file->Ptr(), file->Len(), hash);
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Returns false if the source or one of its dependencies cannot be read
+    static bool HashSources(
+        std::string const & sourcePath,
+        std::vector<std::string> const & dependencies,
+        uint64_t & outHash
+    )
+    {
+        uint64_t hash = HashOffsetBasis;
+        if (HashFile(sourcePath, hash) == false)
+        {
+            return false;
+        }
+        auto const directory = std::filesystem::path(sourcePath).parent_path();
+        for (auto const & dependency : dependencies)
+        {
+            if (HashFile((directory / dependency).string(), hash) == false)
+            {
+                return false;
+            }
+        }
+        outHash = hash;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    static bool StampFile(std::string const & path, uint64_t & stamp)
+    {
+        std::error_code errorCode{};
+        auto const size = std::filesystem::file_size(path, errorCode);
+        if (errorCode)
+        {
+            return false;
+        }
+        auto const writeTime = std::filesystem::last_write_time(path, errorCode);
+        if (errorCode)
+        {
+            return false;
+        }
+        uint64_t const values[2] {
+            static_cast<uint64_t>(size),
+            static_cast<uint64_t>(writeTime.time_since_epoch().count())
+        };
+        stamp = HashBytes(reinterpret_cast<uint8_t const *>(values), sizeof(values), stamp);
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Same as HashSources but only looks at the metadata of the files, so nothing is read
+    static bool StampSources(
+        std::string const & sourcePath,
+        std::vector<std::string> const & dependencies,
+        uint64_t & outStamp
+    )
+    {
+        uint64_t stamp = HashOffsetBasis;
+        if (StampFile(sourcePath, stamp) == false)
+        {
+            return false;
+        }
+        auto const directory = std::filesystem::path(sourcePath).parent_path();
+        for (auto const & dependency : dependencies)
+        {
+            if (StampFile((directory / dependency).string(), stamp) == false)
+            {
+                return false;
+            }
+        }
+        outStamp = stamp;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Sources that were touched without a change keep their cooked mesh, the new stamp spares the hash next time.
+    // Only the stamp is written in place, a torn write just leads to another hash.
+    static void UpdateStamp(std::string const & cachePath, uint64_t const stamp)
+    {
+        std::fstream file{cachePath, std::ios::binary | std::ios::in | std::ios::out};
+        if (file.is_open() == true)
+        {
+            file.seekp(static_cast<std::streamoff>(offsetof(Header, sourceStamp)));
+            file.write(reinterpret_cast<char const *>(&stamp), sizeof(stamp));
+        }
+        if (file.is_open() == false || file.good() == false)
+        {
+            MFA_LOG_INFO("Failed to update the stamp of %s, the sources are hashed again", cachePath.c_str());
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Every model has a single cooked file, its name comes from the path of the source
+    static std::string CachePath(std::string const & sourcePath)
+    {
+        auto const absolutePath = std::filesystem::absolute(sourcePath).lexically_normal().string();
+        auto const pathHash = HashBytes(
+            reinterpret_cast<uint8_t const *>(absolutePath.data()),
+            absolutePath.size(),
+            HashOffsetBasis
+        );
+        std::string fileName = "";
+        MFA_STRING(
+            fileName,
+            "%s_%016llx.mesh",
+            std::filesystem::path(sourcePath).stem().string().c_str(),
+            static_cast<unsigned long long>(pathHash)
+        );
+        return std::filesystem::path(MeshCacheDirectory).append(fileName).string();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    static uint64_t AlignSection(uint64_t const offset)
+    {
+        return (offset + SectionAlignment - 1) & ~(SectionAlignment - 1);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Feeds the tables into the mesh in the same order as the importer does. Primitives are checked against the
+    // buffers because they are inserted without copying.
+    static bool ReadTables(TableReader & table, Header const & header, Mesh & mesh)
+    {
+        uint64_t nextVertexOffset = 0;
+        uint64_t nextIndexOffset = 0;
+        uint32_t verticesStartingIndex = 0;
+        uint32_t indicesStartingIndex = 0;
+
+        uint32_t subMeshCount = 0;
+        if (table.Read(subMeshCount) == false)
+        {
+            return false;
+        }
+        std::vector<Primitive> primitives{};
+        for (uint32_t subMeshIndex = 0; subMeshIndex < subMeshCount; ++subMeshIndex)
+        {
+            [[maybe_unused]] auto const insertedIndex = mesh.InsertSubMesh();
+            MFA_ASSERT(insertedIndex == subMeshIndex);
+            if (table.Read(primitives) == false)
+            {
+                return false;
+            }
+            for (auto const & primitive : primitives)
+            {
+                if (primitive.vertexCount == 0 ||
+                    primitive.indicesCount == 0 ||
+                    primitive.verticesOffset != nextVertexOffset ||
+                    primitive.indicesOffset != nextIndexOffset ||
+                    primitive.verticesStartingIndex != verticesStartingIndex ||
+                    primitive.indicesStartingIndex != indicesStartingIndex ||
+                    verticesStartingIndex + primitive.vertexCount > header.vertexCount ||
+                    indicesStartingIndex + primitive.indicesCount > header.indexCount)
+                {
+                    return false;
+                }
+                mesh.InsertPrimitive(subMeshIndex, primitive);
+
+                nextVertexOffset += sizeof(Vertex) * primitive.vertexCount;
+                nextIndexOffset += sizeof(Index) * primitive.indicesCount;
+                verticesStartingIndex += primitive.vertexCount;
+                indicesStartingIndex += primitive.indicesCount;
+            }
+        }
+        if (verticesStartingIndex != header.vertexCount || indicesStartingIndex != header.indexCount)
+        {
+            return false;
+        }
+
+        uint32_t nodeCount = 0;
+        if (table.Read(nodeCount) == false || nodeCount == 0)
+        {
+            return false;
+        }
+        // Node skins are checked once the skin count is known
+        int maxSkin = -1;
+        for (uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex)
+        {
+            std::string name{};
+            int subMeshIndex = -1;
+            std::vector<int> children{};
+            int skin = -1;
+            NodeTransform transform{};
+            if (table.Read(name) == false ||
+                table.Read(subMeshIndex) == false ||
+                table.Read(children) == false ||
+                table.Read(skin) == false ||
+                table.Read(transform) == false)
+            {
+                return false;
+            }
+            if (subMeshIndex >= static_cast<int>(subMeshCount) || skin < -1)
+            {
+                return false;
+            }
+            maxSkin = (std::max)(maxSkin, skin);
+            for (auto const child : children)
+            {
+                if (child < 0 || child >= static_cast<int>(nodeCount))
+                {
+                    return false;
+                }
+            }
+
+            auto & node = mesh.InsertNode();
+            node.name = std::move(name);
+            node.subMeshIndex = subMeshIndex;
+            node.children = std::move(children);
+            node.skin = skin;
+            node.transform = transform;
+        }
+
+        uint32_t skinCount = 0;
+        if (table.Read(skinCount) == false || maxSkin >= static_cast<int>(skinCount))
+        {
+            return false;
+        }
+        for (uint32_t skinIndex = 0; skinIndex < skinCount; ++skinIndex)
+        {
+            auto & skin = mesh.InsertSkin();
+            if (table.Read(skin.joints) == false ||
+                table.Read(skin.inverseBindMatrices) == false ||
+                table.Read(skin.skeletonRootNode) == false)
+            {
+                return false;
+            }
+            if (skin.inverseBindMatrices.size() != skin.joints.size() ||
+                skin.skeletonRootNode < -1 ||
+                skin.skeletonRootNode >= static_cast<int>(nodeCount))
+            {
+                return false;
+            }
+            for (auto const joint : skin.joints)
+            {
+                if (joint < 0 || joint >= static_cast<int>(nodeCount))
+                {
+                    return false;
+                }
+            }
+        }
+
+        uint32_t animationCount = 0;
+        if (table.Read(animationCount) == false)
+        {
+            return false;
+        }
+        for (uint32_t animationIndex = 0; animationIndex < animationCount; ++animationIndex)
+        {
+            Animation animation{};
+            uint32_t samplerCount = 0;
+            if (table.Read(animation.name) == false || table.Read(samplerCount) == false)
+            {
+                return false;
+            }
+            for (uint32_t samplerIndex = 0; samplerIndex < samplerCount; ++samplerIndex)
+            {
+                auto & sampler = animation.samplers.emplace_back();
+                if (table.Read(sampler.interpolation) == false || table.Read(sampler.inputAndOutput) == false)
+                {
+                    return false;
+                }
+            }
+            if (table.Read(animation.channels) == false ||
+                table.Read(animation.startTime) == false ||
+                table.Read(animation.endTime) == false ||
+                table.Read(animation.animationDuration) == false)
+            {
+                return false;
+            }
+            for (auto const & channel : animation.channels)
+            {
+                if (channel.nodeIndex >= nodeCount || channel.samplerIndex >= samplerCount)
+                {
+                    return false;
+                }
+            }
+            mesh.InsertAnimation(animation);
+        }
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    std::shared_ptr<Mesh> Load(std::string const & sourcePath, std::vector<std::string> & outImageUris)
+    {
+        auto const cachePath = CachePath(sourcePath);
+        std::error_code errorCode{};
+        auto const fileSize = std::filesystem::file_size(cachePath, errorCode);
+        if (errorCode || fileSize < sizeof(Header))
+        {
+            return nullptr;
+        }
+
+        // Header and tables are read before the file is mapped, so nothing holds the file while its stamp changes
+        std::ifstream stream{cachePath, std::ios::binary};
+        Header header{};
+        if (stream.read(reinterpret_cast<char *>(&header), sizeof(Header)).good() == false)
+        {
+            return nullptr;
+        }
+        if (header.magic != CookedMeshMagic ||
+            header.version != CookedMeshVersion ||
+            header.vertexSize != sizeof(Vertex) ||
+            header.indexSize != sizeof(Index) ||
+            header.primitiveSize != sizeof(Primitive))
+        {
+            MFA_LOG_INFO("Cooked mesh %s was written by another version", cachePath.c_str());
+            return nullptr;
+        }
+
+        uint64_t const verticesSize = static_cast<uint64_t>(header.vertexCount) * sizeof(Vertex);
+        uint64_t const indicesSize = static_cast<uint64_t>(header.indexCount) * sizeof(Index);
+        if (header.vertexCount == 0 ||
+            header.indexCount == 0 ||
+            header.tableSize > fileSize ||
+            header.tableOffset > fileSize - header.tableSize ||
+            header.verticesOffset % SectionAlignment != 0 ||
+            header.verticesOffset + verticesSize > fileSize ||
+            header.indicesOffset % SectionAlignment != 0 ||
+            header.indicesOffset + indicesSize > fileSize)
+        {
+            MFA_LOG_WARN("Cooked mesh %s is corrupted", cachePath.c_str());
+            return nullptr;
+        }
+
+        std::vector<uint8_t> tableData(header.tableSize);
+        stream.seekg(static_cast<std::streamoff>(header.tableOffset));
+        if (stream.read(reinterpret_cast<char *>(tableData.data()), static_cast<std::streamsize>(tableData.size())).good() == false)
+        {
+            MFA_LOG_WARN("Cooked mesh %s is corrupted", cachePath.c_str());
+            return nullptr;
+        }
+        stream.close();
+
+        TableReader table{tableData.data(), tableData.size()};
+
+        std::vector<std::string> dependencies{};
+        if (table.Read(dependencies) == false)
+        {
+            MFA_LOG_WARN("Cooked mesh %s is corrupted", cachePath.c_str());
+            return nullptr;
+        }
+
+        // Sources are only read when their sizes or modification times differ from the cooked ones
+        uint64_t sourceStamp = 0;
+        if (StampSources(sourcePath, dependencies, sourceStamp) == false)
+        {
+            MFA_LOG_INFO("Cooked mesh of %s is out of date", sourcePath.c_str());
+            return nullptr;
+        }
+        if (sourceStamp != header.sourceStamp)
+        {
+            uint64_t sourceHash = 0;
+            if (HashSources(sourcePath, dependencies, sourceHash) == false || sourceHash != header.sourceHash)
+            {
+                MFA_LOG_INFO("Cooked mesh of %s is out of date", sourcePath.c_str());
+                return nullptr;
+            }
+            UpdateStamp(cachePath, sourceStamp);
+            header.sourceStamp = sourceStamp;
+        }
+
+        std::vector<std::string> imageUris{};
+        if (table.Read(imageUris) == false)
+        {
+            MFA_LOG_WARN("Cooked mesh %s is corrupted", cachePath.c_str());
+            return nullptr;
+        }
+
+        // The file may have been cooked again in the meantime, its header has to match the one that was checked
+        auto const file = File::Map(cachePath);
+        if (file == nullptr || file->Len() != fileSize)
+        {
+            return nullptr;
+        }
+        Header mappedHeader{};
+        std::memcpy(&mappedHeader, file->Ptr(), sizeof(Header));
+        mappedHeader.sourceStamp = header.sourceStamp;
+        if (std::memcmp(&mappedHeader, &header, sizeof(Header)) != 0)
+        {
+            MFA_LOG_INFO("Cooked mesh %s changed while it was loaded", cachePath.c_str());
+            return nullptr;
+        }
+
+        // Vertices and indices are used straight from the mapping, the views keep the file mapped
+        auto mesh = std::make_shared<Mesh>(
+            header.vertexCount,
+            header.indexCount,
+            Memory::View(Alias{file->Ptr() + header.verticesOffset, verticesSize}, file),
+            Memory::View(Alias{file->Ptr() + header.indicesOffset, indicesSize}, file)
+        );
+        if (ReadTables(table, header, *mesh) == false)
+        {
+            MFA_LOG_WARN("Cooked mesh %s is corrupted", cachePath.c_str());
+            return nullptr;
+        }
+        mesh->FinalizeData();
+
+        outImageUris = std::move(imageUris);
+        return mesh;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool Cook(
+        std::string const & sourcePath,
+        std::vector<std::string> const & dependencies,
+        Mesh const & mesh,
+        std::vector<std::string> const & imageUris
+    )
+    {
+        uint64_t sourceHash = 0;
+        uint64_t sourceStamp = 0;
+        if (HashSources(sourcePath, dependencies, sourceHash) == false ||
+            StampSources(sourcePath, dependencies, sourceStamp) == false)
+        {
+            MFA_LOG_WARN("Failed to hash the sources of %s, the mesh is not cooked", sourcePath.c_str());
+            return false;
+        }
+
+        auto const & meshData = *mesh.GetMeshData();
+        auto const & vertexData = *mesh.GetVertexData();
+        auto const & indexData = *mesh.GetIndexData();
+        MFA_ASSERT(vertexData.Len() == static_cast<size_t>(mesh.GetVertexCount()) * sizeof(Vertex));
+        MFA_ASSERT(indexData.Len() == static_cast<size_t>(mesh.GetIndexCount()) * sizeof(Index));
+
+        TableWriter table{};
+        table.Write(dependencies);
+        table.Write(imageUris);
+
+        table.Write(static_cast<uint32_t>(meshData.subMeshes.size()));
+        for (auto const & subMesh : meshData.subMeshes)
+        {
+            table.Write(subMesh.primitives);
+        }
+
+        table.Write(static_cast<uint32_t>(meshData.nodes.size()));
+        for (auto const & node : meshData.nodes)
+        {
+            table.Write(node.name);
+            table.Write(node.subMeshIndex);
+            table.Write(node.children);
+            table.Write(node.skin);
+            table.Write(node.transform);
+        }
+
+        table.Write(static_cast<uint32_t>(meshData.skins.size()));
+        for (auto const & skin : meshData.skins)
+        {
+            table.Write(skin.joints);
+            table.Write(skin.inverseBindMatrices);
+            table.Write(skin.skeletonRootNode);
+        }
+
+        table.Write(static_cast<uint32_t>(meshData.animations.size()));
+        for (auto const & animation : meshData.animations)
+        {
+            table.Write(animation.name);
+            table.Write(static_cast<uint32_t>(animation.samplers.size()));
+            for (auto const & sampler : animation.samplers)
+            {
+                table.Write(sampler.interpolation);
+                table.Write(sampler.inputAndOutput);
+            }
+            table.Write(animation.channels);
+            table.Write(animation.startTime);
+            table.Write(animation.endTime);
+            table.Write(animation.animationDuration);
+        }
+
+        Header header{};
+        header.sourceHash = sourceHash;
+        header.sourceStamp = sourceStamp;
+        header.vertexCount = mesh.GetVertexCount();
+        header.indexCount = mesh.GetIndexCount();
+        header.tableOffset = sizeof(Header);
+        header.tableSize = table.Data().size();
+        header.verticesOffset = AlignSection(header.tableOffset + header.tableSize);
+        header.indicesOffset = AlignSection(header.verticesOffset + vertexData.Len());
+
+        auto const cookedFile = Memory::AllocSize(header.indicesOffset + indexData.Len());
+        std::memset(cookedFile->Ptr(), 0, cookedFile->Len());
+        std::memcpy(cookedFile->Ptr(), &header, sizeof(Header));
+        std::memcpy(cookedFile->Ptr() + header.tableOffset, table.Data().data(), header.tableSize);
+        std::memcpy(cookedFile->Ptr() + header.verticesOffset, vertexData.Ptr(), vertexData.Len());
+        std::memcpy(cookedFile->Ptr() + header.indicesOffset, indexData.Ptr(), indexData.Len());
+
+        // Each thread writes its own file, so a half written file is never loaded
+        auto const cachePath = CachePath(sourcePath);
+        std::ostringstream tempPath{};
+        tempPath << cachePath << "." << std::this_thread::get_id() << ".tmp";
+        if (File::Write(tempPath.str(), *cookedFile) == false)
+        {
+            return false;
+        }
+        std::error_code errorCode{};
+        std::filesystem::rename(tempPath.str(), cachePath, errorCode);
+        if (errorCode)
+        {
+            MFA_LOG_WARN("Failed to store the cooked mesh %s", cachePath.c_str());
+            std::filesystem::remove(tempPath.str(), errorCode);
+            return false;
+        }
+
+        MFA_LOG_INFO("Cooked mesh of %s", sourcePath.c_str());
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
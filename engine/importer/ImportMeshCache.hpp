@@ -0,0 +1,32 @@
+#pragma once
+
+#include "AssetGLTF_Mesh.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Cooked meshes are stored on disk in the layout that the engine uses at runtime. Vertices and indices are mapped
+// straight from the cooked file, only the small tables of sub-meshes, nodes, skins and animations are rebuilt.
+// A cooked mesh is ignored once the hash of the source file or of one of its buffers changes. The hash is only
+// computed again when the size or the modification time of one of them differs from the cooked file.
+namespace MFA::Importer::MeshCache
+{
+
+    // Returns nullptr when the model has not been cooked yet or the cooked file is out of date.
+    // outImageUris receives the images of the model, relative to the model directory.
+    std::shared_ptr<AS::GLTF::Mesh> Load(
+        std::string const & sourcePath,
+        std::vector<std::string> & outImageUris
+    );
+
+    // Stores a finalized mesh for the next launch. Dependencies are the files next to the source that the mesh
+    // was built from, relative to the model directory. Returns false if the cooked file could not be written.
+    bool Cook(
+        std::string const & sourcePath,
+        std::vector<std::string> const & dependencies,
+        AS::GLTF::Mesh const & mesh,
+        std::vector<std::string> const & imageUris
+    );
+
+}
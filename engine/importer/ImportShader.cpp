@@ -3,12 +3,37 @@
 #include "BedrockAssert.hpp"
 #include "BedrockLog.hpp"
 #include "BedrockFile.hpp"
+#include "BedrockString.hpp"
+
+#if defined(MFA_SHADERC)
+#include <shaderc/shaderc.hpp>
+#endif
+
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
 
 namespace MFA::Importer
 {
 
 	//-------------------------------------------------------------------------------------------------
 
+	// FNV-1a
+	static uint64_t HashBytes(void const * data, size_t const size, uint64_t hash = 14695981039346656037ull)
+	{
+		auto const * bytes = static_cast<uint8_t const *>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
 	std::shared_ptr<AS::Shader> ShaderFromSPV(
 		std::string const& path, 
 		VkShaderStageFlagBits const stage,
@@ -16,7 +41,7 @@ namespace MFA::Importer
 	)
 	{
 		std::shared_ptr<AS::Shader> shader = nullptr;
-		auto buffer = File::Read(path);
+		auto buffer = File::Map(path);
 		if (buffer != nullptr)
 		{
 			shader = std::make_shared<AS::Shader>(entryPoint, stage, buffer);
@@ -51,22 +76,369 @@ namespace MFA::Importer
 
 	//-------------------------------------------------------------------------------------------------
 
-    bool CompileShaderToSPV(
-        std::string const & inputPath,
-        std::string const & outputPath,
-        std::string const & stage
-    )
+	static constexpr char const * ShaderCacheDirectory = "./cache/shaders";
+
+#if defined(MFA_SHADERC)
+	static constexpr char const * ShaderCompilerId = "shaderc";
+#else
+	static constexpr char const * ShaderCompilerId = "glslc";
+#endif
+
+	//-------------------------------------------------------------------------------------------------
+
+	static bool ReadText(std::string const & path, std::string & outText)
+	{
+		if (std::filesystem::exists(path) == false)
+		{
+			return false;
+		}
+		auto const blob = File::Map(path);
+		if (blob == nullptr)
+		{
+			return false;
+		}
+		outText.assign(reinterpret_cast<char const *>(blob->Ptr()), blob->Len());
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	// Returns the path of the included file relative to the including file
+	static bool ParseInclude(std::string const & line, std::string & outName)
+	{
+		auto const directive = line.find_first_not_of(" \t");
+		if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+		{
+			return false;
+		}
+		auto const begin = line.find('"', directive + 8);
+		if (begin == std::string::npos)
+		{
+			return false;
+		}
+		auto const end = line.find('"', begin + 1);
+		if (end == std::string::npos)
+		{
+			return false;
+		}
+		outName = line.substr(begin + 1, end - begin - 1);
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static std::string ResolveInclude(std::string const & requestingPath, std::string const & includeName)
+	{
+		auto const directory = std::filesystem::path(requestingPath).parent_path();
+		return (directory / includeName).lexically_normal().string();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	// Feeds the content of the file and everything it includes into the hash
+	static bool HashSources(
+		std::string const & path,
+		std::unordered_set<std::string> & visited,
+		uint64_t & hash
+	)
+	{
+		if (visited.insert(path).second == false)
+		{
+			return true;
+		}
+
+		std::string text{};
+		if (ReadText(path, text) == false)
+		{
+			MFA_LOG_WARN("Failed to read shader source %s", path.c_str());
+			return false;
+		}
+		hash = HashBytes(text.data(), text.size(), hash);
+
+		std::istringstream stream(text);
+		std::string line{};
+		std::string includeName{};
+		while (std::getline(stream, line))
+		{
+			if (ParseInclude(line, includeName) && HashSources(ResolveInclude(path, includeName), visited, hash) == false)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static char const * StageName(VkShaderStageFlagBits const stage)
+	{
+		switch (stage)
+		{
+		case VK_SHADER_STAGE_VERTEX_BIT:
+			return "vert";
+		case VK_SHADER_STAGE_FRAGMENT_BIT:
+			return "frag";
+		case VK_SHADER_STAGE_COMPUTE_BIT:
+			return "comp";
+		case VK_SHADER_STAGE_GEOMETRY_BIT:
+			return "geom";
+		case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:
+			return "tesc";
+		case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT:
+			return "tese";
+		default:
+			MFA_ASSERT(false);
+			return "";
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+#if defined(MFA_SHADERC)
+
+	static bool IsHLSL(std::string const & path)
+	{
+		return std::filesystem::path(path).extension() == ".hlsl";
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	class ShaderIncluder final : public shaderc::CompileOptions::IncluderInterface
+	{
+	public:
+
+		shaderc_include_result * GetInclude(
+			char const * requestedSource,
+			shaderc_include_type type,
+			char const * requestingSource,
+			size_t includeDepth
+		) override
+		{
+			auto * include = new Include();
+			include->name = ResolveInclude(requestingSource, requestedSource);
+			if (ReadText(include->name, include->content) == false)
+			{
+				// An empty name reports the content as the error message
+				include->content = "Failed to read include " + include->name;
+				include->name.clear();
+			}
+			include->result.source_name = include->name.c_str();
+			include->result.source_name_length = include->name.size();
+			include->result.content = include->content.c_str();
+			include->result.content_length = include->content.size();
+			include->result.user_data = include;
+			return &include->result;
+		}
+
+		void ReleaseInclude(shaderc_include_result * data) override
+		{
+			delete static_cast<Include *>(data->user_data);
+		}
+
+	private:
+
+		struct Include
+		{
+			std::string name{};
+			std::string content{};
+			shaderc_include_result result{};
+		};
+
+	};
+
+	//-------------------------------------------------------------------------------------------------
+
+	static shaderc_shader_kind ShaderKind(VkShaderStageFlagBits const stage)
+	{
+		switch (stage)
+		{
+		case VK_SHADER_STAGE_VERTEX_BIT:
+			return shaderc_vertex_shader;
+		case VK_SHADER_STAGE_FRAGMENT_BIT:
+			return shaderc_fragment_shader;
+		case VK_SHADER_STAGE_COMPUTE_BIT:
+			return shaderc_compute_shader;
+		case VK_SHADER_STAGE_GEOMETRY_BIT:
+			return shaderc_geometry_shader;
+		case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:
+			return shaderc_tess_control_shader;
+		case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT:
+			return shaderc_tess_evaluation_shader;
+		default:
+			MFA_ASSERT(false);
+			return shaderc_glsl_infer_from_source;
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static std::shared_ptr<Blob> CompileToSPV(
+		std::string const & inputPath,
+		VkShaderStageFlagBits const stage,
+		std::string const & entryPoint,
+		std::vector<std::string> const & defines,
+		std::string const & outputPath
+	)
+	{
+		std::string source{};
+		if (ReadText(inputPath, source) == false)
+		{
+			MFA_LOG_WARN("Failed to read shader source %s", inputPath.c_str());
+			return nullptr;
+		}
+
+		shaderc::CompileOptions options{};
+		if (IsHLSL(inputPath))
+		{
+			options.SetSourceLanguage(shaderc_source_language_hlsl);
+		}
+		else
+		{
+			options.SetForcedVersionProfile(450, shaderc_profile_core);
+		}
+		options.SetGenerateDebugInfo();
+		options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+		options.SetIncluder(std::make_unique<ShaderIncluder>());
+		for (auto const & define : defines)
+		{
+			auto const separator = define.find('=');
+			if (separator == std::string::npos)
+			{
+				options.AddMacroDefinition(define);
+			}
+			else
+			{
+				options.AddMacroDefinition(define.substr(0, separator), define.substr(separator + 1));
+			}
+		}
+
+		// The compiler object is not thread safe, each call gets its own
+		shaderc::Compiler const compiler{};
+		auto const result = compiler.CompileGlslToSpv(
+			source.data(),
+			source.size(),
+			ShaderKind(stage),
+			inputPath.c_str(),
+			entryPoint.c_str(),
+			options
+		);
+		if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+		{
+			MFA_LOG_WARN("Failed to compile shader %s\n%s", inputPath.c_str(), result.GetErrorMessage().c_str());
+			return nullptr;
+		}
+
+		std::shared_ptr<Blob> spirv = Memory::Alloc(
+			result.cbegin(),
+			static_cast<size_t>(result.cend() - result.cbegin())
+		);
+		// Failing to cache is not an error, the shader is compiled again on the next run
+		File::Write(outputPath, *spirv);
+		return spirv;
+	}
+
+#else
+
+	//-------------------------------------------------------------------------------------------------
+
+	// Fallback for when shaderc is not available, glslc has to be in the path
+	static std::shared_ptr<Blob> CompileToSPV(
+		std::string const & inputPath,
+		VkShaderStageFlagBits const stage,
+		std::string const & entryPoint,
+		std::vector<std::string> const & defines,
+		std::string const & outputPath
+	)
 	{
 		std::string command = "";
 		MFA_STRING(
 			command,
-			"glslc -g -fshader-stage=%s \"%s\" -o \"%s\" -std=450core",
-			stage.c_str(),
+			"glslc -g -fshader-stage=%s -fentry-point=%s \"%s\" -o \"%s\" -std=450core",
+			StageName(stage),
+			entryPoint.c_str(),
 			inputPath.c_str(),
 			outputPath.c_str()
 		);
-		auto const result = std::system(command.c_str());
-		return result == 0;
+		for (auto const & define : defines)
+		{
+			command += " -D" + define;
+		}
+
+		std::error_code errorCode{};
+		std::filesystem::create_directories(std::filesystem::path(outputPath).parent_path(), errorCode);
+		if (std::system(command.c_str()) != 0)
+		{
+			MFA_LOG_WARN("Failed to compile shader %s", inputPath.c_str());
+			return nullptr;
+		}
+		return File::Read(outputPath);
+	}
+
+#endif
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::shared_ptr<AS::Shader> CompileShader(
+		std::string const & inputPath,
+		VkShaderStageFlagBits const stage,
+		std::string const & entryPoint,
+		std::vector<std::string> const & defines
+	)
+	{
+		uint64_t hash = HashBytes(ShaderCompilerId, std::strlen(ShaderCompilerId));
+		hash = HashBytes(StageName(stage), std::strlen(StageName(stage)), hash);
+		hash = HashBytes(entryPoint.data(), entryPoint.size(), hash);
+		for (auto const & define : defines)
+		{
+			// The separator keeps {"AB"} and {"A", "B"} apart
+			hash = HashBytes(define.data(), define.size() + 1, hash);
+		}
+		std::unordered_set<std::string> visited{};
+		if (HashSources(inputPath, visited, hash) == false)
+		{
+			return nullptr;
+		}
+
+		std::string fileName = "";
+		MFA_STRING(
+			fileName,
+			"%s_%016llx.spv",
+			std::filesystem::path(inputPath).filename().string().c_str(),
+			static_cast<unsigned long long>(hash)
+		);
+		auto const cachePath = std::filesystem::path(ShaderCacheDirectory).append(fileName).string();
+
+		std::shared_ptr<Blob> spirv = nullptr;
+		if (std::filesystem::exists(cachePath))
+		{
+			spirv = File::Read(cachePath);
+		}
+		if (spirv == nullptr || spirv->IsValid() == false)
+		{
+			MFA_LOG_INFO("Compiling shader %s", inputPath.c_str());
+			// Each thread writes its own file, so concurrent compilations of the same shader never share an output
+			std::ostringstream tempPath{};
+			tempPath << cachePath << "." << std::this_thread::get_id() << ".tmp";
+			spirv = CompileToSPV(inputPath, stage, entryPoint, defines, tempPath.str());
+			if (spirv == nullptr)
+			{
+				return nullptr;
+			}
+			std::error_code errorCode{};
+			std::filesystem::rename(tempPath.str(), cachePath, errorCode);
+			if (errorCode)
+			{
+				// The target can be held by another process on windows, the shader is still usable without the cache
+				MFA_LOG_WARN(
+					"Failed to store the compiled shader %s: %s",
+					cachePath.c_str(),
+					errorCode.message().c_str()
+				);
+				std::filesystem::remove(tempPath.str(), errorCode);
+			}
+		}
+
+		return std::make_shared<AS::Shader>(entryPoint, stage, spirv);
 	}
 
 	//-------------------------------------------------------------------------------------------------
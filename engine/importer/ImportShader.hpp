@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "AssetShader.hpp"
 #include "BedrockMemory.hpp"
@@ -21,10 +22,14 @@ namespace MFA::Importer
         std::string const & entryPoint
     );
 
-    bool CompileShaderToSPV(
+    // Compiles the glsl or hlsl source into spirv. The result is cached on disk by a hash of the source, its includes,
+    // the defines and the stage, so unchanged shaders skip the compilation. Defines are in the form of NAME or NAME=VALUE.
+    // Returns nullptr on failure. Safe to call from worker threads.
+    std::shared_ptr<AS::Shader> CompileShader(
         std::string const & inputPath,
-        std::string const & outputPath,
-        std::string const & stage
+        VkShaderStageFlagBits stage,
+        std::string const & entryPoint,
+        std::vector<std::string> const & defines = {}
     );
 
 }
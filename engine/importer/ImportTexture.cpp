@@ -46,7 +46,7 @@ namespace MFA::Importer
     {
         LoadResult ret = LoadResult::Invalid;
 
-        auto const rawFile = File::Read(path);
+        auto const rawFile = File::Map(path);
 
         if (rawFile == nullptr)
         {
@@ -68,14 +68,20 @@ namespace MFA::Importer
             MFA_ASSERT(outImageData.height > 0);
             MFA_ASSERT(outImageData.stbi_components > 0);
 
-            outImageData.stbi_pixels = std::make_shared<Blob>(
-                readData,
-                static_cast<size_t>(outImageData.width) *
-                outImageData.height *
-                outImageData.stbi_components *
-                sizeof(uint8_t)
-
-                );
+            // The pixels stay in the stb buffer, it is released together with the last blob that uses it
+            outImageData.stbi_pixels = Memory::View(
+                Alias{
+                    readData,
+                    static_cast<size_t>(outImageData.width) *
+                    outImageData.height *
+                    outImageData.stbi_components *
+                    sizeof(uint8_t)
+                },
+                std::shared_ptr<void const>(readData, [](void const * pixels)->void
+                {
+                    stbi_image_free(const_cast<void *>(pixels));
+                })
+            );
 
             outImageData.components = outImageData.stbi_components;
             if (prefer_srgb)
@@ -0,0 +1,359 @@
+#include "FrameProfiler.hpp"
+
+#include "BedrockAssert.hpp"
+#include "BedrockFile.hpp"
+#include "BedrockLog.hpp"
+#include "BedrockMemory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace MFA
+{
+
+    // Number of frames that are kept for the ui and the trace export
+    static constexpr size_t HistoryLength = 120;
+
+    //-------------------------------------------------------------------------------------------------
+
+    FrameProfiler & FrameProfiler::Instance()
+    {
+        // Scopes can be recorded before and after the lifetime of any system, so the profiler is created on first use
+        static FrameProfiler instance{};
+        return instance;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    FrameProfiler::FrameProfiler()
+        : _frameStartNs(Now())
+    {}
+
+    //-------------------------------------------------------------------------------------------------
+
+    FrameProfiler::~FrameProfiler() = default;
+
+    //-------------------------------------------------------------------------------------------------
+
+    uint64_t FrameProfiler::Now() noexcept
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count());
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void FrameProfiler::SetThreadName(std::string name)
+    {
+        auto & buffer = GetThreadBuffer();
+        std::lock_guard lock{ _threadBufferMutex };
+        buffer.name = std::move(name);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    uint32_t FrameProfiler::BeginScope()
+    {
+        return GetThreadBuffer().depth++;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void FrameProfiler::EndScope(char const * name, uint64_t const startNs, uint32_t const depth)
+    {
+        auto const endNs = Now();
+
+        auto & buffer = GetThreadBuffer();
+        MFA_ASSERT(buffer.depth == depth + 1);
+        buffer.depth = depth;
+
+        auto const writeCount = buffer.writeCount.load(std::memory_order_relaxed);
+        buffer.events[writeCount % EventCapacity] = Event{
+            .name = name,
+            .startNs = startNs,
+            .endNs = endNs,
+            .depth = depth,
+            .threadIndex = buffer.threadIndex
+        };
+        buffer.writeCount.store(writeCount + 1, std::memory_order_release);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void FrameProfiler::EndFrame()
+    {
+        auto const frameEndNs = Now();
+
+        auto frame = std::make_shared<Frame>();
+        frame->frameNumber = _nextFrameNumber++;
+        frame->startNs = _frameStartNs;
+        frame->endNs = frameEndNs;
+        _frameStartNs = frameEndNs;
+
+        size_t threadCount = 0;
+        {
+            std::lock_guard lock{ _threadBufferMutex };
+            threadCount = _threadBuffers.size();
+            for (auto const & buffer : _threadBuffers)
+            {
+                auto const writeCount = buffer->writeCount.load(std::memory_order_acquire);
+                // The owner keeps writing while we read, a quarter of the ring is left for it
+                auto const oldestSafe = writeCount > EventCapacity * 3 / 4 ? writeCount - EventCapacity * 3 / 4 : 0;
+                auto const readCount = (std::max)(buffer->readCount, oldestSafe);
+                for (auto i = readCount; i < writeCount; ++i)
+                {
+                    frame->events.emplace_back(buffer->events[i % EventCapacity]);
+                }
+                buffer->readCount = writeCount;
+            }
+        }
+
+        if (_enabled.load() == true)
+        {
+            BuildTree(*frame, threadCount);
+        }
+        else
+        {
+            frame->events.clear();
+        }
+
+        std::lock_guard lock{ _historyMutex };
+        _history.emplace_back(std::move(frame));
+        while (_history.size() > HistoryLength)
+        {
+            _history.pop_front();
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void FrameProfiler::SetEnabled(bool const enabled)
+    {
+        _enabled.store(enabled);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool FrameProfiler::IsEnabled() const noexcept
+    {
+        return _enabled.load();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    std::shared_ptr<FrameProfiler::Frame const> FrameProfiler::GetLastFrame() const
+    {
+        std::lock_guard lock{ _historyMutex };
+        if (_history.empty())
+        {
+            return nullptr;
+        }
+        return _history.back();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    std::vector<std::string> FrameProfiler::GetThreadNames() const
+    {
+        std::lock_guard lock{ _threadBufferMutex };
+        std::vector<std::string> names{};
+        for (auto const & buffer : _threadBuffers)
+        {
+            names.emplace_back(buffer->name);
+        }
+        return names;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool FrameProfiler::ExportChromeTrace(std::string const & path) const
+    {
+        auto const threadNames = GetThreadNames();
+
+        std::string json = "{\"traceEvents\":[\n";
+        char line[512]{};
+        bool isFirst = true;
+
+        auto const append = [&json, &isFirst](char const * text)->void
+        {
+            if (isFirst == false)
+            {
+                json += ",\n";
+            }
+            json += text;
+            isFirst = false;
+        };
+
+        // Names are written as they are, scope names are identifiers and never contain quotes
+        for (size_t i = 0; i < threadNames.size(); ++i)
+        {
+            std::snprintf(
+                line,
+                sizeof(line),
+                R"({"name":"thread_name","ph":"M","pid":1,"tid":%zu,"args":{"name":"%s"}})",
+                i,
+                threadNames[i].c_str()
+            );
+            append(line);
+        }
+
+        {
+            std::lock_guard lock{ _historyMutex };
+            auto const originNs = _history.empty() ? 0 : _history.front()->startNs;
+            auto const toMicroseconds = [originNs](uint64_t const ns)->double
+            {
+                return static_cast<double>(ns - (std::min)(ns, originNs)) / 1000.0;
+            };
+
+            for (auto const & frame : _history)
+            {
+                std::snprintf(
+                    line,
+                    sizeof(line),
+                    R"({"name":"Frame %llu","ph":"X","pid":1,"tid":%zu,"ts":%.3f,"dur":%.3f})",
+                    static_cast<unsigned long long>(frame->frameNumber),
+                    threadNames.size(),
+                    toMicroseconds(frame->startNs),
+                    static_cast<double>(frame->endNs - frame->startNs) / 1000.0
+                );
+                append(line);
+
+                for (auto const & event : frame->events)
+                {
+                    std::snprintf(
+                        line,
+                        sizeof(line),
+                        R"({"name":"%s","ph":"X","pid":1,"tid":%u,"ts":%.3f,"dur":%.3f})",
+                        event.name != nullptr ? event.name : "Unnamed",
+                        event.threadIndex,
+                        toMicroseconds(event.startNs),
+                        static_cast<double>(event.endNs - event.startNs) / 1000.0
+                    );
+                    append(line);
+                }
+            }
+        }
+
+        std::snprintf(
+            line,
+            sizeof(line),
+            R"({"name":"thread_name","ph":"M","pid":1,"tid":%zu,"args":{"name":"Frames"}})",
+            threadNames.size()
+        );
+        append(line);
+
+        json += "\n]}\n";
+
+        if (File::Write(path, Alias{ json.data(), json.size() }) == false)
+        {
+            MFA_LOG_WARN("Failed to export the cpu trace into %s", path.c_str());
+            return false;
+        }
+        MFA_LOG_INFO("Exported the cpu trace into %s", path.c_str());
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    FrameProfiler::ThreadBuffer & FrameProfiler::GetThreadBuffer()
+    {
+        static thread_local ThreadBuffer * threadBuffer = nullptr;
+        if (threadBuffer == nullptr)
+        {
+            auto buffer = std::make_unique<ThreadBuffer>();
+            std::lock_guard lock{ _threadBufferMutex };
+            buffer->threadIndex = static_cast<uint32_t>(_threadBuffers.size());
+            buffer->name = "Thread " + std::to_string(buffer->threadIndex);
+            threadBuffer = _threadBuffers.emplace_back(std::move(buffer)).get();
+        }
+        return *threadBuffer;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void FrameProfiler::BuildTree(Frame & frame, size_t const threadCount)
+    {
+        // Children end before their parents, sorting by the start time puts every parent before its children
+        std::stable_sort(
+            frame.events.begin(),
+            frame.events.end(),
+            [](Event const & lhs, Event const & rhs)->bool
+            {
+                if (lhs.threadIndex != rhs.threadIndex)
+                {
+                    return lhs.threadIndex < rhs.threadIndex;
+                }
+                if (lhs.startNs != rhs.startNs)
+                {
+                    return lhs.startNs < rhs.startNs;
+                }
+                return lhs.depth < rhs.depth;
+            }
+        );
+
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            frame.roots.emplace_back(static_cast<int>(frame.nodes.size()));
+            frame.nodes.emplace_back();
+        }
+
+        // Open nodes of the current thread indexed by depth
+        std::vector<int> stack{};
+        uint32_t currentThread = UINT32_MAX;
+
+        for (auto const & event : frame.events)
+        {
+            if (event.threadIndex != currentThread)
+            {
+                currentThread = event.threadIndex;
+                stack.clear();
+            }
+
+            // Scopes whose parent started in an earlier frame are attached to the closest known ancestor
+            auto const parentDepth = (std::min)(static_cast<size_t>(event.depth), stack.size());
+            stack.resize(parentDepth);
+            auto const parentIndex = stack.empty() ? frame.roots[event.threadIndex] : stack.back();
+
+            int nodeIndex = -1;
+            for (auto const childIndex : frame.nodes[parentIndex].children)
+            {
+                auto const * childName = frame.nodes[childIndex].name;
+                // The same literal can have a different address in every translation unit
+                if (childName == event.name || (childName != nullptr && event.name != nullptr && std::strcmp(childName, event.name) == 0))
+                {
+                    nodeIndex = childIndex;
+                    break;
+                }
+            }
+            if (nodeIndex < 0)
+            {
+                nodeIndex = static_cast<int>(frame.nodes.size());
+                frame.nodes.emplace_back(Node{ .name = event.name });
+                frame.nodes[parentIndex].children.emplace_back(nodeIndex);
+            }
+
+            auto & node = frame.nodes[nodeIndex];
+            node.totalNs += event.endNs - event.startNs;
+            ++node.callCount;
+
+            stack.emplace_back(nodeIndex);
+        }
+
+        // Threads are as busy as their top level scopes
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            auto & root = frame.nodes[frame.roots[i]];
+            for (auto const childIndex : root.children)
+            {
+                root.totalNs += frame.nodes[childIndex].totalNs;
+                root.callCount += frame.nodes[childIndex].callCount;
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
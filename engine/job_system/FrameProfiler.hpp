@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MFA
+{
+    // Collects the cpu scopes of every thread and groups them per frame.
+    // Scopes are written into a fixed size ring buffer of the calling thread, so recording never allocates or locks.
+    // EndFrame drains the rings on the calling thread and builds a tree of the frame per thread. The last frames
+    // are kept for the debug ui and for exporting a trace that can be opened in chrome://tracing or Perfetto.
+    class FrameProfiler
+    {
+    public:
+
+        struct Event
+        {
+            char const * name = nullptr;
+            uint64_t startNs = 0;
+            uint64_t endNs = 0;
+            uint32_t depth = 0;
+            uint32_t threadIndex = 0;
+        };
+
+        // Scopes with the same name under the same parent are merged
+        struct Node
+        {
+            char const * name = nullptr;
+            uint64_t totalNs = 0;
+            uint32_t callCount = 0;
+            std::vector<int> children{};
+        };
+
+        struct Frame
+        {
+            uint64_t frameNumber = 0;
+            uint64_t startNs = 0;
+            uint64_t endNs = 0;
+            // Roots are the threads, in the same order as the thread names
+            std::vector<Node> nodes{};
+            std::vector<int> roots{};
+            std::vector<Event> events{};
+        };
+
+        [[nodiscard]]
+        static FrameProfiler & Instance();
+
+        explicit FrameProfiler();
+
+        ~FrameProfiler();
+
+        FrameProfiler(FrameProfiler const &) noexcept = delete;
+        FrameProfiler(FrameProfiler &&) noexcept = delete;
+        FrameProfiler & operator = (FrameProfiler const &) noexcept = delete;
+        FrameProfiler & operator = (FrameProfiler &&) noexcept = delete;
+
+        // Nanoseconds of a monotonic clock
+        [[nodiscard]]
+        static uint64_t Now() noexcept;
+
+        // Only the first call of a thread allocates its buffer
+        void SetThreadName(std::string name);
+
+        // Returns the depth of the new scope
+        [[nodiscard]]
+        uint32_t BeginScope();
+
+        // The name is stored by pointer, string literals are expected
+        void EndScope(char const * name, uint64_t startNs, uint32_t depth);
+
+        // Drains the scopes that ended since the previous call into a new frame
+        void EndFrame();
+
+        void SetEnabled(bool enabled);
+
+        [[nodiscard]]
+        bool IsEnabled() const noexcept;
+
+        [[nodiscard]]
+        std::shared_ptr<Frame const> GetLastFrame() const;
+
+        [[nodiscard]]
+        std::vector<std::string> GetThreadNames() const;
+
+        // Writes the frames of the history in the trace event format, returns false on failure
+        bool ExportChromeTrace(std::string const & path) const;
+
+    private:
+
+        static constexpr size_t EventCapacity = 1 << 14;
+
+        struct ThreadBuffer
+        {
+            std::array<Event, EventCapacity> events{};
+            // Written by the owner thread only
+            std::atomic<uint64_t> writeCount = 0;
+            // Read by EndFrame only
+            uint64_t readCount = 0;
+            uint32_t depth = 0;
+            uint32_t threadIndex = 0;
+            std::string name{};
+        };
+
+        [[nodiscard]]
+        ThreadBuffer & GetThreadBuffer();
+
+        static void BuildTree(Frame & frame, size_t threadCount);
+
+        std::atomic<bool> _enabled = true;
+
+        // Buffers are never released, a thread that exits leaves its last scopes behind
+        std::vector<std::unique_ptr<ThreadBuffer>> _threadBuffers{};
+        mutable std::mutex _threadBufferMutex{};
+
+        uint64_t _nextFrameNumber = 0;
+        uint64_t _frameStartNs = 0;
+
+        std::deque<std::shared_ptr<Frame const>> _history{};
+        mutable std::mutex _historyMutex{};
+    };
+}
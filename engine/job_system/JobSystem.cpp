@@ -1 +1,51 @@
 #include "JobSystem.hpp"
+
+#include <algorithm>
+
+namespace MFA
+{
+
+    //-------------------------------------------------------------------------------------------------
+
+    void JobSystem::ParallelFor(
+        int const begin,
+        int const end,
+        std::function<void(int rangeBegin, int rangeEnd)> const & body,
+        int const grainSize
+    )
+    {
+        MFA_ASSERT(body != nullptr);
+        auto const itemCount = end - begin;
+        if (itemCount <= 0)
+        {
+            return;
+        }
+
+        // A few ranges per thread leave room for stealing when the items are uneven
+        auto const threadCount = (std::max)(threadPool.NumberOfAvailableThreads(), 1);
+        auto const maxRangeCount = (std::max)(itemCount / (std::max)(grainSize, 1), 1);
+        auto const rangeCount = (std::min)(threadCount * 4, maxRangeCount);
+        if (rangeCount == 1)
+        {
+            body(begin, end);
+            return;
+        }
+
+        auto taskGroup = CreateTaskGroup();
+        // The first range is left for the calling thread
+        for (int rangeIndex = 1; rangeIndex < rangeCount; ++rangeIndex)
+        {
+            auto const rangeBegin = begin + static_cast<int>(static_cast<int64_t>(itemCount) * rangeIndex / rangeCount);
+            auto const rangeEnd = begin + static_cast<int>(static_cast<int64_t>(itemCount) * (rangeIndex + 1) / rangeCount);
+            taskGroup.Run([&body, rangeBegin, rangeEnd]()->void
+            {
+                body(rangeBegin, rangeEnd);
+            });
+        }
+        body(begin, begin + static_cast<int>(static_cast<int64_t>(itemCount) / rangeCount));
+        taskGroup.Wait();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
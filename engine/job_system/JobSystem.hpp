@@ -1,9 +1,11 @@
 #pragma once
 
 #include "ThreadPool.hpp"
+#include "TaskGraph.hpp"
+#include "TaskGroup.hpp"
+#include "Task.hpp"
 
 #include <future>
-#include <omp.h>
 
 namespace MFA
 {
@@ -11,19 +13,16 @@ namespace MFA
     {
     public:
 
-        static std::unique_ptr<JobSystem> Instantiate()
+        static std::unique_ptr<JobSystem> Instantiate(ThreadPool::Params const & params = {})
         {
-            return std::make_unique<JobSystem>();
+            return std::make_unique<JobSystem>(params);
         }
 
-        explicit JobSystem()
+        // Parallel loops of the engine use ParallelFor instead of OpenMP, so the pool is the only set of workers
+        explicit JobSystem(ThreadPool::Params const & params = {})
+            : threadPool(params)
         {
             MFA_ASSERT(Instance == nullptr);
-
-			// 80 percent is the best ratio
-			omp_set_num_threads(static_cast<int>(static_cast<float>(std::thread::hardware_concurrency()) * 0.8f));
-			MFA_LOG_INFO("Number of available workers are: %d", omp_get_max_threads());
-
             Instance = this;
         }
 
@@ -43,8 +42,15 @@ namespace MFA
 
             threadPool.AssignTask([task, params]()
                 {
-                    task();
-                    params->promise.set_value();
+                    try
+                    {
+                        task();
+                        params->promise.set_value();
+                    }
+                    catch (...)
+                    {
+                        params->promise.set_exception(std::current_exception());
+                    }
                 }
             );
             return params->promise.get_future();
@@ -61,12 +67,71 @@ namespace MFA
 
             threadPool.AssignTask([task, params]()
                 {
-                    params->promise.set_value(task());
+                    try
+                    {
+                        params->promise.set_value(task());
+                    }
+                    catch (...)
+                    {
+                        params->promise.set_exception(std::current_exception());
+                    }
                 }
             );
             return params->promise.get_future();
         }
 
+        // Tasks of the group run on the pool, waiting on it runs the tasks of the group that are not taken yet
+        [[nodiscard]]
+        TaskGroup CreateTaskGroup()
+        {
+            return TaskGroup{threadPool};
+        }
+
+        // co_await JobSystem::Schedule() continues the coroutine on a worker
+        [[nodiscard]]
+        static ScheduleAwaiter Schedule()
+        {
+            MFA_ASSERT(Instance != nullptr);
+            return ScheduleAwaiter{Instance->threadPool};
+        }
+
+        // Bridge from ordinary code to a coroutine. A worker runs pending tasks until the task is done, other threads
+        // sleep until it is, otherwise they would take the continuations that co_await Schedule() hands to the workers.
+        template<typename T>
+        T SyncWait(Task<T> task)
+        {
+            if (threadPool.IsWorkerThread() == true)
+            {
+                task.Start();
+                while (task.IsDone() == false)
+                {
+                    if (threadPool.TryRunPendingTask() == false)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                return task.TakeResult();
+            }
+
+            TaskInternal::SyncWaitEvent event{};
+            TaskInternal::SyncWaitHelper helper = TaskInternal::MakeSyncWaitHelper(task);
+            helper.handle.promise().event = &event;
+            helper.handle.resume();
+            event.Wait();
+            return task.TakeResult();
+        }
+
+        // Graphs are kept by their owner and run again every frame
+        [[nodiscard]]
+        std::unique_ptr<TaskGraph> CreateTaskGraph()
+        {
+            return std::make_unique<TaskGraph>(threadPool);
+        }
+
+        // Splits [begin, end) into ranges of at least grainSize items and calls the body for each of them.
+        // The calling thread takes part and the call returns once every range is done.
+        void ParallelFor(int begin, int end, std::function<void(int rangeBegin, int rangeEnd)> const & body, int grainSize = 1);
+
         [[nodiscard]]
         auto NumberOfAvailableThreads() const
         {
@@ -79,11 +144,16 @@ namespace MFA
             return threadPool.IsMainThread();
         }
 
+        auto WorkerIndex() const
+        {
+            return threadPool.WorkerIndex();
+        }
+
         inline static JobSystem* Instance = nullptr;
 
     private:
 
-        ThreadPool threadPool{};
+        ThreadPool threadPool;
 
     };
 }
@@ -1,23 +1,23 @@
 #include "ScopeProfiler.hpp"
 
-#include "BedrockAssert.hpp"
-#include "BedrockLog.hpp"
-
-#include <thread>
-
 namespace MFA {
 
-    ScopeProfiler::ScopeProfiler(std::string text)
-        : _text(std::move(text))
-        , _start(std::chrono::high_resolution_clock::now())
+    ScopeProfiler::ScopeProfiler(char const * name)
+        : _name(name)
+        , _isEnabled(FrameProfiler::Instance().IsEnabled())
     {
-        
+        if (_isEnabled == true)
+        {
+            _depth = FrameProfiler::Instance().BeginScope();
+            _startNs = FrameProfiler::Now();
+        }
     }
 
     ScopeProfiler::~ScopeProfiler()
     {
-        auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> duration = end - _start;
-        MFA_LOG_INFO("Profiler: %s took %f seconds", _text.c_str(), duration.count());
+        if (_isEnabled == true)
+        {
+            FrameProfiler::Instance().EndScope(_name, _startNs, _depth);
+        }
     }
 }
@@ -3,14 +3,15 @@
 #include "BedrockAssert.hpp"
 #include "BedrockCommon.hpp"
 #include "BedrockPlatforms.hpp"
-
-#include <atomic>
+#include "FrameProfiler.hpp"
 
 namespace MFA {
+    // Records the duration of the enclosing scope into the frame profiler of the calling thread.
+    // The name is stored by pointer, string literals are expected.
     class ScopeProfiler
     {
     public:
-        explicit ScopeProfiler(std::string text);
+        explicit ScopeProfiler(char const * name);
         ~ScopeProfiler();
 
         ScopeProfiler(ScopeProfiler const &) noexcept = delete;
@@ -20,9 +21,11 @@ namespace MFA {
 
     private:
 
-        std::string const _text;
-        supportedClock::time_point _start{};
+        char const * const _name;
+        bool const _isEnabled;
+        uint32_t _depth = 0;
+        uint64_t _startNs = 0;
     };
 }
 
-#define SCOPE_Profiler(lock)        ScopeProfiler MFA_UNIQUE_NAME(__scopeProfiler) {lock};
+#define SCOPE_Profiler(name)        MFA::ScopeProfiler MFA_UNIQUE_NAME(__scopeProfiler) {name};
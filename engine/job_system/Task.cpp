@@ -0,0 +1,137 @@
+#include "Task.hpp"
+
+#include <array>
+#include <new>
+
+namespace MFA
+{
+
+    // Frames are rounded up to 64, 128, ... 4096 bytes
+    static constexpr size_t SmallestFrameSize = 64;
+    static constexpr size_t SizeClassCount = 7;
+    // Threads that release more frames than they allocate give the rest back to the heap
+    static constexpr int MaxCachedFramesPerClass = 256;
+
+    //-------------------------------------------------------------------------------------------------
+
+    namespace
+    {
+        struct FreeFrame
+        {
+            FreeFrame * next = nullptr;
+        };
+
+        struct FrameCache
+        {
+            struct FreeList
+            {
+                FreeFrame * head = nullptr;
+                int count = 0;
+            };
+
+            ~FrameCache()
+            {
+                for (auto & freeList : freeLists)
+                {
+                    while (freeList.head != nullptr)
+                    {
+                        auto * frame = freeList.head;
+                        freeList.head = frame->next;
+                        ::operator delete(frame);
+                    }
+                }
+            }
+
+            std::array<FreeList, SizeClassCount> freeLists{};
+        };
+
+        thread_local FrameCache ThreadFrameCache{};
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Returns SizeClassCount for frames that are too large to be cached
+    static size_t SizeClassOf(size_t const size)
+    {
+        size_t sizeClass = 0;
+        size_t classSize = SmallestFrameSize;
+        while (classSize < size && sizeClass < SizeClassCount)
+        {
+            classSize <<= 1;
+            ++sizeClass;
+        }
+        return sizeClass;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void * CoroutineFramePool::Allocate(size_t const size)
+    {
+        auto const sizeClass = SizeClassOf(size);
+        if (sizeClass >= SizeClassCount)
+        {
+            return ::operator new(size);
+        }
+
+        auto & freeList = ThreadFrameCache.freeLists[sizeClass];
+        if (freeList.head != nullptr)
+        {
+            auto * frame = freeList.head;
+            freeList.head = frame->next;
+            --freeList.count;
+            return frame;
+        }
+        return ::operator new(SmallestFrameSize << sizeClass);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void CoroutineFramePool::Free(void * frame, size_t const size) noexcept
+    {
+        if (frame == nullptr)
+        {
+            return;
+        }
+
+        auto const sizeClass = SizeClassOf(size);
+        if (sizeClass >= SizeClassCount)
+        {
+            ::operator delete(frame);
+            return;
+        }
+
+        // Frames are often released on another thread than the one that allocated them, they stay there
+        auto & freeList = ThreadFrameCache.freeLists[sizeClass];
+        if (freeList.count >= MaxCachedFramesPerClass)
+        {
+            ::operator delete(frame);
+            return;
+        }
+        freeList.head = new (frame) FreeFrame{freeList.head};
+        ++freeList.count;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskInternal::SyncWaitEvent::Set()
+    {
+        // Notifying under the lock keeps the waiter from returning and destroying the event before this is done
+        std::lock_guard lock{ mMutex };
+        mIsSet = true;
+        mCondition.notify_all();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskInternal::SyncWaitEvent::Wait()
+    {
+        std::unique_lock lock{ mMutex };
+        mCondition.wait(lock, [this]()->bool
+        {
+            return mIsSet;
+        });
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
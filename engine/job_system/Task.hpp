@@ -0,0 +1,586 @@
+#pragma once
+
+#include "BedrockAssert.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace MFA
+{
+    // Coroutine frames are recycled by size class in a free list of the thread that releases them,
+    // so starting a task usually does not reach the global heap. Large frames are not cached.
+    namespace CoroutineFramePool
+    {
+        [[nodiscard]]
+        void * Allocate(size_t size);
+
+        void Free(void * frame, size_t size) noexcept;
+    }
+
+    template<typename T>
+    class Task;
+
+    namespace TaskInternal
+    {
+        struct PromiseBase
+        {
+            static void * operator new(size_t const size)
+            {
+                return CoroutineFramePool::Allocate(size);
+            }
+
+            static void operator delete(void * frame, size_t const size) noexcept
+            {
+                CoroutineFramePool::Free(frame, size);
+            }
+
+            // Resumes whoever awaits the task. Without one, the task was started by Start and only the flag is set.
+            struct FinalAwaiter
+            {
+                [[nodiscard]]
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> const handle) noexcept
+                {
+                    auto & promise = handle.promise();
+                    if (promise.continuation != nullptr)
+                    {
+                        return promise.continuation;
+                    }
+                    // The owner may destroy the frame as soon as the flag is set, so nothing is touched after it
+                    promise.isDone.store(true, std::memory_order_release);
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            [[nodiscard]]
+            std::suspend_always initial_suspend() const noexcept
+            {
+                return {};
+            }
+
+            [[nodiscard]]
+            FinalAwaiter final_suspend() const noexcept
+            {
+                return {};
+            }
+
+            void unhandled_exception() noexcept
+            {
+                exception = std::current_exception();
+            }
+
+            std::coroutine_handle<> continuation{};
+            std::atomic<bool> isDone = false;
+            std::exception_ptr exception{};
+        };
+
+        template<typename T>
+        struct Promise : PromiseBase
+        {
+            [[nodiscard]]
+            Task<T> get_return_object() noexcept;
+
+            template<typename U>
+            void return_value(U && value)
+            {
+                result.template emplace<1>(std::forward<U>(value));
+            }
+
+            [[nodiscard]]
+            T TakeResult()
+            {
+                if (exception != nullptr)
+                {
+                    std::rethrow_exception(exception);
+                }
+                MFA_ASSERT(result.index() == 1);
+                return std::move(std::get<1>(result));
+            }
+
+            std::variant<std::monostate, T> result{};
+        };
+
+        template<>
+        struct Promise<void> : PromiseBase
+        {
+            [[nodiscard]]
+            Task<void> get_return_object() noexcept;
+
+            void return_void() noexcept {}
+
+            void TakeResult() const
+            {
+                if (exception != nullptr)
+                {
+                    std::rethrow_exception(exception);
+                }
+            }
+        };
+    }
+
+    // Lazy coroutine that produces a T. Nothing runs until the task is awaited or started.
+    // A task continues on the thread that resumes it, co_await JobSystem::Schedule() moves it to a worker.
+    template<typename T = void>
+    class [[nodiscard]] Task
+    {
+    public:
+
+        using promise_type = TaskInternal::Promise<T>;
+
+        explicit Task() = default;
+
+        explicit Task(std::coroutine_handle<promise_type> const handle)
+            : mHandle(handle)
+        {}
+
+        ~Task()
+        {
+            if (mHandle != nullptr)
+            {
+                mHandle.destroy();
+            }
+        }
+
+        Task(Task const &) noexcept = delete;
+        Task & operator = (Task const &) noexcept = delete;
+
+        Task(Task && other) noexcept
+            : mHandle(std::exchange(other.mHandle, nullptr))
+            , mIsStarted(other.mIsStarted)
+        {}
+
+        Task & operator = (Task && other) noexcept
+        {
+            if (this != &other)
+            {
+                if (mHandle != nullptr)
+                {
+                    mHandle.destroy();
+                }
+                mHandle = std::exchange(other.mHandle, nullptr);
+                mIsStarted = other.mIsStarted;
+            }
+            return *this;
+        }
+
+        [[nodiscard]]
+        bool IsValid() const noexcept
+        {
+            return mHandle != nullptr;
+        }
+
+        // Runs the task on the calling thread until its first suspension, nobody is resumed when it finishes
+        void Start()
+        {
+            MFA_ASSERT(mHandle != nullptr && mIsStarted == false);
+            mIsStarted = true;
+            mHandle.resume();
+        }
+
+        // Only meaningful for tasks that were started by Start
+        [[nodiscard]]
+        bool IsDone() const noexcept
+        {
+            return mHandle != nullptr && mHandle.promise().isDone.load(std::memory_order_acquire);
+        }
+
+        // Rethrows the exception of the task. The task has to be finished.
+        T TakeResult()
+        {
+            MFA_ASSERT(mHandle != nullptr);
+            return mHandle.promise().TakeResult();
+        }
+
+        // Awaiting starts the task and resumes the awaiter once it has finished, without blocking a thread
+        auto operator co_await() && noexcept
+        {
+            struct Awaiter
+            {
+                [[nodiscard]]
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> const awaiter) noexcept
+                {
+                    handle.promise().continuation = awaiter;
+                    return handle;
+                }
+
+                T await_resume()
+                {
+                    return handle.promise().TakeResult();
+                }
+
+                std::coroutine_handle<promise_type> handle;
+            };
+
+            MFA_ASSERT(mHandle != nullptr && mIsStarted == false);
+            mIsStarted = true;
+            return Awaiter{mHandle};
+        }
+
+        // Same as awaiting the task, but the result and the exception stay in the task for TakeResult
+        auto WhenDone() noexcept
+        {
+            struct Awaiter
+            {
+                [[nodiscard]]
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> const awaiter) noexcept
+                {
+                    handle.promise().continuation = awaiter;
+                    return handle;
+                }
+
+                void await_resume() const noexcept {}
+
+                std::coroutine_handle<promise_type> handle;
+            };
+
+            MFA_ASSERT(mHandle != nullptr && mIsStarted == false);
+            mIsStarted = true;
+            return Awaiter{mHandle};
+        }
+
+    private:
+
+        std::coroutine_handle<promise_type> mHandle{};
+        bool mIsStarted = false;
+    };
+
+    //-------------------------------------------------------------------------------------------------
+
+    template<typename T>
+    Task<T> TaskInternal::Promise<T>::get_return_object() noexcept
+    {
+        return Task<T>{std::coroutine_handle<Promise<T>>::from_promise(*this)};
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    inline Task<void> TaskInternal::Promise<void>::get_return_object() noexcept
+    {
+        return Task<void>{std::coroutine_handle<Promise<void>>::from_promise(*this)};
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Resumes the awaiting coroutine on a worker of the pool
+    class ScheduleAwaiter
+    {
+    public:
+
+        explicit ScheduleAwaiter(ThreadPool & threadPool)
+            : mThreadPool(threadPool)
+        {}
+
+        [[nodiscard]]
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> const handle)
+        {
+            // The awaiter lives in the coroutine frame, so the pool borrows the task instead of allocating one.
+            // The lambda only holds the handle and fits into std::function without a heap allocation.
+            // A pool without workers runs the task right here, the coroutine continues inside AssignTask
+            mResumeTask = [handle]()->void
+            {
+                handle.resume();
+            };
+            mThreadPool.AssignTask(&mResumeTask);
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+
+        ThreadPool & mThreadPool;
+        // Resuming may destroy the awaiter, nothing reads the task after it has called resume
+        ThreadPool::Task mResumeTask{};
+    };
+
+    //-------------------------------------------------------------------------------------------------
+
+    namespace TaskInternal
+    {
+        // Counts the finished tasks of WhenAll, the last one resumes the awaiter
+        struct WhenAllLatch
+        {
+            std::atomic<size_t> remainingCount = 0;
+            std::coroutine_handle<> awaiter{};
+        };
+
+        // Awaits a single task of WhenAll and reports to the latch when it is done
+        struct WhenAllHelper
+        {
+            struct promise_type : PromiseBase
+            {
+                WhenAllLatch * latch = nullptr;
+
+                [[nodiscard]]
+                WhenAllHelper get_return_object() noexcept
+                {
+                    return WhenAllHelper{std::coroutine_handle<promise_type>::from_promise(*this)};
+                }
+
+                struct LatchAwaiter
+                {
+                    [[nodiscard]]
+                    bool await_ready() const noexcept
+                    {
+                        return false;
+                    }
+
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> const handle) noexcept
+                    {
+                        auto * latch = handle.promise().latch;
+                        if (latch->remainingCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        {
+                            return latch->awaiter;
+                        }
+                        return std::noop_coroutine();
+                    }
+
+                    void await_resume() const noexcept {}
+                };
+
+                [[nodiscard]]
+                LatchAwaiter final_suspend() const noexcept
+                {
+                    return {};
+                }
+
+                void return_void() noexcept {}
+            };
+
+            explicit WhenAllHelper(std::coroutine_handle<promise_type> const handle_)
+                : handle(handle_)
+            {}
+
+            ~WhenAllHelper()
+            {
+                if (handle != nullptr)
+                {
+                    handle.destroy();
+                }
+            }
+
+            WhenAllHelper(WhenAllHelper const &) noexcept = delete;
+            WhenAllHelper & operator = (WhenAllHelper const &) noexcept = delete;
+
+            WhenAllHelper(WhenAllHelper && other) noexcept
+                : handle(std::exchange(other.handle, nullptr))
+            {}
+
+            WhenAllHelper & operator = (WhenAllHelper &&) noexcept = delete;
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        // Results and exceptions stay in the awaited task, the helper never throws
+        template<typename T>
+        WhenAllHelper MakeWhenAllHelper(Task<T> & task)
+        {
+            co_await task.WhenDone();
+        }
+
+        template<typename T>
+        class WhenAllAwaiter
+        {
+        public:
+
+            explicit WhenAllAwaiter(std::vector<Task<T>> & tasks)
+                : mTasks(tasks)
+            {}
+
+            [[nodiscard]]
+            bool await_ready() const noexcept
+            {
+                return mTasks.empty();
+            }
+
+            bool await_suspend(std::coroutine_handle<> const awaiter)
+            {
+                // One extra count keeps the awaiter from being resumed while the tasks are still being started
+                mLatch.remainingCount.store(mTasks.size() + 1, std::memory_order_relaxed);
+                mLatch.awaiter = awaiter;
+
+                mHelpers.reserve(mTasks.size());
+                for (auto & task : mTasks)
+                {
+                    auto & helper = mHelpers.emplace_back(MakeWhenAllHelper(task));
+                    helper.handle.promise().latch = &mLatch;
+                    helper.handle.resume();
+                }
+
+                // Every task finished synchronously, the awaiter just continues
+                return mLatch.remainingCount.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+
+            void await_resume() const noexcept {}
+
+        private:
+
+            std::vector<Task<T>> & mTasks;
+            std::vector<WhenAllHelper> mHelpers{};
+            WhenAllLatch mLatch{};
+        };
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    namespace TaskInternal
+    {
+        // Lets a thread that is not a worker sleep until a task is done
+        class SyncWaitEvent
+        {
+        public:
+
+            void Set();
+
+            void Wait();
+
+        private:
+
+            std::mutex mMutex{};
+            std::condition_variable mCondition{};
+            bool mIsSet = false;
+        };
+
+        // Awaits the task of SyncWait and sets the event when it is done
+        struct SyncWaitHelper
+        {
+            struct promise_type : PromiseBase
+            {
+                SyncWaitEvent * event = nullptr;
+
+                [[nodiscard]]
+                SyncWaitHelper get_return_object() noexcept
+                {
+                    return SyncWaitHelper{std::coroutine_handle<promise_type>::from_promise(*this)};
+                }
+
+                struct EventAwaiter
+                {
+                    [[nodiscard]]
+                    bool await_ready() const noexcept
+                    {
+                        return false;
+                    }
+
+                    void await_suspend(std::coroutine_handle<promise_type> const handle) noexcept
+                    {
+                        handle.promise().event->Set();
+                    }
+
+                    void await_resume() const noexcept {}
+                };
+
+                [[nodiscard]]
+                EventAwaiter final_suspend() const noexcept
+                {
+                    return {};
+                }
+
+                void return_void() noexcept {}
+            };
+
+            explicit SyncWaitHelper(std::coroutine_handle<promise_type> const handle_)
+                : handle(handle_)
+            {}
+
+            ~SyncWaitHelper()
+            {
+                if (handle != nullptr)
+                {
+                    handle.destroy();
+                }
+            }
+
+            SyncWaitHelper(SyncWaitHelper const &) noexcept = delete;
+            SyncWaitHelper(SyncWaitHelper &&) noexcept = delete;
+            SyncWaitHelper & operator = (SyncWaitHelper const &) noexcept = delete;
+            SyncWaitHelper & operator = (SyncWaitHelper &&) noexcept = delete;
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        // Results and exceptions stay in the awaited task, the helper never throws
+        template<typename T>
+        SyncWaitHelper MakeSyncWaitHelper(Task<T> & task)
+        {
+            co_await task.WhenDone();
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Starts every task at once and finishes when all of them are done. Tasks that begin with
+    // co_await JobSystem::Schedule() run in parallel. The first exception is rethrown after all tasks are done.
+    inline Task<void> WhenAll(std::vector<Task<void>> tasks)
+    {
+        co_await TaskInternal::WhenAllAwaiter<void>{tasks};
+        std::exception_ptr exception{};
+        for (auto & task : tasks)
+        {
+            try
+            {
+                task.TakeResult();
+            }
+            catch (...)
+            {
+                if (exception == nullptr)
+                {
+                    exception = std::current_exception();
+                }
+            }
+        }
+        if (exception != nullptr)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Results are in the order of the tasks
+    template<typename T>
+    Task<std::vector<T>> WhenAll(std::vector<Task<T>> tasks)
+    {
+        co_await TaskInternal::WhenAllAwaiter<T>{tasks};
+        std::vector<T> results{};
+        results.reserve(tasks.size());
+        for (auto & task : tasks)
+        {
+            results.emplace_back(task.TakeResult());
+        }
+        co_return results;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
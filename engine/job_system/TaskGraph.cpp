@@ -0,0 +1,277 @@
+#include "TaskGraph.hpp"
+
+#include "BedrockAssert.hpp"
+#include "ScopeProfiler.hpp"
+
+namespace MFA
+{
+
+    //-------------------------------------------------------------------------------------------------
+
+    TaskGraph::TaskGraph(ThreadPool & threadPool)
+        : mThreadPool(threadPool)
+    {
+        mTicket = [this]()->void
+        {
+            TryRunReadyNode();
+            // Nothing of the graph is touched after this, the destructor waits for it
+            mPendingTicketCount.fetch_sub(1, std::memory_order_release);
+        };
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    TaskGraph::~TaskGraph()
+    {
+        MFA_ASSERT(mRemainingNodeCount.load() == 0);
+        while (mPendingTicketCount.load(std::memory_order_acquire) > 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    TaskGraph::NodeId TaskGraph::AddNode(char const * name, std::function<void()> task)
+    {
+        MFA_ASSERT(task != nullptr);
+        MFA_ASSERT(mRemainingNodeCount.load() == 0);
+        auto const nodeId = static_cast<NodeId>(mNodes.size());
+        mNodes.emplace_back(Node{.name = name, .task = std::move(task)});
+        mIsDirty = true;
+        return nodeId;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskGraph::AddEdge(NodeId const from, NodeId const to)
+    {
+        MFA_ASSERT(from >= 0 && from < NodeCount());
+        MFA_ASSERT(to >= 0 && to < NodeCount());
+        MFA_ASSERT(from != to);
+        MFA_ASSERT(mRemainingNodeCount.load() == 0);
+        mNodes[from].successors.emplace_back(to);
+        ++mNodes[to].dependencyCount;
+        mIsDirty = true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskGraph::Clear()
+    {
+        MFA_ASSERT(mRemainingNodeCount.load() == 0);
+        mNodes.clear();
+        mRoots.clear();
+        mRemainingDependencies.reset();
+        mIsDirty = false;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskGraph::Run()
+    {
+        MFA_ASSERT(mRemainingNodeCount.load() == 0);
+
+        if (mIsDirty == true)
+        {
+            Prepare();
+        }
+        if (mRoots.empty())
+        {
+            return;
+        }
+
+        auto const nodeCount = NodeCount();
+        for (NodeId nodeId = 0; nodeId < nodeCount; ++nodeId)
+        {
+            mRemainingDependencies[nodeId].store(mNodes[nodeId].dependencyCount, std::memory_order_relaxed);
+        }
+        mHasFailed.store(false, std::memory_order_relaxed);
+        mRemainingNodeCount.store(nodeCount, std::memory_order_release);
+
+        for (size_t i = 1; i < mRoots.size(); ++i)
+        {
+            Schedule(mRoots[i]);
+        }
+        RunNode(mRoots[0]);
+
+        // Only nodes of this graph are taken here, unrelated tasks of the pool could hold up the caller for long
+        while (true)
+        {
+            NodeId nodeId = -1;
+            {
+                std::unique_lock lock{ mReadyMutex };
+                mReadyCondition.wait(lock, [this]()->bool
+                {
+                    return mReadyNodes.empty() == false || mRemainingNodeCount.load(std::memory_order_acquire) == 0;
+                });
+                if (mReadyNodes.empty())
+                {
+                    break;
+                }
+                nodeId = mReadyNodes.back();
+                mReadyNodes.pop_back();
+            }
+            RunNode(nodeId);
+        }
+
+        std::exception_ptr exception{};
+        {
+            std::lock_guard lock{ mExceptionMutex };
+            std::swap(exception, mException);
+        }
+        if (exception != nullptr)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    int TaskGraph::NodeCount() const
+    {
+        return static_cast<int>(mNodes.size());
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskGraph::Prepare()
+    {
+        mIsDirty = false;
+
+        auto const nodeCount = NodeCount();
+        mRemainingDependencies = std::make_unique<std::atomic<int>[]>(nodeCount);
+        {
+            // Late tickets of the previous run may still look at the list
+            std::lock_guard lock{ mReadyMutex };
+            mReadyNodes.reserve(nodeCount);
+        }
+
+        mRoots.clear();
+        for (NodeId nodeId = 0; nodeId < nodeCount; ++nodeId)
+        {
+            auto & node = mNodes[nodeId];
+            if (node.dependencyCount == 0)
+            {
+                mRoots.emplace_back(nodeId);
+            }
+        }
+
+#ifdef MFA_DEBUG
+        // Kahn's algorithm visits every node only if there is no cycle
+        std::vector<int> dependencyCounts(nodeCount);
+        for (NodeId nodeId = 0; nodeId < nodeCount; ++nodeId)
+        {
+            dependencyCounts[nodeId] = mNodes[nodeId].dependencyCount;
+        }
+        std::vector<NodeId> readyNodes = mRoots;
+        int visitedCount = 0;
+        while (readyNodes.empty() == false)
+        {
+            auto const nodeId = readyNodes.back();
+            readyNodes.pop_back();
+            ++visitedCount;
+            for (auto const successor : mNodes[nodeId].successors)
+            {
+                if (--dependencyCounts[successor] == 0)
+                {
+                    readyNodes.emplace_back(successor);
+                }
+            }
+        }
+        MFA_ASSERT(visitedCount == nodeCount);
+#endif
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskGraph::Schedule(NodeId const nodeId)
+    {
+        {
+            std::lock_guard lock{ mReadyMutex };
+            mReadyNodes.emplace_back(nodeId);
+        }
+        // Wakes Run when it sleeps, so it takes the node if no worker is free
+        mReadyCondition.notify_one();
+
+        mPendingTicketCount.fetch_add(1, std::memory_order_relaxed);
+        mThreadPool.AssignTask(&mTicket);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool TaskGraph::TryRunReadyNode()
+    {
+        NodeId nodeId = -1;
+        {
+            std::lock_guard lock{ mReadyMutex };
+            if (mReadyNodes.empty())
+            {
+                return false;
+            }
+            nodeId = mReadyNodes.back();
+            mReadyNodes.pop_back();
+        }
+        RunNode(nodeId);
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskGraph::RunNode(NodeId nodeId)
+    {
+        while (nodeId >= 0)
+        {
+            auto const & node = mNodes[nodeId];
+
+            if (mHasFailed.load(std::memory_order_acquire) == false)
+            {
+                SCOPE_Profiler(node.name)
+                try
+                {
+                    node.task();
+                }
+                catch (...)
+                {
+                    std::lock_guard lock{ mExceptionMutex };
+                    if (mException == nullptr)
+                    {
+                        mException = std::current_exception();
+                    }
+                    mHasFailed.store(true, std::memory_order_release);
+                }
+            }
+
+            // The first successor that becomes ready is the continuation of this thread
+            NodeId continuation = -1;
+            for (auto const successor : node.successors)
+            {
+                if (mRemainingDependencies[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    if (continuation < 0)
+                    {
+                        continuation = successor;
+                    }
+                    else
+                    {
+                        Schedule(successor);
+                    }
+                }
+            }
+
+            // Once the last node is counted Run may return. Counting under the lock keeps Run from returning before
+            // the notification is done, the graph is not touched after that.
+            {
+                std::lock_guard lock{ mReadyMutex };
+                if (mRemainingNodeCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    mReadyCondition.notify_all();
+                }
+            }
+            nodeId = continuation;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
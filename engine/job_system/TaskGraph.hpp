@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MFA
+{
+    // Directed acyclic graph of tasks that is built once and run many times, for example once per frame.
+    // A node starts when all the nodes before it are finished. The thread that finishes a node continues with one of
+    // the nodes that became ready and puts the others into the ready list of the graph, the pool gets a ticket that
+    // takes one of them. Run blocks until every node is done. Meanwhile it runs ready nodes of this graph and sleeps
+    // when there are none, it never picks up unrelated work of the pool. The ticket and the ready list are reused,
+    // so running the graph does not allocate unless nodes or edges were added since the previous run.
+    class TaskGraph
+    {
+    public:
+
+        using NodeId = int;
+
+        explicit TaskGraph(ThreadPool & threadPool);
+
+        // Waits for tickets that the pool has not run yet, so the graph has to be destroyed before the pool
+        ~TaskGraph();
+
+        TaskGraph(TaskGraph const &) noexcept = delete;
+        TaskGraph(TaskGraph &&) noexcept = delete;
+        TaskGraph & operator = (TaskGraph const &) noexcept = delete;
+        TaskGraph & operator = (TaskGraph &&) noexcept = delete;
+
+        // The name is stored by pointer and shows up in the cpu profiler, string literals are expected
+        NodeId AddNode(char const * name, std::function<void()> task);
+
+        // The second node starts after the first one is finished
+        void AddEdge(NodeId from, NodeId to);
+
+        void Clear();
+
+        // Nodes after a node that throws are skipped, the first exception is rethrown once the graph has stopped
+        void Run();
+
+        [[nodiscard]]
+        int NodeCount() const;
+
+    private:
+
+        struct Node
+        {
+            char const * name = nullptr;
+            std::function<void()> task{};
+            std::vector<NodeId> successors{};
+            int dependencyCount = 0;
+        };
+
+        // Finds the roots and checks that the graph has no cycle
+        void Prepare();
+
+        void Schedule(NodeId nodeId);
+
+        // Runs a node of the ready list, returns false when the list is empty
+        bool TryRunReadyNode();
+
+        void RunNode(NodeId nodeId);
+
+        ThreadPool & mThreadPool;
+
+        std::vector<Node> mNodes{};
+        std::vector<NodeId> mRoots{};
+        bool mIsDirty = false;
+
+        std::unique_ptr<std::atomic<int>[]> mRemainingDependencies{};
+        // Only changed under the ready mutex, so Run can sleep until it reaches zero
+        std::atomic<int> mRemainingNodeCount = 0;
+
+        // Every node is ready at most once per run, so the list never grows beyond the node count
+        std::vector<NodeId> mReadyNodes{};
+        std::mutex mReadyMutex{};
+        std::condition_variable mReadyCondition{};
+
+        // Lent to the pool once per scheduled node. A ticket that runs late finds an empty list or helps the next run.
+        ThreadPool::Task mTicket{};
+        std::atomic<int> mPendingTicketCount = 0;
+
+        std::atomic<bool> mHasFailed = false;
+        std::exception_ptr mException{};
+        std::mutex mExceptionMutex{};
+    };
+}
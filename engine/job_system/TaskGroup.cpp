@@ -0,0 +1,122 @@
+#include "TaskGroup.hpp"
+
+#include "BedrockAssert.hpp"
+
+namespace MFA
+{
+
+    //-------------------------------------------------------------------------------------------------
+
+    TaskGroup::TaskGroup(ThreadPool & threadPool)
+        : mThreadPool(threadPool)
+        , mState(std::make_shared<State>())
+    {}
+
+    //-------------------------------------------------------------------------------------------------
+
+    TaskGroup::~TaskGroup()
+    {
+        WaitForTasks();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskGroup::Run(std::function<void()> task)
+    {
+        MFA_ASSERT(task != nullptr);
+        {
+            std::lock_guard lock{ mState->mutex };
+            mState->pendingTasks.emplace_back(std::move(task));
+            ++mState->remainingTaskCount;
+        }
+        // A waiting owner takes the new task as well
+        mState->condition.notify_all();
+
+        mThreadPool.AssignTask([state = mState]()->void
+        {
+            RunPendingTask(*state);
+        });
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskGroup::Wait()
+    {
+        WaitForTasks();
+
+        std::exception_ptr exception{};
+        {
+            std::lock_guard lock{ mState->mutex };
+            std::swap(exception, mState->exception);
+        }
+        if (exception != nullptr)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool TaskGroup::RunPendingTask(State & state)
+    {
+        std::function<void()> task{};
+        {
+            std::lock_guard lock{ state.mutex };
+            if (state.pendingTasks.empty())
+            {
+                return false;
+            }
+            task = std::move(state.pendingTasks.front());
+            state.pendingTasks.pop_front();
+        }
+
+        std::exception_ptr exception{};
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        // Captures of the task are released before the owner can return from Wait
+        task = nullptr;
+
+        std::lock_guard lock{ state.mutex };
+        if (exception != nullptr && state.exception == nullptr)
+        {
+            state.exception = exception;
+        }
+        if (--state.remainingTaskCount == 0)
+        {
+            state.condition.notify_all();
+        }
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void TaskGroup::WaitForTasks()
+    {
+        while (true)
+        {
+            if (RunPendingTask(*mState) == true)
+            {
+                continue;
+            }
+            // The rest of the tasks are running on other threads
+            std::unique_lock lock{ mState->mutex };
+            mState->condition.wait(lock, [this]()->bool
+            {
+                return mState->remainingTaskCount == 0 || mState->pendingTasks.empty() == false;
+            });
+            if (mState->remainingTaskCount == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
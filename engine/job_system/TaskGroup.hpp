@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace MFA
+{
+    // Runs a set of tasks on the thread pool and waits for all of them.
+    // Tasks of a group wait in a queue of the group, the pool only gets a ticket that takes one of them.
+    // Wait runs the queued tasks of this group on the calling thread and sleeps once all of them are taken, so
+    // groups can be nested inside tasks and a waiting thread never picks up unrelated work of the pool.
+    // The first exception of a task is rethrown by Wait.
+    class TaskGroup
+    {
+    public:
+
+        explicit TaskGroup(ThreadPool & threadPool);
+
+        // Waits for the tasks that are still running, exceptions are dropped
+        ~TaskGroup();
+
+        TaskGroup(TaskGroup const &) noexcept = delete;
+        TaskGroup(TaskGroup &&) noexcept = delete;
+        TaskGroup & operator = (TaskGroup const &) noexcept = delete;
+        TaskGroup & operator = (TaskGroup &&) noexcept = delete;
+
+        void Run(std::function<void()> task);
+
+        void Wait();
+
+    private:
+
+        // Tickets that reach a worker after the group is done find an empty queue, they keep the state alive
+        struct State
+        {
+            std::mutex mutex{};
+            std::condition_variable condition{};
+            std::deque<std::function<void()>> pendingTasks{};
+            int remainingTaskCount = 0;
+            std::exception_ptr exception{};
+        };
+
+        // Returns false when every task of the group is taken
+        static bool RunPendingTask(State & state);
+
+        void WaitForTasks();
+
+        ThreadPool & mThreadPool;
+
+        std::shared_ptr<State> mState;
+    };
+}
@@ -1,26 +1,153 @@
 #include "ThreadPool.hpp"
 
+#include "BedrockLog.hpp"
+#include "BedrockPlatforms.hpp"
+#include "FrameProfiler.hpp"
+
+#if defined(__PLATFORM_WIN__)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__PLATFORM_LINUX__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+
 namespace MFA
 {
 
+    // Number of unsuccessful searches before an idle worker parks
+    static constexpr int SpinCount = 64;
+
+    static thread_local ThreadPool const * CurrentPool = nullptr;
+    static thread_local int CurrentWorkerNumber = -1;
+
+    // Tasks that belong to the caller are marked in the lowest bit of the pointer, std::function is pointer aligned
+    static constexpr uintptr_t BorrowedTaskBit = 1;
+
+    //-------------------------------------------------------------------------------------------------
+
+    static ThreadPool::Task * MarkBorrowed(ThreadPool::Task * task)
+    {
+        return reinterpret_cast<ThreadPool::Task *>(reinterpret_cast<uintptr_t>(task) | BorrowedTaskBit);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    static bool IsBorrowed(ThreadPool::Task const * task)
+    {
+        return (reinterpret_cast<uintptr_t>(task) & BorrowedTaskBit) != 0;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    static ThreadPool::Task * Unmark(ThreadPool::Task * task)
+    {
+        return reinterpret_cast<ThreadPool::Task *>(reinterpret_cast<uintptr_t>(task) & ~BorrowedTaskBit);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Borrowed tasks are left to their owner
+    static void DeleteTask(ThreadPool::Task * task)
+    {
+        if (IsBorrowed(task) == false)
+        {
+            delete task;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Xorshift, every thread has its own state so victims are picked without contention
+    static uint32_t NextRandom()
+    {
+        static thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Macs only take affinity hints, threads are left to the scheduler there
+    static void PinCurrentThread(int const coreIndex)
+    {
+#if defined(__PLATFORM_WIN__)
+        // Cores beyond the first processor group can not be addressed by a mask
+        if (coreIndex >= static_cast<int>(sizeof(DWORD_PTR) * 8) ||
+            SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << coreIndex) == 0)
+        {
+            MFA_LOG_WARN("Failed to pin the thread to core %d", coreIndex);
+        }
+#elif defined(__PLATFORM_LINUX__)
+        cpu_set_t cpuSet{};
+        CPU_ZERO(&cpuSet);
+        CPU_SET(coreIndex, &cpuSet);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+        {
+            MFA_LOG_WARN("Failed to pin the thread to core %d", coreIndex);
+        }
+#else
+        (void)coreIndex;
+#endif
+    }
+
     //-------------------------------------------------------------------------------------------------
 
-    ThreadPool::ThreadPool()
+    ThreadPool::ThreadPool(Params const & params)
     {
         mMainThreadId = std::this_thread::get_id();
-        mNumberOfThreads = static_cast<int>(std::thread::hardware_concurrency() * 0.75f);
-        MFA_LOG_INFO("Job system is running on %d threads. Available threads are: %d", mNumberOfThreads, static_cast<int>(std::thread::hardware_concurrency()));
-        if (mNumberOfThreads < 2)
+        FrameProfiler::Instance().SetThreadName("Main thread");
+
+        auto const coreCount = (std::max)(static_cast<int>(std::thread::hardware_concurrency()), 1);
+        auto const firstWorkerCore = params.reserveMainThread == true ? 1 : 0;
+        mNumberOfThreads = params.workerCount > 0 ? params.workerCount : coreCount - firstWorkerCore;
+        MFA_LOG_INFO(
+            "Job system is running on %d threads. Available threads are: %d. Main thread is %s",
+            mNumberOfThreads,
+            coreCount,
+            params.reserveMainThread == true ? "reserved" : "shared"
+        );
+
+        if (params.pinThreads == true && params.reserveMainThread == true)
         {
+            PinCurrentThread(0);
+        }
+
+        if (mNumberOfThreads < 1)
+        {
+            mNumberOfThreads = 0;
             mIsAlive = false;
         }
         else
         {
             mIsAlive = true;
-            mTasks = std::vector<ThreadSafeQueue<Task>>(mNumberOfThreads);
         	for (int threadIndex = 0; threadIndex < mNumberOfThreads; threadIndex++)
             {
-                mThreadObjects.emplace_back(std::make_unique<ThreadObject>(threadIndex, *this));
+                // Workers wrap around when there are more of them than cores, the main core is only shared without a spare one
+                auto const spareCoreCount = coreCount - firstWorkerCore;
+                auto coreIndex = -1;
+                if (params.pinThreads == true)
+                {
+                    coreIndex = spareCoreCount > 0
+                        ? firstWorkerCore + threadIndex % spareCoreCount
+                        : threadIndex % coreCount;
+                }
+                mThreadObjects.emplace_back(std::make_unique<ThreadObject>(threadIndex, coreIndex, *this));
+            }
+            // Workers steal from each other, so they start once all of them exist
+            for (auto const & threadObject : mThreadObjects)
+            {
+                threadObject->Start();
             }
         }
 
@@ -35,17 +162,45 @@ namespace MFA
 
     //-------------------------------------------------------------------------------------------------
 
+    bool ThreadPool::IsWorkerThread() const
+    {
+        return CurrentPool == this && CurrentWorkerNumber >= 0;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    int ThreadPool::WorkerIndex() const
+    {
+        return CurrentPool == this ? CurrentWorkerNumber : -1;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     ThreadPool::~ThreadPool()
     {
-        mIsAlive = false;
-        for (auto const & thread : mThreadObjects)
         {
-            thread->Notify();
+            std::lock_guard lock{ mParkMutex };
+            mIsAlive = false;
         }
+        mParkCondition.notify_all();
         for (auto const & thread : mThreadObjects)
         {
             thread->Join();
         }
+
+        // Tasks that never started are dropped
+        Task * task = nullptr;
+        for (auto const & thread : mThreadObjects)
+        {
+            while (thread->Tasks().Steal(task))
+            {
+                DeleteTask(task);
+            }
+        }
+        while (mSharedTasks.TryToPop(task))
+        {
+            DeleteTask(task);
+        }
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -56,9 +211,7 @@ namespace MFA
 
         if (mIsAlive == true)
         {
-            mTasks[mNextTaskIdx].Push(task);
-            mThreadObjects[mNextTaskIdx]->Notify();
-            mNextTaskIdx = (mNextTaskIdx + 1) % mThreadObjects.size();
+            PushTask(new Task(task));
         }
         else
         {
@@ -68,55 +221,168 @@ namespace MFA
 
     //-------------------------------------------------------------------------------------------------
 
-    ThreadPool::ThreadObject::ThreadObject(int const threadNumber, ThreadPool & parent)
-        :
-        mParent(parent),
-        mThreadNumber(threadNumber)
+    void ThreadPool::AssignTask(Task * task)
     {
-        mThread = std::make_unique<std::thread>([this]()-> void
+        assert(task != nullptr && *task != nullptr);
+        MFA_ASSERT(IsBorrowed(task) == false);
+
+        if (mIsAlive == true)
         {
-            mainLoop();
-        });
+            PushTask(MarkBorrowed(task));
+        }
+        else
+        {
+            (*task)();
+        }
     }
 
     //-------------------------------------------------------------------------------------------------
 
-    int ThreadPool::NumberOfAvailableThreads() const
+    void ThreadPool::PushTask(Task * task)
     {
-        return mNumberOfThreads;
+        // Counted before it is visible, so a worker that finds it never drives the count below zero
+        mPendingTaskCount.fetch_add(1);
+        if (CurrentPool == this && CurrentWorkerNumber >= 0)
+        {
+            mThreadObjects[CurrentWorkerNumber]->Tasks().Push(task);
+        }
+        else if (mSharedTasks.TryToPush(task) == false)
+        {
+            // Workers are far behind, running the task here slows down the producer instead of growing the queue
+            mPendingTaskCount.fetch_sub(1);
+            RunTask(task);
+            return;
+        }
+        WakeWorker();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool ThreadPool::TryRunPendingTask()
+    {
+        if (mIsAlive == false)
+        {
+            return false;
+        }
+        auto * task = FindTask(CurrentPool == this ? CurrentWorkerNumber : -1);
+        if (task == nullptr)
+        {
+            return false;
+        }
+        RunTask(task);
+        return true;
     }
 
     //-------------------------------------------------------------------------------------------------
 
-    bool ThreadPool::ThreadObject::AwakeCondition(int idx)
+    ThreadPool::Task * ThreadPool::FindTask(int const workerNumber)
     {
-        return mParent.mTasks[idx].IsEmpty() == false || mParent.mIsAlive == false;
+        Task * task = nullptr;
+
+        if (workerNumber >= 0 && mThreadObjects[workerNumber]->Tasks().Pop(task))
+        {
+            mPendingTaskCount.fetch_sub(1);
+            return task;
+        }
+
+        if (mSharedTasks.TryToPop(task))
+        {
+            mPendingTaskCount.fetch_sub(1);
+            return task;
+        }
+
+        // Starting from a random victim spreads the thieves over the workers
+        auto const threadCount = static_cast<int>(mThreadObjects.size());
+        auto const firstVictim = threadCount > 0 ? static_cast<int>(NextRandom() % static_cast<uint32_t>(threadCount)) : 0;
+        for (int i = 0; i < threadCount; ++i)
+        {
+            auto const victim = (firstVictim + i) % threadCount;
+            if (victim != workerNumber && mThreadObjects[victim]->Tasks().Steal(task))
+            {
+                mPendingTaskCount.fetch_sub(1);
+                return task;
+            }
+        }
+
+        return nullptr;
     }
 
     //-------------------------------------------------------------------------------------------------
 
-    void ThreadPool::ThreadObject::Join() const
+    void ThreadPool::RunTask(Task * task)
     {
-        mThread->join();
+        MFA_ASSERT(task != nullptr);
+        auto const & function = *Unmark(task);
+        try
+        {
+            if (function != nullptr)
+            {
+                function();
+            }
+        }
+        catch (std::exception const & exception)
+        {
+            if (mExceptions.TryToPush(std::string{ exception.what() }) == false)
+            {
+                MFA_LOG_ERROR("Task failed with exception: %s", exception.what());
+            }
+        }
+        DeleteTask(task);
     }
 
     //-------------------------------------------------------------------------------------------------
 
-    bool ThreadPool::ThreadObject::IsFree()
+    void ThreadPool::WakeWorker()
     {
-        auto const isFree = mIsBusy == false;
-        if (isFree == false)
+        if (mParkedWorkerCount.load() > 0)
         {
-            mCondition.notify_one();
+            // Taking the lock makes sure that a worker that is about to park sees the new task
+            {
+                std::lock_guard lock{ mParkMutex };
+            }
+            mParkCondition.notify_one();
         }
-        return isFree;
     }
 
     //-------------------------------------------------------------------------------------------------
 
-    void ThreadPool::ThreadObject::Notify()
+    ThreadPool::ThreadObject::ThreadObject(int const threadNumber, int const coreIndex, ThreadPool & parent)
+        :
+        mParent(parent),
+        mThreadNumber(threadNumber),
+        mCoreIndex(coreIndex)
+    {}
+
+    //-------------------------------------------------------------------------------------------------
+
+    void ThreadPool::ThreadObject::Start()
+    {
+        MFA_ASSERT(mThread == nullptr);
+        mThread = std::make_unique<std::thread>([this]()-> void
+        {
+            mainLoop();
+        });
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    int ThreadPool::NumberOfAvailableThreads() const
+    {
+        return mNumberOfThreads;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void ThreadPool::ThreadObject::Join() const
+    {
+        mThread->join();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool ThreadPool::ThreadObject::IsFree() const
     {
-        mCondition.notify_one();
+        return mIsBusy == false;
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -128,41 +394,55 @@ namespace MFA
 
     //-------------------------------------------------------------------------------------------------
 
+    WorkStealingDeque<ThreadPool::Task *> & ThreadPool::ThreadObject::Tasks()
+    {
+        return mTasks;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     void ThreadPool::ThreadObject::mainLoop()
     {
-        std::mutex mutex{};
-        std::unique_lock<std::mutex> mLock{ mutex };
+        FrameProfiler::Instance().SetThreadName("Worker " + std::to_string(mThreadNumber));
+        if (mCoreIndex >= 0)
+        {
+            PinCurrentThread(mCoreIndex);
+        }
+
+        CurrentPool = &mParent;
+        CurrentWorkerNumber = mThreadNumber;
+
+        int failedSearchCount = 0;
         while (mParent.mIsAlive)
         {
-            mCondition.wait(mLock, [this]()->bool
-                {
-                    return AwakeCondition(mThreadNumber);
-                }
-            );
-            mIsBusy = true;
-            while (mParent.mIsAlive)
+            auto * task = mParent.FindTask(mThreadNumber);
+            if (task != nullptr)
             {
-                Task currentTask;
-                bool isEmpty = false;
-                while (mParent.mTasks[mThreadNumber].TryToPop(currentTask, isEmpty) == false);
-                if (isEmpty == true)
-                {
-	                break;
-                }
-                try
-                {
-                    if (currentTask != nullptr)
-                    {
-                        currentTask();
-                    }
-                }
-                catch (std::exception const & exception)
-                {
-                    while (mParent.mExceptions.TryToPush(exception.what()) == false);
-                }
+                failedSearchCount = 0;
+                mIsBusy = true;
+                mParent.RunTask(task);
+                mIsBusy = false;
+                continue;
+            }
+
+            if (++failedSearchCount < SpinCount)
+            {
+                std::this_thread::yield();
+                continue;
             }
-            mIsBusy = false;
+            failedSearchCount = 0;
+
+            std::unique_lock lock{ mParent.mParkMutex };
+            ++mParent.mParkedWorkerCount;
+            mParent.mParkCondition.wait(lock, [this]()->bool
+            {
+                return mParent.mPendingTaskCount.load() > 0 || mParent.mIsAlive == false;
+            });
+            --mParent.mParkedWorkerCount;
         }
+
+        CurrentPool = nullptr;
+        CurrentWorkerNumber = -1;
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -184,22 +464,10 @@ namespace MFA
     std::vector<std::string> ThreadPool::Exceptions()
     {
         std::vector<std::string> exceptions{};
-
-        while (true)
+        std::string exception{};
+        while (mExceptions.TryToPop(exception))
         {
-            std::string exception;
-            bool isEmpty = false;
-            if (mExceptions.TryToPop(exception, isEmpty))
-            {
-                if (isEmpty == false)
-                {
-                    exceptions.emplace_back(exception);
-                }
-                else
-                {
-	                break;
-                }
-            }
+            exceptions.emplace_back(std::move(exception));
         }
         return exceptions;
     }
@@ -1,24 +1,40 @@
 #pragma once
 
 #include "ThreadSafeQueue.hpp"
+#include "WorkStealingDeque.hpp"
 
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include <string>
 #include <vector>
 
 namespace MFA
 {
 
+    // Every worker owns a work stealing deque. Tasks that are assigned from a worker go to its own deque,
+    // tasks from other threads go to a shared queue. Idle workers take the shared tasks and then steal from a random
+    // worker before they park on a condition variable. Assigning a task wakes a parked worker only when one exists.
     class ThreadPool
     {
     public:
 
         using Task = std::function<void()>;
-        
-        explicit ThreadPool();
-        // We can have a threadPool with custom number of threads
+
+        // Every parallel part of the engine runs on these workers, so this is the whole thread budget of the process
+        struct Params
+        {
+            // Zero picks one worker per core, minus the core of the main thread when it is reserved
+            int workerCount = 0;
+            // The main thread keeps a core that no worker is pinned to
+            bool reserveMainThread = true;
+            // Binds every worker and a reserved main thread to a core of its own, so they do not migrate between cores
+            bool pinThreads = false;
+        };
+
+        // Has to be created on the main thread
+        explicit ThreadPool(Params const & params);
 
         ~ThreadPool();
 
@@ -30,16 +46,32 @@ namespace MFA
         [[nodiscard]]
         bool IsMainThread() const;
 
+        [[nodiscard]]
+        bool IsWorkerThread() const;
+
+        // Index of the calling worker in [0, NumberOfAvailableThreads()), -1 on threads that are not workers of this pool
+        [[nodiscard]]
+        int WorkerIndex() const;
+
         void AssignTask(Task const & task);
 
+        // The task is owned by the caller and has to stay alive until it has run. Nothing is allocated, so
+        // callers that schedule the same work every frame keep their tasks and pass them again.
+        void AssignTask(Task * task);
+
+        // Runs one pending task on the calling thread, returns false if none was found.
+        // Only workers should call it while they wait, any other thread would pick up unrelated and possibly long work.
+        bool TryRunPendingTask();
+
         [[nodiscard]]
         int NumberOfAvailableThreads() const;
-        
+
         class ThreadObject
         {
         public:
 
-            explicit ThreadObject(int threadNumber, ThreadPool & parent);
+            // Core index is -1 for workers that are not pinned
+            explicit ThreadObject(int threadNumber, int coreIndex, ThreadPool & parent);
 
             ~ThreadObject() = default;
 
@@ -48,32 +80,35 @@ namespace MFA
             ThreadObject & operator = (ThreadObject const &) noexcept = delete;
             ThreadObject & operator = (ThreadObject &&) noexcept = delete;
 
+            void Start();
+
             void Join() const;
 
             [[nodiscard]]
-            bool IsFree();
-
-            void Notify();
+            bool IsFree() const;
 
             [[nodiscard]]
             int GetThreadNumber() const;
 
-            bool AwakeCondition(int idx);
+            [[nodiscard]]
+            WorkStealingDeque<Task *> & Tasks();
 
         private:
 
             void mainLoop();
-            
+
             ThreadPool & mParent;
 
             int mThreadNumber;
 
-            std::condition_variable mCondition;
+            int mCoreIndex;
 
             std::unique_ptr<std::thread> mThread;
 
             std::atomic<bool> mIsBusy = false;
 
+            WorkStealingDeque<Task *> mTasks{};
+
         };
 
         bool AllThreadsAreIdle() const;
@@ -81,17 +116,36 @@ namespace MFA
         std::vector<std::string> Exceptions();
 
     private:
-        
+
+        // Worker number is -1 for threads that are not part of the pool
+        [[nodiscard]]
+        Task * FindTask(int workerNumber);
+
+        // Deletes the task afterwards unless it is borrowed from the caller
+        void RunTask(Task * task);
+
+        // Pushes a task that the pool owns or a borrowed one, see AssignTask
+        void PushTask(Task * task);
+
+        void WakeWorker();
+
         std::vector<std::unique_ptr<ThreadObject>> mThreadObjects;
 
-        bool mIsAlive = true;
+        std::atomic<bool> mIsAlive = true;
 
         int mNumberOfThreads = 0;
 
-        ThreadSafeQueue<std::string> mExceptions{};
+        // Exceptions that do not fit are only logged
+        ThreadSafeQueue<std::string> mExceptions{ 64 };
+
+        // Tasks that are assigned from outside of the workers, the assigning thread runs the task itself when it is full
+        ThreadSafeQueue<Task *> mSharedTasks{ 4096 };
 
-        std::vector<ThreadSafeQueue<Task>> mTasks{};
-        int mNextTaskIdx {};
+        // Assigned tasks that are not taken yet, parked workers wake up when it is positive
+        std::atomic<int64_t> mPendingTaskCount = 0;
+        std::atomic<int> mParkedWorkerCount = 0;
+        std::mutex mParkMutex{};
+        std::condition_variable mParkCondition{};
 
         std::thread::id mMainThreadId{};
 
@@ -1,79 +1,156 @@
 #pragma once
 
 #include "BedrockAssert.hpp"
-#include "ScopeLock.hpp"
 
-#include <queue>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace MFA {
 
+// Bounded multi producer multi consumer ring of Dmitry Vyukov. Every cell carries a sequence number that tells
+// producers and consumers whether it is their turn, so the only contention is a single CAS on the head or the tail.
+// Items are moved in and out, move only payloads are supported. Full and empty queues fail instead of spinning,
+// callers decide how to back off.
 template <typename T>
 class ThreadSafeQueue {
 public:
 
-    bool TryToPush(T newData) {
-        bool expectedValue = false;
-        bool const desiredValue = true;
-        if (mLock.compare_exchange_strong(expectedValue, desiredValue) == false) {
-            return false;
+    explicit ThreadSafeQueue(size_t const capacity = 1024)
+        : mMask(capacity - 1)
+        , mCells(std::make_unique<Cell[]>(capacity))
+    {
+        MFA_ASSERT(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
         }
-
-        MFA_ASSERT(mLock == true);
-        mData.push(newData);
-        mLock = false;
-        return true;
     }
 
-    void Push(T newData)
+    // No other thread uses the queue anymore, so the items between the head and the tail are destroyed in place
+    ~ThreadSafeQueue()
     {
-        while (TryToPush(newData) == false);
+        auto const tail = mTail.load(std::memory_order_acquire);
+        for (auto position = mHead.load(std::memory_order_acquire); position != tail; ++position)
+        {
+            std::launder(reinterpret_cast<T *>(mCells[position & mMask].Storage()))->~T();
+        }
     }
 
-    // Returns front item
-    bool TryToPop(T & outData, bool & isEmpty) {
-        bool expectedValue = false;
-        bool const desiredValue = true;
-
-        isEmpty = true;
-
-        if (mLock.compare_exchange_strong(expectedValue, desiredValue) == false) {
-            return false;
+    ThreadSafeQueue(ThreadSafeQueue const &) noexcept = delete;
+    ThreadSafeQueue(ThreadSafeQueue &&) noexcept = delete;
+    ThreadSafeQueue & operator = (ThreadSafeQueue const &) noexcept = delete;
+    ThreadSafeQueue & operator = (ThreadSafeQueue &&) noexcept = delete;
+
+    // Returns false when the queue is full, the item is left untouched in that case
+    template <typename U>
+    bool TryToPush(U && newData) {
+        Cell * cell = nullptr;
+        auto position = mTail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &mCells[position & mMask];
+            auto const sequence = cell->sequence.load(std::memory_order_acquire);
+            auto const difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (difference == 0)
+            {
+                if (mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = mTail.load(std::memory_order_relaxed);
+            }
         }
 
-        MFA_ASSERT(mLock == true);
-        bool success = true;
-        if (mData.empty() == false) 
+        new (cell->Storage()) T(std::forward<U>(newData));
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false when the queue is empty
+    bool TryToPop(T & outData) {
+        Cell * cell = nullptr;
+        auto position = mHead.load(std::memory_order_relaxed);
+        while (true)
         {
-            outData = mData.front();
-            isEmpty = false;
-            mData.pop();
+            cell = &mCells[position & mMask];
+            auto const sequence = cell->sequence.load(std::memory_order_acquire);
+            auto const difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+            if (difference == 0)
+            {
+                if (mHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = mHead.load(std::memory_order_relaxed);
+            }
         }
 
-        mLock = false;
-        return success;
+        auto * item = std::launder(reinterpret_cast<T *>(cell->Storage()));
+        outData = std::move(*item);
+        item->~T();
+        cell->sequence.store(position + mMask + 1, std::memory_order_release);
+        return true;
     }
 
-    void Pop(T & outData, bool& isEmpty)
-    {
-        while (TryToPop(outData, isEmpty) == false);
+    // Only a hint while other threads push or pop
+    [[nodiscard]]
+    bool IsEmpty() const {
+        return ItemCount() == 0;
     }
 
+    // Only a hint while other threads push or pop
     [[nodiscard]]
-    bool IsEmpty() {
-        SCOPE_LOCK(mLock)
-        return mData.empty();
+    size_t ItemCount() const
+    {
+        auto const head = mHead.load(std::memory_order_acquire);
+        auto const tail = mTail.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
     }
 
     [[nodiscard]]
-    size_t ItemCount()
+    size_t Capacity() const
     {
-        SCOPE_LOCK(mLock)
-        return mData.size();
+        return mMask + 1;
     }
 
 private:
-    std::atomic<bool> mLock = false;
-    std::queue<T> mData {};
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence = 0;
+        alignas(T) std::byte storage[sizeof(T)];
+
+        [[nodiscard]]
+        void * Storage()
+        {
+            return storage;
+        }
+    };
+
+    size_t const mMask;
+    std::unique_ptr<Cell[]> mCells;
+
+    // Producers and consumers work on different cache lines
+    alignas(64) std::atomic<size_t> mTail = 0;
+    alignas(64) std::atomic<size_t> mHead = 0;
 };
 
 }
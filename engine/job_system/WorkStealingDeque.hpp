@@ -0,0 +1,162 @@
+#pragma once
+
+#include "BedrockAssert.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace MFA
+{
+    // Chase-Lev deque with the memory orders of "Correct and Efficient Work-Stealing for Weak Memory Models".
+    // Only the owner thread may push and pop, they work on the bottom like a stack so the most recent task stays hot
+    // in cache. Any other thread can steal the oldest task from the top.
+    // Items have to be trivially copyable, tasks are stored by pointer.
+    template<typename T>
+    class WorkStealingDeque
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+    public:
+
+        explicit WorkStealingDeque(int64_t const initialCapacity = 256)
+        {
+            MFA_ASSERT(initialCapacity > 0 && (initialCapacity & (initialCapacity - 1)) == 0);
+            auto & array = mArrays.emplace_back(std::make_unique<Array>(initialCapacity));
+            mArray.store(array.get(), std::memory_order_relaxed);
+        }
+
+        ~WorkStealingDeque() = default;
+
+        WorkStealingDeque(WorkStealingDeque const &) noexcept = delete;
+        WorkStealingDeque(WorkStealingDeque &&) noexcept = delete;
+        WorkStealingDeque & operator = (WorkStealingDeque const &) noexcept = delete;
+        WorkStealingDeque & operator = (WorkStealingDeque &&) noexcept = delete;
+
+        // Owner only
+        void Push(T item)
+        {
+            auto const bottom = mBottom.load(std::memory_order_relaxed);
+            auto const top = mTop.load(std::memory_order_acquire);
+            auto * array = mArray.load(std::memory_order_relaxed);
+            if (bottom - top > array->capacity - 1)
+            {
+                array = Grow(array, bottom, top);
+            }
+            array->Put(bottom, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            mBottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        // Owner only, returns the most recently pushed item
+        [[nodiscard]]
+        bool Pop(T & outItem)
+        {
+            auto const bottom = mBottom.load(std::memory_order_relaxed) - 1;
+            auto * array = mArray.load(std::memory_order_relaxed);
+            mBottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto top = mTop.load(std::memory_order_relaxed);
+
+            if (top > bottom)
+            {
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            outItem = array->Get(bottom);
+            if (top == bottom)
+            {
+                // Last item, a thief may be taking it at the same time
+                bool const won = mTop.compare_exchange_strong(
+                    top,
+                    top + 1,
+                    std::memory_order_seq_cst,
+                    std::memory_order_relaxed
+                );
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        // Any thread, returns the oldest item. Fails when the deque is empty or another thread won the race.
+        [[nodiscard]]
+        bool Steal(T & outItem)
+        {
+            auto top = mTop.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto const bottom = mBottom.load(std::memory_order_acquire);
+
+            if (top >= bottom)
+            {
+                return false;
+            }
+
+            auto * array = mArray.load(std::memory_order_acquire);
+            auto const item = array->Get(top);
+            if (mTop.compare_exchange_strong(
+                top,
+                top + 1,
+                std::memory_order_seq_cst,
+                std::memory_order_relaxed
+            ) == false)
+            {
+                return false;
+            }
+            outItem = item;
+            return true;
+        }
+
+        [[nodiscard]]
+        bool IsEmpty() const
+        {
+            auto const bottom = mBottom.load(std::memory_order_relaxed);
+            auto const top = mTop.load(std::memory_order_relaxed);
+            return top >= bottom;
+        }
+
+    private:
+
+        struct Array
+        {
+            explicit Array(int64_t const capacity_)
+                : capacity(capacity_)
+                , items(std::make_unique<std::atomic<T>[]>(static_cast<size_t>(capacity_)))
+            {}
+
+            [[nodiscard]]
+            T Get(int64_t const index) const
+            {
+                return items[index & (capacity - 1)].load(std::memory_order_relaxed);
+            }
+
+            void Put(int64_t const index, T item)
+            {
+                items[index & (capacity - 1)].store(item, std::memory_order_relaxed);
+            }
+
+            int64_t const capacity;
+            std::unique_ptr<std::atomic<T>[]> items;
+        };
+
+        Array * Grow(Array * oldArray, int64_t const bottom, int64_t const top)
+        {
+            auto & newArray = mArrays.emplace_back(std::make_unique<Array>(oldArray->capacity * 2));
+            for (auto i = top; i < bottom; ++i)
+            {
+                newArray->Put(i, oldArray->Get(i));
+            }
+            mArray.store(newArray.get(), std::memory_order_release);
+            return newArray.get();
+        }
+
+        alignas(64) std::atomic<int64_t> mTop = 0;
+        alignas(64) std::atomic<int64_t> mBottom = 0;
+        std::atomic<Array *> mArray = nullptr;
+        // Thieves may still read an old array, so they are only released with the deque
+        std::vector<std::unique_ptr<Array>> mArrays{};
+    };
+}
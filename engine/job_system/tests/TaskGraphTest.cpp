@@ -0,0 +1,149 @@
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Task graphs: nodes start after their dependencies, the graph runs again without being rebuilt, Run leaves
+// unrelated tasks of the pool to the workers and exceptions skip the remaining nodes.
+
+namespace
+{
+    using namespace MFA;
+
+    int FailureCount = 0;
+
+    //-------------------------------------------------------------------------------------------------
+
+    void Check(bool const condition, char const * description)
+    {
+        if (condition == false)
+        {
+            std::printf("Failed: %s\n", description);
+            ++FailureCount;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
+
+int main()
+{
+    // Few workers, so unrelated tasks are still queued while the main thread waits
+    auto jobSystem = JobSystem::Instantiate(ThreadPool::Params{.workerCount = 2});
+    auto const mainThreadId = std::this_thread::get_id();
+
+    {// Dependencies are respected on every run
+        // a -> {b, c, d} -> e
+        std::atomic<int> step = 0;
+        std::atomic<int> aStep = -1;
+        std::atomic<int> eStep = -1;
+        std::atomic<int> middleAfterA = 0;
+
+        auto taskGraph = jobSystem->CreateTaskGraph();
+        auto const a = taskGraph->AddNode("a", [&]()->void
+        {
+            aStep = step.fetch_add(1);
+        });
+        auto const e = taskGraph->AddNode("e", [&]()->void
+        {
+            eStep = step.fetch_add(1);
+        });
+        for (int i = 0; i < 3; ++i)
+        {
+            auto const middle = taskGraph->AddNode("middle", [&]()->void
+            {
+                if (aStep.load() >= 0)
+                {
+                    middleAfterA.fetch_add(1);
+                }
+                step.fetch_add(1);
+            });
+            taskGraph->AddEdge(a, middle);
+            taskGraph->AddEdge(middle, e);
+        }
+
+        bool isOrdered = true;
+        for (int run = 0; run < 100; ++run)
+        {
+            step = 0;
+            aStep = -1;
+            eStep = -1;
+            middleAfterA = 0;
+            taskGraph->Run();
+            isOrdered &= aStep.load() == 0 && eStep.load() == 4 && middleAfterA.load() == 3;
+        }
+        Check(isOrdered, "Nodes start after their dependencies");
+    }
+
+    {// Run does not pick up unrelated tasks
+        std::atomic<int> unrelatedOnMainThread = 0;
+        std::vector<std::future<void>> unrelatedTasks{};
+        for (int i = 0; i < 8; ++i)
+        {
+            unrelatedTasks.emplace_back(jobSystem->AssignTask([&]()->void
+            {
+                if (std::this_thread::get_id() == mainThreadId)
+                {
+                    unrelatedOnMainThread.fetch_add(1);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }));
+        }
+
+        std::atomic<int> nodeCount = 0;
+        auto taskGraph = jobSystem->CreateTaskGraph();
+        auto const root = taskGraph->AddNode("root", []()->void {});
+        for (int i = 0; i < 8; ++i)
+        {
+            auto const node = taskGraph->AddNode("node", [&]()->void
+            {
+                nodeCount.fetch_add(1);
+            });
+            taskGraph->AddEdge(root, node);
+        }
+        taskGraph->Run();
+        Check(nodeCount.load() == 8, "Run returns after every node");
+        Check(unrelatedOnMainThread.load() == 0, "Run leaves unrelated tasks to the workers");
+
+        for (auto & task : unrelatedTasks)
+        {
+            task.wait();
+        }
+    }
+
+    {// A failed node skips the nodes after it
+        std::atomic<bool> hasRunAfterFailure = false;
+        auto taskGraph = jobSystem->CreateTaskGraph();
+        auto const failing = taskGraph->AddNode("failing", []()->void
+        {
+            throw std::runtime_error("node failed");
+        });
+        auto const after = taskGraph->AddNode("after", [&]()->void
+        {
+            hasRunAfterFailure = true;
+        });
+        taskGraph->AddEdge(failing, after);
+
+        std::string message{};
+        try
+        {
+            taskGraph->Run();
+        }
+        catch (std::runtime_error const & exception)
+        {
+            message = exception.what();
+        }
+        Check(message == "node failed", "Run rethrows the exception of a node");
+        Check(hasRunAfterFailure.load() == false, "Nodes after a failed node are skipped");
+    }
+
+    std::printf(FailureCount == 0 ? "Passed\n" : "Failed\n");
+    return FailureCount == 0 ? 0 : 1;
+}
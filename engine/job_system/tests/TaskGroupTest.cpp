@@ -0,0 +1,137 @@
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Task groups and parallel loops: the caller only helps with its own work, unrelated tasks of the pool stay on
+// the workers, and exceptions reach Wait.
+
+namespace
+{
+    using namespace MFA;
+
+    int FailureCount = 0;
+
+    //-------------------------------------------------------------------------------------------------
+
+    void Check(bool const condition, char const * description)
+    {
+        if (condition == false)
+        {
+            std::printf("Failed: %s\n", description);
+            ++FailureCount;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
+
+int main()
+{
+    // Few workers, so unrelated tasks are still queued while the main thread waits
+    auto jobSystem = JobSystem::Instantiate(ThreadPool::Params{.workerCount = 2});
+    auto const mainThreadId = std::this_thread::get_id();
+
+    {// Waiting does not pick up unrelated tasks
+        std::atomic<int> unrelatedOnMainThread = 0;
+        std::vector<std::future<void>> unrelatedTasks{};
+        for (int i = 0; i < 8; ++i)
+        {
+            unrelatedTasks.emplace_back(jobSystem->AssignTask([&]()->void
+            {
+                if (std::this_thread::get_id() == mainThreadId)
+                {
+                    unrelatedOnMainThread.fetch_add(1);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }));
+        }
+
+        std::atomic<int> groupCount = 0;
+        auto taskGroup = jobSystem->CreateTaskGroup();
+        for (int i = 0; i < 16; ++i)
+        {
+            taskGroup.Run([&]()->void
+            {
+                groupCount.fetch_add(1);
+            });
+        }
+        taskGroup.Wait();
+        Check(groupCount.load() == 16, "Wait returns after every task of the group");
+        Check(unrelatedOnMainThread.load() == 0, "Wait leaves unrelated tasks to the workers");
+
+        jobSystem->ParallelFor(0, 64, [](int, int)->void {}, 1);
+        Check(unrelatedOnMainThread.load() == 0, "ParallelFor leaves unrelated tasks to the workers");
+
+        for (auto & task : unrelatedTasks)
+        {
+            task.wait();
+        }
+    }
+
+    {// ParallelFor visits every item once
+        std::vector<std::atomic<int>> visits(1000);
+        jobSystem->ParallelFor(0, 1000, [&](int const rangeBegin, int const rangeEnd)->void
+        {
+            for (int i = rangeBegin; i < rangeEnd; ++i)
+            {
+                visits[i].fetch_add(1);
+            }
+        }, 16);
+        bool everyItemOnce = true;
+        for (auto const & visit : visits)
+        {
+            everyItemOnce &= visit.load() == 1;
+        }
+        Check(everyItemOnce, "ParallelFor visits every item once");
+    }
+
+    {// Nested groups inside the tasks of a group
+        std::atomic<int> count = 0;
+        auto outerGroup = jobSystem->CreateTaskGroup();
+        for (int i = 0; i < 4; ++i)
+        {
+            outerGroup.Run([&]()->void
+            {
+                auto innerGroup = jobSystem->CreateTaskGroup();
+                for (int j = 0; j < 4; ++j)
+                {
+                    innerGroup.Run([&]()->void
+                    {
+                        count.fetch_add(1);
+                    });
+                }
+                innerGroup.Wait();
+            });
+        }
+        outerGroup.Wait();
+        Check(count.load() == 16, "Nested groups finish");
+    }
+
+    {// Exceptions reach Wait
+        std::string message{};
+        auto taskGroup = jobSystem->CreateTaskGroup();
+        taskGroup.Run([]()->void
+        {
+            throw std::runtime_error("group task failed");
+        });
+        try
+        {
+            taskGroup.Wait();
+        }
+        catch (std::runtime_error const & exception)
+        {
+            message = exception.what();
+        }
+        Check(message == "group task failed", "Wait rethrows the exception of a task");
+    }
+
+    std::printf(FailureCount == 0 ? "Passed\n" : "Failed\n");
+    return FailureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Coroutine tasks: Schedule resumes on a worker, WhenAll keeps the order of the results, SyncWait bridges to
+// ordinary code and exceptions reach the awaiter.
+
+namespace
+{
+    using namespace MFA;
+
+    int FailureCount = 0;
+
+    //-------------------------------------------------------------------------------------------------
+
+    void Check(bool const condition, char const * description)
+    {
+        if (condition == false)
+        {
+            std::printf("Failed: %s\n", description);
+            ++FailureCount;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    Task<std::thread::id> ResumeOnWorker()
+    {
+        co_await JobSystem::Schedule();
+        co_return std::this_thread::get_id();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    Task<int> Square(int const value, std::atomic<int> & workerCount)
+    {
+        co_await JobSystem::Schedule();
+        if (JobSystem::Instance->IsMainThread() == false)
+        {
+            workerCount.fetch_add(1);
+        }
+        co_return value * value;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Awaits another task, the result travels through two coroutines
+    Task<int> SumOfSquares(int const count, std::atomic<int> & workerCount)
+    {
+        std::vector<Task<int>> tasks{};
+        for (int i = 0; i < count; ++i)
+        {
+            tasks.emplace_back(Square(i, workerCount));
+        }
+        auto const squares = co_await WhenAll(std::move(tasks));
+        int sum = 0;
+        for (auto const square : squares)
+        {
+            sum += square;
+        }
+        co_return sum;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Results that are not trivially copyable have to reach the awaiter intact
+    Task<std::string> Name(int const value)
+    {
+        co_await JobSystem::Schedule();
+        co_return "name " + std::to_string(value);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    Task<int> Throw(std::string message)
+    {
+        co_await JobSystem::Schedule();
+        throw std::runtime_error(message);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    Task<void> Count(std::atomic<int> & counter, bool const shouldThrow)
+    {
+        co_await JobSystem::Schedule();
+        counter.fetch_add(1);
+        if (shouldThrow)
+        {
+            throw std::runtime_error("void task failed");
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
+
+int main()
+{
+    // More workers than cores, so the tasks interleave even on a single core machine
+    auto jobSystem = JobSystem::Instantiate(ThreadPool::Params{.workerCount = 4});
+
+    {// Schedule
+        auto const threadId = jobSystem->SyncWait(ResumeOnWorker());
+        Check(threadId != std::this_thread::get_id(), "Schedule resumes on a worker");
+    }
+
+    {// WhenAll keeps the order of the results
+        std::atomic<int> workerCount = 0;
+        std::vector<Task<int>> tasks{};
+        for (int i = 0; i < 64; ++i)
+        {
+            tasks.emplace_back(Square(i, workerCount));
+        }
+        auto const squares = jobSystem->SyncWait(WhenAll(std::move(tasks)));
+        bool isInOrder = squares.size() == 64;
+        for (int i = 0; i < static_cast<int>(squares.size()); ++i)
+        {
+            isInOrder &= squares[i] == i * i;
+        }
+        Check(isInOrder, "WhenAll returns every result in the order of the tasks");
+        Check(workerCount.load() > 0, "WhenAll tasks run on workers");
+    }
+
+    {// WhenAll of strings
+        std::vector<Task<std::string>> tasks{};
+        for (int i = 0; i < 16; ++i)
+        {
+            tasks.emplace_back(Name(i));
+        }
+        auto const names = jobSystem->SyncWait(WhenAll(std::move(tasks)));
+        bool isIntact = names.size() == 16;
+        for (int i = 0; i < static_cast<int>(names.size()); ++i)
+        {
+            isIntact &= names[i] == "name " + std::to_string(i);
+        }
+        Check(isIntact, "WhenAll returns results that are not trivially copyable");
+    }
+
+    {// Nested tasks
+        std::atomic<int> workerCount = 0;
+        auto const sum = jobSystem->SyncWait(SumOfSquares(100, workerCount));
+        Check(sum == 328350, "Nested WhenAll inside an awaited task");
+    }
+
+    {// Exceptions reach SyncWait
+        std::string message{};
+        try
+        {
+            (void)jobSystem->SyncWait(Throw("single task failed"));
+        }
+        catch (std::runtime_error const & exception)
+        {
+            message = exception.what();
+        }
+        Check(message == "single task failed", "SyncWait rethrows the exception of the task");
+    }
+
+    {// The first exception of WhenAll is rethrown once every task is done
+        std::atomic<int> counter = 0;
+        std::vector<Task<void>> tasks{};
+        for (int i = 0; i < 16; ++i)
+        {
+            tasks.emplace_back(Count(counter, i == 3 || i == 9));
+        }
+        std::string message{};
+        try
+        {
+            jobSystem->SyncWait(WhenAll(std::move(tasks)));
+        }
+        catch (std::runtime_error const & exception)
+        {
+            message = exception.what();
+        }
+        Check(message == "void task failed", "WhenAll rethrows the exception of a failed task");
+        Check(counter.load() == 16, "WhenAll waits for the tasks that did not fail");
+    }
+
+    {// WhenAll of values with a failure
+        std::atomic<int> workerCount = 0;
+        std::vector<Task<int>> tasks{};
+        tasks.emplace_back(Square(2, workerCount));
+        tasks.emplace_back(Throw("value task failed"));
+        tasks.emplace_back(Square(3, workerCount));
+        std::string message{};
+        try
+        {
+            (void)jobSystem->SyncWait(WhenAll(std::move(tasks)));
+        }
+        catch (std::runtime_error const & exception)
+        {
+            message = exception.what();
+        }
+        Check(message == "value task failed", "WhenAll of values rethrows the exception of a failed task");
+    }
+
+    {// Empty WhenAll finishes right away
+        auto const results = jobSystem->SyncWait(WhenAll(std::vector<Task<int>>{}));
+        Check(results.empty(), "Empty WhenAll");
+    }
+
+    std::printf(FailureCount == 0 ? "Passed\n" : "Failed\n");
+    return FailureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+#include "ThreadSafeQueue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Sweeps the number of producers and consumers of one queue. Every item carries a unique id and every id has to be
+// received exactly once, the run fails otherwise. Throughput is reported per configuration.
+
+namespace
+{
+    using namespace MFA;
+
+    constexpr int ThreadCounts[] = {1, 2, 4, 8, 16, 32};
+    constexpr size_t QueueCapacity = 1024;
+    constexpr uint32_t ItemCount = 1 << 18;
+
+    // Has no default constructor and can only be moved, like the payloads of the job system
+    struct Item
+    {
+        explicit Item(uint32_t const id_)
+            : id(std::make_unique<uint32_t>(id_))
+        {}
+
+        std::unique_ptr<uint32_t> id;
+    };
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Returns false if an item was lost or received more than once
+    bool RunConfiguration(int const producerCount, int const consumerCount)
+    {
+        ThreadSafeQueue<Item> queue{ QueueCapacity };
+        auto receiveCounts = std::make_unique<std::atomic<uint32_t>[]>(ItemCount);
+        std::atomic<uint32_t> remainingItemCount = ItemCount;
+        std::atomic<bool> start = false;
+
+        std::vector<std::thread> threads{};
+        for (int producer = 0; producer < producerCount; ++producer)
+        {
+            threads.emplace_back([&, producer]()->void
+            {
+                while (start.load(std::memory_order_acquire) == false)
+                {
+                    std::this_thread::yield();
+                }
+                for (auto id = static_cast<uint32_t>(producer); id < ItemCount; id += producerCount)
+                {
+                    Item item{ id };
+                    while (queue.TryToPush(std::move(item)) == false)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (int consumer = 0; consumer < consumerCount; ++consumer)
+        {
+            threads.emplace_back([&]()->void
+            {
+                while (start.load(std::memory_order_acquire) == false)
+                {
+                    std::this_thread::yield();
+                }
+                Item item{ 0 };
+                while (remainingItemCount.load(std::memory_order_relaxed) > 0)
+                {
+                    if (queue.TryToPop(item) == false)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    receiveCounts[*item.id].fetch_add(1, std::memory_order_relaxed);
+                    remainingItemCount.fetch_sub(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        auto const startTime = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+        auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        uint32_t lostCount = 0;
+        uint32_t duplicateCount = 0;
+        for (uint32_t id = 0; id < ItemCount; ++id)
+        {
+            auto const receiveCount = receiveCounts[id].load(std::memory_order_relaxed);
+            lostCount += receiveCount == 0 ? 1 : 0;
+            duplicateCount += receiveCount > 1 ? receiveCount - 1 : 0;
+        }
+
+        std::printf(
+            "%9d %9d %12.2f %8u %10u\n",
+            producerCount,
+            consumerCount,
+            static_cast<double>(ItemCount) / seconds / 1.0e6,
+            lostCount,
+            duplicateCount
+        );
+        return lostCount == 0 && duplicateCount == 0 && queue.IsEmpty();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+}
+
+int main()
+{
+    std::printf(
+        "%u items through a queue of %zu, %u hardware threads\n",
+        ItemCount,
+        QueueCapacity,
+        std::thread::hardware_concurrency()
+    );
+    std::printf("%9s %9s %12s %8s %10s\n", "producers", "consumers", "Mitems/s", "lost", "duplicates");
+
+    bool success = true;
+    for (auto const producerCount : ThreadCounts)
+    {
+        for (auto const consumerCount : ThreadCounts)
+        {
+            success &= RunConfiguration(producerCount, consumerCount);
+        }
+    }
+
+    {// Items that are still queued are destroyed with the queue
+        ThreadSafeQueue<Item> queue{ 8 };
+        for (uint32_t id = 0; id < 5; ++id)
+        {
+            success &= queue.TryToPush(Item{ id });
+        }
+        Item item{ 0 };
+        success &= queue.TryToPop(item) && *item.id == 0;
+    }
+
+    std::printf(success ? "Passed\n" : "Failed\n");
+    return success ? 0 : 1;
+}
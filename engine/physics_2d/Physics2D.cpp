@@ -1,7 +1,9 @@
 #include "Physics2D.hpp"
 
 #include "BedrockAssert.hpp"
+#include "ScopeProfiler.hpp"
 
+#include <algorithm>
 #include <set>
 #include <utility>
 
@@ -243,6 +245,8 @@ bool Physics2D::MoveBox(
 
 void Physics2D::Update()
 {
+    SCOPE_Profiler("Physics2D")
+
     if (_isMapDirty == true)
     {
         _isMapDirty = false;
@@ -332,26 +336,22 @@ void Physics2D::Render(MFA::RT::CommandRecordState& recordState)
 
             glm::vec4 color{ 0.0f, 1.0f, 0.0f, 1.0f };
 
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ box.v0.x, 0.0f, box.v0.y },
                 glm::vec3{ box.v1.x, 0.0f, box.v1.y },
                 color
             );
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ box.v1.x, 0.0f, box.v1.y },
                 glm::vec3{ box.v2.x, 0.0f, box.v2.y },
                 color
             );
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ box.v2.x, 0.0f, box.v2.y },
                 glm::vec3{ box.v3.x, 0.0f, box.v3.y },
                 color
             );
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ box.v3.x, 0.0f, box.v3.y },
                 glm::vec3{ box.v0.x, 0.0f, box.v0.y },
                 color
@@ -364,26 +364,22 @@ void Physics2D::Render(MFA::RT::CommandRecordState& recordState)
 
             glm::vec4 color{ 0.0f, 0.0f, 1.0f, 1.0f };
 
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ box.v0.x, 0.0f, box.v0.y },
                 glm::vec3{ box.v1.x, 0.0f, box.v1.y },
                 color
             );
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ box.v1.x, 0.0f, box.v1.y },
                 glm::vec3{ box.v2.x, 0.0f, box.v2.y },
                 color
             );
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ box.v2.x, 0.0f, box.v2.y },
                 glm::vec3{ box.v3.x, 0.0f, box.v3.y },
                 color
             );
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ box.v3.x, 0.0f, box.v3.y },
                 glm::vec3{ box.v0.x, 0.0f, box.v0.y },
                 color
@@ -400,26 +396,22 @@ void Physics2D::Render(MFA::RT::CommandRecordState& recordState)
 
             glm::vec4 color{ 1.0f, 0.0f, 0.0f, 1.0f };
 
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ v0.x, 0.0f, v0.y },
                 glm::vec3{ v1.x, 0.0f, v1.y },
                 color
             );
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ v1.x, 0.0f, v1.y },
                 glm::vec3{ v2.x, 0.0f, v2.y },
                 color
             );
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ v2.x, 0.0f, v2.y },
                 glm::vec3{ v3.x, 0.0f, v3.y },
                 color
             );
-            _lineRenderer->Draw(
-                recordState,
+            _lineRenderer->AddLine(
                 glm::vec3{ v3.x, 0.0f, v3.y },
                 glm::vec3{ v0.x, 0.0f, v0.y },
                 color
@@ -430,13 +422,15 @@ void Physics2D::Render(MFA::RT::CommandRecordState& recordState)
             MFA_LOG_ERROR("Shape not implemented");
 	    }
     }
+    _pointRenderer->Render(recordState);
+    _lineRenderer->Render(recordState);
 }
 
 //-----------------------------------------------------------------------
 
 bool Physics2D::Raycast(
     Layer const layerMask,
-    std::set<EntityID> const & excludeIds,
+    std::span<EntityID const> const excludeIds,
     Ray const& ray,
     float maxDistance,
     HitInfo& outHitInfo
@@ -494,7 +488,7 @@ bool Physics2D::Raycast(
     
     for (auto * item : _itemList)
     {
-	    if (excludeIds.contains(item->id) == false && (item->layer & layerMask) > 0)
+	    if ((item->layer & layerMask) > 0 && std::find(excludeIds.begin(), excludeIds.end(), item->id) == excludeIds.end())
 	    {
             if (item->aabb.Overlap(aabb) == true)
             {
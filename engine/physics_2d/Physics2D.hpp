@@ -7,6 +7,7 @@
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <set>
+#include <span>
 
 #include "glm/gtx/hash.hpp"
 #include "utils/LineRenderer.hpp"
@@ -164,7 +165,7 @@ public:
     [[nodiscard]]
     bool Raycast(
         Layer layerMask,
-        std::set<EntityID> const & excludeIds,
+        std::span<EntityID const> excludeIds,
         Ray const & ray,
         float maxDistance,
         HitInfo& outHitInfo
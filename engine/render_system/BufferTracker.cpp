@@ -8,11 +8,36 @@ namespace MFA
 
     //-----------------------------------------------------------------------------------------------
 
+    void BufferDirtyRange::Add(size_t const offset, size_t const size)
+    {
+        begin = std::min(begin, offset);
+        end = std::max(end, offset + size);
+    }
+
+    //-----------------------------------------------------------------------------------------------
+
+    void BufferDirtyRange::Clear()
+    {
+        begin = std::numeric_limits<size_t>::max();
+        end = 0;
+    }
+
+    //-----------------------------------------------------------------------------------------------
+
+    bool BufferDirtyRange::IsEmpty() const
+    {
+        return begin >= end;
+    }
+
+    //-----------------------------------------------------------------------------------------------
+
     HostVisibleBufferTracker::HostVisibleBufferTracker(
         std::shared_ptr<RT::BufferGroup> bufferGroup, 
         Alias const & data
     ) : HostVisibleBufferTracker(std::move(bufferGroup))
     {
+        MFA_ASSERT(data.Len() <= mData->Len());
+        std::memcpy(mData->Ptr(), data.Ptr(), data.Len());
         for (auto const& buffer : mBufferGroup->buffers)
         {
             RB::UpdateHostVisibleBuffer(
@@ -29,41 +54,61 @@ namespace MFA
         : mBufferGroup(std::move(bufferGroup))
     {
         mData = Memory::AllocSize(mBufferGroup->bufferSize);
-        mDirtyCounter = 0;
+        mDirtyRanges.resize(mBufferGroup->buffers.size());
     }
 
     //-----------------------------------------------------------------------------------------------
     
     void HostVisibleBufferTracker::Update(RT::CommandRecordState const & recordState)
     {
-        if (mDirtyCounter > 0)
+        auto & dirtyRange = mDirtyRanges[recordState.frameIndex];
+        if (dirtyRange.IsEmpty() == false)
         {
             RB::UpdateHostVisibleBuffer(
                 LogicalDevice::Instance->GetVkDevice(),
                 *mBufferGroup->buffers[recordState.frameIndex],
-                Alias(mData->Ptr(), mData->Len())
+                Alias(mData->Ptr() + dirtyRange.begin, dirtyRange.end - dirtyRange.begin),
+                dirtyRange.begin
             );
-            --mDirtyCounter;
+            dirtyRange.Clear();
         }
     }
     
     //-----------------------------------------------------------------------------------------------
     
-    void HostVisibleBufferTracker::SetData(Alias const & data)
+    void HostVisibleBufferTracker::SetData(Alias const & data, size_t const offset)
     {
-        mDirtyCounter = mBufferGroup->buffers.size();
-        MFA_ASSERT(data.Len() <= mData->Len());
-        std::memcpy(mData->Ptr(), data.Ptr(), data.Len());
+        MFA_ASSERT(offset + data.Len() <= mData->Len());
+        std::memcpy(mData->Ptr() + offset, data.Ptr(), data.Len());
+        MarkDirty(offset, data.Len());
     }
 
     //-----------------------------------------------------------------------------------------------
     
     uint8_t * HostVisibleBufferTracker::Data()
     {
-        mDirtyCounter = mBufferGroup->buffers.size();
-        return mData->Ptr();
+        return Data(0, mData->Len());
     }
-    
+
+    //-----------------------------------------------------------------------------------------------
+
+    uint8_t * HostVisibleBufferTracker::Data(size_t const offset, size_t const size)
+    {
+        MarkDirty(offset, size);
+        return mData->Ptr() + offset;
+    }
+
+    //-----------------------------------------------------------------------------------------------
+
+    void HostVisibleBufferTracker::MarkDirty(size_t const offset, size_t const size)
+    {
+        MFA_ASSERT(offset + size <= mData->Len());
+        for (auto & dirtyRange : mDirtyRanges)
+        {
+            dirtyRange.Add(offset, size);
+        }
+    }
+
     //-----------------------------------------------------------------------------------------------
     
     LocalBufferTracker::LocalBufferTracker(
@@ -73,45 +118,68 @@ namespace MFA
         : mLocalBuffer(std::move(localBuffer))
         , mHostVisibleBuffer(std::move(hostVisibleBuffer))
     {
+        MFA_ASSERT(mLocalBuffer->buffers.size() == mHostVisibleBuffer->buffers.size());
         mData = Memory::AllocSize(mLocalBuffer->bufferSize);
+        mDirtyRanges.resize(mLocalBuffer->buffers.size());
     }
     
     //-----------------------------------------------------------------------------------------------
     
     void LocalBufferTracker::Update(RT::CommandRecordState const & recordState)
     {
-        if (mDirtyCounter > 0)
+        auto & dirtyRange = mDirtyRanges[recordState.frameIndex];
+        if (dirtyRange.IsEmpty() == false)
         {
             RB::UpdateHostVisibleBuffer(
                 LogicalDevice::Instance->GetVkDevice(),
                 *mHostVisibleBuffer->buffers[recordState.frameIndex],
-                Alias(mData->Ptr(), mData->Len())
+                Alias(mData->Ptr() + dirtyRange.begin, dirtyRange.end - dirtyRange.begin),
+                dirtyRange.begin
             );
             RB::UpdateLocalBuffer(
                 recordState.commandBuffer,
                 *mLocalBuffer->buffers[recordState.frameIndex],
-                *mHostVisibleBuffer->buffers[recordState.frameIndex]
+                *mHostVisibleBuffer->buffers[recordState.frameIndex],
+                dirtyRange.begin,
+                dirtyRange.end - dirtyRange.begin
             );
-            --mDirtyCounter;
+            dirtyRange.Clear();
         }
     }
 
     //-----------------------------------------------------------------------------------------------
     
-    void LocalBufferTracker::SetData(Alias const & data)
+    void LocalBufferTracker::SetData(Alias const & data, size_t const offset)
     {
-        mDirtyCounter = mLocalBuffer->buffers.size();
-        MFA_ASSERT(data.Len() <= mData->Len());
-        std::memcpy(mData->Ptr(), data.Ptr(), data.Len());
+        MFA_ASSERT(offset + data.Len() <= mData->Len());
+        std::memcpy(mData->Ptr() + offset, data.Ptr(), data.Len());
+        MarkDirty(offset, data.Len());
     }
 
     //-----------------------------------------------------------------------------------------------
     
     uint8_t * LocalBufferTracker::Data()
     {
-        // Returns the data and resets the counter.
-        mDirtyCounter = LogicalDevice::Instance->GetMaxFramePerFlight();
-        return mData->Ptr();
+        return Data(0, mData->Len());
+    }
+
+    //-----------------------------------------------------------------------------------------------
+
+    uint8_t * LocalBufferTracker::Data(size_t const offset, size_t const size)
+    {
+        MarkDirty(offset, size);
+        return mData->Ptr() + offset;
+    }
+
+    //-----------------------------------------------------------------------------------------------
+
+    void LocalBufferTracker::MarkDirty(size_t const offset, size_t const size)
+    {
+        MFA_ASSERT(offset + size <= mData->Len());
+        for (auto & dirtyRange : mDirtyRanges)
+        {
+            dirtyRange.Add(offset, size);
+        }
     }
     
     //-----------------------------------------------------------------------------------------------
@@ -4,8 +4,24 @@
 #include "RenderBackend.hpp"
 #include "RenderTypes.hpp"
 
+#include <limits>
+
 namespace MFA
 {
+    // Byte range of the cpu data that is modified since the buffer of a frame was last updated
+    struct BufferDirtyRange
+    {
+        size_t begin = std::numeric_limits<size_t>::max();
+        size_t end = 0;
+
+        void Add(size_t offset, size_t size);
+
+        void Clear();
+
+        [[nodiscard]]
+        bool IsEmpty() const;
+    };
+
     struct HostVisibleBufferTracker
     {
     public:
@@ -14,19 +30,27 @@ namespace MFA
 
         explicit HostVisibleBufferTracker(std::shared_ptr<RT::BufferGroup> bufferGroup);
 
+        // Only copies the modified range into the buffer of the active frame
         void Update(RT::CommandRecordState const & recordState);
 
-        void SetData(Alias const & data);
+        void SetData(Alias const & data, size_t offset = 0);
 
+        // Marks the whole buffer as dirty, prefer the ranged version when only part of the data changes
         [[nodiscard]]
         uint8_t * Data();
 
+        [[nodiscard]]
+        uint8_t * Data(size_t offset, size_t size);
+
+        void MarkDirty(size_t offset, size_t size);
+
         RT::BufferGroup const & HostVisibleBuffer();
 
     private:
         
         std::shared_ptr<RT::BufferGroup> mBufferGroup;
-        int mDirtyCounter = 0;
+        // One range per buffer of the group
+        std::vector<BufferDirtyRange> mDirtyRanges{};
         std::unique_ptr<Blob> mData {};
     };
 
@@ -40,13 +64,20 @@ namespace MFA
             std::shared_ptr<RT::BufferGroup> hostVisibleBuffer
         );
 
+        // Only copies the modified range into the stage buffer and records a copy of the same range
         void Update(RT::CommandRecordState const & recordState);
 
-        void SetData(Alias const & data);
+        void SetData(Alias const & data, size_t offset = 0);
 
+        // Marks the whole buffer as dirty, prefer the ranged version when only part of the data changes
         [[nodiscard]]
         uint8_t * Data();
 
+        [[nodiscard]]
+        uint8_t * Data(size_t offset, size_t size);
+
+        void MarkDirty(size_t offset, size_t size);
+
         [[nodiscard]]
         RT::BufferGroup const & HostVisibleBuffer() const;
 
@@ -57,7 +88,8 @@ namespace MFA
 
         std::shared_ptr<RT::BufferGroup> mLocalBuffer{};
         std::shared_ptr<RT::BufferGroup> mHostVisibleBuffer{};
-        int mDirtyCounter = 0;
+        // One range per buffer of the group
+        std::vector<BufferDirtyRange> mDirtyRanges{};
         std::unique_ptr<Blob> mData {};
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,263 @@
+#include "DescriptorAllocator.hpp"
+
+#include "RenderBackend.hpp"
+#include "BedrockAssert.hpp"
+#include "BedrockLog.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace MFA
+{
+
+	static constexpr uint32_t MaxSetsPerPool = 4096;
+
+	// Lifetime totals are halved once they pass this many sets so they follow recent layouts and never overflow
+	static constexpr uint64_t TotalSetCountLimit = 1 << 20;
+
+	//-------------------------------------------------------------------------------------------------
+
+	// Works for both const and mutable lists
+	template<typename Counts>
+	static auto * FindCount(Counts & counts, VkDescriptorType const type)
+	{
+		decltype(counts.data()) result = nullptr;
+		for (auto & count : counts)
+		{
+			if (count.type == type)
+			{
+				result = &count;
+				break;
+			}
+		}
+		return result;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static void AddCount(std::vector<VkDescriptorPoolSize> & counts, VkDescriptorType const type, uint32_t const value)
+	{
+		auto * count = FindCount(counts, type);
+		if (count == nullptr)
+		{
+			counts.emplace_back(VkDescriptorPoolSize{ .type = type, .descriptorCount = value });
+		}
+		else
+		{
+			count->descriptorCount += value;
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	DescriptorAllocator::DescriptorAllocator(VkDevice device, uint32_t const initialSetsPerPool)
+		: _device(device)
+		, _nextSetsPerPool((std::max)(initialSetsPerPool, 1u))
+	{
+		MFA_ASSERT(_device != VK_NULL_HANDLE);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	DescriptorAllocator::~DescriptorAllocator()
+	{
+		_usedPools.clear();
+		_freePools.clear();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	RT::DescriptorSetGroup DescriptorAllocator::Allocate(RT::DescriptorSetLayoutGroup const & layout, uint32_t const count)
+	{
+		MFA_ASSERT(count > 0);
+
+		std::lock_guard lock{ _mutex };
+
+		std::vector<VkDescriptorSet> descriptorSets(count);
+
+		auto * pool = &AcquirePool(layout, count);
+		auto result = RB::TryAllocateDescriptorSets(
+			_device,
+			pool->descriptorPool->descriptorPool,
+			layout.descriptorSetLayout,
+			count,
+			descriptorSets.data()
+		);
+
+		// Our bookkeeping does not know about fragmentation, the next pool is a fresh one
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+		{
+			pool->remainingSets = 0;
+			pool = &AcquirePool(layout, count);
+			result = RB::TryAllocateDescriptorSets(
+				_device,
+				pool->descriptorPool->descriptorPool,
+				layout.descriptorSetLayout,
+				count,
+				descriptorSets.data()
+			);
+		}
+
+		if (result != VK_SUCCESS)
+		{
+			MFA_LOG_ERROR("Failed to allocate descriptor sets, error code: %d", static_cast<int>(result));
+			MFA_CRASH("Failed to allocate descriptor sets");
+		}
+
+		Consume(*pool, layout, count);
+
+		_usage.setCount += count;
+		_totalSetCount += count;
+		for (auto const & descriptorCount : layout.descriptorCounts)
+		{
+			AddCount(_usage.descriptorCounts, descriptorCount.type, descriptorCount.descriptorCount * count);
+			AddCount(_totalDescriptorCounts, descriptorCount.type, descriptorCount.descriptorCount * count);
+		}
+
+		if (_totalSetCount > TotalSetCountLimit)
+		{
+			_totalSetCount /= 2;
+			for (auto & descriptorCount : _totalDescriptorCounts)
+			{
+				descriptorCount.descriptorCount /= 2;
+			}
+		}
+
+		return RT::DescriptorSetGroup{ .descriptorSets = std::move(descriptorSets) };
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void DescriptorAllocator::Reset()
+	{
+		std::lock_guard lock{ _mutex };
+
+		for (auto & pool : _usedPools)
+		{
+			RB::ResetDescriptorPool(_device, pool.descriptorPool->descriptorPool);
+			pool.remainingSets = pool.maxSets;
+			pool.remaining = pool.capacity;
+			_freePools.emplace_back(std::move(pool));
+		}
+		_usedPools.clear();
+
+		_usage.setCount = 0;
+		_usage.descriptorCounts.clear();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	DescriptorAllocator::Usage DescriptorAllocator::GetUsage() const
+	{
+		std::lock_guard lock{ _mutex };
+		auto usage = _usage;
+		usage.poolCount = static_cast<int>(_usedPools.size() + _freePools.size());
+		return usage;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool DescriptorAllocator::CanFit(Pool const & pool, RT::DescriptorSetLayoutGroup const & layout, uint32_t const count)
+	{
+		if (pool.remainingSets < count)
+		{
+			return false;
+		}
+		for (auto const & descriptorCount : layout.descriptorCounts)
+		{
+			auto const * remaining = FindCount(pool.remaining, descriptorCount.type);
+			if (remaining == nullptr || remaining->descriptorCount < descriptorCount.descriptorCount * count)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void DescriptorAllocator::Consume(Pool & pool, RT::DescriptorSetLayoutGroup const & layout, uint32_t const count)
+	{
+		pool.remainingSets -= (std::min)(pool.remainingSets, count);
+		for (auto const & descriptorCount : layout.descriptorCounts)
+		{
+			auto * remaining = FindCount(pool.remaining, descriptorCount.type);
+			MFA_ASSERT(remaining != nullptr);
+			remaining->descriptorCount -= (std::min)(remaining->descriptorCount, descriptorCount.descriptorCount * count);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	DescriptorAllocator::Pool DescriptorAllocator::CreatePool(RT::DescriptorSetLayoutGroup const & layout, uint32_t const count)
+	{
+		auto const maxSets = (std::max)(_nextSetsPerPool, count);
+		_nextSetsPerPool = (std::min)(_nextSetsPerPool * 2, MaxSetsPerPool);
+
+		// Every type that was ever allocated gets room for its average share, and the request itself always fits
+		auto requested = _totalDescriptorCounts;
+		for (auto const & descriptorCount : layout.descriptorCounts)
+		{
+			AddCount(requested, descriptorCount.type, descriptorCount.descriptorCount * count);
+		}
+		auto const totalSetCount = static_cast<double>(_totalSetCount + count);
+
+		Pool pool{
+			.maxSets = maxSets,
+			.remainingSets = maxSets
+		};
+		for (auto const & descriptorCount : requested)
+		{
+			auto const average = static_cast<double>(descriptorCount.descriptorCount) / totalSetCount;
+			auto poolCount = static_cast<uint32_t>(std::ceil(average * maxSets));
+			for (auto const & layoutCount : layout.descriptorCounts)
+			{
+				if (layoutCount.type == descriptorCount.type)
+				{
+					poolCount = (std::max)(poolCount, layoutCount.descriptorCount * count);
+				}
+			}
+			if (poolCount > 0)
+			{
+				pool.capacity.emplace_back(VkDescriptorPoolSize{ .type = descriptorCount.type, .descriptorCount = poolCount });
+			}
+		}
+		pool.remaining = pool.capacity;
+
+		pool.descriptorPool = RB::CreateDescriptorPool(_device, maxSets, pool.capacity);
+		MFA_LOG_DEBUG("Created a descriptor pool for %u sets", maxSets);
+
+		return pool;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	DescriptorAllocator::Pool & DescriptorAllocator::AcquirePool(RT::DescriptorSetLayoutGroup const & layout, uint32_t const count)
+	{
+		if (_usedPools.empty() == false && CanFit(_usedPools.back(), layout, count))
+		{
+			return _usedPools.back();
+		}
+
+		auto const findResult = std::find_if(
+			_freePools.begin(),
+			_freePools.end(),
+			[&layout, count](Pool const & pool)->bool
+			{
+				return CanFit(pool, layout, count);
+			}
+		);
+		if (findResult != _freePools.end())
+		{
+			_usedPools.emplace_back(std::move(*findResult));
+			_freePools.erase(findResult);
+			return _usedPools.back();
+		}
+
+		_usedPools.emplace_back(CreatePool(layout, count));
+		return _usedPools.back();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "RenderTypes.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MFA
+{
+    // Allocates descriptor sets from a chain of pools. When the current pool cannot fit a request a new one is created,
+    // so callers never have to guess the number of sets up front. Pools are sized from the layouts that were allocated
+    // so far and every new pool holds twice as many sets as the previous one.
+    // Reset returns all the sets at once and keeps the pools for reuse, which makes it suitable for per frame sets.
+    class DescriptorAllocator
+    {
+    public:
+
+        struct Usage
+        {
+            int poolCount = 0;
+            uint32_t setCount = 0;
+            // Descriptors of each type that are allocated since the last reset
+            std::vector<VkDescriptorPoolSize> descriptorCounts{};
+        };
+
+        explicit DescriptorAllocator(VkDevice device, uint32_t initialSetsPerPool = 4);
+
+        ~DescriptorAllocator();
+
+        DescriptorAllocator(DescriptorAllocator const &) noexcept = delete;
+        DescriptorAllocator(DescriptorAllocator &&) noexcept = delete;
+        DescriptorAllocator & operator = (DescriptorAllocator const &) noexcept = delete;
+        DescriptorAllocator & operator = (DescriptorAllocator &&) noexcept = delete;
+
+        // Sets stay valid until Reset is called or the allocator is destroyed
+        [[nodiscard]]
+        RT::DescriptorSetGroup Allocate(RT::DescriptorSetLayoutGroup const & layout, uint32_t count = 1);
+
+        // Only call when none of the allocated sets is used by a pending command buffer
+        void Reset();
+
+        [[nodiscard]]
+        Usage GetUsage() const;
+
+    private:
+
+        struct Pool
+        {
+            std::shared_ptr<RT::DescriptorPool> descriptorPool{};
+            uint32_t maxSets = 0;
+            uint32_t remainingSets = 0;
+            std::vector<VkDescriptorPoolSize> capacity{};
+            std::vector<VkDescriptorPoolSize> remaining{};
+        };
+
+        [[nodiscard]]
+        static bool CanFit(Pool const & pool, RT::DescriptorSetLayoutGroup const & layout, uint32_t count);
+
+        static void Consume(Pool & pool, RT::DescriptorSetLayoutGroup const & layout, uint32_t count);
+
+        [[nodiscard]]
+        Pool CreatePool(RT::DescriptorSetLayoutGroup const & layout, uint32_t count);
+
+        // Returns a pool that can fit the request, moving to a recycled or a new pool if the current one is full
+        [[nodiscard]]
+        Pool & AcquirePool(RT::DescriptorSetLayoutGroup const & layout, uint32_t count);
+
+        VkDevice _device{};
+        uint32_t _nextSetsPerPool = 0;
+
+        // The last pool is the one that is allocated from
+        std::vector<Pool> _usedPools{};
+        std::vector<Pool> _freePools{};
+
+        // Lifetime totals, new pools are sized with the average number of descriptors per set
+        uint64_t _totalSetCount = 0;
+        std::vector<VkDescriptorPoolSize> _totalDescriptorCounts{};
+
+        Usage _usage{};
+
+        mutable std::mutex _mutex{};
+    };
+}
@@ -0,0 +1,495 @@
+#include "GpuProfiler.hpp"
+
+#include "RenderBackend.hpp"
+#include "BedrockAssert.hpp"
+#include "BedrockFile.hpp"
+#include "BedrockLog.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+namespace MFA
+{
+
+	// Every scope uses two timestamps
+	static constexpr uint32_t MaxScopesPerFrame = 256;
+	static constexpr size_t HistoryLength = 300;
+
+	static constexpr VkQueryPipelineStatisticFlags StatisticFlags =
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	// Same order as the bits, each value is followed by its availability
+	static constexpr uint32_t StatisticCount = 5;
+
+	//-------------------------------------------------------------------------------------------------
+
+	GpuProfiler::GpuProfiler(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		uint32_t const queueFamily,
+		VkPhysicalDeviceProperties const & properties,
+		VkPhysicalDeviceFeatures const & features,
+		uint32_t const maxFramesPerFlight
+	)
+		: _device(device)
+	{
+		MFA_ASSERT(_device != VK_NULL_HANDLE);
+		MFA_ASSERT(maxFramesPerFlight > 0);
+
+		auto const validBits = RB::GetTimestampValidBits(physicalDevice, queueFamily);
+		_timestampSupported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+		_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+		_timestampPeriod = properties.limits.timestampPeriod;
+
+		// Secondary command buffers execute inside the statistics query, so it has to be inherited
+		_statisticsSupported = features.pipelineStatisticsQuery == VK_TRUE && features.inheritedQueries == VK_TRUE;
+
+		if (_timestampSupported == false)
+		{
+			MFA_LOG_WARN("Timestamp queries are not supported on the graphic queue, gpu timings are disabled");
+		}
+		if (_statisticsSupported == false)
+		{
+			MFA_LOG_WARN("Inherited pipeline statistics queries are not supported, gpu statistics are disabled");
+		}
+
+		_frames.resize(maxFramesPerFlight);
+		for (auto & frame : _frames)
+		{
+			frame = std::make_unique<Frame>();
+			frame->names.resize(MaxScopesPerFrame);
+			if (_timestampSupported == true)
+			{
+				frame->timestampPool = RB::CreateQueryPool(_device, VK_QUERY_TYPE_TIMESTAMP, MaxScopesPerFrame * 2);
+			}
+			if (_statisticsSupported == true)
+			{
+				frame->statisticsPool = RB::CreateQueryPool(_device, VK_QUERY_TYPE_PIPELINE_STATISTICS, 1, StatisticFlags);
+			}
+		}
+
+		Instance = this;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	GpuProfiler::~GpuProfiler()
+	{
+		for (auto const & frame : _frames)
+		{
+			if (frame->timestampPool != VK_NULL_HANDLE)
+			{
+				RB::DestroyQueryPool(_device, frame->timestampPool);
+			}
+			if (frame->statisticsPool != VK_NULL_HANDLE)
+			{
+				RB::DestroyQueryPool(_device, frame->statisticsPool);
+			}
+		}
+		_frames.clear();
+
+		Instance = nullptr;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void GpuProfiler::Collect(uint32_t const frameIndex)
+	{
+		MFA_ASSERT(frameIndex < _frames.size());
+		auto & frame = *_frames[frameIndex];
+		if (frame.isRecorded == false)
+		{
+			return;
+		}
+		frame.isRecorded = false;
+
+		if (frame.isEnabled == false)
+		{
+			return;
+		}
+
+		FrameRecord record{ .frameNumber = frame.frameNumber };
+
+		auto const scopeCount = (std::min)(frame.scopeCount.load(), MaxScopesPerFrame);
+		if (scopeCount > 0)
+		{
+			// Value and availability of every query
+			std::vector<uint64_t> results(scopeCount * 2 * 2);
+			// Not ready is expected for the scopes that were never ended, their availability stays zero
+			auto const result = RB::GetQueryPoolResults(
+				_device,
+				frame.timestampPool,
+				0,
+				scopeCount * 2,
+				sizeof(uint64_t) * 2,
+				results.size() * sizeof(uint64_t),
+				results.data()
+			);
+			if (result == VK_SUCCESS || result == VK_NOT_READY)
+			{
+				for (uint32_t i = 0; i < scopeCount; ++i)
+				{
+					auto const * beginQuery = &results[i * 4];
+					auto const * endQuery = &results[i * 4 + 2];
+					if (beginQuery[1] == 0 || endQuery[1] == 0)
+					{
+						continue;
+					}
+
+					auto const ticks = (endQuery[0] - beginQuery[0]) & _timestampMask;
+					auto const milliseconds = static_cast<float>(static_cast<double>(ticks) * _timestampPeriod / 1'000'000.0);
+
+					std::string const name = frame.names[i] != nullptr ? frame.names[i] : "Unnamed";
+					auto const findResult = std::find_if(
+						record.samples.begin(),
+						record.samples.end(),
+						[&name](Sample const & sample)->bool
+						{
+							return sample.name == name;
+						}
+					);
+					if (findResult != record.samples.end())
+					{
+						findResult->milliseconds += milliseconds;
+					}
+					else
+					{
+						record.samples.emplace_back(Sample{ .name = name, .milliseconds = milliseconds });
+					}
+				}
+			}
+		}
+
+		if (frame.hasStatistics == true)
+		{
+			std::array<uint64_t, StatisticCount + 1> results{};
+			auto const result = RB::GetQueryPoolResults(
+				_device,
+				frame.statisticsPool,
+				0,
+				1,
+				sizeof(results),
+				sizeof(results),
+				results.data()
+			);
+			if (result == VK_SUCCESS && results[StatisticCount] != 0)
+			{
+				record.hasStatistics = true;
+				record.statistics = Statistics{
+					.inputAssemblyVertices = results[0],
+					.inputAssemblyPrimitives = results[1],
+					.vertexShaderInvocations = results[2],
+					.clippingPrimitives = results[3],
+					.fragmentShaderInvocations = results[4],
+				};
+			}
+		}
+
+		std::lock_guard lock{ _historyMutex };
+		_history.emplace_back(std::move(record));
+		while (_history.size() > HistoryLength)
+		{
+			_history.pop_front();
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void GpuProfiler::BeginFrame(RT::CommandRecordState const & recordState)
+	{
+		MFA_ASSERT(recordState.isValid);
+		MFA_ASSERT(recordState.frameIndex < _frames.size());
+
+		auto & frame = *_frames[recordState.frameIndex];
+		// Already begun by a previous command buffer of the same frame
+		if (frame.isRecorded == true)
+		{
+			return;
+		}
+		frame.isRecorded = true;
+		frame.isEnabled = _enabled.load();
+		frame.hasStatistics = false;
+		frame.frameNumber = _nextFrameNumber++;
+		frame.scopeCount.store(0);
+
+		if (frame.isEnabled == false)
+		{
+			return;
+		}
+
+		if (frame.timestampPool != VK_NULL_HANDLE)
+		{
+			RB::ResetQueryPool(recordState.commandBuffer, frame.timestampPool, 0, MaxScopesPerFrame * 2);
+		}
+		if (frame.statisticsPool != VK_NULL_HANDLE)
+		{
+			RB::ResetQueryPool(recordState.commandBuffer, frame.statisticsPool, 0, 1);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	GpuProfiler::ScopeId GpuProfiler::BeginScope(RT::CommandRecordState const & recordState, char const * name)
+	{
+		MFA_ASSERT(recordState.frameIndex < _frames.size());
+
+		auto & frame = *_frames[recordState.frameIndex];
+		if (frame.isEnabled == false || frame.timestampPool == VK_NULL_HANDLE)
+		{
+			return InvalidScope;
+		}
+
+		auto const scopeIndex = frame.scopeCount.fetch_add(1);
+		if (scopeIndex >= MaxScopesPerFrame)
+		{
+			return InvalidScope;
+		}
+
+		frame.names[scopeIndex] = name;
+		RB::WriteTimestamp(
+			recordState.commandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			frame.timestampPool,
+			scopeIndex * 2
+		);
+
+		return static_cast<ScopeId>(scopeIndex);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void GpuProfiler::EndScope(RT::CommandRecordState const & recordState, ScopeId const scopeId)
+	{
+		if (scopeId == InvalidScope)
+		{
+			return;
+		}
+		MFA_ASSERT(recordState.frameIndex < _frames.size());
+
+		auto const & frame = *_frames[recordState.frameIndex];
+		RB::WriteTimestamp(
+			recordState.commandBuffer,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			frame.timestampPool,
+			static_cast<uint32_t>(scopeId) * 2 + 1
+		);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void GpuProfiler::BeginStatistics(RT::CommandRecordState const & recordState)
+	{
+		MFA_ASSERT(recordState.frameIndex < _frames.size());
+
+		auto & frame = *_frames[recordState.frameIndex];
+		if (frame.isEnabled == false || frame.statisticsPool == VK_NULL_HANDLE || frame.hasStatistics == true)
+		{
+			return;
+		}
+
+		RB::BeginQuery(recordState.commandBuffer, frame.statisticsPool, 0);
+		frame.hasStatistics = true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void GpuProfiler::EndStatistics(RT::CommandRecordState const & recordState)
+	{
+		MFA_ASSERT(recordState.frameIndex < _frames.size());
+
+		auto const & frame = *_frames[recordState.frameIndex];
+		if (frame.hasStatistics == false)
+		{
+			return;
+		}
+
+		RB::EndQuery(recordState.commandBuffer, frame.statisticsPool, 0);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	VkQueryPipelineStatisticFlags GpuProfiler::GetInheritedStatistics() const noexcept
+	{
+		return _statisticsSupported == true ? StatisticFlags : 0;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void GpuProfiler::SetEnabled(bool const enabled)
+	{
+		_enabled.store(enabled);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool GpuProfiler::IsEnabled() const noexcept
+	{
+		return _enabled.load();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool GpuProfiler::IsStatisticsSupported() const noexcept
+	{
+		return _statisticsSupported;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::vector<GpuProfiler::ScopeTiming> GpuProfiler::GetTimings() const
+	{
+		std::lock_guard lock{ _historyMutex };
+
+		std::vector<ScopeTiming> timings{};
+		std::vector<int> sampleCounts{};
+		for (auto const & record : _history)
+		{
+			for (auto const & sample : record.samples)
+			{
+				auto findResult = std::find_if(
+					timings.begin(),
+					timings.end(),
+					[&sample](ScopeTiming const & timing)->bool
+					{
+						return timing.name == sample.name;
+					}
+				);
+				if (findResult == timings.end())
+				{
+					timings.emplace_back(ScopeTiming{ .name = sample.name });
+					sampleCounts.emplace_back(0);
+					findResult = timings.end() - 1;
+				}
+				auto const index = std::distance(timings.begin(), findResult);
+
+				findResult->lastMs = sample.milliseconds;
+				findResult->averageMs += sample.milliseconds;
+				findResult->maxMs = (std::max)(findResult->maxMs, sample.milliseconds);
+				++sampleCounts[index];
+			}
+		}
+
+		for (size_t i = 0; i < timings.size(); ++i)
+		{
+			timings[i].averageMs /= static_cast<float>(sampleCounts[i]);
+		}
+
+		return timings;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	GpuProfiler::Statistics GpuProfiler::GetStatistics() const
+	{
+		std::lock_guard lock{ _historyMutex };
+		for (auto record = _history.rbegin(); record != _history.rend(); ++record)
+		{
+			if (record->hasStatistics == true)
+			{
+				return record->statistics;
+			}
+		}
+		return {};
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool GpuProfiler::ExportCsv(std::string const & path) const
+	{
+		std::string csv{};
+		{
+			std::lock_guard lock{ _historyMutex };
+
+			// A scope that is missing from a frame is written as zero
+			std::vector<std::string> names{};
+			for (auto const & record : _history)
+			{
+				for (auto const & sample : record.samples)
+				{
+					if (std::find(names.begin(), names.end(), sample.name) == names.end())
+					{
+						names.emplace_back(sample.name);
+					}
+				}
+			}
+
+			csv += "frame";
+			for (auto const & name : names)
+			{
+				csv += "," + name + " (ms)";
+			}
+			csv += ",input assembly vertices,input assembly primitives,vertex shader invocations,clipping primitives,fragment shader invocations\n";
+
+			char value[32]{};
+			for (auto const & record : _history)
+			{
+				csv += std::to_string(record.frameNumber);
+				for (auto const & name : names)
+				{
+					float milliseconds = 0.0f;
+					for (auto const & sample : record.samples)
+					{
+						if (sample.name == name)
+						{
+							milliseconds = sample.milliseconds;
+							break;
+						}
+					}
+					std::snprintf(value, sizeof(value), ",%.4f", milliseconds);
+					csv += value;
+				}
+				if (record.hasStatistics == true)
+				{
+					auto const & statistics = record.statistics;
+					csv += "," + std::to_string(statistics.inputAssemblyVertices) +
+						"," + std::to_string(statistics.inputAssemblyPrimitives) +
+						"," + std::to_string(statistics.vertexShaderInvocations) +
+						"," + std::to_string(statistics.clippingPrimitives) +
+						"," + std::to_string(statistics.fragmentShaderInvocations);
+				}
+				else
+				{
+					csv += ",,,,,";
+				}
+				csv += "\n";
+			}
+		}
+
+		if (File::Write(path, Alias{ csv.data(), csv.size() }) == false)
+		{
+			MFA_LOG_WARN("Failed to export the gpu profile into %s", path.c_str());
+			return false;
+		}
+		MFA_LOG_INFO("Exported the gpu profile into %s", path.c_str());
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	GpuProfiler::Scope::Scope(RT::CommandRecordState const & recordState, char const * name)
+		: _recordState(recordState)
+	{
+		if (Instance != nullptr)
+		{
+			_scopeId = Instance->BeginScope(_recordState, name);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	GpuProfiler::Scope::~Scope()
+	{
+		if (Instance != nullptr)
+		{
+			Instance->EndScope(_recordState, _scopeId);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "RenderTypes.hpp"
+#include "BedrockCommon.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MFA
+{
+    // Measures the gpu time of named scopes with timestamp queries and counts the pipeline statistics of the display pass.
+    // Every frame in flight owns its query pools. Results are read after the fence of that frame is waited on,
+    // so reading back never stalls and the numbers are as old as the number of frames in flight.
+    // Scopes can be written from the primary and from secondary command buffers on any thread.
+    class GpuProfiler
+    {
+    public:
+
+        using ScopeId = int32_t;
+        static constexpr ScopeId InvalidScope = -1;
+
+        inline static GpuProfiler * Instance = nullptr;
+
+        struct Statistics
+        {
+            uint64_t inputAssemblyVertices = 0;
+            uint64_t inputAssemblyPrimitives = 0;
+            uint64_t vertexShaderInvocations = 0;
+            uint64_t clippingPrimitives = 0;
+            uint64_t fragmentShaderInvocations = 0;
+        };
+
+        // Scopes with the same name in a frame are summed
+        struct ScopeTiming
+        {
+            std::string name{};
+            float lastMs = 0.0f;
+            float averageMs = 0.0f;
+            float maxMs = 0.0f;
+        };
+
+        explicit GpuProfiler(
+            VkDevice device,
+            VkPhysicalDevice physicalDevice,
+            uint32_t queueFamily,
+            VkPhysicalDeviceProperties const & properties,
+            VkPhysicalDeviceFeatures const & features,
+            uint32_t maxFramesPerFlight
+        );
+
+        ~GpuProfiler();
+
+        GpuProfiler(GpuProfiler const &) noexcept = delete;
+        GpuProfiler(GpuProfiler &&) noexcept = delete;
+        GpuProfiler & operator = (GpuProfiler const &) noexcept = delete;
+        GpuProfiler & operator = (GpuProfiler &&) noexcept = delete;
+
+        // Reads the results of the previous use of this frame index, its fence must be already waited on
+        void Collect(uint32_t frameIndex);
+
+        // Resets the queries of the frame, must be recorded into the primary command buffer outside of a render pass.
+        // Only the first call of every frame has an effect.
+        void BeginFrame(RT::CommandRecordState const & recordState);
+
+        // The name is stored by pointer and has to outlive the frame, string literals are expected
+        [[nodiscard]]
+        ScopeId BeginScope(RT::CommandRecordState const & recordState, char const * name);
+
+        void EndScope(RT::CommandRecordState const & recordState, ScopeId scopeId);
+
+        // Only one statistics query can be active at once, it has to be recorded into the primary command buffer
+        void BeginStatistics(RT::CommandRecordState const & recordState);
+
+        void EndStatistics(RT::CommandRecordState const & recordState);
+
+        // Has to be passed to the secondary command buffers that execute while the statistics query is active
+        [[nodiscard]]
+        VkQueryPipelineStatisticFlags GetInheritedStatistics() const noexcept;
+
+        // Takes effect from the next frame
+        void SetEnabled(bool enabled);
+
+        [[nodiscard]]
+        bool IsEnabled() const noexcept;
+
+        [[nodiscard]]
+        bool IsStatisticsSupported() const noexcept;
+
+        // Rolling breakdown over the frames of the history
+        [[nodiscard]]
+        std::vector<ScopeTiming> GetTimings() const;
+
+        [[nodiscard]]
+        Statistics GetStatistics() const;
+
+        // One row per frame of the history and one column per scope, returns false on failure
+        bool ExportCsv(std::string const & path) const;
+
+        class Scope
+        {
+        public:
+
+            explicit Scope(RT::CommandRecordState const & recordState, char const * name);
+            ~Scope();
+
+            Scope(Scope const &) noexcept = delete;
+            Scope(Scope &&) noexcept = delete;
+            Scope & operator = (Scope const &) noexcept = delete;
+            Scope & operator = (Scope &&) noexcept = delete;
+
+        private:
+
+            RT::CommandRecordState const & _recordState;
+            ScopeId _scopeId = InvalidScope;
+        };
+
+    private:
+
+        struct Frame
+        {
+            VkQueryPool timestampPool{};
+            VkQueryPool statisticsPool{};
+            std::vector<char const *> names{};
+            std::atomic<uint32_t> scopeCount = 0;
+            bool isRecorded = false;
+            bool isEnabled = false;
+            bool hasStatistics = false;
+            uint64_t frameNumber = 0;
+        };
+
+        struct Sample
+        {
+            std::string name{};
+            float milliseconds = 0.0f;
+        };
+
+        struct FrameRecord
+        {
+            uint64_t frameNumber = 0;
+            std::vector<Sample> samples{};
+            bool hasStatistics = false;
+            Statistics statistics{};
+        };
+
+        VkDevice _device{};
+
+        // Nanoseconds per tick
+        double _timestampPeriod = 0.0;
+        uint64_t _timestampMask = 0;
+        bool _timestampSupported = false;
+        bool _statisticsSupported = false;
+
+        std::atomic<bool> _enabled = true;
+        uint64_t _nextFrameNumber = 0;
+
+        std::vector<std::unique_ptr<Frame>> _frames{};
+
+        std::deque<FrameRecord> _history{};
+        mutable std::mutex _historyMutex{};
+    };
+}
+
+#define SCOPE_GpuProfiler(recordState, name)    MFA::GpuProfiler::Scope MFA_UNIQUE_NAME(__gpuScopeProfiler) {recordState, name};
@@ -4,10 +4,42 @@
 #include "BedrockAssert.hpp"
 #include "BedrockPlatforms.hpp"
 #include "RenderBackend.hpp"
+#include "BedrockFile.hpp"
+#include "JobSystem.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <thread>
 
 namespace MFA
 {
 
+    static constexpr VkDeviceSize UploadRingSize = 16 * 1024 * 1024;
+
+    static constexpr char const * PipelineCacheDirectory = "./cache";
+
+    // Secondary command buffers are allocated in groups to keep vkAllocateCommandBuffers out of most frames
+    static constexpr uint32_t SecondaryCommandBufferBatch = 4;
+
+    //-------------------------------------------------------------------------------------------------
+
+    // Every device and driver version gets its own file, so switching gpus or updating the driver never loads stale data
+    static std::string PipelineCachePath(VkPhysicalDeviceProperties const & properties)
+    {
+        std::string fileName = "pipeline_cache_";
+        char hex[3]{};
+        for (auto const byte : properties.pipelineCacheUUID)
+        {
+            std::snprintf(hex, sizeof(hex), "%02x", byte);
+            fileName += hex;
+        }
+        fileName += "_" + std::to_string(properties.driverVersion) + ".bin";
+        return std::filesystem::path(PipelineCacheDirectory).append(fileName).string();
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     static VkBool32 VKAPI_PTR DebugCallback(
         VkDebugReportFlagsEXT const flags,
         VkDebugReportObjectTypeEXT object_type,
@@ -78,6 +110,9 @@ namespace MFA
         {
             UpdateSurface();
         }
+
+        _streamingQueue->Update();
+        _uploadQueue->Update();
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -100,6 +135,51 @@ namespace MFA
          }
     }
 
+    //-------------------------------------------------------------------------------------------------
+
+    void LogicalDevice::ResetSecondaryCommandPools(uint32_t const frameIndex)
+    {
+        std::lock_guard lock(_secondaryCommandPoolMutex);
+        for (auto const & pool : _secondaryCommandPools[frameIndex])
+        {
+            if (pool != nullptr && pool->nextCommandBuffer > 0)
+            {
+                RB::ResetCommandPool(_vkDevice, pool->commandPool);
+                pool->nextCommandBuffer = 0;
+            }
+        }
+    }
+    //-------------------------------------------------------------------------------------------------
+
+    void LogicalDevice::SavePipelineCache() const
+    {
+        auto const cacheData = RB::GetPipelineCacheData(_vkDevice, _pipelineCache);
+        if (cacheData == nullptr)
+        {
+            return;
+        }
+        // A crash or a second instance must never leave a torn cache behind, so the data is renamed into place
+        std::ostringstream tempPath{};
+        tempPath << _pipelineCachePath << "." << std::this_thread::get_id() << ".tmp";
+        std::error_code errorCode{};
+        if (File::Write(tempPath.str(), *cacheData) == false)
+        {
+            MFA_LOG_WARN("Failed to save the pipeline cache into %s", _pipelineCachePath.c_str());
+            std::filesystem::remove(tempPath.str(), errorCode);
+            return;
+        }
+        std::filesystem::rename(tempPath.str(), _pipelineCachePath, errorCode);
+        if (errorCode)
+        {
+            MFA_LOG_WARN(
+                "Failed to save the pipeline cache into %s: %s",
+                _pipelineCachePath.c_str(),
+                errorCode.message().c_str()
+            );
+            std::filesystem::remove(tempPath.str(), errorCode);
+        }
+    }
+
     //-------------------------------------------------------------------------------------------------
     
     static int SDLEventWatcher(void * data, SDL_Event * event)
@@ -225,6 +305,8 @@ namespace MFA
             _graphicQueueFamily = result.graphicQueueFamily;
             _computeQueueFamily = result.computeQueueFamily;
             _presentQueueFamily = result.presentQueueFamily;
+            _hasDedicatedTransferQueue = result.isTransferQueueValid;
+            _transferQueueFamily = result.isTransferQueueValid ? result.transferQueueFamily : result.graphicQueueFamily;
         }
 
         {
@@ -232,12 +314,20 @@ namespace MFA
                 _physicalDevice,
                 _graphicQueueFamily,
                 _presentQueueFamily,
+                _transferQueueFamily,
                 _physicalDeviceFeatures
             );
             _vkDevice = result.device;
             _physicalMemoryProperties = result.physicalMemoryProperties;
+            _timelineSemaphoreEnabled = result.timelineSemaphoreEnabled;
         }
 
+        _memoryAllocator = std::make_unique<MemoryAllocator>(
+            _vkDevice,
+            _physicalMemoryProperties,
+            _physicalDeviceProperties.limits.nonCoherentAtomSize
+        );
+
         // Get graphics and presentation queues (which may be the same)
         _graphicQueue = RB::GetQueueByFamilyIndex(
             _vkDevice,
@@ -257,7 +347,49 @@ namespace MFA
         );
         MFA_ASSERT(_presentQueue != VK_NULL_HANDLE);
 
-        MFA_LOG_INFO("Acquired graphics, compute and presentation queues");
+        _transferQueue = RB::GetQueueByFamilyIndex(
+            _vkDevice,
+            _transferQueueFamily
+        );
+        MFA_ASSERT(_transferQueue != VK_NULL_HANDLE);
+
+        MFA_LOG_INFO("Acquired graphics, compute, presentation and transfer queues");
+
+        {// Pipeline cache
+            _pipelineCachePath = PipelineCachePath(_physicalDeviceProperties);
+            std::shared_ptr<Blob> cacheData = nullptr;
+            if (std::filesystem::exists(_pipelineCachePath))
+            {
+                cacheData = File::Read(_pipelineCachePath);
+            }
+            _pipelineCache = RB::CreatePipelineCache(_vkDevice, _physicalDeviceProperties, cacheData.get());
+            MFA_LOG_INFO(
+                "Pipeline cache %s: %s",
+                cacheData != nullptr ? "loaded" : "created",
+                _pipelineCachePath.c_str()
+            );
+        }
+
+        _uploadQueue = std::make_unique<UploadQueue>(
+            _vkDevice,
+            _physicalDevice,
+            _graphicQueueFamily,
+            _graphicQueue,
+            _queueMutex,
+            UploadRingSize,
+            _physicalDeviceProperties.limits.optimalBufferCopyOffsetAlignment
+        );
+
+        // The transfer queue is only used when the resources can be handed over with a timeline semaphore
+        bool const canStream = _hasDedicatedTransferQueue && _timelineSemaphoreEnabled;
+        _streamingQueue = std::make_unique<StreamingQueue>(
+            _vkDevice,
+            _physicalDevice,
+            _transferQueueFamily,
+            canStream ? _transferQueue : VK_NULL_HANDLE,
+            _queueMutex,
+            _graphicQueueFamily
+        );
 
         // Graphic
         _graphicCommandPool = RB::CreateCommandPool(_vkDevice, _graphicQueueFamily);
@@ -297,6 +429,24 @@ namespace MFA
             _maxFramePerFlight
         );
 
+        // Secondary, one slot for the main thread and one for every worker of the job system
+        _mainThreadId = std::this_thread::get_id();
+        auto const workerCount = JobSystem::Instance != nullptr ? JobSystem::Instance->NumberOfAvailableThreads() : 0;
+        _secondaryCommandPools.resize(_maxFramePerFlight);
+        for (auto & framePools : _secondaryCommandPools)
+        {
+            framePools.resize(workerCount + 1);
+        }
+
+        _gpuProfiler = std::make_unique<GpuProfiler>(
+            _vkDevice,
+            _physicalDevice,
+            _graphicQueueFamily,
+            _physicalDeviceProperties,
+            _physicalDeviceFeatures,
+            _maxFramePerFlight
+        );
+
         _depthFormat = RB::FindDepthFormat(_physicalDevice);
 
     #if defined(MFA_DEBUG)  // TODO Fix support for android
@@ -322,11 +472,17 @@ namespace MFA
 
     LogicalDevice::~LogicalDevice()
     {
+        // Buffers of the upload and streaming queues are released through the instance
+        _streamingQueue.reset();
+        _uploadQueue.reset();
+
         Instance = nullptr;
 
         // Common part with resize
         DeviceWaitIdle();
 
+        _gpuProfiler.reset();
+
         SDL_DelEventWatch(SDLEventWatcher, _window);
 
         // Graphic
@@ -364,6 +520,18 @@ namespace MFA
             _vkDevice,
             _presentSemaphores
         );
+        // Secondary
+        for (auto const & framePools : _secondaryCommandPools)
+        {
+            for (auto const & pool : framePools)
+            {
+                if (pool != nullptr)
+                {
+                    RB::DestroyCommandPool(_vkDevice, pool->commandPool);
+                }
+            }
+        }
+        _secondaryCommandPools.clear();
         RB::DestroyFence(
             _vkDevice,
             _graphicFences
@@ -373,6 +541,11 @@ namespace MFA
             _computeFences
         );
 
+        SavePipelineCache();
+        RB::DestroyPipelineCache(_vkDevice, _pipelineCache);
+
+        _memoryAllocator.reset();
+
         RB::DestroyLogicalDevice(_vkDevice);
 
         RB::DestroyWindowSurface(_vkInstance, _surface);
@@ -411,6 +584,11 @@ namespace MFA
         auto const computeFence = GetComputeFence(recordState);
         RB::WaitForFence(vkDevice, {graphicFence, computeFence});
         RB::ResetFences(vkDevice, {graphicFence, computeFence});
+
+        // The previous commands of this frame are finished, so its secondary command buffers can be recorded again
+        ResetSecondaryCommandPools(recordState.frameIndex);
+        // Queries of this frame are finished as well, reading them does not wait
+        _gpuProfiler->Collect(recordState.frameIndex);
         
 	    // We ignore failed acquire of image because a resize will be triggered at end of pass
 	    RB::AcquireNextImage(
@@ -580,6 +758,66 @@ namespace MFA
 
     //-------------------------------------------------------------------------------------------------
 
+    MemoryAllocator & LogicalDevice::GetMemoryAllocator() const noexcept
+    {
+        MFA_ASSERT(_memoryAllocator != nullptr);
+        return *_memoryAllocator;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    UploadQueue & LogicalDevice::GetUploadQueue() const noexcept
+    {
+        MFA_ASSERT(_uploadQueue != nullptr);
+        return *_uploadQueue;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    StreamingQueue & LogicalDevice::GetStreamingQueue() const noexcept
+    {
+        MFA_ASSERT(_streamingQueue != nullptr);
+        return *_streamingQueue;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    GpuProfiler & LogicalDevice::GetGpuProfiler() const noexcept
+    {
+        MFA_ASSERT(_gpuProfiler != nullptr);
+        return *_gpuProfiler;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    uint32_t LogicalDevice::GetTransferQueueFamily() const noexcept
+    {
+        return _transferQueueFamily;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    VkQueue LogicalDevice::GetTransferQueue() const noexcept
+    {
+        return _transferQueue;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    bool LogicalDevice::HasDedicatedTransferQueue() const noexcept
+    {
+        return _hasDedicatedTransferQueue;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    VkPipelineCache LogicalDevice::GetPipelineCache() const noexcept
+    {
+        return _pipelineCache;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     VkQueue LogicalDevice::GetGraphicQueue() const noexcept
     {
 	    return _graphicQueue;
@@ -715,6 +953,7 @@ namespace MFA
 
     void LogicalDevice::DeviceWaitIdle() const
     {
+        std::lock_guard lock{ _queueMutex };
         RB::DeviceWaitIdle(_vkDevice);
     }
 
@@ -780,6 +1019,12 @@ namespace MFA
 
         recordState.commandBufferType = commandBufferType;
         recordState.commandBuffer = commandBuffer;
+
+        // Queries are reset before any render pass of the frame begins
+        if (commandBufferType == RT::CommandBufferType::Graphic)
+        {
+            _gpuProfiler->BeginFrame(recordState);
+        }
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -799,8 +1044,69 @@ namespace MFA
 
     //-------------------------------------------------------------------------------------------------
 
+    VkCommandBuffer LogicalDevice::AcquireSecondaryCommandBuffer(RT::CommandRecordState const & recordState)
+    {
+        MFA_ASSERT(recordState.isValid);
+
+        auto const slot = RecordingThreadSlot();
+        if (slot < 0)
+        {
+            MFA_CRASH("Secondary command buffers can only be recorded on the main thread or on a worker of the job system");
+        }
+
+        SecondaryCommandPool * pool = nullptr;
+        {
+            std::lock_guard lock(_secondaryCommandPoolMutex);
+            auto & framePools = _secondaryCommandPools[recordState.frameIndex];
+            // The job system can be created after the device or replaced by one with more workers
+            if (slot >= static_cast<int>(framePools.size()))
+            {
+                framePools.resize(slot + 1);
+            }
+            auto & slotPool = framePools[slot];
+            if (slotPool == nullptr)
+            {
+                slotPool = std::make_unique<SecondaryCommandPool>();
+                slotPool->commandPool = RB::CreateCommandPool(_vkDevice, _graphicQueueFamily);
+            }
+            pool = slotPool.get();
+        }
+
+        // Only the calling thread touches its own pool
+        if (pool->nextCommandBuffer == pool->commandBuffers.size())
+        {
+            auto const commandBuffers = RB::CreateCommandBuffers(
+                _vkDevice,
+                SecondaryCommandBufferBatch,
+                pool->commandPool,
+                VK_COMMAND_BUFFER_LEVEL_SECONDARY
+            );
+            pool->commandBuffers.insert(pool->commandBuffers.end(), commandBuffers.begin(), commandBuffers.end());
+        }
+
+        return pool->commandBuffers[pool->nextCommandBuffer++];
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    int LogicalDevice::RecordingThreadSlot() const
+    {
+        if (std::this_thread::get_id() == _mainThreadId)
+        {
+            return 0;
+        }
+        auto const * jobSystem = JobSystem::Instance;
+        auto const workerIndex = jobSystem != nullptr ? jobSystem->WorkerIndex() : -1;
+        return workerIndex >= 0 ? workerIndex + 1 : -1;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     void LogicalDevice::SubmitQueues(RT::CommandRecordState & recordState)
     {
+        // Uploads are ordered before the frame on the graphic queue, no cpu wait is needed
+        _uploadQueue->Submit();
+
         const auto graphicSemaphore = GetGraphicSemaphore(recordState);
         const auto computeSemaphore = GetComputeSemaphore(recordState);
         const auto presentSemaphore = GetPresentSemaphore(recordState);
@@ -839,6 +1145,7 @@ namespace MFA
                 .pSignalSemaphores = computeSignalSemaphores.data(),
             };
 
+            std::lock_guard lock{ _queueMutex };
             RB::SubmitQueues(
                 _computeQueue,
                 1,
@@ -877,7 +1184,8 @@ namespace MFA
                 .signalSemaphoreCount = static_cast<uint32_t>(graphicSignalSemaphores.size()),
                 .pSignalSemaphores = graphicSignalSemaphores.data(),
             };
-            
+
+            std::lock_guard lock{ _queueMutex };
             RB::SubmitQueues(
                 _graphicQueue,
                 1,
@@ -904,7 +1212,11 @@ namespace MFA
         presentInfo.pImageIndices = &recordState.imageIndex;
         
         // TODO Move to renderBackend
-        auto const res = vkQueuePresentKHR(_presentQueue, &presentInfo);
+        VkResult res{};
+        {
+            std::lock_guard lock{ _queueMutex };
+            res = vkQueuePresentKHR(_presentQueue, &presentInfo);
+        }
         if (res == VK_SUBOPTIMAL_KHR || res == VK_ERROR_OUT_OF_DATE_KHR || _windowResized == true)
         {
             _windowResized = true;
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "RenderBackend.hpp"
+#include "MemoryAllocator.hpp"
+#include "UploadQueue.hpp"
+#include "StreamingQueue.hpp"
+#include "GpuProfiler.hpp"
 #include "BedrockSignal.hpp"
 
 #include <vulkan/vulkan.h>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace MFA
 {
@@ -98,6 +104,32 @@ namespace MFA
         [[nodiscard]]
         VkPhysicalDeviceMemoryProperties GetPhysicalMemoryProperties() const noexcept;
 
+        [[nodiscard]]
+        MemoryAllocator & GetMemoryAllocator() const noexcept;
+
+        [[nodiscard]]
+        UploadQueue & GetUploadQueue() const noexcept;
+
+        [[nodiscard]]
+        StreamingQueue & GetStreamingQueue() const noexcept;
+
+        [[nodiscard]]
+        GpuProfiler & GetGpuProfiler() const noexcept;
+
+        // Same as the graphic queue family when the device has no dedicated transfer family
+        [[nodiscard]]
+        uint32_t GetTransferQueueFamily() const noexcept;
+
+        [[nodiscard]]
+        VkQueue GetTransferQueue() const noexcept;
+
+        [[nodiscard]]
+        bool HasDedicatedTransferQueue() const noexcept;
+
+        // Shared by every pipeline creation, persisted between runs
+        [[nodiscard]]
+        VkPipelineCache GetPipelineCache() const noexcept;
+
         [[nodiscard]]
         VkQueue GetGraphicQueue() const noexcept;
 
@@ -172,6 +204,11 @@ namespace MFA
 
         void EndCommandBuffer(RT::CommandRecordState & recordState);
 
+        // Returns an unused secondary command buffer of the calling thread for the frame of the record state.
+        // Every thread allocates from its own command pool, so recording jobs can call it from the job system.
+        [[nodiscard]]
+        VkCommandBuffer AcquireSecondaryCommandBuffer(RT::CommandRecordState const & recordState);
+
         void SubmitQueues(RT::CommandRecordState & recordState);
 
         void Present(RT::CommandRecordState const & recordState, VkSwapchainKHR swapChain);
@@ -185,6 +222,14 @@ namespace MFA
 
         void UpdateSurface();
 
+        void ResetSecondaryCommandPools(uint32_t frameIndex);
+
+        // Slot of the secondary command pools of the calling thread, -1 if it may not record
+        [[nodiscard]]
+        int RecordingThreadSlot() const;
+
+        void SavePipelineCache() const;
+
     public:
 
         inline static LogicalDevice* Instance = nullptr;
@@ -226,13 +271,29 @@ namespace MFA
         uint32_t _graphicQueueFamily {};
         uint32_t _computeQueueFamily {};
         uint32_t _presentQueueFamily {};
+        uint32_t _transferQueueFamily {};
+        bool _hasDedicatedTransferQueue = false;
+        bool _timelineSemaphoreEnabled = false;
 
         VkDevice _vkDevice {};
         VkPhysicalDeviceMemoryProperties _physicalMemoryProperties{};
+        std::unique_ptr<MemoryAllocator> _memoryAllocator{};
 
         VkQueue _graphicQueue {};
         VkQueue _computeQueue {};
         VkQueue _presentQueue {};
+        // The queues can be the same VkQueue and the upload queue submits from other threads,
+        // so every submit, present and device wait takes this lock
+        mutable std::mutex _queueMutex {};
+        // Used by the streaming queue thread when it is a dedicated queue
+        VkQueue _transferQueue {};
+
+        std::unique_ptr<UploadQueue> _uploadQueue{};
+        std::unique_ptr<StreamingQueue> _streamingQueue{};
+        std::unique_ptr<GpuProfiler> _gpuProfiler{};
+
+        VkPipelineCache _pipelineCache {};
+        std::string _pipelineCachePath {};
 
         VkCommandPool _graphicCommandPool {};
         std::vector<VkCommandBuffer> _graphicCommandBuffer {};
@@ -246,6 +307,18 @@ namespace MFA
     
         std::vector<VkSemaphore> _presentSemaphores {};
 
+        struct SecondaryCommandPool
+        {
+            VkCommandPool commandPool {};
+            std::vector<VkCommandBuffer> commandBuffers {};
+            size_t nextCommandBuffer = 0;
+        };
+        // The main thread records into slot 0 and worker i of the job system into slot i + 1
+        std::thread::id _mainThreadId {};
+        // Indexed by [frameIndex][recording thread], a pool is created the first time a thread records into it
+        std::vector<std::vector<std::unique_ptr<SecondaryCommandPool>>> _secondaryCommandPools {};
+        std::mutex _secondaryCommandPoolMutex {};
+
         VkFormat _depthFormat {};
         VkSurfaceFormatKHR _surfaceFormat{};
 
@@ -0,0 +1,502 @@
+#include "MemoryAllocator.hpp"
+
+#include "BedrockAssert.hpp"
+#include "BedrockLog.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace MFA
+{
+
+	static constexpr VkDeviceSize MinBuddySize = 256;
+	static constexpr VkDeviceSize DeviceLocalBlockSize = 64 * 1024 * 1024;
+	static constexpr VkDeviceSize HostVisibleBlockSize = 16 * 1024 * 1024;
+	static constexpr VkDeviceSize StagingPageSize = 32 * 1024 * 1024;
+
+	//-------------------------------------------------------------------------------------------------
+
+	static void VK_Check(VkResult const result)
+	{
+		if (result != VK_SUCCESS)
+		{
+			MFA_LOG_ERROR("Vulkan command failed with code: %i", static_cast<int>(result));
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static VkDeviceSize AlignUp(VkDeviceSize const value, VkDeviceSize const alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static VkDeviceSize AlignDown(VkDeviceSize const value, VkDeviceSize const alignment)
+	{
+		return value & ~(alignment - 1);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	static uint32_t BuddyOrder(VkDeviceSize const size)
+	{
+		auto const units = std::bit_ceil((std::max)(size, MinBuddySize) / MinBuddySize);
+		return static_cast<uint32_t>(std::countr_zero(units));
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	float MemoryAllocator::Stats::InternalFragmentation() const noexcept
+	{
+		if (allocatedBytes == 0)
+		{
+			return 0.0f;
+		}
+		return 1.0f - static_cast<float>(usedBytes) / static_cast<float>(allocatedBytes);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	float MemoryAllocator::Stats::ExternalFragmentation() const noexcept
+	{
+		if (freeBytes == 0)
+		{
+			return 0.0f;
+		}
+		return 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	MemoryAllocator::MemoryAllocator(
+		VkDevice device,
+		VkPhysicalDeviceMemoryProperties const & memoryProperties,
+		VkDeviceSize const nonCoherentAtomSize
+	)
+		: _device(device)
+		, _memoryProperties(memoryProperties)
+		, _nonCoherentAtomSize((std::max)(nonCoherentAtomSize, VkDeviceSize{1}))
+	{
+		MFA_ASSERT(_device != VK_NULL_HANDLE);
+		Instance = this;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	MemoryAllocator::~MemoryAllocator()
+	{
+		Instance = nullptr;
+
+		auto const stats = GetStats();
+		if (stats.allocationCount > 0)
+		{
+			MFA_LOG_WARN("%d gpu allocations are still alive while destroying the memory allocator", stats.allocationCount);
+		}
+
+		for (auto & pool : _pools)
+		{
+			for (auto & block : pool.blocks)
+			{
+				if (block != nullptr)
+				{
+					DestroyBlock(*block);
+				}
+			}
+		}
+		for (auto & block : _dedicatedBlocks)
+		{
+			if (block != nullptr)
+			{
+				DestroyBlock(*block);
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	RT::MemoryAllocation MemoryAllocator::Allocate(
+		VkMemoryRequirements const & requirements,
+		VkMemoryPropertyFlags const properties,
+		Usage const usage
+	)
+	{
+		std::scoped_lock lock{_mutex};
+
+		auto const memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+
+		auto & pool = FindOrCreatePool(memoryTypeIndex, usage);
+		auto const poolIndex = static_cast<int>(&pool - _pools.data());
+
+		RT::MemoryAllocation allocation{};
+		allocation.memoryTypeIndex = memoryTypeIndex;
+		allocation.size = requirements.size;
+
+		if (requirements.size > pool.blockSize / 2)
+		{
+			auto block = CreateBlock(pool, requirements.size);
+			block->allocationCount = 1;
+			block->usedBytes = requirements.size;
+			block->allocatedBytes = requirements.size;
+			block->head = requirements.size;
+
+			allocation.memory = block->memory;
+			allocation.offset = 0;
+			allocation.allocatedSize = requirements.size;
+			allocation.mappedPtr = block->mappedPtr;
+			allocation.poolIndex = -1;
+
+			auto const freeSlot = std::find(_dedicatedBlocks.begin(), _dedicatedBlocks.end(), nullptr);
+			allocation.blockIndex = static_cast<int>(freeSlot - _dedicatedBlocks.begin());
+			if (freeSlot == _dedicatedBlocks.end())
+			{
+				_dedicatedBlocks.emplace_back(std::move(block));
+			}
+			else
+			{
+				*freeSlot = std::move(block);
+			}
+			return allocation;
+		}
+
+		allocation.poolIndex = poolIndex;
+
+		for (int blockIndex = 0; blockIndex < static_cast<int>(pool.blocks.size()); ++blockIndex)
+		{
+			auto & block = pool.blocks[blockIndex];
+			if (block != nullptr && AllocateFromBlock(pool, *block, requirements, allocation) == true)
+			{
+				allocation.blockIndex = blockIndex;
+				return allocation;
+			}
+		}
+
+		auto const freeSlot = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+		allocation.blockIndex = static_cast<int>(freeSlot - pool.blocks.begin());
+		auto & block = freeSlot == pool.blocks.end()
+			? pool.blocks.emplace_back(CreateBlock(pool, pool.blockSize))
+			: (*freeSlot = CreateBlock(pool, pool.blockSize));
+
+		bool const success = AllocateFromBlock(pool, *block, requirements, allocation);
+		MFA_ASSERT(success == true);
+
+		return allocation;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void MemoryAllocator::Free(RT::MemoryAllocation const & allocation)
+	{
+		std::scoped_lock lock{_mutex};
+
+		if (allocation.poolIndex < 0)
+		{
+			auto & block = _dedicatedBlocks[allocation.blockIndex];
+			MFA_ASSERT(block != nullptr && block->memory == allocation.memory);
+			DestroyBlock(*block);
+			block.reset();
+			return;
+		}
+
+		auto & pool = _pools[allocation.poolIndex];
+		auto & block = pool.blocks[allocation.blockIndex];
+		MFA_ASSERT(block != nullptr && block->memory == allocation.memory);
+
+		--block->allocationCount;
+		block->usedBytes -= allocation.size;
+		block->allocatedBytes -= allocation.allocatedSize;
+
+		if (pool.usage == Usage::Staging)
+		{
+			// Linear pages can only be reused when everything inside them is released
+			if (block->allocationCount == 0)
+			{
+				block->head = 0;
+			}
+		}
+		else
+		{
+			auto offset = allocation.offset;
+			auto order = allocation.order;
+			auto const maxOrder = static_cast<uint32_t>(block->freeLists.size()) - 1;
+			while (order < maxOrder)
+			{
+				auto const buddyOffset = offset ^ (MinBuddySize << order);
+				auto & freeList = block->freeLists[order];
+				auto const buddyIt = freeList.find(buddyOffset);
+				if (buddyIt == freeList.end())
+				{
+					break;
+				}
+				freeList.erase(buddyIt);
+				offset = (std::min)(offset, buddyOffset);
+				++order;
+			}
+			block->freeLists[order].emplace(offset);
+		}
+
+		if (block->allocationCount == 0)
+		{
+			// We keep one block per pool around to avoid allocating a new one for the next resource
+			auto const aliveBlockCount = std::count_if(
+				pool.blocks.begin(),
+				pool.blocks.end(),
+				[](auto const & item)->bool { return item != nullptr; }
+			);
+			if (aliveBlockCount > 1)
+			{
+				DestroyBlock(*block);
+				block.reset();
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void MemoryAllocator::Flush(
+		RT::MemoryAllocation const & allocation,
+		VkDeviceSize const offset,
+		VkDeviceSize const size
+	) const
+	{
+		auto const propertyFlags = _memoryProperties.memoryTypes[allocation.memoryTypeIndex].propertyFlags;
+		if ((propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0)
+		{
+			return;
+		}
+
+		// Ranges have to be aligned to nonCoherentAtomSize. Blocks are allocated with a size that is a multiple of it.
+		auto const begin = AlignDown(allocation.offset + offset, _nonCoherentAtomSize);
+		auto const end = AlignUp(allocation.offset + offset + size, _nonCoherentAtomSize);
+
+		VkMappedMemoryRange const range{
+			.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+			.memory = allocation.memory,
+			.offset = begin,
+			.size = end - begin
+		};
+		VK_Check(vkFlushMappedMemoryRanges(_device, 1, &range));
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	MemoryAllocator::Stats MemoryAllocator::GetStats() const
+	{
+		std::scoped_lock lock{_mutex};
+
+		Stats stats{};
+
+		auto const addBlock = [&stats](Block const & block)->void
+		{
+			stats.reservedBytes += block.size;
+			stats.usedBytes += block.usedBytes;
+			stats.allocatedBytes += block.allocatedBytes;
+			stats.allocationCount += block.allocationCount;
+		};
+
+		for (auto const & pool : _pools)
+		{
+			for (auto const & block : pool.blocks)
+			{
+				if (block == nullptr)
+				{
+					continue;
+				}
+				++stats.blockCount;
+				addBlock(*block);
+
+				if (pool.usage == Usage::Staging)
+				{
+					auto const freeBytes = block->size - block->head;
+					stats.freeBytes += freeBytes;
+					stats.largestFreeRange = (std::max)(stats.largestFreeRange, freeBytes);
+				}
+				else
+				{
+					for (uint32_t order = 0; order < static_cast<uint32_t>(block->freeLists.size()); ++order)
+					{
+						auto const & freeList = block->freeLists[order];
+						if (freeList.empty() == false)
+						{
+							auto const rangeSize = MinBuddySize << order;
+							stats.freeBytes += rangeSize * freeList.size();
+							stats.largestFreeRange = (std::max)(stats.largestFreeRange, rangeSize);
+						}
+					}
+				}
+			}
+		}
+
+		for (auto const & block : _dedicatedBlocks)
+		{
+			if (block != nullptr)
+			{
+				++stats.dedicatedAllocationCount;
+				addBlock(*block);
+			}
+		}
+
+		return stats;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	uint32_t MemoryAllocator::FindMemoryType(uint32_t const typeFilter, VkMemoryPropertyFlags const properties) const
+	{
+		for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < _memoryProperties.memoryTypeCount; memoryTypeIndex++)
+		{
+			if ((typeFilter & (1 << memoryTypeIndex)) && (_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & properties) == properties)
+			{
+				return memoryTypeIndex;
+			}
+		}
+
+		MFA_CRASH("failed to find suitable memory type!");
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::unique_ptr<MemoryAllocator::Block> MemoryAllocator::CreateBlock(Pool const & pool, VkDeviceSize const size) const
+	{
+		auto block = std::make_unique<Block>();
+		block->size = AlignUp(size, _nonCoherentAtomSize);
+
+		VkMemoryAllocateInfo const allocateInfo{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.allocationSize = block->size,
+			.memoryTypeIndex = pool.memoryTypeIndex
+		};
+		VK_Check(vkAllocateMemory(_device, &allocateInfo, nullptr, &block->memory));
+
+		// Host visible blocks stay mapped for their whole lifetime, a single VkDeviceMemory cannot be mapped twice
+		if (IsHostVisible(pool.memoryTypeIndex) == true)
+		{
+			void * mappedPtr = nullptr;
+			VK_Check(vkMapMemory(_device, block->memory, 0, VK_WHOLE_SIZE, 0, &mappedPtr));
+			block->mappedPtr = static_cast<uint8_t *>(mappedPtr);
+		}
+
+		if (pool.usage != Usage::Staging && size == pool.blockSize)
+		{
+			auto const maxOrder = BuddyOrder(pool.blockSize);
+			block->freeLists.resize(maxOrder + 1);
+			block->freeLists[maxOrder].emplace(0);
+		}
+
+		return block;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void MemoryAllocator::DestroyBlock(Block & block) const
+	{
+		if (block.mappedPtr != nullptr)
+		{
+			vkUnmapMemory(_device, block.memory);
+			block.mappedPtr = nullptr;
+		}
+		vkFreeMemory(_device, block.memory, nullptr);
+		block.memory = VK_NULL_HANDLE;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool MemoryAllocator::AllocateFromBlock(
+		Pool const & pool,
+		Block & block,
+		VkMemoryRequirements const & requirements,
+		RT::MemoryAllocation & outAllocation
+	) const
+	{
+		if (pool.usage == Usage::Staging)
+		{
+			auto const offset = AlignUp(block.head, requirements.alignment);
+			if (offset + requirements.size > block.size)
+			{
+				return false;
+			}
+			block.head = offset + requirements.size;
+			outAllocation.offset = offset;
+			outAllocation.allocatedSize = requirements.size;
+		}
+		else
+		{
+			// Buddy ranges are aligned to their own size, so rounding up to the alignment is enough
+			auto const order = BuddyOrder((std::max)(requirements.size, requirements.alignment));
+			auto availableOrder = order;
+			while (availableOrder < block.freeLists.size() && block.freeLists[availableOrder].empty() == true)
+			{
+				++availableOrder;
+			}
+			if (availableOrder >= block.freeLists.size())
+			{
+				return false;
+			}
+
+			auto & freeList = block.freeLists[availableOrder];
+			auto const offset = *freeList.begin();
+			freeList.erase(freeList.begin());
+
+			// Splitting the range and returning the upper halves
+			while (availableOrder > order)
+			{
+				--availableOrder;
+				block.freeLists[availableOrder].emplace(offset + (MinBuddySize << availableOrder));
+			}
+
+			outAllocation.offset = offset;
+			outAllocation.order = order;
+			outAllocation.allocatedSize = MinBuddySize << order;
+		}
+
+		++block.allocationCount;
+		block.usedBytes += requirements.size;
+		block.allocatedBytes += outAllocation.allocatedSize;
+
+		outAllocation.memory = block.memory;
+		outAllocation.mappedPtr = block.mappedPtr != nullptr ? block.mappedPtr + outAllocation.offset : nullptr;
+
+		return true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	MemoryAllocator::Pool & MemoryAllocator::FindOrCreatePool(uint32_t const memoryTypeIndex, Usage const usage)
+	{
+		for (auto & pool : _pools)
+		{
+			if (pool.memoryTypeIndex == memoryTypeIndex && pool.usage == usage)
+			{
+				return pool;
+			}
+		}
+
+		auto & pool = _pools.emplace_back();
+		pool.memoryTypeIndex = memoryTypeIndex;
+		pool.usage = usage;
+		if (usage == Usage::Staging)
+		{
+			pool.blockSize = StagingPageSize;
+		}
+		else if (IsHostVisible(memoryTypeIndex) == true)
+		{
+			pool.blockSize = HostVisibleBlockSize;
+		}
+		else
+		{
+			pool.blockSize = DeviceLocalBlockSize;
+		}
+		return pool;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool MemoryAllocator::IsHostVisible(uint32_t const memoryTypeIndex) const
+	{
+		return (_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+}
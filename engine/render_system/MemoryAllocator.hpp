@@ -0,0 +1,139 @@
+#pragma once
+
+#include "RenderTypes.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace MFA
+{
+    // Sub-allocates buffers and images from large VkDeviceMemory blocks.
+    // Staging buffers use linear pages that are reset once every allocation inside them is freed.
+    // Other resources use a buddy allocator per block. Resources larger than half of a block get a dedicated allocation.
+    class MemoryAllocator
+    {
+    public:
+
+        enum class Usage : uint8_t
+        {
+            Buffer,
+            // Images are kept in separate blocks so that we do not need to respect bufferImageGranularity
+            Image,
+            // Short-lived upload buffers
+            Staging
+        };
+
+        struct Stats
+        {
+            int blockCount = 0;
+            int dedicatedAllocationCount = 0;
+            int allocationCount = 0;
+            // Memory that is allocated from the driver
+            VkDeviceSize reservedBytes = 0;
+            // Memory that is requested by the resources
+            VkDeviceSize usedBytes = 0;
+            // Memory that is taken by the resources including alignment and rounding
+            VkDeviceSize allocatedBytes = 0;
+            VkDeviceSize freeBytes = 0;
+            VkDeviceSize largestFreeRange = 0;
+
+            // Wasted part of the allocated memory
+            [[nodiscard]]
+            float InternalFragmentation() const noexcept;
+
+            // Part of the free memory that cannot be used by the largest possible allocation
+            [[nodiscard]]
+            float ExternalFragmentation() const noexcept;
+        };
+
+        inline static MemoryAllocator * Instance = nullptr;
+
+        explicit MemoryAllocator(
+            VkDevice device,
+            VkPhysicalDeviceMemoryProperties const & memoryProperties,
+            VkDeviceSize nonCoherentAtomSize
+        );
+
+        ~MemoryAllocator();
+
+        MemoryAllocator(MemoryAllocator const &) noexcept = delete;
+        MemoryAllocator(MemoryAllocator &&) noexcept = delete;
+        MemoryAllocator & operator = (MemoryAllocator const &) noexcept = delete;
+        MemoryAllocator & operator = (MemoryAllocator &&) noexcept = delete;
+
+        [[nodiscard]]
+        RT::MemoryAllocation Allocate(
+            VkMemoryRequirements const & requirements,
+            VkMemoryPropertyFlags properties,
+            Usage usage
+        );
+
+        void Free(RT::MemoryAllocation const & allocation);
+
+        // Required after cpu writes when the memory type is not host coherent
+        void Flush(RT::MemoryAllocation const & allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+        [[nodiscard]]
+        Stats GetStats() const;
+
+        [[nodiscard]]
+        uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+    private:
+
+        struct Block
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            uint8_t * mappedPtr = nullptr;
+            VkDeviceSize size = 0;
+            int allocationCount = 0;
+            VkDeviceSize usedBytes = 0;
+            VkDeviceSize allocatedBytes = 0;
+            // Buddy allocator, free offsets per order
+            std::vector<std::set<VkDeviceSize>> freeLists{};
+            // Linear allocator
+            VkDeviceSize head = 0;
+        };
+
+        struct Pool
+        {
+            uint32_t memoryTypeIndex = 0;
+            Usage usage = Usage::Buffer;
+            VkDeviceSize blockSize = 0;
+            // Released blocks stay as nullptr so that the indices of the allocations remain valid
+            std::vector<std::unique_ptr<Block>> blocks{};
+        };
+
+        [[nodiscard]]
+        std::unique_ptr<Block> CreateBlock(Pool const & pool, VkDeviceSize size) const;
+
+        void DestroyBlock(Block & block) const;
+
+        [[nodiscard]]
+        bool AllocateFromBlock(
+            Pool const & pool,
+            Block & block,
+            VkMemoryRequirements const & requirements,
+            RT::MemoryAllocation & outAllocation
+        ) const;
+
+        [[nodiscard]]
+        Pool & FindOrCreatePool(uint32_t memoryTypeIndex, Usage usage);
+
+        [[nodiscard]]
+        bool IsHostVisible(uint32_t memoryTypeIndex) const;
+
+        VkDevice _device{};
+        VkPhysicalDeviceMemoryProperties _memoryProperties{};
+        VkDeviceSize _nonCoherentAtomSize{};
+
+        std::vector<Pool> _pools{};
+        std::vector<std::unique_ptr<Block>> _dedicatedBlocks{};
+
+        mutable std::mutex _mutex{};
+    };
+}
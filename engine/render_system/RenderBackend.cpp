@@ -3,7 +3,9 @@
 #include "BedrockLog.hpp"
 #include "BedrockAssert.hpp"
 #include "BedrockString.hpp"
+#include "MemoryAllocator.hpp"
 
+#include <algorithm>
 #include <vector>
 #include <set>
 #include <cstdio>
@@ -75,7 +77,8 @@ namespace MFA::RenderBackend
         VkCommandBuffer commandBuffer,
         VkBuffer sourceBuffer,
         VkBuffer destinationBuffer,
-        VkDeviceSize const size
+        VkDeviceSize const size,
+        VkDeviceSize const offset = 0
     );
 
 
@@ -97,6 +100,7 @@ namespace MFA::RenderBackend
         VkDevice device,
         VkCommandBuffer commandBuffer,
         VkBuffer buffer,
+        VkDeviceSize bufferOffset,
         VkImage image,
         AS::Texture const& cpuTexture
     );
@@ -320,7 +324,7 @@ namespace MFA::RenderBackend
             // The version of the engine
             .engineVersion = EngineVersion,
             // The version of Vulkan we're using for this application
-            .apiVersion = VK_API_VERSION_1_1
+            .apiVersion = VK_API_VERSION_1_2
         };
         std::vector<char const *> instanceExtensions{};
 
@@ -576,6 +580,9 @@ namespace MFA::RenderBackend
         bool isComputeQueueSet = false;
         uint32_t computeQueueFamily = -1;
 
+        bool isTransferQueueSet = false;
+        uint32_t transferQueueFamily = -1;
+
         uint32_t queueFamilyCount = 0;
         vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
         if (queueFamilyCount == 0)
@@ -593,6 +600,21 @@ namespace MFA::RenderBackend
 
         MFA_LOG_INFO("physical device has %d queue families.", queueFamilyCount);
 
+        for (uint32_t queueIndex = 0; queueIndex < queueFamilyCount; queueIndex++)
+        {
+            auto const & queueFamily = queueFamilies[queueIndex];
+            if (
+                isTransferQueueSet == false &&
+                queueFamily.queueCount > 0 &&
+                (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0 &&
+                (queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0
+            )
+            {
+                transferQueueFamily = queueIndex;
+                isTransferQueueSet = true;
+            }
+        }
+
         for (uint32_t queueIndex = 0; queueIndex < queueFamilyCount; queueIndex++)
         {
             if (isPresentQueueSet == false)
@@ -638,7 +660,10 @@ namespace MFA::RenderBackend
             .graphicQueueFamily = graphicQueueFamily,
 
             .isComputeQueueValid = isComputeQueueSet,
-            .computeQueueFamily = computeQueueFamily
+            .computeQueueFamily = computeQueueFamily,
+
+            .isTransferQueueValid = isTransferQueueSet,
+            .transferQueueFamily = transferQueueFamily
         };
     }
 
@@ -648,6 +673,7 @@ namespace MFA::RenderBackend
         VkPhysicalDevice physicalDevice,
         uint32_t const graphicsQueueFamily,
         uint32_t const presentQueueFamily,
+        uint32_t const transferQueueFamily,
         VkPhysicalDeviceFeatures const & enabledPhysicalDeviceFeatures
     )
     {
@@ -655,34 +681,55 @@ namespace MFA::RenderBackend
 
         MFA_ASSERT(physicalDevice != nullptr);
 
-        // Create one graphics queue and optionally a separate presentation queue
+        // Create one queue per unique family: graphics, presentation and transfer
         float const queuePriority = 1.0f;
 
-        VkDeviceQueueCreateInfo queueCreateInfo[2] = {};
+        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos{};
+        for (auto const queueFamily : {graphicsQueueFamily, presentQueueFamily, transferQueueFamily})
+        {
+            bool isDuplicate = false;
+            for (auto const & queueCreateInfo : queueCreateInfos)
+            {
+                isDuplicate |= queueCreateInfo.queueFamilyIndex == queueFamily;
+            }
+            if (isDuplicate == false)
+            {
+                queueCreateInfos.emplace_back(VkDeviceQueueCreateInfo{
+                    .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                    .queueFamilyIndex = queueFamily,
+                    .queueCount = 1,
+                    .pQueuePriorities = &queuePriority
+                });
+            }
+        }
 
-        queueCreateInfo[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo[0].queueFamilyIndex = graphicsQueueFamily;
-        queueCreateInfo[0].queueCount = 1;
-        queueCreateInfo[0].pQueuePriorities = &queuePriority;
+        // Timeline semaphores are core in 1.2, the transfer queue uses them to hand resources to the graphic queue
+        VkPhysicalDeviceProperties physicalDeviceProperties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
 
-        queueCreateInfo[1].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo[1].queueFamilyIndex = presentQueueFamily;
-        queueCreateInfo[1].queueCount = 1;
-        queueCreateInfo[1].pQueuePriorities = &queuePriority;
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES
+        };
+        if (physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_2)
+        {
+            VkPhysicalDeviceFeatures2 features2{
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &timelineSemaphoreFeatures
+            };
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+        }
+        logicalDevice.timelineSemaphoreEnabled = timelineSemaphoreFeatures.timelineSemaphore == VK_TRUE;
 
         // Create logical device from physical device
         // Note: there are separate instance and device extensions!
         VkDeviceCreateInfo deviceCreateInfo = {};
         deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        deviceCreateInfo.pQueueCreateInfos = queueCreateInfo;
-
-        if (graphicsQueueFamily == presentQueueFamily)
+        deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
+        deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+        if (logicalDevice.timelineSemaphoreEnabled)
         {
-            deviceCreateInfo.queueCreateInfoCount = 1;
-        }
-        else
-        {
-            deviceCreateInfo.queueCreateInfoCount = 2;
+            timelineSemaphoreFeatures.pNext = nullptr;
+            deviceCreateInfo.pNext = &timelineSemaphoreFeatures;
         }
 
         std::vector<char const *> DebugLayers {};
@@ -756,7 +803,8 @@ namespace MFA::RenderBackend
     std::vector<VkCommandBuffer> CreateCommandBuffers(
         VkDevice device,
         uint32_t const count,
-        VkCommandPool commandPool
+        VkCommandPool commandPool,
+        VkCommandBufferLevel const level
     )
     {
         std::vector<VkCommandBuffer> commandBuffers(count);
@@ -764,7 +812,7 @@ namespace MFA::RenderBackend
         VkCommandBufferAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool = commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.level = level;
         allocInfo.commandBufferCount = count;
 
         VK_Check(vkAllocateCommandBuffers(
@@ -781,6 +829,15 @@ namespace MFA::RenderBackend
 
     //-------------------------------------------------------------------------------------------------
 
+    void ResetCommandPool(VkDevice device, VkCommandPool commandPool)
+    {
+        MFA_ASSERT(device != nullptr);
+        MFA_ASSERT(commandPool != VK_NULL_HANDLE);
+        VK_Check(vkResetCommandPool(device, commandPool, 0));
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     std::vector<VkSemaphore> CreateSemaphores(VkDevice device, uint32_t count)
     {
         VkSemaphoreCreateInfo const semaphoreInfo{
@@ -804,6 +861,35 @@ namespace MFA::RenderBackend
 
     //-------------------------------------------------------------------------------------------------
 
+    VkSemaphore CreateTimelineSemaphore(VkDevice device, uint64_t const initialValue)
+    {
+        VkSemaphoreTypeCreateInfo const typeInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = initialValue
+        };
+
+        VkSemaphoreCreateInfo const semaphoreInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &typeInfo
+        };
+
+        VkSemaphore semaphore{};
+        VK_Check(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore));
+        return semaphore;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    uint64_t GetSemaphoreCounterValue(VkDevice device, VkSemaphore timelineSemaphore)
+    {
+        uint64_t value = 0;
+        VK_Check(vkGetSemaphoreCounterValue(device, timelineSemaphore, &value));
+        return value;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     std::vector<VkFence> CreateFence(VkDevice device, uint32_t count)
     {
         VkFenceCreateInfo const fenceInfo{
@@ -1004,29 +1090,6 @@ namespace MFA::RenderBackend
         outHeight = DM.h;
     }
 
-    //-------------------------------------------------------------------------------------------------
-
-	uint32_t FindMemoryType(
-        VkPhysicalDevice* physicalDevice,
-        uint32_t const typeFilter,
-        VkMemoryPropertyFlags const propertyFlags
-    )
-    {
-        MFA_ASSERT(physicalDevice != nullptr);
-        VkPhysicalDeviceMemoryProperties memory_properties;
-        vkGetPhysicalDeviceMemoryProperties(*physicalDevice, &memory_properties);
-
-        for (uint32_t memory_type_index = 0; memory_type_index < memory_properties.memoryTypeCount; memory_type_index++)
-        {
-            if ((typeFilter & (1 << memory_type_index)) && (memory_properties.memoryTypes[memory_type_index].propertyFlags & propertyFlags) == propertyFlags)
-            {
-                return memory_type_index;
-            }
-        }
-
-        MFA_CRASH("failed to find suitable memory type!");
-    }
-
     //-------------------------------------------------------------------------------------------------
 
     std::shared_ptr<RT::ImageGroup> CreateImage(
@@ -1068,20 +1131,16 @@ namespace MFA::RenderBackend
         VkMemoryRequirements memory_requirements;
         vkGetImageMemoryRequirements(device, image, &memory_requirements);
 
-        VkMemoryAllocateInfo allocate_info{};
-        allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocate_info.allocationSize = memory_requirements.size;
-        allocate_info.memoryTypeIndex = FindMemoryType(
-            &physicalDevice,
-            memory_requirements.memoryTypeBits,
-            properties
+        auto * allocator = MemoryAllocator::Instance;
+        MFA_ASSERT(allocator != nullptr);
+        auto const allocation = allocator->Allocate(
+            memory_requirements,
+            properties,
+            MemoryAllocator::Usage::Image
         );
+        VK_Check(vkBindImageMemory(device, image, allocation.memory, allocation.offset));
 
-        VkDeviceMemory memory{};
-        VK_Check(vkAllocateMemory(device, &allocate_info, nullptr, &memory));
-        VK_Check(vkBindImageMemory(device, image, memory, 0));
-
-        return std::make_shared<RT::ImageGroup>(image, memory);
+        return std::make_shared<RT::ImageGroup>(image, allocation);
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -1092,7 +1151,7 @@ namespace MFA::RenderBackend
     )
     {
         vkDestroyImage(device, imageGroup.image, nullptr);
-        vkFreeMemory(device, imageGroup.memory, nullptr);
+        MemoryAllocator::Instance->Free(imageGroup.allocation);
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -1209,6 +1268,7 @@ namespace MFA::RenderBackend
 
     std::shared_ptr<RT::PipelineGroup> CreateGraphicPipeline(
         VkDevice device,
+        VkPipelineCache pipelineCache,
         uint8_t shaderStagesCount,
         RT::GpuShader const** shaderStages,
         uint32_t vertexBindingDescriptionCount,
@@ -1354,7 +1414,7 @@ namespace MFA::RenderBackend
         VkPipeline pipeline{};
         VK_Check(vkCreateGraphicsPipelines(
             device,
-            VK_NULL_HANDLE,
+            pipelineCache,
             1,
             &pipelineCreateInfo,
             nullptr,
@@ -1396,6 +1456,7 @@ namespace MFA::RenderBackend
 
     std::shared_ptr<RT::PipelineGroup> CreateComputePipeline(
         VkDevice device,
+        VkPipelineCache pipelineCache,
         RT::GpuShader const& shaderStage,
         VkPipelineLayout pipelineLayout
     )
@@ -1416,7 +1477,7 @@ namespace MFA::RenderBackend
         VkPipeline pipeline{};
         VK_Check(vkCreateComputePipelines(
             device,
-            VK_NULL_HANDLE,
+            pipelineCache,
             1,
             &pipelineCreateInfo,
             VK_NULL_HANDLE,
@@ -1443,6 +1504,201 @@ namespace MFA::RenderBackend
 
 	//-------------------------------------------------------------------------------------------------
 
+    VkPipelineCache CreatePipelineCache(
+        VkDevice device,
+        VkPhysicalDeviceProperties const & physicalDeviceProperties,
+        BaseBlob const * initialData
+    )
+    {
+        MFA_ASSERT(device != nullptr);
+
+        bool isDataValid = initialData != nullptr && initialData->IsValid();
+        if (isDataValid)
+        {
+            // The driver is allowed to reject the data anyway but an invalid blob must never reach it
+            VkPipelineCacheHeaderVersionOne header{};
+            isDataValid = initialData->Len() >= sizeof(header);
+            if (isDataValid)
+            {
+                std::memcpy(&header, initialData->Ptr(), sizeof(header));
+                isDataValid = header.headerSize >= sizeof(header) &&
+                    header.headerSize <= initialData->Len() &&
+                    header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                    header.vendorID == physicalDeviceProperties.vendorID &&
+                    header.deviceID == physicalDeviceProperties.deviceID &&
+                    std::memcmp(header.pipelineCacheUUID, physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+            }
+            if (isDataValid == false)
+            {
+                MFA_LOG_WARN("Pipeline cache data does not match the current device, starting with an empty cache");
+            }
+        }
+
+        VkPipelineCacheCreateInfo const createInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .initialDataSize = isDataValid ? initialData->Len() : 0,
+            .pInitialData = isDataValid ? initialData->Ptr() : nullptr,
+        };
+
+        VkPipelineCache pipelineCache{};
+        VK_Check(vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache));
+        return pipelineCache;
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    std::shared_ptr<Blob> GetPipelineCacheData(VkDevice device, VkPipelineCache pipelineCache)
+    {
+        MFA_ASSERT(device != nullptr);
+        MFA_ASSERT(pipelineCache != VK_NULL_HANDLE);
+
+        size_t dataSize = 0;
+        VK_Check(vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr));
+        if (dataSize == 0)
+        {
+            return nullptr;
+        }
+
+        std::shared_ptr<Blob> data = Memory::AllocSize(dataSize);
+        VK_Check(vkGetPipelineCacheData(device, pipelineCache, &dataSize, data->Ptr()));
+        return data;
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    void DestroyPipelineCache(VkDevice device, VkPipelineCache pipelineCache)
+    {
+        MFA_ASSERT(device != nullptr);
+        MFA_ASSERT(pipelineCache != VK_NULL_HANDLE);
+        vkDestroyPipelineCache(device, pipelineCache, nullptr);
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    VkQueryPool CreateQueryPool(
+        VkDevice device,
+        VkQueryType const queryType,
+        uint32_t const queryCount,
+        VkQueryPipelineStatisticFlags const pipelineStatistics
+    )
+    {
+        MFA_ASSERT(device != nullptr);
+        MFA_ASSERT(queryCount > 0);
+
+        VkQueryPoolCreateInfo const createInfo{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = queryType,
+            .queryCount = queryCount,
+            .pipelineStatistics = pipelineStatistics,
+        };
+
+        VkQueryPool queryPool{};
+        VK_Check(vkCreateQueryPool(device, &createInfo, nullptr, &queryPool));
+        return queryPool;
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    void DestroyQueryPool(VkDevice device, VkQueryPool queryPool)
+    {
+        MFA_ASSERT(device != nullptr);
+        MFA_ASSERT(queryPool != VK_NULL_HANDLE);
+        vkDestroyQueryPool(device, queryPool, nullptr);
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    void ResetQueryPool(
+        VkCommandBuffer commandBuffer,
+        VkQueryPool queryPool,
+        uint32_t const firstQuery,
+        uint32_t const queryCount
+    )
+    {
+        MFA_ASSERT(commandBuffer != nullptr);
+        MFA_ASSERT(queryPool != VK_NULL_HANDLE);
+        vkCmdResetQueryPool(commandBuffer, queryPool, firstQuery, queryCount);
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    void WriteTimestamp(
+        VkCommandBuffer commandBuffer,
+        VkPipelineStageFlagBits const pipelineStage,
+        VkQueryPool queryPool,
+        uint32_t const query
+    )
+    {
+        MFA_ASSERT(commandBuffer != nullptr);
+        MFA_ASSERT(queryPool != VK_NULL_HANDLE);
+        vkCmdWriteTimestamp(commandBuffer, pipelineStage, queryPool, query);
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    void BeginQuery(VkCommandBuffer commandBuffer, VkQueryPool queryPool, uint32_t const query)
+    {
+        MFA_ASSERT(commandBuffer != nullptr);
+        MFA_ASSERT(queryPool != VK_NULL_HANDLE);
+        vkCmdBeginQuery(commandBuffer, queryPool, query, 0);
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    void EndQuery(VkCommandBuffer commandBuffer, VkQueryPool queryPool, uint32_t const query)
+    {
+        MFA_ASSERT(commandBuffer != nullptr);
+        MFA_ASSERT(queryPool != VK_NULL_HANDLE);
+        vkCmdEndQuery(commandBuffer, queryPool, query);
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    VkResult GetQueryPoolResults(
+        VkDevice device,
+        VkQueryPool queryPool,
+        uint32_t const firstQuery,
+        uint32_t const queryCount,
+        size_t const stride,
+        size_t const dataSize,
+        void * data
+    )
+    {
+        MFA_ASSERT(device != nullptr);
+        MFA_ASSERT(queryPool != VK_NULL_HANDLE);
+        MFA_ASSERT(data != nullptr);
+        return vkGetQueryPoolResults(
+            device,
+            queryPool,
+            firstQuery,
+            queryCount,
+            dataSize,
+            data,
+            stride,
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+        );
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
+    uint32_t GetTimestampValidBits(VkPhysicalDevice physicalDevice, uint32_t const queueFamily)
+    {
+        MFA_ASSERT(physicalDevice != nullptr);
+
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+        if (queueFamily >= familyCount)
+        {
+            return 0;
+        }
+        return families[queueFamily].timestampValidBits;
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
     void DestroySwapChain(VkDevice device, RT::SwapChainGroup const& swapChainGroup)
     {
         MFA_ASSERT(device);
@@ -1819,7 +2075,8 @@ namespace MFA::RenderBackend
         VkFramebuffer frameBuffer,
         VkExtent2D const& extent2D,
         uint32_t const clearValuesCount,
-        VkClearValue const* clearValues
+        VkClearValue const* clearValues,
+        VkSubpassContents const subpassContents
     )
     {
         VkRenderPassBeginInfo renderPassBeginInfo = {};
@@ -1833,7 +2090,7 @@ namespace MFA::RenderBackend
         renderPassBeginInfo.clearValueCount = clearValuesCount;
         renderPassBeginInfo.pClearValues = clearValues;
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, subpassContents);
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -1843,6 +2100,36 @@ namespace MFA::RenderBackend
         vkCmdEndRenderPass(commandBuffer);
     }
 
+    //-------------------------------------------------------------------------------------------------
+
+    void BeginSecondaryCommandBuffer(
+        VkCommandBuffer commandBuffer,
+        VkRenderPass renderPass,
+        uint32_t const subpass,
+        VkFramebuffer frameBuffer,
+        VkQueryPipelineStatisticFlags const pipelineStatistics
+    )
+    {
+        MFA_ASSERT(commandBuffer != nullptr);
+        MFA_ASSERT(renderPass != VK_NULL_HANDLE);
+
+        VkCommandBufferInheritanceInfo const inheritanceInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .renderPass = renderPass,
+            .subpass = subpass,
+            .framebuffer = frameBuffer,
+            .pipelineStatistics = pipelineStatistics,
+        };
+
+        VkCommandBufferBeginInfo const beginInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = &inheritanceInfo,
+        };
+
+        VK_Check(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    }
+
     VkFramebuffer CreateFrameBuffers(VkDevice device, VkRenderPass renderPass, VkImageView const* attachments,
 	    uint32_t attachmentsCount, VkExtent2D const swapChainExtent, uint32_t layersCount)
     {
@@ -2073,52 +2360,6 @@ namespace MFA::RenderBackend
 
     //-------------------------------------------------------------------------------------------------
 
-    [[nodiscard]]
-    VkCommandBuffer BeginSingleTimeCommand(VkDevice device, VkCommandPool const & commandPool)
-    {
-        MFA_ASSERT(device != nullptr);
-
-        VkCommandBufferAllocateInfo allocate_info{};
-        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocate_info.commandPool = commandPool;
-        allocate_info.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device, &allocate_info, &commandBuffer);
-
-        VkCommandBufferBeginInfo begin_info{};
-        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        vkBeginCommandBuffer(commandBuffer, &begin_info);
-
-        return commandBuffer;
-    }
-
-    //-------------------------------------------------------------------------------------------------
-
-    void EndAndSubmitSingleTimeCommand(
-        VkDevice device,
-        VkCommandPool const & commandPool,
-        VkQueue const & queue,
-        VkCommandBuffer const & commandBuffer
-    )
-    {
-        VK_Check(vkEndCommandBuffer(commandBuffer));
-
-        VkSubmitInfo submit_info{};
-        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = &commandBuffer;
-        VK_Check(vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE));
-        VK_Check(vkQueueWaitIdle(queue));
-
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-    }
-
-    //-------------------------------------------------------------------------------------------------
-
     std::shared_ptr<RT::GpuShader> CreateShader(VkDevice device, std::shared_ptr<AS::Shader> const& cpuShader)
     {
 	    MFA_ASSERT(device != nullptr);
@@ -2171,7 +2412,34 @@ namespace MFA::RenderBackend
             nullptr,
             &descriptorSetLayout
         ));
-        return std::make_shared<RT::DescriptorSetLayoutGroup>(descriptorSetLayout);
+
+        // Kept with the layout so descriptor pools can be sized for it
+        std::vector<VkDescriptorPoolSize> descriptorCounts{};
+        for (uint8_t i = 0; i < bindings_count; ++i)
+        {
+            auto const & binding = bindings[i];
+            auto findResult = std::find_if(
+                descriptorCounts.begin(),
+                descriptorCounts.end(),
+                [&binding](VkDescriptorPoolSize const & poolSize)->bool
+                {
+                    return poolSize.type == binding.descriptorType;
+                }
+            );
+            if (findResult == descriptorCounts.end())
+            {
+                descriptorCounts.emplace_back(VkDescriptorPoolSize{
+                    .type = binding.descriptorType,
+                    .descriptorCount = binding.descriptorCount
+                });
+            }
+            else
+            {
+                findResult->descriptorCount += binding.descriptorCount;
+            }
+        }
+
+        return std::make_shared<RT::DescriptorSetLayoutGroup>(descriptorSetLayout, std::move(descriptorCounts));
     }
     
     //-------------------------------------------------------------------------------------------------
@@ -2224,6 +2492,17 @@ namespace MFA::RenderBackend
             poolSize.descriptorCount = maxSets;
             poolSizes.emplace_back(poolSize);
         }
+        return CreateDescriptorPool(device, maxSets, poolSizes);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    std::shared_ptr<RT::DescriptorPool> CreateDescriptorPool(
+        VkDevice device,
+        uint32_t const maxSets,
+        std::vector<VkDescriptorPoolSize> const & poolSizes
+    )
+    {
         VkDescriptorPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
@@ -2244,6 +2523,13 @@ namespace MFA::RenderBackend
 
     //-------------------------------------------------------------------------------------------------
 
+    void ResetDescriptorPool(VkDevice device, VkDescriptorPool pool)
+    {
+        VK_Check(vkResetDescriptorPool(device, pool, 0));
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     void DestroyDescriptorPool(
         VkDevice device,
         VkDescriptorPool pool
@@ -2357,6 +2643,31 @@ namespace MFA::RenderBackend
 
     //-------------------------------------------------------------------------------------------------
 
+    VkResult TryAllocateDescriptorSets(
+        VkDevice device,
+        VkDescriptorPool descriptorPool,
+        VkDescriptorSetLayout descriptorSetLayout,
+        uint32_t const descriptorSetCount,
+        VkDescriptorSet * outDescriptorSets
+    )
+    {
+        MFA_ASSERT(device != nullptr);
+        MFA_ASSERT(descriptorPool != VK_NULL_HANDLE);
+        MFA_ASSERT(descriptorSetLayout != VK_NULL_HANDLE);
+        MFA_ASSERT(outDescriptorSets != nullptr);
+
+        std::vector<VkDescriptorSetLayout> layouts(descriptorSetCount, descriptorSetLayout);
+        VkDescriptorSetAllocateInfo const allocInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool = descriptorPool,
+            .descriptorSetCount = descriptorSetCount,
+            .pSetLayouts = layouts.data()
+        };
+        return vkAllocateDescriptorSets(device, &allocInfo, outDescriptorSets);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     RT::DescriptorSetGroup CreateDescriptorSet(
         VkDevice device, 
         VkDescriptorPool descriptorPool,
@@ -2459,8 +2770,8 @@ namespace MFA::RenderBackend
 	    MFA_ASSERT(device != nullptr);
         MFA_ASSERT(bufferGroup.memory != VK_NULL_HANDLE);
         MFA_ASSERT(bufferGroup.buffer != VK_NULL_HANDLE);
-        vkFreeMemory(device, bufferGroup.memory, nullptr);
         vkDestroyBuffer(device, bufferGroup.buffer, nullptr);
+        MemoryAllocator::Instance->Free(bufferGroup.allocation);
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -2524,6 +2835,26 @@ namespace MFA::RenderBackend
 
     //-------------------------------------------------------------------------------------------------
 
+    void Draw(
+        RT::CommandRecordState const& recordState,
+        uint32_t const vertexCount,
+        uint32_t const instanceCount,
+        uint32_t const firstVertex,
+        uint32_t const firstInstance
+    )
+    {
+        MFA_ASSERT(recordState.isValid);
+        vkCmdDraw(
+            recordState.commandBuffer,
+            vertexCount,
+            instanceCount,
+            firstVertex,
+            firstInstance
+        );
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
     std::shared_ptr<RT::BufferGroup> CreateBufferGroup(
         VkDevice device,
         VkPhysicalDevice physicalDevice,
@@ -2656,10 +2987,13 @@ namespace MFA::RenderBackend
         VkCommandBuffer commandBuffer,
         VkBuffer sourceBuffer,
         VkBuffer destinationBuffer,
-        VkDeviceSize const size
+        VkDeviceSize const size,
+        VkDeviceSize const offset
     )
     {
         VkBufferCopy const copyRegion{
+            .srcOffset = offset,
+            .dstOffset = offset,
             .size = size
         };
 
@@ -2676,21 +3010,22 @@ namespace MFA::RenderBackend
 
     void CopyDataToHostVisibleBuffer(
         VkDevice device,
-        VkDeviceMemory bufferMemory,
-        BaseBlob const & dataBlob
+        RT::BufferAndMemory const & buffer,
+        BaseBlob const & dataBlob,
+        size_t const offset
     )
     {
         MFA_ASSERT(dataBlob.IsValid() == true);
         void* tempBufferData = nullptr;
         MapHostVisibleMemory(
             device,
-            bufferMemory,
-            0,
+            buffer,
+            offset,
             dataBlob.Len(),
             &tempBufferData
         );
         std::memcpy(tempBufferData, dataBlob.Ptr(), dataBlob.Len());
-        UnMapHostVisibleMemory(device, bufferMemory);
+        UnMapHostVisibleMemory(device, buffer, offset, dataBlob.Len());
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -2698,11 +3033,12 @@ namespace MFA::RenderBackend
     void UpdateHostVisibleBuffer(
         VkDevice device,
         RT::BufferAndMemory const& buffer, 
-        BaseBlob const& data
+        BaseBlob const& data,
+        size_t const offset
     )
     {
-        //assert(buffer.size == data.Len());
-        CopyDataToHostVisibleBuffer(device, buffer.memory, data);
+        MFA_ASSERT(offset + data.Len() <= buffer.size);
+        CopyDataToHostVisibleBuffer(device, buffer, data, offset);
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -2710,15 +3046,23 @@ namespace MFA::RenderBackend
     void UpdateLocalBuffer(
         VkCommandBuffer commandBuffer, 
         RT::BufferAndMemory const& buffer,
-	    RT::BufferAndMemory const& stageBuffer
+	    RT::BufferAndMemory const& stageBuffer,
+        VkDeviceSize const offset,
+        VkDeviceSize size
     )
     {
         // MFA_ASSERT(buffer.size == stageBuffer.size);
+        if (size == VK_WHOLE_SIZE)
+        {
+            size = buffer.size - offset;
+        }
+        MFA_ASSERT(offset + size <= buffer.size);
         CopyBuffer(
             commandBuffer,
             stageBuffer.buffer,
             buffer.buffer,
-            buffer.size
+            size,
+            offset
         );
     }
 
@@ -2782,6 +3126,25 @@ namespace MFA::RenderBackend
 
 	//-------------------------------------------------------------------------------------------------
 
+    std::shared_ptr<RT::BufferGroup> CreateHostVisibleVertexBufferGroup(
+        VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        VkDeviceSize const bufferSize,
+        int const bufferCount
+    )
+    {
+        return RB::CreateBufferGroup(
+            device,
+            physicalDevice,
+            bufferSize,
+            bufferCount,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+    }
+
+	//-------------------------------------------------------------------------------------------------
+
     std::shared_ptr<RT::BufferAndMemory> CreateIndexBuffer(
         VkDevice device,
         VkPhysicalDevice physicalDevice,
@@ -2847,42 +3210,46 @@ namespace MFA::RenderBackend
 	    VkMemoryRequirements memory_requirements{};
 	    vkGetBufferMemoryRequirements(device, buffer, &memory_requirements);
 
-	    VkMemoryAllocateInfo memoryAllocationInfo{};
-	    memoryAllocationInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	    memoryAllocationInfo.allocationSize = memory_requirements.size;
-	    memoryAllocationInfo.memoryTypeIndex = FindMemoryType(
-		    &physicalDevice,
-		    memory_requirements.memoryTypeBits,
-		    properties
+	    auto * allocator = MemoryAllocator::Instance;
+	    MFA_ASSERT(allocator != nullptr);
+	    // Buffers that are only used as a copy source are short-lived upload buffers
+	    auto const allocation = allocator->Allocate(
+		    memory_requirements,
+		    properties,
+		    usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT ? MemoryAllocator::Usage::Staging : MemoryAllocator::Usage::Buffer
 	    );
+	    VK_Check(vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset));
 
-	    VkDeviceMemory memory{};
-	    VK_Check(vkAllocateMemory(device, &memoryAllocationInfo, nullptr, &memory));
-	    VK_Check(vkBindBufferMemory(device, buffer, memory, 0));
-
-	    return std::make_shared<RT::BufferAndMemory>(buffer, memory, size);
+	    return std::make_shared<RT::BufferAndMemory>(buffer, allocation, size);
     }
 
 	//-------------------------------------------------------------------------------------------------
 
     void MapHostVisibleMemory(
         VkDevice device, 
-        VkDeviceMemory bufferMemory, 
+        RT::BufferAndMemory const & buffer, 
         size_t const offset, 
         size_t const size,
 	    void** outBufferData
     )
     {
 	    MFA_ASSERT(*outBufferData == nullptr);
-	    VK_Check(vkMapMemory(device, bufferMemory, offset, size, 0, outBufferData));
-	    MFA_ASSERT(*outBufferData != nullptr);
+	    // Host visible blocks are mapped once by the allocator, several buffers share the same VkDeviceMemory
+	    MFA_ASSERT(buffer.allocation.mappedPtr != nullptr);
+	    MFA_ASSERT(offset + size <= buffer.size);
+	    *outBufferData = buffer.allocation.mappedPtr + offset;
     }
 
 	//-------------------------------------------------------------------------------------------------
 
-    void UnMapHostVisibleMemory(VkDevice device, VkDeviceMemory bufferMemory)
+    void UnMapHostVisibleMemory(
+        VkDevice device,
+        RT::BufferAndMemory const & buffer,
+        size_t const offset,
+        size_t const size
+    )
     {
-	    vkUnmapMemory(device, bufferMemory);
+	    MemoryAllocator::Instance->Flush(buffer.allocation, offset, size);
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -3030,6 +3397,7 @@ namespace MFA::RenderBackend
         VkDevice device,
         VkCommandBuffer commandBuffer,
         VkBuffer buffer,
+        VkDeviceSize const bufferOffset,
         VkImage image,
         AS::Texture const& cpuTexture
     )
@@ -3054,14 +3422,14 @@ namespace MFA::RenderBackend
             for (uint8_t mipLevel = 0; mipLevel < mipCount; mipLevel++)
             {
                 auto const& mipInfo = cpuTexture.GetMipmap(mipLevel);
-                auto& region = regionsArray[mipLevel];
+                auto& region = regionsArray[sliceIndex * mipCount + mipLevel];
                 region.imageExtent.width = mipInfo.dimension.width;
                 region.imageExtent.height = mipInfo.dimension.height;
                 region.imageExtent.depth = mipInfo.dimension.depth;
                 region.imageOffset.x = 0;
                 region.imageOffset.y = 0;
                 region.imageOffset.z = 0;
-                region.bufferOffset = static_cast<uint32_t>(cpuTexture.mipOffsetInBytes(mipLevel, sliceIndex));
+                region.bufferOffset = bufferOffset + cpuTexture.mipOffsetInBytes(mipLevel, sliceIndex);
                 region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
                 region.imageSubresource.mipLevel = mipLevel;
                 region.imageSubresource.baseArrayLayer = sliceIndex;
@@ -3124,11 +3492,15 @@ namespace MFA::RenderBackend
 
     //-------------------------------------------------------------------------------------------------
 
-    CreateTextureResult CreateTexture(
+    std::shared_ptr<RT::GpuTexture> CreateTexture(
         AS::Texture const& cpuTexture,
         VkDevice device,
         VkPhysicalDevice physicalDevice,
-        VkCommandBuffer commandBuffer
+        VkCommandBuffer commandBuffer,
+        RT::BufferAndMemory const& stageBuffer,
+        VkDeviceSize const stageOffset,
+        uint32_t const srcQueueFamily,
+        uint32_t const dstQueueFamily
     )
     {
         MFA_ASSERT(device != nullptr);
@@ -3144,17 +3516,7 @@ namespace MFA::RenderBackend
             auto const& largestMipmapInfo = cpuTexture.GetMipmap(0);
             auto const buffer = cpuTexture.GetBuffer();
             MFA_ASSERT(buffer != nullptr && buffer->IsValid() == true);
-            // Create upload buffer
-            auto const uploadBufferGroup = CreateBuffer(    // TODO: We can cache this buffer
-                device,
-                physicalDevice,
-                buffer->Len(),
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-            );
-
-            // Map texture data to buffer
-            CopyDataToHostVisibleBuffer(device, uploadBufferGroup->memory, *buffer);
+            MFA_ASSERT(stageOffset + buffer->Len() <= stageBuffer.size);
 
             auto const vulkan_format = ConvertCpuTextureFormatToGpu(format);
 
@@ -3186,20 +3548,35 @@ namespace MFA::RenderBackend
             CopyBufferToImage(
                 device,
                 commandBuffer,
-                uploadBufferGroup->buffer,
+                stageBuffer.buffer,
+                stageOffset,
                 imageGroup->image,
                 cpuTexture
             );
 
-            TransferImageLayout(
-                device,
-                commandBuffer,
-                imageGroup->image,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                mipCount,
-                sliceCount
-            );
+            if (srcQueueFamily != dstQueueFamily)
+            {
+                ReleaseImageOwnership(
+                    commandBuffer,
+                    imageGroup->image,
+                    mipCount,
+                    sliceCount,
+                    srcQueueFamily,
+                    dstQueueFamily
+                );
+            }
+            else
+            {
+                TransferImageLayout(
+                    device,
+                    commandBuffer,
+                    imageGroup->image,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    mipCount,
+                    sliceCount
+                );
+            }
 
             auto imageView = CreateImageView(
                 device,
@@ -3211,13 +3588,153 @@ namespace MFA::RenderBackend
                 VK_IMAGE_VIEW_TYPE_2D
             );
 
-            std::shared_ptr<RT::GpuTexture> gpuTexture = std::make_shared<RT::GpuTexture>(
+            return std::make_shared<RT::GpuTexture>(
                 imageGroup,
                 imageView
             );
-            return { gpuTexture, uploadBufferGroup };
         }
-        return {nullptr, nullptr};
+        return nullptr;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void ReleaseBufferOwnership(
+        VkCommandBuffer commandBuffer,
+        RT::BufferAndMemory const& buffer,
+        uint32_t const srcQueueFamily,
+        uint32_t const dstQueueFamily
+    )
+    {
+        VkBufferMemoryBarrier const barrier{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = 0,
+            .srcQueueFamilyIndex = srcQueueFamily,
+            .dstQueueFamilyIndex = dstQueueFamily,
+            .buffer = buffer.buffer,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE
+        };
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0,
+            0, nullptr,
+            1, &barrier,
+            0, nullptr
+        );
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void AcquireBufferOwnership(
+        VkCommandBuffer commandBuffer,
+        RT::BufferAndMemory const& buffer,
+        uint32_t const srcQueueFamily,
+        uint32_t const dstQueueFamily,
+        VkPipelineStageFlags const dstStageMask,
+        VkAccessFlags const dstAccessMask
+    )
+    {
+        VkBufferMemoryBarrier const barrier{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = 0,
+            .dstAccessMask = dstAccessMask,
+            .srcQueueFamilyIndex = srcQueueFamily,
+            .dstQueueFamilyIndex = dstQueueFamily,
+            .buffer = buffer.buffer,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE
+        };
+        // Chains with the semaphore wait of the submission
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            dstStageMask,
+            0,
+            0, nullptr,
+            1, &barrier,
+            0, nullptr
+        );
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    static VkImageMemoryBarrier ImageOwnershipBarrier(
+        VkImage image,
+        uint32_t const levelCount,
+        uint32_t const layerCount,
+        uint32_t const srcQueueFamily,
+        uint32_t const dstQueueFamily
+    )
+    {
+        return VkImageMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .srcQueueFamilyIndex = srcQueueFamily,
+            .dstQueueFamilyIndex = dstQueueFamily,
+            .image = image,
+            .subresourceRange = VkImageSubresourceRange{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = levelCount,
+                .baseArrayLayer = 0,
+                .layerCount = layerCount
+            }
+        };
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void ReleaseImageOwnership(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        uint32_t const levelCount,
+        uint32_t const layerCount,
+        uint32_t const srcQueueFamily,
+        uint32_t const dstQueueFamily
+    )
+    {
+        auto barrier = ImageOwnershipBarrier(image, levelCount, layerCount, srcQueueFamily, dstQueueFamily);
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void AcquireImageOwnership(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        uint32_t const levelCount,
+        uint32_t const layerCount,
+        uint32_t const srcQueueFamily,
+        uint32_t const dstQueueFamily
+    )
+    {
+        auto barrier = ImageOwnershipBarrier(image, levelCount, layerCount, srcQueueFamily, dstQueueFamily);
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        // Chains with the semaphore wait of the submission
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
     }
 
     //-------------------------------------------------------------------------------------------------
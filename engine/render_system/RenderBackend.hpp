@@ -69,6 +69,10 @@ namespace MFA::RenderBackend
 
         bool const isComputeQueueValid = false;
         uint32_t const computeQueueFamily = -1;
+
+        // Only set for a family that supports transfer without graphics and compute (DMA engine)
+        bool const isTransferQueueValid = false;
+        uint32_t const transferQueueFamily = -1;
     };
 
     [[nodiscard]]
@@ -82,13 +86,16 @@ namespace MFA::RenderBackend
     {
         VkDevice device{};
         VkPhysicalDeviceMemoryProperties physicalMemoryProperties{};
+        bool timelineSemaphoreEnabled = false;
     };
 
+    // Pass the graphic queue family as the transfer family when there is no dedicated transfer queue
     [[nodiscard]]
     CreateLogicalDeviceResult CreateLogicalDevice(
         VkPhysicalDevice physicalDevice,
         uint32_t graphicsQueueFamily,
         uint32_t presentQueueFamily,
+        uint32_t transferQueueFamily,
         VkPhysicalDeviceFeatures const & enabledPhysicalDeviceFeatures
     );
 
@@ -105,12 +112,22 @@ namespace MFA::RenderBackend
     std::vector<VkCommandBuffer> CreateCommandBuffers(
         VkDevice device,
         uint32_t const count,
-        VkCommandPool commandPool
+        VkCommandPool commandPool,
+        VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY
     );
 
+    // Returns every command buffer of the pool to the initial state
+    void ResetCommandPool(VkDevice device, VkCommandPool commandPool);
+
     [[nodiscard]]
     std::vector<VkSemaphore> CreateSemaphores(VkDevice device, uint32_t count);
 
+    [[nodiscard]]
+    VkSemaphore CreateTimelineSemaphore(VkDevice device, uint64_t initialValue);
+
+    [[nodiscard]]
+    uint64_t GetSemaphoreCounterValue(VkDevice device, VkSemaphore timelineSemaphore);
+
     [[nodiscard]]
     std::vector<VkFence> CreateFence(VkDevice device, uint32_t count);
 
@@ -239,6 +256,7 @@ namespace MFA::RenderBackend
 
     std::shared_ptr<RT::PipelineGroup> CreateGraphicPipeline(
         VkDevice device,
+        VkPipelineCache pipelineCache,
         uint8_t shaderStagesCount,
         RT::GpuShader const** shaderStages,
         uint32_t vertexBindingDescriptionCount,
@@ -253,12 +271,71 @@ namespace MFA::RenderBackend
 
     std::shared_ptr<RT::PipelineGroup> CreateComputePipeline(
         VkDevice device,
+        VkPipelineCache pipelineCache,
         RT::GpuShader const& shaderStage,
         VkPipelineLayout pipelineLayout
     );
 
     void DestroyPipeline(VkDevice device, RT::PipelineGroup& pipelineGroup);
 
+    // Initial data is ignored when its header does not belong to the given device and driver
+    [[nodiscard]]
+    VkPipelineCache CreatePipelineCache(
+        VkDevice device,
+        VkPhysicalDeviceProperties const & physicalDeviceProperties,
+        BaseBlob const * initialData
+    );
+
+    [[nodiscard]]
+    std::shared_ptr<Blob> GetPipelineCacheData(VkDevice device, VkPipelineCache pipelineCache);
+
+    void DestroyPipelineCache(VkDevice device, VkPipelineCache pipelineCache);
+
+    [[nodiscard]]
+    VkQueryPool CreateQueryPool(
+        VkDevice device,
+        VkQueryType queryType,
+        uint32_t queryCount,
+        VkQueryPipelineStatisticFlags pipelineStatistics = 0
+    );
+
+    void DestroyQueryPool(VkDevice device, VkQueryPool queryPool);
+
+    // Must be recorded outside of a render pass
+    void ResetQueryPool(
+        VkCommandBuffer commandBuffer,
+        VkQueryPool queryPool,
+        uint32_t firstQuery,
+        uint32_t queryCount
+    );
+
+    void WriteTimestamp(
+        VkCommandBuffer commandBuffer,
+        VkPipelineStageFlagBits pipelineStage,
+        VkQueryPool queryPool,
+        uint32_t query
+    );
+
+    void BeginQuery(VkCommandBuffer commandBuffer, VkQueryPool queryPool, uint32_t query);
+
+    void EndQuery(VkCommandBuffer commandBuffer, VkQueryPool queryPool, uint32_t query);
+
+    // Never waits, every query is followed by its availability so results that are not ready can be skipped
+    [[nodiscard]]
+    VkResult GetQueryPoolResults(
+        VkDevice device,
+        VkQueryPool queryPool,
+        uint32_t firstQuery,
+        uint32_t queryCount,
+        size_t stride,
+        size_t dataSize,
+        void * data
+    );
+
+    // Number of meaningful bits in the timestamps of the queue family, zero means timestamps are not supported
+    [[nodiscard]]
+    uint32_t GetTimestampValidBits(VkPhysicalDevice physicalDevice, uint32_t queueFamily);
+
     void DestroySwapChain(VkDevice device, RT::SwapChainGroup const& swapChainGroup);
 
     std::shared_ptr<RT::SwapChainGroup> CreateSwapChain(
@@ -313,11 +390,22 @@ namespace MFA::RenderBackend
         VkFramebuffer frameBuffer,
         VkExtent2D const& extent2D,
         uint32_t clearValuesCount,
-        VkClearValue const* clearValues
+        VkClearValue const* clearValues,
+        VkSubpassContents subpassContents = VK_SUBPASS_CONTENTS_INLINE
     );
 
     void EndRenderPass(VkCommandBuffer commandBuffer);
 
+    // Begins a secondary command buffer that continues the given subpass of the render pass
+    // Pipeline statistics has to match the queries that are active in the primary command buffer
+    void BeginSecondaryCommandBuffer(
+        VkCommandBuffer commandBuffer,
+        VkRenderPass renderPass,
+        uint32_t subpass,
+        VkFramebuffer frameBuffer,
+        VkQueryPipelineStatisticFlags pipelineStatistics = 0
+    );
+
     VkFramebuffer CreateFrameBuffers(
         VkDevice device,
         VkRenderPass renderPass,
@@ -391,16 +479,6 @@ namespace MFA::RenderBackend
         VkFence fence
     );
 
-    [[nodiscard]]
-    VkCommandBuffer BeginSingleTimeCommand(VkDevice device, VkCommandPool const & commandPool);
-
-    void EndAndSubmitSingleTimeCommand(
-        VkDevice device,
-        VkCommandPool const & commandPool,
-        VkQueue const & queue,
-        VkCommandBuffer const & commandBuffer
-    );
-
     std::shared_ptr<RT::GpuShader> CreateShader(
         VkDevice device,
         std::shared_ptr<AS::Shader> const& cpuShader
@@ -416,12 +494,21 @@ namespace MFA::RenderBackend
 
     void DestroyDescriptorSetLayout(VkDevice device, VkDescriptorSetLayout descriptorSetLayout);
 
-    // TODO: We need to ask for pool sizes instead
+    // Reserves maxSets descriptors of every type
     std::shared_ptr<RT::DescriptorPool> CreateDescriptorPool(
         VkDevice device,
         uint32_t const maxSets
     );
 
+    std::shared_ptr<RT::DescriptorPool> CreateDescriptorPool(
+        VkDevice device,
+        uint32_t maxSets,
+        std::vector<VkDescriptorPoolSize> const & poolSizes
+    );
+
+    // Returns every set of the pool to it
+    void ResetDescriptorPool(VkDevice device, VkDescriptorPool pool);
+
     void DestroyDescriptorPool(
         VkDevice device,
         VkDescriptorPool pool
@@ -459,6 +546,16 @@ namespace MFA::RenderBackend
         VkDescriptorSet descriptorSet
     );
 
+    // Does not treat an exhausted pool as an error, the result is VK_ERROR_OUT_OF_POOL_MEMORY in that case
+    [[nodiscard]]
+    VkResult TryAllocateDescriptorSets(
+        VkDevice device,
+        VkDescriptorPool descriptorPool,
+        VkDescriptorSetLayout descriptorSetLayout,
+        uint32_t descriptorSetCount,
+        VkDescriptorSet * outDescriptorSets
+    );
+
     RT::DescriptorSetGroup CreateDescriptorSet(
         VkDevice device,
         VkDescriptorPool descriptorPool,
@@ -511,6 +608,14 @@ namespace MFA::RenderBackend
         uint32_t firstInstance = 0
     );
 
+    void Draw(
+        RT::CommandRecordState const& recordState,
+        uint32_t vertexCount,
+        uint32_t instanceCount = 1,
+        uint32_t firstVertex = 0,
+        uint32_t firstInstance = 0
+    );
+
     std::shared_ptr<RT::BufferGroup> CreateBufferGroup(
         VkDevice device,
         VkPhysicalDevice physicalDevice,
@@ -555,16 +660,21 @@ namespace MFA::RenderBackend
         uint32_t count
     );
 
+    // Writes the data at the given byte offset of the buffer
     void UpdateHostVisibleBuffer(
         VkDevice device,
         RT::BufferAndMemory const& buffer,
-        BaseBlob const& data
+        BaseBlob const& data,
+        size_t offset = 0
     );
 
+    // Copies the range of the stage buffer into the same range of the local buffer
     void UpdateLocalBuffer(
         VkCommandBuffer commandBuffer,
         RT::BufferAndMemory const& buffer,
-        RT::BufferAndMemory const& stageBuffer
+        RT::BufferAndMemory const& stageBuffer,
+        VkDeviceSize offset = 0,
+        VkDeviceSize size = VK_WHOLE_SIZE
     );
     
     std::shared_ptr<RT::BufferAndMemory> CreateVertexBuffer(
@@ -588,6 +698,14 @@ namespace MFA::RenderBackend
         int const bufferCount
     );
 
+    // Used for the vertices that are written by the cpu every frame
+    std::shared_ptr<RT::BufferGroup> CreateHostVisibleVertexBufferGroup(
+        VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        VkDeviceSize const bufferSize,
+        int const bufferCount
+    );
+
     std::shared_ptr<RT::BufferAndMemory> CreateIndexBuffer(
         VkDevice device,
         VkPhysicalDevice physicalDevice,
@@ -610,20 +728,28 @@ namespace MFA::RenderBackend
         VkMemoryPropertyFlags properties
     );
     
+    // Returns a pointer into the persistently mapped block of the buffer
     void MapHostVisibleMemory(
         VkDevice device,
-        VkDeviceMemory bufferMemory,
+        RT::BufferAndMemory const & buffer,
         size_t const offset,
         size_t const size,
         void** outBufferData
     );
     
-    void UnMapHostVisibleMemory(VkDevice device, VkDeviceMemory bufferMemory);
+    // Flushes the written range if the memory is not host coherent
+    void UnMapHostVisibleMemory(
+        VkDevice device,
+        RT::BufferAndMemory const & buffer,
+        size_t offset,
+        size_t size
+    );
     
     void CopyDataToHostVisibleBuffer(
         VkDevice device,
-        VkDeviceMemory bufferMemory,
-        BaseBlob const & dataBlob
+        RT::BufferAndMemory const & buffer,
+        BaseBlob const & dataBlob,
+        size_t offset = 0
     );
 
     void PushConstants(
@@ -662,13 +788,57 @@ namespace MFA::RenderBackend
 
     void DestroySampler(VkDevice device, RT::SamplerGroup const& sampler);
 
-    using CreateTextureResult = std::tuple<std::shared_ptr<RT::GpuTexture>, std::shared_ptr<RT::BufferAndMemory>>;
+    // Records the upload of a texture whose data is already written to the stage buffer at the given offset.
+    // The stage buffer has to stay alive until the command buffer is executed.
+    // When the queue families differ the last barrier releases the image to the destination family instead,
+    // AcquireImageOwnership has to be recorded on the destination queue before the texture is used.
     [[nodiscard]]
-    CreateTextureResult CreateTexture(
+    std::shared_ptr<RT::GpuTexture> CreateTexture(
         AS::Texture const& cpuTexture,
         VkDevice device,
         VkPhysicalDevice physicalDevice,
-        VkCommandBuffer commandBuffer
+        VkCommandBuffer commandBuffer,
+        RT::BufferAndMemory const& stageBuffer,
+        VkDeviceSize stageOffset,
+        uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED,
+        uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED
+    );
+
+    // Queue family ownership transfer of resources with exclusive sharing mode. The release is recorded on the source
+    // queue after the last write, the acquire on the destination queue and it has to execute after the release.
+    void ReleaseBufferOwnership(
+        VkCommandBuffer commandBuffer,
+        RT::BufferAndMemory const& buffer,
+        uint32_t srcQueueFamily,
+        uint32_t dstQueueFamily
+    );
+
+    void AcquireBufferOwnership(
+        VkCommandBuffer commandBuffer,
+        RT::BufferAndMemory const& buffer,
+        uint32_t srcQueueFamily,
+        uint32_t dstQueueFamily,
+        VkPipelineStageFlags dstStageMask,
+        VkAccessFlags dstAccessMask
+    );
+
+    // The image is moved from transfer dst to shader read only layout as part of the transfer
+    void ReleaseImageOwnership(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        uint32_t levelCount,
+        uint32_t layerCount,
+        uint32_t srcQueueFamily,
+        uint32_t dstQueueFamily
+    );
+
+    void AcquireImageOwnership(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        uint32_t levelCount,
+        uint32_t layerCount,
+        uint32_t srcQueueFamily,
+        uint32_t dstQueueFamily
     );
 
     void DestroyTexture(VkDevice device, RT::GpuTexture& gpuTexture);
@@ -12,10 +12,11 @@ namespace MFA::RenderTypes
 
 	ImageGroup::ImageGroup(
 		VkImage image_,
-		VkDeviceMemory memory_
+		MemoryAllocation const & allocation_
 	)
 		: image(image_)
-		, memory(memory_)
+		, memory(allocation_.memory)
+		, allocation(allocation_)
 	{}
 
 	//-------------------------------------------------------------------------------------------------
@@ -58,8 +59,12 @@ namespace MFA::RenderTypes
 
 	//-------------------------------------------------------------------------------------------------
 
-	DescriptorSetLayoutGroup::DescriptorSetLayoutGroup(VkDescriptorSetLayout descriptorSetLayout_)
+	DescriptorSetLayoutGroup::DescriptorSetLayoutGroup(
+		VkDescriptorSetLayout descriptorSetLayout_,
+		std::vector<VkDescriptorPoolSize> descriptorCounts_
+	)
 		: descriptorSetLayout(descriptorSetLayout_)
+		, descriptorCounts(std::move(descriptorCounts_))
 	{
 		MFA_ASSERT(descriptorSetLayout != VK_NULL_HANDLE);
 	}
@@ -202,10 +207,15 @@ namespace MFA::RenderTypes
 
 	//-------------------------------------------------------------------------------------------------
 
-	BufferAndMemory::BufferAndMemory(VkBuffer buffer_, VkDeviceMemory memory_, VkDeviceSize size_)
+	BufferAndMemory::BufferAndMemory(
+		VkBuffer buffer_,
+		MemoryAllocation const & allocation_,
+		VkDeviceSize size_
+	)
 		: buffer(buffer_)
-		, memory(memory_)
+		, memory(allocation_.memory)
 		, size(size_)
+		, allocation(allocation_)
 	{
 	}
 
@@ -12,14 +12,33 @@ namespace MFA
 
 	namespace RenderTypes
     {
+        // Range of a VkDeviceMemory block that is owned by a single resource
+        struct MemoryAllocation
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize offset = 0;
+            // Requested size
+            VkDeviceSize size = 0;
+            // Size including the rounding of the allocator
+            VkDeviceSize allocatedSize = 0;
+            // Already offset to the start of the allocation. Null if the memory is not host visible.
+            uint8_t * mappedPtr = nullptr;
+            uint32_t memoryTypeIndex = 0;
+            // -1 for dedicated allocations
+            int poolIndex = -1;
+            int blockIndex = -1;
+            uint32_t order = 0;
+        };
+
         struct ImageGroup
         {
             const VkImage image;
             const VkDeviceMemory memory;
+            MemoryAllocation const allocation;
 
             explicit ImageGroup(
                 VkImage image_,
-                VkDeviceMemory memory_
+                MemoryAllocation const & allocation_
             );
             ~ImageGroup();
 
@@ -64,7 +83,10 @@ namespace MFA
 
         struct DescriptorSetLayoutGroup
         {
-            explicit DescriptorSetLayoutGroup(VkDescriptorSetLayout descriptorSetLayout_);
+            explicit DescriptorSetLayoutGroup(
+                VkDescriptorSetLayout descriptorSetLayout_,
+                std::vector<VkDescriptorPoolSize> descriptorCounts_ = {}
+            );
             ~DescriptorSetLayoutGroup();
 
             DescriptorSetLayoutGroup(DescriptorSetLayoutGroup const &) noexcept = delete;
@@ -73,6 +95,8 @@ namespace MFA
             DescriptorSetLayoutGroup & operator= (DescriptorSetLayoutGroup && rhs) noexcept = delete;
 
             VkDescriptorSetLayout const descriptorSetLayout;
+            // Number of descriptors of each type that a single set of this layout consumes
+            std::vector<VkDescriptorPoolSize> const descriptorCounts;
 
         };
     
@@ -228,10 +252,11 @@ namespace MFA
             const VkBuffer buffer;
             const VkDeviceMemory memory;
             VkDeviceSize const size;
+            MemoryAllocation const allocation;
 
             explicit BufferAndMemory(
                 VkBuffer buffer_,
-                VkDeviceMemory memory_,
+                MemoryAllocation const & allocation_,
                 VkDeviceSize size_
             );
             ~BufferAndMemory();
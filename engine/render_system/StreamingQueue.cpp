@@ -0,0 +1,438 @@
+#include "StreamingQueue.hpp"
+
+#include "RenderBackend.hpp"
+#include "UploadQueue.hpp"
+#include "BedrockAssert.hpp"
+#include "BedrockLog.hpp"
+
+#include <chrono>
+
+namespace MFA
+{
+
+	// How often the streaming thread checks the timeline semaphore while uploads are in flight
+	static constexpr std::chrono::milliseconds PollInterval{ 1 };
+
+	//-------------------------------------------------------------------------------------------------
+
+	StreamingQueue::StreamingQueue(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		uint32_t const transferQueueFamily,
+		VkQueue transferQueue,
+		std::mutex & queueMutex,
+		uint32_t const graphicQueueFamily
+	)
+		: _device(device)
+		, _physicalDevice(physicalDevice)
+		, _transferQueueFamily(transferQueueFamily)
+		, _transferQueue(transferQueue)
+		, _queueMutex(queueMutex)
+		, _graphicQueueFamily(graphicQueueFamily)
+		, _hasDedicatedQueue(transferQueue != VK_NULL_HANDLE)
+	{
+		MFA_ASSERT(_device != VK_NULL_HANDLE);
+
+		if (_hasDedicatedQueue)
+		{
+			MFA_ASSERT(_transferQueueFamily != _graphicQueueFamily);
+			_commandPool = RB::CreateCommandPool(_device, _transferQueueFamily);
+			_timelineSemaphore = RB::CreateTimelineSemaphore(_device, 0);
+			MFA_LOG_INFO("Streaming uses the transfer queue family %u", _transferQueueFamily);
+		}
+		else
+		{
+			MFA_LOG_INFO("No dedicated transfer queue, streaming goes through the graphic queue");
+		}
+
+		_thread = std::thread([this]()->void{ Run(); });
+
+		Instance = this;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	StreamingQueue::~StreamingQueue()
+	{
+		Instance = nullptr;
+
+		{
+			std::lock_guard lock{ _jobMutex };
+			_isRunning = false;
+			// Requests that have not started yet are dropped
+			_jobs.clear();
+		}
+		_jobCondition.notify_all();
+		_thread.join();
+
+		MFA_ASSERT(_inFlight.empty());
+
+		if (_hasDedicatedQueue)
+		{
+			if (_freeCommandBuffers.empty() == false)
+			{
+				RB::DestroyCommandBuffers(
+					_device,
+					_commandPool,
+					static_cast<uint32_t>(_freeCommandBuffers.size()),
+					_freeCommandBuffers.data()
+				);
+			}
+			RB::DestroySemaphore(_device, { _timelineSemaphore });
+			RB::DestroyCommandPool(_device, _commandPool);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::shared_ptr<StreamingQueue::TextureRequest> StreamingQueue::StreamTexture(TextureLoader loader)
+	{
+		MFA_ASSERT(loader != nullptr);
+		auto request = std::make_shared<TextureRequest>();
+		{
+			std::lock_guard lock{ _jobMutex };
+			_jobs.emplace_back(Job{
+				.textureLoader = std::move(loader),
+				.textureRequest = request
+			});
+		}
+		_jobCondition.notify_one();
+		return request;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::shared_ptr<StreamingQueue::BufferRequest> StreamingQueue::StreamBuffer(
+		BufferLoader loader,
+		VkBufferUsageFlags const usage
+	)
+	{
+		MFA_ASSERT(loader != nullptr);
+		auto request = std::make_shared<BufferRequest>();
+		{
+			std::lock_guard lock{ _jobMutex };
+			_jobs.emplace_back(Job{
+				.bufferLoader = std::move(loader),
+				.bufferUsage = usage,
+				.bufferRequest = request
+			});
+		}
+		_jobCondition.notify_one();
+		return request;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void StreamingQueue::Update()
+	{
+		std::vector<Handoff> handoffs{};
+		{
+			std::lock_guard lock{ _handoffMutex };
+			handoffs.swap(_handoffs);
+		}
+
+		auto * uploadQueue = UploadQueue::Instance;
+		MFA_ASSERT(uploadQueue != nullptr);
+
+		for (auto & handoff : handoffs)
+		{
+			if (handoff.textureRequest != nullptr)
+			{
+				if (handoff.gpuTexture != nullptr)
+				{
+					uploadQueue->AcquireImage(
+						handoff.gpuTexture->imageGroup->image,
+						handoff.cpuTexture->GetMipCount(),
+						handoff.cpuTexture->GetSlices(),
+						_transferQueueFamily,
+						_timelineSemaphore,
+						handoff.timelineValue
+					);
+					handoff.textureRequest->resource = handoff.gpuTexture;
+				}
+				else
+				{
+					auto [gpuTexture, token] = uploadQueue->CreateTexture(*handoff.cpuTexture);
+					handoff.textureRequest->resource = gpuTexture;
+				}
+				handoff.textureRequest->isReady = true;
+			}
+
+			if (handoff.bufferRequest != nullptr)
+			{
+				if (handoff.gpuBuffer != nullptr)
+				{
+					uploadQueue->AcquireBuffer(
+						*handoff.gpuBuffer,
+						_transferQueueFamily,
+						VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+							VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+						VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+							VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+						_timelineSemaphore,
+						handoff.timelineValue
+					);
+					handoff.bufferRequest->resource = handoff.gpuBuffer;
+				}
+				else
+				{
+					auto [gpuBuffer, token] = uploadQueue->CreateBuffer(*handoff.cpuBuffer, handoff.bufferUsage);
+					handoff.bufferRequest->resource = gpuBuffer;
+				}
+				handoff.bufferRequest->isReady = true;
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool StreamingQueue::HasDedicatedQueue() const noexcept
+	{
+		return _hasDedicatedQueue;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void StreamingQueue::Run()
+	{
+		while (true)
+		{
+			std::deque<Job> jobs{};
+			{
+				std::unique_lock lock{ _jobMutex };
+				auto const hasWork = [this]()->bool
+				{
+					return _isRunning == false || _jobs.empty() == false;
+				};
+				if (_inFlight.empty())
+				{
+					_jobCondition.wait(lock, hasWork);
+				}
+				else
+				{
+					_jobCondition.wait_for(lock, PollInterval, hasWork);
+				}
+
+				if (_isRunning == false && _inFlight.empty())
+				{
+					break;
+				}
+				jobs.swap(_jobs);
+			}
+
+			if (jobs.empty() == false)
+			{
+				Batch batch{};
+
+				for (auto const & job : jobs)
+				{
+					Handoff handoff{};
+					if (Load(job, handoff) == false)
+					{
+						continue;
+					}
+
+					if (_hasDedicatedQueue)
+					{
+						Record(handoff, batch);
+						batch.handoffs.emplace_back(std::move(handoff));
+					}
+					else
+					{
+						std::lock_guard lock{ _handoffMutex };
+						_handoffs.emplace_back(std::move(handoff));
+					}
+				}
+
+				if (batch.handoffs.empty() == false)
+				{
+					SubmitBatch(std::move(batch));
+				}
+			}
+
+			if (_hasDedicatedQueue)
+			{
+				RetireBatches();
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool StreamingQueue::Load(Job const & job, Handoff & outHandoff) const
+	{
+		if (job.textureRequest != nullptr)
+		{
+			auto cpuTexture = job.textureLoader();
+			if (cpuTexture == nullptr || cpuTexture->isValid() == false)
+			{
+				MFA_LOG_WARN("Failed to load the streamed texture");
+				job.textureRequest->isFailed = true;
+				return false;
+			}
+			outHandoff.textureRequest = job.textureRequest;
+			outHandoff.cpuTexture = std::move(cpuTexture);
+			return true;
+		}
+
+		if (job.bufferRequest != nullptr)
+		{
+			auto cpuBuffer = job.bufferLoader();
+			if (cpuBuffer == nullptr || cpuBuffer->IsValid() == false)
+			{
+				MFA_LOG_WARN("Failed to load the streamed buffer");
+				job.bufferRequest->isFailed = true;
+				return false;
+			}
+			outHandoff.bufferRequest = job.bufferRequest;
+			outHandoff.cpuBuffer = std::move(cpuBuffer);
+			outHandoff.bufferUsage = job.bufferUsage;
+			return true;
+		}
+
+		MFA_ASSERT(false);
+		return false;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void StreamingQueue::Record(Handoff & handoff, Batch & batch)
+	{
+		if (batch.commandBuffer == VK_NULL_HANDLE)
+		{
+			if (_freeCommandBuffers.empty())
+			{
+				batch.commandBuffer = RB::CreateCommandBuffers(_device, 1, _commandPool)[0];
+			}
+			else
+			{
+				batch.commandBuffer = _freeCommandBuffers.back();
+				_freeCommandBuffers.pop_back();
+			}
+			RB::BeginCommandBuffer(
+				batch.commandBuffer,
+				VkCommandBufferBeginInfo{
+					.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+					.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+				}
+			);
+		}
+
+		auto const & cpuData = handoff.cpuTexture != nullptr
+			? *handoff.cpuTexture->GetBuffer()
+			: *handoff.cpuBuffer;
+
+		auto stageBuffer = RB::CreateBuffer(
+			_device,
+			_physicalDevice,
+			cpuData.Len(),
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		RB::CopyDataToHostVisibleBuffer(_device, *stageBuffer, cpuData);
+
+		if (handoff.cpuTexture != nullptr)
+		{
+			handoff.gpuTexture = RB::CreateTexture(
+				*handoff.cpuTexture,
+				_device,
+				_physicalDevice,
+				batch.commandBuffer,
+				*stageBuffer,
+				0,
+				_transferQueueFamily,
+				_graphicQueueFamily
+			);
+		}
+		else
+		{
+			handoff.gpuBuffer = RB::CreateBuffer(
+				_device,
+				_physicalDevice,
+				cpuData.Len(),
+				handoff.bufferUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			);
+
+			VkBufferCopy const region{
+				.srcOffset = 0,
+				.dstOffset = 0,
+				.size = cpuData.Len()
+			};
+			vkCmdCopyBuffer(batch.commandBuffer, stageBuffer->buffer, handoff.gpuBuffer->buffer, 1, &region);
+
+			RB::ReleaseBufferOwnership(
+				batch.commandBuffer,
+				*handoff.gpuBuffer,
+				_transferQueueFamily,
+				_graphicQueueFamily
+			);
+		}
+
+		batch.stageBuffers.emplace_back(std::move(stageBuffer));
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void StreamingQueue::SubmitBatch(Batch && batch)
+	{
+		RB::EndCommandBuffer(batch.commandBuffer);
+
+		batch.timelineValue = ++_timelineValue;
+		for (auto & handoff : batch.handoffs)
+		{
+			handoff.timelineValue = batch.timelineValue;
+		}
+
+		VkTimelineSemaphoreSubmitInfo const timelineInfo{
+			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+			.signalSemaphoreValueCount = 1,
+			.pSignalSemaphoreValues = &batch.timelineValue,
+		};
+
+		VkSubmitInfo const submitInfo{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.pNext = &timelineInfo,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &batch.commandBuffer,
+			.signalSemaphoreCount = 1,
+			.pSignalSemaphores = &_timelineSemaphore,
+		};
+
+		{
+			std::lock_guard queueLock{ _queueMutex };
+			RB::SubmitQueues(_transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		}
+
+		_inFlight.emplace_back(std::move(batch));
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void StreamingQueue::RetireBatches()
+	{
+		if (_inFlight.empty())
+		{
+			return;
+		}
+
+		auto const completedValue = RB::GetSemaphoreCounterValue(_device, _timelineSemaphore);
+
+		while (_inFlight.empty() == false && _inFlight.front().timelineValue <= completedValue)
+		{
+			auto & batch = _inFlight.front();
+			{
+				std::lock_guard lock{ _handoffMutex };
+				for (auto & handoff : batch.handoffs)
+				{
+					_handoffs.emplace_back(std::move(handoff));
+				}
+			}
+			_freeCommandBuffers.emplace_back(batch.commandBuffer);
+			_inFlight.pop_front();
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "RenderTypes.hpp"
+#include "AssetTexture.hpp"
+#include "BedrockMemory.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MFA
+{
+    // Streams textures and buffers from a background thread. Loaders run on the streaming thread, the data is uploaded
+    // on the dedicated transfer queue and the resources are released to the graphic family. Once the timeline semaphore
+    // reports the upload as finished, Update records the acquire barriers through the UploadQueue so frame submission
+    // never waits for a transfer.
+    // Without a dedicated transfer family or timeline semaphores the loaded data goes through the UploadQueue instead.
+    // Submits on the transfer queue take the queue mutex of the device, device wait idle covers every queue.
+    class StreamingQueue
+    {
+    public:
+
+        // Resource is valid once isReady is true. It can be used by every command buffer that is submitted afterward.
+        template<typename Resource>
+        struct Request
+        {
+            std::atomic<bool> isReady = false;
+            // Set when the loader failed
+            std::atomic<bool> isFailed = false;
+            std::shared_ptr<Resource> resource{};
+        };
+
+        using TextureRequest = Request<RT::GpuTexture>;
+        using BufferRequest = Request<RT::BufferAndMemory>;
+
+        using TextureLoader = std::function<std::shared_ptr<AS::Texture>()>;
+        using BufferLoader = std::function<std::shared_ptr<Blob>()>;
+
+        inline static StreamingQueue * Instance = nullptr;
+
+        // Pass VK_NULL_HANDLE as the transfer queue when there is no dedicated transfer family
+        explicit StreamingQueue(
+            VkDevice device,
+            VkPhysicalDevice physicalDevice,
+            uint32_t transferQueueFamily,
+            VkQueue transferQueue,
+            std::mutex & queueMutex,
+            uint32_t graphicQueueFamily
+        );
+
+        ~StreamingQueue();
+
+        StreamingQueue(StreamingQueue const &) noexcept = delete;
+        StreamingQueue(StreamingQueue &&) noexcept = delete;
+        StreamingQueue & operator = (StreamingQueue const &) noexcept = delete;
+        StreamingQueue & operator = (StreamingQueue &&) noexcept = delete;
+
+        [[nodiscard]]
+        std::shared_ptr<TextureRequest> StreamTexture(TextureLoader loader);
+
+        // Usage of the device local buffer, e.g. vertex or index buffer
+        [[nodiscard]]
+        std::shared_ptr<BufferRequest> StreamBuffer(BufferLoader loader, VkBufferUsageFlags usage);
+
+        // Hands the finished uploads to the graphic queue, call it from the render thread before the frame is submitted
+        void Update();
+
+        [[nodiscard]]
+        bool HasDedicatedQueue() const noexcept;
+
+    private:
+
+        struct Job
+        {
+            TextureLoader textureLoader{};
+            std::shared_ptr<TextureRequest> textureRequest{};
+
+            BufferLoader bufferLoader{};
+            VkBufferUsageFlags bufferUsage{};
+            std::shared_ptr<BufferRequest> bufferRequest{};
+        };
+
+        // Loaded cpu data or an uploaded resource that waits for the graphic queue
+        struct Handoff
+        {
+            std::shared_ptr<TextureRequest> textureRequest{};
+            std::shared_ptr<AS::Texture> cpuTexture{};
+            std::shared_ptr<RT::GpuTexture> gpuTexture{};
+
+            std::shared_ptr<BufferRequest> bufferRequest{};
+            std::shared_ptr<Blob> cpuBuffer{};
+            VkBufferUsageFlags bufferUsage{};
+            std::shared_ptr<RT::BufferAndMemory> gpuBuffer{};
+
+            uint64_t timelineValue = 0;
+        };
+
+        struct Batch
+        {
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            uint64_t timelineValue = 0;
+            std::vector<std::shared_ptr<RT::BufferAndMemory>> stageBuffers{};
+            std::vector<Handoff> handoffs{};
+        };
+
+        void Run();
+
+        // Runs the loader, returns false if it did not produce valid data
+        [[nodiscard]]
+        bool Load(Job const & job, Handoff & outHandoff) const;
+
+        void Record(Handoff & handoff, Batch & batch);
+
+        void SubmitBatch(Batch && batch);
+
+        void RetireBatches();
+
+        VkDevice _device{};
+        VkPhysicalDevice _physicalDevice{};
+        uint32_t _transferQueueFamily{};
+        VkQueue _transferQueue{};
+        std::mutex & _queueMutex;
+        uint32_t _graphicQueueFamily{};
+
+        bool _hasDedicatedQueue = false;
+
+        // Owned by the streaming thread
+        VkCommandPool _commandPool{};
+        VkSemaphore _timelineSemaphore{};
+        uint64_t _timelineValue = 0;
+        std::deque<Batch> _inFlight{};
+        std::vector<VkCommandBuffer> _freeCommandBuffers{};
+
+        std::mutex _jobMutex{};
+        std::condition_variable _jobCondition{};
+        std::deque<Job> _jobs{};
+        bool _isRunning = true;
+
+        std::mutex _handoffMutex{};
+        std::vector<Handoff> _handoffs{};
+
+        std::thread _thread{};
+    };
+}
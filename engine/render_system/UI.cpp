@@ -1,5 +1,6 @@
 #include "UI.hpp"
 
+#include "BedrockFrameArena.hpp"
 #include "BedrockPlatforms.hpp"
 
 #include <cstdint>
@@ -173,7 +174,7 @@ namespace MFA
             }
         );
 
-        _descriptorPool = RB::CreateDescriptorPool(LogicalDevice::Instance->GetVkDevice(), LogicalDevice::Instance->GetMaxFramePerFlight());
+        _descriptorAllocator = std::make_unique<DescriptorAllocator>(LogicalDevice::Instance->GetVkDevice(), 1);
 
         CreateDescriptorSetLayout();
 
@@ -245,6 +246,8 @@ namespace MFA
             return false;
         }
 
+        SCOPE_GpuProfiler(recordState, "ImGui")
+
         // Setup desired Vulkan state
         // Bind pipeline and descriptor sets:
         RB::BindPipeline(recordState, *_pipeline);
@@ -266,11 +269,19 @@ namespace MFA
                 // Create or resize the vertex/index buffers
                 size_t const vertexSize = drawData->TotalVtxCount * sizeof(ImDrawVert);
                 size_t const indexSize = drawData->TotalIdxCount * sizeof(ImDrawIdx);
-                auto const vertexData = Memory::AllocSize(vertexSize);
-                auto const indexData = Memory::AllocSize(indexSize);
+                // Staging copies only live until the upload below, so they come from the frame arena
+                auto * frameMemory = FrameArena::Instance().Resource();
+                Alias const vertexData{
+                    static_cast<uint8_t *>(frameMemory->allocate(vertexSize, alignof(ImDrawVert))),
+                    vertexSize
+                };
+                Alias const indexData{
+                    static_cast<uint8_t *>(frameMemory->allocate(indexSize, alignof(ImDrawIdx))),
+                    indexSize
+                };
                 {
-                    auto* vertexPtr = reinterpret_cast<ImDrawVert*>(vertexData->Ptr());
-                    auto* indexPtr = reinterpret_cast<ImDrawIdx*>(indexData->Ptr());
+                    auto* vertexPtr = reinterpret_cast<ImDrawVert*>(vertexData.Ptr());
+                    auto* indexPtr = reinterpret_cast<ImDrawIdx*>(indexData.Ptr());
                     for (int n = 0; n < drawData->CmdListsCount; n++)
                     {
                         const ImDrawList* cmd = drawData->CmdLists[n];
@@ -301,7 +312,7 @@ namespace MFA
                 RB::UpdateHostVisibleBuffer(
                     device,
                     *vertexBuffer,
-                    *vertexData
+                    vertexData
                 );
 
                 if (indexBuffer == nullptr || indexBuffer->size < indexSize)
@@ -318,7 +329,7 @@ namespace MFA
                 RB::UpdateHostVisibleBuffer(
                     device,
                     *indexBuffer, 
-                    *indexData
+                    indexData
                 );
 
                 RB::BindIndexBuffer(
@@ -503,12 +514,7 @@ namespace MFA
         });
 
         // Create Descriptor Set:
-        _descriptorSetGroup = RB::CreateDescriptorSet(
-            LogicalDevice::Instance->GetVkDevice(),
-            _descriptorPool->descriptorPool,
-            _descriptorSetLayout->descriptorSetLayout,
-            1
-        );
+        _descriptorSetGroup = _descriptorAllocator->Allocate(*_descriptorSetLayout);
 
 
         auto const pipelineLayout = RB::CreatePipelineLayout(
@@ -593,6 +599,7 @@ namespace MFA
 
         _pipeline = RB::CreateGraphicPipeline(
             LogicalDevice::Instance->GetVkDevice(),
+            LogicalDevice::Instance->GetPipelineCache(),
             static_cast<uint8_t>(shaderStages.size()),
             shaderStages.data(),
             1,
@@ -651,29 +658,10 @@ namespace MFA
             importTextureOptions
         );
 
-        auto const device = LogicalDevice::Instance;
-
-        auto const commandBuffer = RB::BeginSingleTimeCommand(
-            device->GetVkDevice(), 
-            device->GetGraphicCommandPool()
-        );
-
         // TODO Support from in memory import of images inside importer
-        auto [texture, stagingBuffer] = RB::CreateTexture(
-            *textureAsset, 
-            device->GetVkDevice(), 
-            device->GetPhysicalDevice(),
-            commandBuffer
-        );
+        auto [texture, uploadToken] = UploadQueue::Instance->CreateTexture(*textureAsset);
 
         _fontTexture = texture;
-
-        RB::EndAndSubmitSingleTimeCommand(
-			device->GetVkDevice(),
-            device->GetGraphicCommandPool(),
-            device->GetGraphicQueue(),
-            commandBuffer
-        );
     }
 
     //-------------------------------------------------------------------------------------------------
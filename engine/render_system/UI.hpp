@@ -3,6 +3,7 @@
 #include "BedrockSignal.hpp"
 #include "RenderBackend.hpp"
 #include "render_pass/DisplayRenderPass.hpp"
+#include "DescriptorAllocator.hpp"
 
 #include "imgui.h"
 
@@ -67,7 +68,7 @@ namespace MFA
 
         std::shared_ptr<RT::SamplerGroup> _fontSampler{};
         std::shared_ptr<RT::DescriptorSetLayoutGroup> _descriptorSetLayout{};
-        std::shared_ptr<RT::DescriptorPool> _descriptorPool{};
+        std::unique_ptr<DescriptorAllocator> _descriptorAllocator{};
         RT::DescriptorSetGroup _descriptorSetGroup{};
         std::shared_ptr<RT::PipelineGroup> _pipeline{};
         std::shared_ptr<RT::GpuTexture> _fontTexture{};
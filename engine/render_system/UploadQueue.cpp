@@ -0,0 +1,571 @@
+#include "UploadQueue.hpp"
+
+#include "RenderBackend.hpp"
+#include "BedrockAssert.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace MFA
+{
+
+	// Texel blocks of all supported formats are at most 16 bytes
+	static constexpr VkDeviceSize TextureCopyAlignment = 16;
+	static constexpr VkDeviceSize BufferCopyAlignment = 4;
+
+	//-------------------------------------------------------------------------------------------------
+
+	static uint64_t AlignUp(uint64_t const value, uint64_t const alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	UploadQueue::UploadQueue(
+		VkDevice device,
+		VkPhysicalDevice physicalDevice,
+		uint32_t const queueFamily,
+		VkQueue queue,
+		std::mutex & queueMutex,
+		VkDeviceSize const ringSize,
+		VkDeviceSize const copyAlignment
+	)
+		: _device(device)
+		, _physicalDevice(physicalDevice)
+		, _queueFamily(queueFamily)
+		, _queue(queue)
+		, _queueMutex(queueMutex)
+		, _ringSize(ringSize)
+		, _copyAlignment((std::max)(copyAlignment, BufferCopyAlignment))
+		, _submitThreshold(ringSize / 4)
+	{
+		MFA_ASSERT(_device != VK_NULL_HANDLE);
+		MFA_ASSERT(_queue != VK_NULL_HANDLE);
+		MFA_ASSERT(_ringSize > 0);
+
+		_commandPool = RB::CreateCommandPool(_device, _queueFamily);
+
+		_ring = RB::CreateBuffer(
+			_device,
+			_physicalDevice,
+			_ringSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		void * ringPtr = nullptr;
+		RB::MapHostVisibleMemory(_device, *_ring, 0, _ringSize, &ringPtr);
+		_ringPtr = static_cast<uint8_t *>(ringPtr);
+
+		_recording.token = 1;
+
+		Instance = this;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	UploadQueue::~UploadQueue()
+	{
+		WaitIdle();
+
+		MFA_ASSERT(_inFlight.empty());
+
+		if (_freeCommandBuffers.empty() == false)
+		{
+			RB::DestroyCommandBuffers(
+				_device,
+				_commandPool,
+				static_cast<uint32_t>(_freeCommandBuffers.size()),
+				_freeCommandBuffers.data()
+			);
+		}
+		RB::DestroyFence(_device, _freeFences);
+		RB::DestroyCommandPool(_device, _commandPool);
+
+		_ring.reset();
+
+		Instance = nullptr;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	UploadQueue::Token UploadQueue::UploadBuffer(
+		RT::BufferAndMemory const & dstBuffer,
+		BaseBlob const & data,
+		VkDeviceSize const dstOffset
+	)
+	{
+		MFA_ASSERT(dstOffset + data.Len() <= dstBuffer.size);
+
+		std::lock_guard lock{ _mutex };
+
+		if (data.Len() == 0)
+		{
+			return _recording.token;
+		}
+
+		// Staging may submit the open batch to free ring space, so the batch is started afterward
+		auto const stageRange = Stage(data, BufferCopyAlignment);
+		auto const token = _recording.token;
+		std::ignore = BeginBatch();
+
+		AddCopy(
+			stageRange.buffer->buffer,
+			dstBuffer.buffer,
+			VkBufferCopy{
+				.srcOffset = stageRange.offset,
+				.dstOffset = dstOffset,
+				.size = data.Len()
+			}
+		);
+
+		if (_recordedBytes >= _submitThreshold)
+		{
+			SubmitInternal();
+		}
+
+		return token;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::tuple<std::shared_ptr<RT::BufferAndMemory>, UploadQueue::Token> UploadQueue::CreateBuffer(
+		BaseBlob const & data,
+		VkBufferUsageFlags const usage
+	)
+	{
+		auto buffer = RB::CreateBuffer(
+			_device,
+			_physicalDevice,
+			data.Len(),
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+		auto const token = UploadBuffer(*buffer, data);
+		return { buffer, token };
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::tuple<std::shared_ptr<RT::GpuTexture>, UploadQueue::Token> UploadQueue::CreateTexture(
+		AS::Texture const & cpuTexture
+	)
+	{
+		MFA_ASSERT(cpuTexture.isValid());
+		auto const buffer = cpuTexture.GetBuffer();
+		MFA_ASSERT(buffer != nullptr && buffer->IsValid());
+
+		std::lock_guard lock{ _mutex };
+
+		auto const stageRange = Stage(*buffer, (std::max)(_copyAlignment, TextureCopyAlignment));
+		auto const token = _recording.token;
+		auto const commandBuffer = BeginBatch();
+
+		auto gpuTexture = RB::CreateTexture(
+			cpuTexture,
+			_device,
+			_physicalDevice,
+			commandBuffer,
+			*stageRange.buffer,
+			stageRange.offset
+		);
+
+		if (_recordedBytes >= _submitThreshold)
+		{
+			SubmitInternal();
+		}
+
+		return { gpuTexture, token };
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	UploadQueue::Token UploadQueue::AcquireBuffer(
+		RT::BufferAndMemory const & buffer,
+		uint32_t const srcQueueFamily,
+		VkPipelineStageFlags const dstStageMask,
+		VkAccessFlags const dstAccessMask,
+		VkSemaphore timelineSemaphore,
+		uint64_t const value
+	)
+	{
+		std::lock_guard lock{ _mutex };
+
+		auto const commandBuffer = BeginBatch();
+		RB::AcquireBufferOwnership(
+			commandBuffer,
+			buffer,
+			srcQueueFamily,
+			_queueFamily,
+			dstStageMask,
+			dstAccessMask
+		);
+		AddWait(timelineSemaphore, value);
+
+		return _recording.token;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	UploadQueue::Token UploadQueue::AcquireImage(
+		VkImage image,
+		uint32_t const levelCount,
+		uint32_t const layerCount,
+		uint32_t const srcQueueFamily,
+		VkSemaphore timelineSemaphore,
+		uint64_t const value
+	)
+	{
+		std::lock_guard lock{ _mutex };
+
+		auto const commandBuffer = BeginBatch();
+		RB::AcquireImageOwnership(
+			commandBuffer,
+			image,
+			levelCount,
+			layerCount,
+			srcQueueFamily,
+			_queueFamily
+		);
+		AddWait(timelineSemaphore, value);
+
+		return _recording.token;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	UploadQueue::Token UploadQueue::Submit()
+	{
+		std::lock_guard lock{ _mutex };
+		return SubmitInternal();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	UploadQueue::Token UploadQueue::CurrentToken() const
+	{
+		std::lock_guard lock{ _mutex };
+		return _recording.token;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	bool UploadQueue::IsComplete(Token const token)
+	{
+		std::lock_guard lock{ _mutex };
+		Retire();
+		return token <= _completedToken;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void UploadQueue::Wait(Token const token)
+	{
+		std::lock_guard lock{ _mutex };
+		WaitInternal(token);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void UploadQueue::WaitIdle()
+	{
+		std::lock_guard lock{ _mutex };
+		auto const token = SubmitInternal();
+		WaitInternal(token);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void UploadQueue::Update()
+	{
+		std::lock_guard lock{ _mutex };
+		Retire();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	UploadQueue::StageRange UploadQueue::Stage(BaseBlob const & data, VkDeviceSize const alignment)
+	{
+		auto const size = static_cast<VkDeviceSize>(data.Len());
+
+		if (size > _ringSize)
+		{
+			auto stageBuffer = RB::CreateBuffer(
+				_device,
+				_physicalDevice,
+				size,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			);
+			RB::CopyDataToHostVisibleBuffer(_device, *stageBuffer, data);
+			_recording.stageBuffers.emplace_back(stageBuffer);
+			_recordedBytes += size;
+			return StageRange{ .buffer = stageBuffer.get(), .offset = 0 };
+		}
+
+		auto position = AlignUp(_ringHead, alignment);
+		// Allocations never wrap around the end of the ring
+		if (position % _ringSize + size > _ringSize)
+		{
+			position = AlignUp(position, _ringSize);
+		}
+
+		while (position + size - _ringTail > _ringSize)
+		{
+			Retire();
+			if (_inFlight.empty() && _isRecording == false)
+			{
+				// Nothing references the ring anymore
+				_ringTail = position;
+				break;
+			}
+			if (position + size - _ringTail > _ringSize)
+			{
+				if (_inFlight.empty())
+				{
+					SubmitInternal();
+				}
+				WaitInternal(_inFlight.front().token);
+			}
+		}
+
+		auto const offset = position % _ringSize;
+		std::memcpy(_ringPtr + offset, data.Ptr(), size);
+		RB::UnMapHostVisibleMemory(_device, *_ring, offset, size);
+
+		_ringHead = position + size;
+		_recordedBytes += size;
+
+		return StageRange{ .buffer = _ring.get(), .offset = offset };
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void UploadQueue::AddCopy(VkBuffer srcBuffer, VkBuffer dstBuffer, VkBufferCopy const & region)
+	{
+		auto const findResult = std::find_if(
+			_pendingCopies.begin(),
+			_pendingCopies.end(),
+			[srcBuffer, dstBuffer](PendingCopy const & pendingCopy)->bool
+			{
+				return pendingCopy.srcBuffer == srcBuffer && pendingCopy.dstBuffer == dstBuffer;
+			}
+		);
+
+		if (findResult == _pendingCopies.end())
+		{
+			_pendingCopies.emplace_back(PendingCopy{
+				.srcBuffer = srcBuffer,
+				.dstBuffer = dstBuffer,
+				.regions = { region }
+			});
+			return;
+		}
+
+		// Consecutive writes into the same buffer become a single region
+		auto & lastRegion = findResult->regions.back();
+		if (
+			lastRegion.srcOffset + lastRegion.size == region.srcOffset &&
+			lastRegion.dstOffset + lastRegion.size == region.dstOffset
+		)
+		{
+			lastRegion.size += region.size;
+			return;
+		}
+
+		findResult->regions.emplace_back(region);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void UploadQueue::AddWait(VkSemaphore timelineSemaphore, uint64_t const value)
+	{
+		auto & semaphores = _recording.waitSemaphores;
+		for (size_t i = 0; i < semaphores.size(); ++i)
+		{
+			if (semaphores[i] == timelineSemaphore)
+			{
+				_recording.waitValues[i] = (std::max)(_recording.waitValues[i], value);
+				return;
+			}
+		}
+		semaphores.emplace_back(timelineSemaphore);
+		_recording.waitValues.emplace_back(value);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	VkCommandBuffer UploadQueue::BeginBatch()
+	{
+		if (_isRecording)
+		{
+			return _recording.commandBuffer;
+		}
+
+		if (_freeCommandBuffers.empty())
+		{
+			_recording.commandBuffer = RB::CreateCommandBuffers(_device, 1, _commandPool)[0];
+		}
+		else
+		{
+			_recording.commandBuffer = _freeCommandBuffers.back();
+			_freeCommandBuffers.pop_back();
+		}
+
+		if (_freeFences.empty())
+		{
+			_recording.fence = RB::CreateFence(_device, 1)[0];
+		}
+		else
+		{
+			_recording.fence = _freeFences.back();
+			_freeFences.pop_back();
+		}
+
+		RB::BeginCommandBuffer(
+			_recording.commandBuffer,
+			VkCommandBufferBeginInfo{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+				.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+			}
+		);
+
+		_isRecording = true;
+		return _recording.commandBuffer;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	UploadQueue::Token UploadQueue::SubmitInternal()
+	{
+		if (_isRecording == false)
+		{
+			return _recording.token - 1;
+		}
+
+		auto const commandBuffer = _recording.commandBuffer;
+
+		for (auto const & pendingCopy : _pendingCopies)
+		{
+			vkCmdCopyBuffer(
+				commandBuffer,
+				pendingCopy.srcBuffer,
+				pendingCopy.dstBuffer,
+				static_cast<uint32_t>(pendingCopy.regions.size()),
+				pendingCopy.regions.data()
+			);
+		}
+		_pendingCopies.clear();
+
+		// Makes the uploads visible to every later submission on this queue
+		VkMemoryBarrier const memoryBarrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+				VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+		};
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1, &memoryBarrier,
+			0, nullptr,
+			0, nullptr
+		);
+
+		RB::EndCommandBuffer(commandBuffer);
+
+		RB::ResetFences(_device, { _recording.fence });
+
+		auto const waitCount = static_cast<uint32_t>(_recording.waitSemaphores.size());
+		std::vector<VkPipelineStageFlags> const waitStages(waitCount, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+		VkTimelineSemaphoreSubmitInfo const timelineInfo{
+			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+			.waitSemaphoreValueCount = waitCount,
+			.pWaitSemaphoreValues = _recording.waitValues.data(),
+		};
+
+		VkSubmitInfo const submitInfo{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.pNext = waitCount > 0 ? &timelineInfo : nullptr,
+			.waitSemaphoreCount = waitCount,
+			.pWaitSemaphores = _recording.waitSemaphores.data(),
+			.pWaitDstStageMask = waitStages.data(),
+			.commandBufferCount = 1,
+			.pCommandBuffers = &commandBuffer,
+		};
+		{
+			std::lock_guard queueLock{ _queueMutex };
+			RB::SubmitQueues(_queue, 1, &submitInfo, _recording.fence);
+		}
+
+		auto const token = _recording.token;
+		_recording.ringEnd = _ringHead;
+		_inFlight.emplace_back(std::move(_recording));
+
+		_recording = Batch{};
+		_recording.token = token + 1;
+		_isRecording = false;
+		_recordedBytes = 0;
+
+		return token;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void UploadQueue::WaitInternal(Token const token)
+	{
+		if (token >= _recording.token)
+		{
+			SubmitInternal();
+		}
+
+		// Batches complete in submission order, waiting on the last one with a smaller token is enough
+		VkFence fence = VK_NULL_HANDLE;
+		for (auto const & batch : _inFlight)
+		{
+			if (batch.token > token)
+			{
+				break;
+			}
+			fence = batch.fence;
+		}
+
+		if (fence != VK_NULL_HANDLE)
+		{
+			RB::WaitForFence(_device, { fence });
+		}
+
+		Retire();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void UploadQueue::Retire()
+	{
+		while (_inFlight.empty() == false)
+		{
+			auto & batch = _inFlight.front();
+			if (vkGetFenceStatus(_device, batch.fence) != VK_SUCCESS)
+			{
+				break;
+			}
+
+			// The pool allows individual resets, beginning the command buffer again resets it
+			_freeCommandBuffers.emplace_back(batch.commandBuffer);
+			_freeFences.emplace_back(batch.fence);
+
+			_ringTail = batch.ringEnd;
+			_completedToken = batch.token;
+
+			_inFlight.pop_front();
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "RenderTypes.hpp"
+#include "AssetTexture.hpp"
+#include "BedrockMemory.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace MFA
+{
+    // Batches gpu uploads into a single command buffer. Data is written into a persistently mapped staging ring,
+    // buffer copies are coalesced per destination and the whole batch is submitted once with a fence.
+    // Every upload returns a token of its batch that can be polled or waited on.
+    // Batches are submitted on the graphic queue before the frame, so rendering never needs to wait on the cpu side.
+    // Uploads can submit from any thread when the ring fills up, so every submit takes the queue mutex of the device.
+    class UploadQueue
+    {
+    public:
+
+        using Token = uint64_t;
+
+        inline static UploadQueue * Instance = nullptr;
+
+        explicit UploadQueue(
+            VkDevice device,
+            VkPhysicalDevice physicalDevice,
+            uint32_t queueFamily,
+            VkQueue queue,
+            std::mutex & queueMutex,
+            VkDeviceSize ringSize,
+            VkDeviceSize copyAlignment
+        );
+
+        ~UploadQueue();
+
+        UploadQueue(UploadQueue const &) noexcept = delete;
+        UploadQueue(UploadQueue &&) noexcept = delete;
+        UploadQueue & operator = (UploadQueue const &) noexcept = delete;
+        UploadQueue & operator = (UploadQueue &&) noexcept = delete;
+
+        // Queues a copy of the data into the given range of the destination buffer
+        Token UploadBuffer(
+            RT::BufferAndMemory const & dstBuffer,
+            BaseBlob const & data,
+            VkDeviceSize dstOffset = 0
+        );
+
+        // Creates a device local buffer and queues the upload of its content
+        std::tuple<std::shared_ptr<RT::BufferAndMemory>, Token> CreateBuffer(
+            BaseBlob const & data,
+            VkBufferUsageFlags usage
+        );
+
+        // Creates the image and queues the upload of all the mip levels and slices
+        std::tuple<std::shared_ptr<RT::GpuTexture>, Token> CreateTexture(AS::Texture const & cpuTexture);
+
+        // Records the acquire half of a queue family ownership transfer into the open batch.
+        // The batch waits for the timeline semaphore to reach the value before it executes.
+        Token AcquireBuffer(
+            RT::BufferAndMemory const & buffer,
+            uint32_t srcQueueFamily,
+            VkPipelineStageFlags dstStageMask,
+            VkAccessFlags dstAccessMask,
+            VkSemaphore timelineSemaphore,
+            uint64_t value
+        );
+
+        Token AcquireImage(
+            VkImage image,
+            uint32_t levelCount,
+            uint32_t layerCount,
+            uint32_t srcQueueFamily,
+            VkSemaphore timelineSemaphore,
+            uint64_t value
+        );
+
+        // Submits the open batch. Returns the token of the last submitted batch.
+        Token Submit();
+
+        // Token of the batch that is currently being recorded
+        [[nodiscard]]
+        Token CurrentToken() const;
+
+        [[nodiscard]]
+        bool IsComplete(Token token);
+
+        // Submits the batch of the token if it is still open and blocks until it is executed
+        void Wait(Token token);
+
+        void WaitIdle();
+
+        // Releases the ring space and the command buffers of the completed batches
+        void Update();
+
+    private:
+
+        struct Batch
+        {
+            Token token = 0;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+            // Ring position after the last allocation of this batch
+            uint64_t ringEnd = 0;
+            // Uploads that do not fit inside the ring get their own stage buffer
+            std::vector<std::shared_ptr<RT::BufferAndMemory>> stageBuffers{};
+            // Timeline semaphores of other queues that the batch waits on
+            std::vector<VkSemaphore> waitSemaphores{};
+            std::vector<uint64_t> waitValues{};
+        };
+
+        struct PendingCopy
+        {
+            VkBuffer srcBuffer = VK_NULL_HANDLE;
+            VkBuffer dstBuffer = VK_NULL_HANDLE;
+            std::vector<VkBufferCopy> regions{};
+        };
+
+        struct StageRange
+        {
+            RT::BufferAndMemory const * buffer = nullptr;
+            VkDeviceSize offset = 0;
+        };
+
+        // Writes the data into the ring or into a dedicated stage buffer
+        [[nodiscard]]
+        StageRange Stage(BaseBlob const & data, VkDeviceSize alignment);
+
+        void AddCopy(VkBuffer srcBuffer, VkBuffer dstBuffer, VkBufferCopy const & region);
+
+        void AddWait(VkSemaphore timelineSemaphore, uint64_t value);
+
+        [[nodiscard]]
+        VkCommandBuffer BeginBatch();
+
+        Token SubmitInternal();
+
+        void WaitInternal(Token token);
+
+        void Retire();
+
+        VkDevice _device{};
+        VkPhysicalDevice _physicalDevice{};
+        uint32_t _queueFamily{};
+        VkQueue _queue{};
+        std::mutex & _queueMutex;
+        VkCommandPool _commandPool{};
+
+        std::shared_ptr<RT::BufferAndMemory> _ring{};
+        uint8_t * _ringPtr = nullptr;
+        VkDeviceSize _ringSize{};
+        VkDeviceSize _copyAlignment{};
+        // Monotonic positions, the physical offset is position % ringSize
+        uint64_t _ringHead = 0;
+        uint64_t _ringTail = 0;
+        // The open batch is submitted early when it takes this much of the ring
+        VkDeviceSize _submitThreshold{};
+
+        Batch _recording{};
+        bool _isRecording = false;
+        VkDeviceSize _recordedBytes = 0;
+        std::vector<PendingCopy> _pendingCopies{};
+
+        std::deque<Batch> _inFlight{};
+        Token _completedToken = 0;
+
+        std::vector<VkCommandBuffer> _freeCommandBuffers{};
+        std::vector<VkFence> _freeFences{};
+
+        mutable std::mutex _mutex{};
+    };
+}
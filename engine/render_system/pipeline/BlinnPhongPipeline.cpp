@@ -35,10 +35,7 @@ namespace MFA
 
         mViewProjBuffer = std::move(viewProjectionBuffer);
 
-        mDescriptorPool = RB::CreateDescriptorPool(
-            LogicalDevice::Instance->GetVkDevice(),
-            params.maxSets
-        );
+        mDescriptorAllocator = std::make_unique<DescriptorAllocator>(LogicalDevice::Instance->GetVkDevice());
 
         CreateDescriptorSetLayout();
 
@@ -53,7 +50,7 @@ namespace MFA
     {
         mPipeline = nullptr;
         mDescriptorSetLayout = nullptr;
-        mDescriptorPool = nullptr;
+        mDescriptorAllocator = nullptr;
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -198,6 +195,7 @@ namespace MFA
 
         mPipeline = RB::CreateGraphicPipeline(
             LogicalDevice::Instance->GetVkDevice(),
+            LogicalDevice::Instance->GetPipelineCache(),
             static_cast<uint8_t>(shaders.size()),
             shaders.data(),
             1,
@@ -216,12 +214,7 @@ namespace MFA
     void BlinnPhongPipeline::CreateDescriptorSets()
     {
         auto const maxFramesPerFlight = LogicalDevice::Instance->GetMaxFramePerFlight();
-        mDescriptorSetGroup = RB::CreateDescriptorSet(
-            LogicalDevice::Instance->GetVkDevice(),
-            mDescriptorPool->descriptorPool,
-            mDescriptorSetLayout->descriptorSetLayout,
-            maxFramesPerFlight
-        );
+        mDescriptorSetGroup = mDescriptorAllocator->Allocate(*mDescriptorSetLayout, maxFramesPerFlight);
 
         for (uint32_t frameIndex = 0; frameIndex < maxFramesPerFlight; ++frameIndex)
         {
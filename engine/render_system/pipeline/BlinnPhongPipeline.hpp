@@ -2,6 +2,7 @@
 
 #include "RenderTypes.hpp"
 #include "render_pass/DisplayRenderPass.hpp"
+#include "DescriptorAllocator.hpp"
 
 #include <glm/glm.hpp>
 
@@ -39,7 +40,6 @@ namespace MFA
 
         struct Params
         {
-            int maxSets = 100;
             VkCullModeFlags cullModeFlags = VK_CULL_MODE_BACK_BIT;
             VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
             VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
@@ -73,7 +73,7 @@ namespace MFA
 
         void CreateDescriptorSets();
 
-        std::shared_ptr<RT::DescriptorPool> mDescriptorPool{};
+        std::unique_ptr<DescriptorAllocator> mDescriptorAllocator{};
         std::shared_ptr<RT::DescriptorSetLayoutGroup> mDescriptorSetLayout{};
         std::shared_ptr<RT::PipelineGroup> mPipeline{};
         std::shared_ptr<RT::BufferGroup> mViewProjBuffer{};
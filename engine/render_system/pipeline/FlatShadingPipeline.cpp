@@ -3,11 +3,19 @@
 #include "BedrockPath.hpp"
 #include "DescriptorSetSchema.hpp"
 #include "ImportShader.hpp"
+#include "ImportTexture.hpp"
 #include "LogicalDevice.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <string>
 
 namespace MFA
 {
 
+	// Binding of the texture array inside the per pipeline descriptor set
+	static constexpr uint32_t TextureArrayBinding = 4;
+
 	//-------------------------------------------------------------------------------------------------
 
 	FlatShadingPipeline::FlatShadingPipeline(
@@ -27,14 +35,24 @@ namespace MFA
 
         mLightSourceBuffer = std::move(lightSourceBuffer);
 
-		mDescriptorPool = RB::CreateDescriptorPool(
-			LogicalDevice::Instance->GetVkDevice(),
-			_params.maxSets
+		auto const & limits = LogicalDevice::Instance->GetPhysicalDeviceProperties().limits;
+		auto const maxSampledImages = (std::min)(
+			limits.maxPerStageDescriptorSampledImages,
+			limits.maxDescriptorSetSampledImages
 		);
+		mTextureCapacity = std::clamp(_params.maxTextures, 1, static_cast<int>(maxSampledImages));
+
+		if (LogicalDevice::Instance->GetPhysicalDeviceFeatures().shaderSampledImageArrayDynamicIndexing == VK_FALSE)
+		{
+			MFA_LOG_WARN("Device does not support dynamic indexing of sampled image arrays");
+		}
 
+		mDescriptorAllocator = std::make_unique<DescriptorAllocator>(LogicalDevice::Instance->GetVkDevice());
+
+		CreateDefaultTexture();
+		CreateMaterialBuffer();
 		CreatePerPipelineDescriptorSetLayout();
-		CreatePerGeometryDescriptorSetLayout();
-		CreatePipeline();
+		CreatePipeline(CompileShaders(mTextureCapacity));
 		CreatePerPipelineDescriptorSets();
 	}
 
@@ -42,10 +60,17 @@ namespace MFA
 
 	FlatShadingPipeline::~FlatShadingPipeline()
 	{
+		if (mReloadFuture.valid())
+		{
+			mReloadFuture.wait();
+		}
+		mRetiredPipelines.clear();
 		mPipeline = nullptr;
 		mPerPipelineDescriptorLayout = nullptr;
-		mPerGeometryDescriptorLayout = nullptr;
-		mDescriptorPool = nullptr;
+		mDescriptorAllocator = nullptr;
+		mMaterialBuffer = nullptr;
+		mStreamedTextures.clear();
+		mTextures.clear();
 	}
 
 	//-------------------------------------------------------------------------------------------------
@@ -87,43 +112,242 @@ namespace MFA
 
 	//-------------------------------------------------------------------------------------------------
 
-	RT::DescriptorSetGroup FlatShadingPipeline::CreatePerGeometryDescriptorSetGroup(
-		RT::BufferAndMemory const & material,
-		RT::GpuTexture const & texture
-	) const
+	int FlatShadingPipeline::AddTexture(std::shared_ptr<RT::GpuTexture> const & texture)
 	{
-		auto perGeometryDescriptorSet = RB::CreateDescriptorSet(
-			LogicalDevice::Instance->GetVkDevice(),
-			mDescriptorPool->descriptorPool,
-			mPerGeometryDescriptorLayout->descriptorSetLayout,
-			1
+		MFA_ASSERT(texture != nullptr);
+
+		std::lock_guard lock{ mMaterialMutex };
+
+		auto const findResult = mTextureIndices.find(texture.get());
+		if (findResult != mTextureIndices.end())
+		{
+			return findResult->second;
+		}
+
+		if (static_cast<int>(mTextures.size()) >= mTextureCapacity)
+		{
+			MFA_LOG_WARN("Texture array is full, using the default texture instead");
+			return 0;
+		}
+
+		auto const textureIndex = static_cast<int>(mTextures.size());
+		mTextures.emplace_back(texture);
+		mTextureIndices.emplace(texture.get(), textureIndex);
+		return textureIndex;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	int FlatShadingPipeline::AddTexture(std::shared_ptr<StreamingQueue::TextureRequest> const & request)
+	{
+		MFA_ASSERT(request != nullptr);
+
+		std::lock_guard lock{ mMaterialMutex };
+
+		auto const findResult = mStreamedTextureIndices.find(request);
+		if (findResult != mStreamedTextureIndices.end())
+		{
+			return findResult->second;
+		}
+
+		if (static_cast<int>(mTextures.size()) >= mTextureCapacity)
+		{
+			MFA_LOG_WARN("Texture array is full, using the default texture instead");
+			return 0;
+		}
+
+		auto const textureIndex = static_cast<int>(mTextures.size());
+		auto defaultTexture = mTextures[0];
+		mTextures.emplace_back(std::move(defaultTexture));
+		mStreamedTextureIndices.emplace(request, textureIndex);
+		mStreamedTextures.emplace_back(StreamedTexture{ .slot = textureIndex, .request = request });
+		return textureIndex;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::tuple<int, UploadQueue::Token> FlatShadingPipeline::AddMaterial(Material const & material)
+	{
+		std::lock_guard lock{ mMaterialMutex };
+
+		MFA_ASSERT(material.textureIndex >= 0 && material.textureIndex < static_cast<int>(mTextures.size()));
+
+		auto const findResult = mMaterialIndices.find(material);
+		if (findResult != mMaterialIndices.end())
+		{
+			return { findResult->second, mMaterialTokens[findResult->second] };
+		}
+
+		if (static_cast<int>(mMaterialTokens.size()) >= _params.maxMaterials)
+		{
+			MFA_LOG_WARN("Material table is full, using the default material instead");
+			return { 0, mMaterialTokens[0] };
+		}
+
+		auto const materialIndex = static_cast<int>(mMaterialTokens.size());
+		auto const token = UploadQueue::Instance->UploadBuffer(
+			*mMaterialBuffer->buffers[0],
+			Alias(material),
+			static_cast<VkDeviceSize>(materialIndex) * sizeof(Material)
 		);
+		mMaterialTokens.emplace_back(token);
+		mMaterialIndices.emplace(material, materialIndex);
+		return { materialIndex, token };
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void FlatShadingPipeline::Update(RT::CommandRecordState const & recordState)
+	{
+		std::lock_guard lock{ mMaterialMutex };
+
+		UpdateStreamedTextures();
+
+		auto & writtenTextureCount = mWrittenTextureCounts[recordState.frameIndex];
+		auto & changedTextureSlots = mChangedTextureSlots[recordState.frameIndex];
+		auto const textureCount = static_cast<int>(mTextures.size());
+		if (writtenTextureCount == textureCount && changedTextureSlots.empty())
+		{
+			return;
+		}
 
-		auto const& descriptorSet = perGeometryDescriptorSet.descriptorSets[0];
-		MFA_ASSERT(descriptorSet != VK_NULL_HANDLE);
+		auto const descriptorSet = mPerPipelineDescriptorSetGroup.descriptorSets[recordState.frameIndex];
 
-		DescriptorSetSchema descriptorSetSchema{ descriptorSet };
+		// Reserved up front, the writes keep pointers into it
+		std::vector<VkDescriptorImageInfo> imageInfos{};
+		imageInfos.reserve(textureCount - writtenTextureCount + changedTextureSlots.size());
+		auto const imageInfo = [this](int const slot)->VkDescriptorImageInfo
+		{
+			return VkDescriptorImageInfo{
+				.sampler = VK_NULL_HANDLE,
+				.imageView = mTextures[slot]->imageView->imageView,
+				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			};
+		};
 
-		// Material
-		VkDescriptorBufferInfo const bufferInfo{
-			.buffer = material.buffer,
-			.offset = 0,
-			.range = material.size,
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets{};
+		auto const addWrite = [&](int const firstSlot, int const slotCount)->void
+		{
+			writeDescriptorSets.emplace_back(VkWriteDescriptorSet{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = descriptorSet,
+				.dstBinding = TextureArrayBinding,
+				.dstArrayElement = static_cast<uint32_t>(firstSlot),
+				.descriptorCount = static_cast<uint32_t>(slotCount),
+				.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+				.pImageInfo = imageInfos.data() + imageInfos.size() - slotCount
+			});
 		};
-		descriptorSetSchema.AddUniformBuffer(&bufferInfo);
 
-		// BaseColor
-		VkDescriptorImageInfo const texturesSamplerInfo{
-			.sampler = VK_NULL_HANDLE,
-			.imageView = texture.imageView->imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		for (auto const slot : changedTextureSlots)
+		{
+			if (slot < writtenTextureCount)
+			{
+				imageInfos.emplace_back(imageInfo(slot));
+				addWrite(slot, 1);
+			}
+		}
+		changedTextureSlots.clear();
+
+		if (writtenTextureCount < textureCount)
+		{
+			for (int i = writtenTextureCount; i < textureCount; ++i)
+			{
+				imageInfos.emplace_back(imageInfo(i));
+			}
+			addWrite(writtenTextureCount, textureCount - writtenTextureCount);
+		}
+
+		// The fence of this frame is already waited on, so its descriptor set is not in use
+		if (writeDescriptorSets.empty() == false)
+		{
+			RB::UpdateDescriptorSets(
+				LogicalDevice::Instance->GetVkDevice(),
+				static_cast<uint32_t>(writeDescriptorSets.size()),
+				writeDescriptorSets.data()
+			);
+		}
+
+		writtenTextureCount = textureCount;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void FlatShadingPipeline::UpdateStreamedTextures()
+	{
+		// A request becomes ready in LogicalDevice::Update, after its acquire barrier is recorded into the upload batch.
+		// That batch waits on the timeline semaphore of the transfer queue and is submitted ahead of this frame, so the
+		// first draw that samples the texture is ordered after the transfer.
+		std::erase_if(mStreamedTextures, [this](StreamedTexture const & streamedTexture)->bool
+		{
+			auto const & request = *streamedTexture.request;
+			if (request.isFailed)
+			{
+				// The slot keeps the default texture
+				return true;
+			}
+			if (request.isReady == false)
+			{
+				return false;
+			}
+			mTextures[streamedTexture.slot] = request.resource;
+			mTextureIndices.emplace(request.resource.get(), streamedTexture.slot);
+			for (auto & changedTextureSlots : mChangedTextureSlots)
+			{
+				changedTextureSlots.emplace_back(streamedTexture.slot);
+			}
+			return true;
+		});
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	size_t FlatShadingPipeline::MaterialHash::operator()(Material const & material) const noexcept
+	{
+		size_t hash = 0;
+		auto const combine = [&hash](size_t const value)->void
+		{
+			hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
 		};
+		for (int i = 0; i < 4; ++i)
+		{
+			combine(std::hash<float>{}(material.color[i]));
+		}
+		combine(std::hash<int>{}(material.hasBaseColorTexture));
+		combine(std::hash<int>{}(material.textureIndex));
+		return hash;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void FlatShadingPipeline::CreateDefaultTexture()
+	{
+		// Slot zero, it also fills the part of the texture array that is not used yet
+		auto const cpuTexture = Importer::ErrorTexture();
+		auto [gpuTexture, uploadToken] = UploadQueue::Instance->CreateTexture(*cpuTexture);
+		auto const textureIndex = AddTexture(gpuTexture);
+		MFA_ASSERT(textureIndex == 0);
+	}
 
-		descriptorSetSchema.AddImage(&texturesSamplerInfo, 1);
+	//-------------------------------------------------------------------------------------------------
 
-		descriptorSetSchema.UpdateDescriptorSets();
+	void FlatShadingPipeline::CreateMaterialBuffer()
+	{
+		MFA_ASSERT(_params.maxMaterials > 0);
+		mMaterialBuffer = RB::CreateLocalStorageBuffer(
+			LogicalDevice::Instance->GetVkDevice(),
+			LogicalDevice::Instance->GetPhysicalDevice(),
+			sizeof(Material) * _params.maxMaterials,
+			1
+		);
 
-		return perGeometryDescriptorSet;
+		// Index zero is used when the table is full
+		auto const [materialIndex, uploadToken] = AddMaterial(Material{
+			.color = glm::vec4{1.0f, 1.0f, 1.0f, 1.0f},
+			.hasBaseColorTexture = 0,
+			.textureIndex = 0
+		});
+		MFA_ASSERT(materialIndex == 0);
 	}
 
 	//-------------------------------------------------------------------------------------------------
@@ -159,83 +383,67 @@ namespace MFA
 		};
 		bindings.emplace_back(samplerLayoutBinding);
 
-		mPerPipelineDescriptorLayout = RB::CreateDescriptorSetLayout(
-			LogicalDevice::Instance->GetVkDevice(),
-			static_cast<uint8_t>(bindings.size()),
-			bindings.data()
-		);
-	}
-
-	//-------------------------------------------------------------------------------------------------
-
-	void FlatShadingPipeline::CreatePerGeometryDescriptorSetLayout()
-	{
-		std::vector<VkDescriptorSetLayoutBinding> bindings{};
-
-		// Material
+		// Material table
 		bindings.emplace_back(VkDescriptorSetLayoutBinding{
 			.binding = static_cast<uint32_t>(bindings.size()),
-			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 			.descriptorCount = 1,
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
 		});
 
-		// Base color
+		// Textures
+		MFA_ASSERT(bindings.size() == TextureArrayBinding);
 		bindings.emplace_back(VkDescriptorSetLayoutBinding{
 			.binding = static_cast<uint32_t>(bindings.size()),
 			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-			.descriptorCount = 1,
+			.descriptorCount = static_cast<uint32_t>(mTextureCapacity),
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
 		});
 
-		mPerGeometryDescriptorLayout = RB::CreateDescriptorSetLayout(
+		mPerPipelineDescriptorLayout = RB::CreateDescriptorSetLayout(
 			LogicalDevice::Instance->GetVkDevice(),
 			static_cast<uint8_t>(bindings.size()),
 			bindings.data()
 		);
-
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	void FlatShadingPipeline::CreatePipeline()
+	FlatShadingPipeline::Shaders FlatShadingPipeline::CompileShaders(int const textureCapacity)
 	{
-		// Vertex shader
-		{
-			bool success = Importer::CompileShaderToSPV(
+		std::vector<std::string> const defines{
+			"MAX_TEXTURE_COUNT=" + std::to_string(textureCapacity)
+		};
+		return Shaders {
+			.vertex = Importer::CompileShader(
 				Path::Instance->Get("engine/shaders/flat_shading_pipeline/FlatShadingPipeline.vert.hlsl"),
-				Path::Instance->Get("engine/shaders/flat_shading_pipeline/FlatShadingPipeline.vert.spv"),
-				"vert"
-			);
-			MFA_ASSERT(success == true);
-		}
-		auto cpuVertexShader = Importer::ShaderFromSPV(
-			Path::Instance->Get("engine/shaders/flat_shading_pipeline/FlatShadingPipeline.vert.spv"),
-			VK_SHADER_STAGE_VERTEX_BIT,
-			"main"
-		);
+				VK_SHADER_STAGE_VERTEX_BIT,
+				"main",
+				defines
+			),
+			.fragment = Importer::CompileShader(
+				Path::Instance->Get("engine/shaders/flat_shading_pipeline/FlatShadingPipeline.frag.hlsl"),
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				"main",
+				defines
+			)
+		};
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void FlatShadingPipeline::CreatePipeline(Shaders const & cpuShaders)
+	{
+		MFA_ASSERT(cpuShaders.vertex != nullptr);
+		MFA_ASSERT(cpuShaders.fragment != nullptr);
+
 		auto gpuVertexShader = RB::CreateShader(
 			LogicalDevice::Instance->GetVkDevice(),
-			cpuVertexShader
-		);
-
-		// Fragment shader
-		{
-			bool success = Importer::CompileShaderToSPV(
-				Path::Instance->Get("engine/shaders/flat_shading_pipeline/FlatShadingPipeline.frag.hlsl"),
-				Path::Instance->Get("engine/shaders/flat_shading_pipeline/FlatShadingPipeline.frag.spv"),
-				"frag"
-			);
-			MFA_ASSERT(success == true);
-		}
-		auto cpuFragmentShader = Importer::ShaderFromSPV(
-			Path::Instance->Get("engine/shaders/flat_shading_pipeline/FlatShadingPipeline.frag.spv"),
-			VK_SHADER_STAGE_FRAGMENT_BIT,
-			"main"
+			cpuShaders.vertex
 		);
 		auto gpuFragmentShader = RB::CreateShader(
 			LogicalDevice::Instance->GetVkDevice(),
-			cpuFragmentShader
+			cpuShaders.fragment
 		);
 
 		std::vector<RT::GpuShader const*> shaders{ gpuVertexShader.get(), gpuFragmentShader.get() };
@@ -289,8 +497,7 @@ namespace MFA
 		};
 
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
-			mPerPipelineDescriptorLayout->descriptorSetLayout,
-			mPerGeometryDescriptorLayout->descriptorSetLayout
+			mPerPipelineDescriptorLayout->descriptorSetLayout
 		};
 		
 		const auto pipelineLayout = RB::CreatePipelineLayout(
@@ -305,6 +512,7 @@ namespace MFA
 
 		mPipeline = RB::CreateGraphicPipeline(
 			LogicalDevice::Instance->GetVkDevice(),
+			LogicalDevice::Instance->GetPipelineCache(),
 			static_cast<uint8_t>(shaders.size()),
 			shaders.data(),
 			1,
@@ -323,10 +531,8 @@ namespace MFA
 	void FlatShadingPipeline::CreatePerPipelineDescriptorSets()
 	{
 		auto const maxFramesPerFlight = LogicalDevice::Instance->GetMaxFramePerFlight();
-		mPerPipelineDescriptorSetGroup = RB::CreateDescriptorSet(
-			LogicalDevice::Instance->GetVkDevice(),
-			mDescriptorPool->descriptorPool,
-			mPerPipelineDescriptorLayout->descriptorSetLayout,
+		mPerPipelineDescriptorSetGroup = mDescriptorAllocator->Allocate(
+			*mPerPipelineDescriptorLayout,
 			maxFramesPerFlight
 		);
 
@@ -366,18 +572,96 @@ namespace MFA
 			};
 			descriptorSetSchema.AddSampler(&texturesSamplerInfo);
 
+			/////////////////////////////////////////////////////////////////
+			// Materials
+			/////////////////////////////////////////////////////////////////
+
+			VkDescriptorBufferInfo materialBufferInfo{
+				.buffer = mMaterialBuffer->buffers[0]->buffer,
+				.offset = 0,
+				.range = mMaterialBuffer->bufferSize
+			};
+			descriptorSetSchema.AddStorageBuffer(&materialBufferInfo);
+
+			// Every slot starts with the default texture, Update writes the real ones once they are added
+			std::vector<VkDescriptorImageInfo> textureInfos(
+				mTextureCapacity,
+				VkDescriptorImageInfo{
+					.sampler = VK_NULL_HANDLE,
+					.imageView = mTextures[0]->imageView->imageView,
+					.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+				}
+			);
+			descriptorSetSchema.AddImage(textureInfos.data(), static_cast<uint32_t>(textureInfos.size()));
+
 			descriptorSetSchema.UpdateDescriptorSets();
 		}
+
+		mWrittenTextureCounts.assign(maxFramesPerFlight, 1);
+		mChangedTextureSlots.assign(maxFramesPerFlight, {});
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
 	void FlatShadingPipeline::reload()
 	{
+		if (mReloadFuture.valid())
+		{
+			MFA_LOG_DEBUG("Shading pipeline is already reloading");
+			return;
+		}
 		MFA_LOG_DEBUG("Reloading shading pipeline");
 
-		LogicalDevice::Instance->DeviceWaitIdle();
-		CreatePipeline();
+		if (JobSystem::Instance != nullptr)
+		{
+			mReloadFuture = JobSystem::Instance->AssignTask<Shaders>([textureCapacity = mTextureCapacity]()->Shaders
+			{
+				return CompileShaders(textureCapacity);
+			});
+		}
+		else
+		{
+			std::promise<Shaders> promise{};
+			promise.set_value(CompileShaders(mTextureCapacity));
+			mReloadFuture = promise.get_future();
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void FlatShadingPipeline::Update()
+	{
+		// Frames are not submitted while the window is hidden, and showing it again waits for the device
+		if (LogicalDevice::Instance->IsWindowVisible())
+		{
+			for (auto & retired : mRetiredPipelines)
+			{
+				--retired.remainingFrames;
+			}
+			std::erase_if(mRetiredPipelines, [](RetiredPipeline const & retired)->bool
+			{
+				return retired.remainingFrames == 0;
+			});
+		}
+
+		if (mReloadFuture.valid() == false ||
+			mReloadFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			return;
+		}
+
+		auto const shaders = mReloadFuture.get();
+		if (shaders.vertex == nullptr || shaders.fragment == nullptr)
+		{
+			MFA_LOG_WARN("Failed to reload the shading pipeline, keeping the previous one");
+			return;
+		}
+
+		mRetiredPipelines.emplace_back(RetiredPipeline {
+			.pipeline = std::move(mPipeline),
+			.remainingFrames = LogicalDevice::Instance->GetMaxFramePerFlight() + 1
+		});
+		CreatePipeline(shaders);
 	}
 
 	//-------------------------------------------------------------------------------------------------
@@ -2,9 +2,16 @@
 
 #include "IShadingPipeline.h"
 #include "render_pass/DisplayRenderPass.hpp"
+#include "DescriptorAllocator.hpp"
+#include "AssetShader.hpp"
+#include "UploadQueue.hpp"
+#include "StreamingQueue.hpp"
 
 #include <glm/glm.hpp>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace MFA
 {
@@ -35,23 +42,32 @@ namespace MFA
         struct PushConstants
         {
             glm::mat4 model;
+            int materialIndex;
+            int placeholder0;
+            int placeholder1;
+            int placeholder2;
         };
 
+        // Element of the material table, textureIndex points into the texture array of the pipeline
         struct Material
         {
             glm::vec4 color {};
             int hasBaseColorTexture {};
+            int textureIndex {};
             int placeholder0 {};
             int placeholder1 {};
-            int placeholder2 {};
+
+            bool operator == (Material const & other) const = default;
         };
 
         struct Params
         {
-            int maxSets = 1000;
             VkCullModeFlags cullModeFlags = VK_CULL_MODE_BACK_BIT;
             VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
             VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+            int maxMaterials = 1024;
+            // Clamped to the sampled image limits of the device
+            int maxTextures = 256;
         };
 
         explicit FlatShadingPipeline(
@@ -60,7 +76,6 @@ namespace MFA
             std::shared_ptr<RT::SamplerGroup> sampler,
             std::shared_ptr<RT::BufferGroup> lightSourceBuffer,
             Params params = Params {
-                .maxSets = 100,
                 .cullModeFlags = VK_CULL_MODE_BACK_BIT,
                 .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
                 .polygonMode = VK_POLYGON_MODE_FILL
@@ -76,36 +91,101 @@ namespace MFA
 
         void SetPushConstants(RT::CommandRecordState& recordState, PushConstants pushConstants) const;
 
+        // Returns the slot of the texture in the texture array, the same texture always maps to the same slot
+        [[nodiscard]]
+        int AddTexture(std::shared_ptr<RT::GpuTexture> const & texture);
+
+        // Reserves a slot for a texture that is still streaming. The slot shows the default texture until the request
+        // is ready, then Update writes the streamed texture into the descriptor set of each frame.
         [[nodiscard]]
-        RT::DescriptorSetGroup CreatePerGeometryDescriptorSetGroup(
-            RT::BufferAndMemory const& material,
-            RT::GpuTexture const& texture
-        ) const;
+        int AddTexture(std::shared_ptr<StreamingQueue::TextureRequest> const & request);
 
+        // Returns the index of the material in the material table, equal materials share an index.
+        // The token belongs to the upload of the material data.
+        [[nodiscard]]
+        std::tuple<int, UploadQueue::Token> AddMaterial(Material const & material);
+
+        // Writes the textures that were added or finished streaming since the descriptor set of this frame was last used.
+        // Call once per frame before any draw is recorded.
+        void Update(RT::CommandRecordState const & recordState);
+
+        // Compiles the shaders on the job system, the new pipeline is swapped in by Update once they are ready
         void reload() override;
 
+        // Call once per frame before recording
+        void Update();
+
     private:
 
-        void CreatePerPipelineDescriptorSetLayout();
+        struct Shaders
+        {
+            std::shared_ptr<AS::Shader> vertex{};
+            std::shared_ptr<AS::Shader> fragment{};
+        };
+
+        // Pipelines replaced by a reload stay alive until the frames that recorded them are finished
+        struct RetiredPipeline
+        {
+            std::shared_ptr<RT::PipelineGroup> pipeline{};
+            uint32_t remainingFrames = 0;
+        };
 
-        void CreatePerGeometryDescriptorSetLayout();
+        struct StreamedTexture
+        {
+            int slot = 0;
+            std::shared_ptr<StreamingQueue::TextureRequest> request{};
+        };
+
+        struct MaterialHash
+        {
+            size_t operator()(Material const & material) const noexcept;
+        };
+
+        [[nodiscard]]
+        static Shaders CompileShaders(int textureCapacity);
 
-        void CreatePipeline();
+        void CreateDefaultTexture();
+
+        void UpdateStreamedTextures();
+
+        void CreateMaterialBuffer();
+
+        void CreatePerPipelineDescriptorSetLayout();
+
+        void CreatePipeline(Shaders const & shaders);
 
         void CreatePerPipelineDescriptorSets();
 
-        std::shared_ptr<RT::DescriptorPool> mDescriptorPool{};
+        std::unique_ptr<DescriptorAllocator> mDescriptorAllocator{};
 
     	std::shared_ptr<RT::DescriptorSetLayoutGroup> mPerPipelineDescriptorLayout{};
-        std::shared_ptr<RT::DescriptorSetLayoutGroup> mPerGeometryDescriptorLayout{};
 
         std::shared_ptr<RT::PipelineGroup> mPipeline{};
+        std::vector<RetiredPipeline> mRetiredPipelines{};
+        std::future<Shaders> mReloadFuture{};
         std::shared_ptr<RT::BufferGroup> mViewProjBuffer{};
         std::shared_ptr<RT::BufferGroup> mLightSourceBuffer{};
         std::shared_ptr<RT::SamplerGroup> mSampler{};
 
         RT::DescriptorSetGroup mPerPipelineDescriptorSetGroup{};
 
+        // Materials of every renderer live in one storage buffer and textures in one array,
+        // so a single descriptor set bind per frame covers all the geometry
+        int mTextureCapacity = 0;
+        std::shared_ptr<RT::BufferGroup> mMaterialBuffer{};
+        std::vector<std::shared_ptr<RT::GpuTexture>> mTextures{};
+        std::unordered_map<RT::GpuTexture const *, int> mTextureIndices{};
+        std::vector<UploadQueue::Token> mMaterialTokens{};
+        std::unordered_map<Material, int, MaterialHash> mMaterialIndices{};
+        std::vector<StreamedTexture> mStreamedTextures{};
+        // Keeps the requests alive so their addresses are never reused by a new request
+        std::unordered_map<std::shared_ptr<StreamingQueue::TextureRequest>, int> mStreamedTextureIndices{};
+        // Number of textures that are already written into the descriptor set of each frame
+        std::vector<int> mWrittenTextureCounts{};
+        // Written slots of each frame whose streamed texture became ready afterward
+        std::vector<std::vector<int>> mChangedTextureSlots{};
+        std::mutex mMaterialMutex{};
+
         std::shared_ptr<DisplayRenderPass> mDisplayRenderPass{};
 
         Params _params{};
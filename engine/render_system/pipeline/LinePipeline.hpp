@@ -2,6 +2,7 @@
 
 #include "RenderTypes.hpp"
 #include "render_pass/DisplayRenderPass.hpp"
+#include "DescriptorAllocator.hpp"
 
 #include <glm/glm.hpp>
 
@@ -14,6 +15,7 @@ namespace MFA
         struct Vertex
         {
             glm::vec3 position{};
+            glm::vec4 color{};
         };
 
         struct ViewProjection
@@ -24,13 +26,11 @@ namespace MFA
         struct PushConstants
         {
             glm::mat4 model;
-            glm::vec4 color;
         };
 
         explicit LinePipeline(
             std::shared_ptr<DisplayRenderPass> displayRenderPass,
-            std::shared_ptr<RT::BufferGroup> viewProjectionBuffer,
-            int maxSets
+            std::shared_ptr<RT::BufferGroup> viewProjectionBuffer
         );
 
         ~LinePipeline();
@@ -50,7 +50,7 @@ namespace MFA
 
         void CreateDescriptorSets();
 
-        std::shared_ptr<RT::DescriptorPool> mDescriptorPool {};
+        std::unique_ptr<DescriptorAllocator> mDescriptorAllocator {};
         std::shared_ptr<RT::DescriptorSetLayoutGroup> mDescriptorSetLayout{};
         std::shared_ptr<RT::PipelineGroup> mPipeline{};
         std::shared_ptr<RT::BufferGroup> mViewProjBuffer{};
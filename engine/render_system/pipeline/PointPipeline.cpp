@@ -13,18 +13,14 @@ namespace MFA
 
     PointPipeline::PointPipeline(
         std::shared_ptr<DisplayRenderPass> displayRenderPass,
-        std::shared_ptr<RT::BufferGroup> viewProjectionBuffer,
-        int const maxSets
+        std::shared_ptr<RT::BufferGroup> viewProjectionBuffer
     )
     {
         mDisplayRenderPass = std::move(displayRenderPass);
 
         mViewProjBuffer = std::move(viewProjectionBuffer);
 
-        mDescriptorPool = RB::CreateDescriptorPool(
-            LogicalDevice::Instance->GetVkDevice(),
-            maxSets
-        );
+        mDescriptorAllocator = std::make_unique<DescriptorAllocator>(LogicalDevice::Instance->GetVkDevice());
         CreateDescriptorSetLayout();
         CreatePipeline();
         CreateDescriptorSets();
@@ -36,7 +32,7 @@ namespace MFA
     {
         mPipeline = nullptr;
         mDescriptorSetLayout = nullptr;
-        mDescriptorPool = nullptr;
+        mDescriptorAllocator = nullptr;
     }
 
     //-------------------------------------------------------------------------------------------------
@@ -73,7 +69,7 @@ namespace MFA
         RB::PushConstants(
             recordState,
             mPipeline->pipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+            VK_SHADER_STAGE_VERTEX_BIT,
             0,
             Alias(pushConstants)
         );
@@ -107,22 +103,24 @@ namespace MFA
     void PointPipeline::CreatePipeline()
     {
         // Vertex shader
-        auto cpuVertexShader = Importer::ShaderFromSPV(
-            Path::Instance->Get("engine/shaders/point_pipeline/PointPipeline.vert.spv"),
+        auto cpuVertexShader = Importer::CompileShader(
+            Path::Instance->Get("engine/shaders/point_pipeline/PointPipeline.vert.hlsl"),
             VK_SHADER_STAGE_VERTEX_BIT,
             "main"
         );
+        MFA_ASSERT(cpuVertexShader != nullptr);
         auto gpuVertexShader = RB::CreateShader(
             LogicalDevice::Instance->GetVkDevice(),
             cpuVertexShader
         );
 
         // Fragment shader
-        auto cpuFragmentShader = Importer::ShaderFromSPV(
-            Path::Instance->Get("engine/shaders/point_pipeline/PointPipeline.frag.spv"),
+        auto cpuFragmentShader = Importer::CompileShader(
+            Path::Instance->Get("engine/shaders/point_pipeline/PointPipeline.frag.hlsl"),
             VK_SHADER_STAGE_FRAGMENT_BIT,
             "main"
         );
+        MFA_ASSERT(cpuFragmentShader != nullptr);
         auto gpuFragmentShader = RB::CreateShader(
             LogicalDevice::Instance->GetVkDevice(),
             cpuFragmentShader
@@ -144,6 +142,20 @@ namespace MFA
             .format = VK_FORMAT_R32G32B32_SFLOAT,
             .offset = offsetof(Vertex, position),
             });
+        // Color
+        inputAttributeDescriptions.emplace_back(VkVertexInputAttributeDescription{
+            .location = static_cast<uint32_t>(inputAttributeDescriptions.size()),
+            .binding = 0,
+            .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+            .offset = offsetof(Vertex, color),
+            });
+        // Point size
+        inputAttributeDescriptions.emplace_back(VkVertexInputAttributeDescription{
+            .location = static_cast<uint32_t>(inputAttributeDescriptions.size()),
+            .binding = 0,
+            .format = VK_FORMAT_R32_SFLOAT,
+            .offset = offsetof(Vertex, pointSize),
+            });
 
         RB::CreateGraphicPipelineOptions pipelineOptions{};
         pipelineOptions.useStaticViewportAndScissor = false;
@@ -156,7 +168,7 @@ namespace MFA
         // pipeline layout
         std::vector<VkPushConstantRange> const pushConstantRanges{
             VkPushConstantRange {
-                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
                 .offset = 0,
                 .size = sizeof(PushConstants),
             }
@@ -173,6 +185,7 @@ namespace MFA
 
         mPipeline = RB::CreateGraphicPipeline(
             LogicalDevice::Instance->GetVkDevice(),
+            LogicalDevice::Instance->GetPipelineCache(),
             static_cast<uint8_t>(shaders.size()),
             shaders.data(),
             1,
@@ -191,10 +204,8 @@ namespace MFA
     void PointPipeline::CreateDescriptorSets()
     {
         auto const maxFramesPerFlight = LogicalDevice::Instance->GetMaxFramePerFlight();
-        mDescriptorSetGroup = RB::CreateDescriptorSet(
-            LogicalDevice::Instance->GetVkDevice(),
-            mDescriptorPool->descriptorPool,
-            mDescriptorSetLayout->descriptorSetLayout,
+        mDescriptorSetGroup = mDescriptorAllocator->Allocate(
+            *mDescriptorSetLayout,
             maxFramesPerFlight
         );
 
@@ -2,6 +2,7 @@
 
 #include "RenderTypes.hpp"
 #include "render_pass/DisplayRenderPass.hpp"
+#include "DescriptorAllocator.hpp"
 
 #include <glm/glm.hpp>
 
@@ -14,6 +15,8 @@ namespace MFA
         struct Vertex
         {
             glm::vec3 position{};
+            glm::vec4 color{};
+            float pointSize = 1.0f;
         };
 
         struct ViewProjection
@@ -24,19 +27,11 @@ namespace MFA
         struct PushConstants
         {
             glm::mat4 model;
-
-            glm::vec4 color;
-
-            float pointSize = 1.0f;
-            float placeholder0;
-            float placeholder1;
-            float placeholder2;
         };
 
         explicit PointPipeline(
             std::shared_ptr<DisplayRenderPass> displayRenderPass,
-            std::shared_ptr<RT::BufferGroup> viewProjectionBuffer,
-            int maxSets
+            std::shared_ptr<RT::BufferGroup> viewProjectionBuffer
         );
 
         ~PointPipeline();
@@ -56,7 +51,7 @@ namespace MFA
 
         void CreateDescriptorSets();
 
-        std::shared_ptr<RT::DescriptorPool> mDescriptorPool{};
+        std::unique_ptr<DescriptorAllocator> mDescriptorAllocator{};
         std::shared_ptr<RT::DescriptorSetLayoutGroup> mDescriptorSetLayout{};
         std::shared_ptr<RT::PipelineGroup> mPipeline{};
         std::shared_ptr<RT::BufferGroup> mViewProjBuffer{};
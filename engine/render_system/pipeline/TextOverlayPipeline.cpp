@@ -16,10 +16,7 @@ TextOverlayPipeline::TextOverlayPipeline(
 	: _displayRenderPass(std::move(displayRenderPass))
 	, _sampler(std::move(sampler))
 {
-	_descriptorPool = RB::CreateDescriptorPool(
-		LogicalDevice::Instance->GetVkDevice(),
-		1
-	);
+	_descriptorAllocator = std::make_unique<DescriptorAllocator>(LogicalDevice::Instance->GetVkDevice(), 1);
 	CreateDescriptorLayout();
 	CreatePipeline();
 }
@@ -30,7 +27,7 @@ TextOverlayPipeline::~TextOverlayPipeline()
 {
 	_pipeline = nullptr;
 	_descriptorLayout = nullptr;
-	_descriptorPool = nullptr;
+	_descriptorAllocator = nullptr;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -82,12 +79,7 @@ void TextOverlayPipeline::CreateDescriptorLayout()
 
 RT::DescriptorSetGroup TextOverlayPipeline::CreateDescriptorSet(RT::GpuTexture const & texture)
 {
-	auto descriptorSetGroup = RB::CreateDescriptorSet(
-		LogicalDevice::Instance->GetVkDevice(),
-		_descriptorPool->descriptorPool,
-		_descriptorLayout->descriptorSetLayout,
-		1
-	);
+	auto descriptorSetGroup = _descriptorAllocator->Allocate(*_descriptorLayout);
 
 	auto const& descriptorSet = descriptorSetGroup.descriptorSets[0];
 	MFA_ASSERT(descriptorSet != VK_NULL_HANDLE);
@@ -111,38 +103,24 @@ RT::DescriptorSetGroup TextOverlayPipeline::CreateDescriptorSet(RT::GpuTexture c
 void TextOverlayPipeline::CreatePipeline()
 {
 	// Vertex shader
-	{
-		bool success = Importer::CompileShaderToSPV(
-			Path::Instance->Get("engine/shaders/text_overlay_pipeline/TextOverlay.vert.hlsl"),
-			Path::Instance->Get("engine/shaders/text_overlay_pipeline/TextOverlay.vert.spv"),
-			"vert"
-		);
-		MFA_ASSERT(success == true);
-	}
-	auto cpuVertexShader = Importer::ShaderFromSPV(
-		Path::Instance->Get("engine/shaders/text_overlay_pipeline/TextOverlay.vert.spv"),
+	auto cpuVertexShader = Importer::CompileShader(
+		Path::Instance->Get("engine/shaders/text_overlay_pipeline/TextOverlay.vert.hlsl"),
 		VK_SHADER_STAGE_VERTEX_BIT,
 		"main"
 	);
+	MFA_ASSERT(cpuVertexShader != nullptr);
 	auto gpuVertexShader = RB::CreateShader(
 		LogicalDevice::Instance->GetVkDevice(),
 		cpuVertexShader
 	);
 
 	// Fragment shader
-	{
-		bool success = Importer::CompileShaderToSPV(
-			Path::Instance->Get("engine/shaders/text_overlay_pipeline/TextOverlay.frag.hlsl"),
-			Path::Instance->Get("engine/shaders/text_overlay_pipeline/TextOverlay.frag.spv"),
-			"frag"
-		);
-		MFA_ASSERT(success == true);
-	}
-	auto cpuFragmentShader = Importer::ShaderFromSPV(
-		Path::Instance->Get("engine/shaders/text_overlay_pipeline/TextOverlay.frag.spv"),
+	auto cpuFragmentShader = Importer::CompileShader(
+		Path::Instance->Get("engine/shaders/text_overlay_pipeline/TextOverlay.frag.hlsl"),
 		VK_SHADER_STAGE_FRAGMENT_BIT,
 		"main"
 	);
+	MFA_ASSERT(cpuFragmentShader != nullptr);
 	auto gpuFragmentShader = RB::CreateShader(
 		LogicalDevice::Instance->GetVkDevice(),
 		cpuFragmentShader
@@ -205,6 +183,7 @@ void TextOverlayPipeline::CreatePipeline()
 
 	_pipeline = RB::CreateGraphicPipeline(
 		LogicalDevice::Instance->GetVkDevice(),
+		LogicalDevice::Instance->GetPipelineCache(),
 		static_cast<uint8_t>(shaders.size()),
 		shaders.data(),
 		1,
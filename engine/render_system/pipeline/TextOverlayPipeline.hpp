@@ -1,6 +1,7 @@
 #pragma once
 
 #include "render_pass/DisplayRenderPass.hpp"
+#include "DescriptorAllocator.hpp"
 
 #include <glm/glm.hpp>
 
@@ -41,7 +42,7 @@ namespace MFA
 
         std::shared_ptr<MFA::RT::SamplerGroup> _sampler{};
 
-        std::shared_ptr<MFA::RT::DescriptorPool> _descriptorPool{};
+        std::unique_ptr<MFA::DescriptorAllocator> _descriptorAllocator{};
 
         std::shared_ptr<MFA::RT::DescriptorSetLayoutGroup> _descriptorLayout{};
 
@@ -1,5 +1,6 @@
 #include "DisplayRenderPass.hpp"
 
+#include "BedrockFrameArena.hpp"
 #include "LogicalDevice.hpp"
 
 namespace MFA
@@ -40,7 +41,11 @@ namespace MFA
 
     //-------------------------------------------------------------------------------------------------
 
-    void DisplayRenderPass::Begin(RT::CommandRecordState & recordState, glm::vec4 backgroundColor)
+    void DisplayRenderPass::Begin(
+        RT::CommandRecordState & recordState,
+        glm::vec4 backgroundColor,
+        VkSubpassContents const subpassContents
+    )
     {
         ClearDepthBufferIfNeeded(recordState);
 
@@ -61,13 +66,84 @@ namespace MFA
         clearValues[1].color = VkClearColorValue{ .float32 = {backgroundColor.x, backgroundColor.y, backgroundColor.z, backgroundColor.w } };
         clearValues[2].depthStencil = { .depth = 1.0f, .stencil = 0 };
 
+        auto & gpuProfiler = LogicalDevice::Instance->GetGpuProfiler();
+        gpuProfiler.BeginStatistics(recordState);
+        mProfilerScope = gpuProfiler.BeginScope(recordState, "Display pass");
+
         RB::BeginRenderPass(
             recordState.commandBuffer,
             mRenderPass->vkRenderPass,
             GetFrameBuffer(recordState),
             swapChainExtend,
             static_cast<uint32_t>(clearValues.size()),
-            clearValues.data()
+            clearValues.data(),
+            subpassContents
+        );
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    RT::CommandRecordState DisplayRenderPass::BeginSecondary(RT::CommandRecordState const & primaryRecordState)
+    {
+        MFA_ASSERT(primaryRecordState.renderPass == this);
+
+        RT::CommandRecordState recordState{
+            .imageIndex = primaryRecordState.imageIndex,
+            .frameIndex = primaryRecordState.frameIndex,
+            .isValid = primaryRecordState.isValid,
+            .commandBufferType = RT::CommandBufferType::Graphic,
+            .commandBuffer = LogicalDevice::Instance->AcquireSecondaryCommandBuffer(primaryRecordState),
+            .pipeline = nullptr,
+            .renderPass = this,
+            .swapChain = primaryRecordState.swapChain,
+        };
+
+        RB::BeginSecondaryCommandBuffer(
+            recordState.commandBuffer,
+            mRenderPass->vkRenderPass,
+            0,
+            GetFrameBuffer(recordState),
+            LogicalDevice::Instance->GetGpuProfiler().GetInheritedStatistics()
+        );
+
+        // Dynamic states are not inherited from the primary command buffer
+        auto const surfaceCapabilities = LogicalDevice::Instance->GetSurfaceCapabilities();
+        RB::AssignViewportAndScissorToCommandBuffer(surfaceCapabilities.currentExtent, recordState.commandBuffer);
+
+        return recordState;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void DisplayRenderPass::EndSecondary(RT::CommandRecordState & secondaryRecordState)
+    {
+        MFA_ASSERT(secondaryRecordState.commandBuffer != nullptr);
+        RB::EndCommandBuffer(secondaryRecordState.commandBuffer);
+    }
+
+    //-------------------------------------------------------------------------------------------------
+
+    void DisplayRenderPass::ExecuteSecondaries(
+        RT::CommandRecordState & primaryRecordState,
+        std::span<RT::CommandRecordState const> const secondaryRecordStates
+    )
+    {
+        MFA_ASSERT(primaryRecordState.renderPass == this);
+
+        auto commandBuffers = FrameArena::Instance().Vector<VkCommandBuffer>(secondaryRecordStates.size());
+        for (auto const & secondaryRecordState : secondaryRecordStates)
+        {
+            commandBuffers.emplace_back(secondaryRecordState.commandBuffer);
+        }
+        if (commandBuffers.empty())
+        {
+            return;
+        }
+
+        RB::ExecuteCommandBuffer(
+            primaryRecordState.commandBuffer,
+            static_cast<uint32_t>(commandBuffers.size()),
+            commandBuffers.data()
         );
     }
 
@@ -84,6 +160,11 @@ namespace MFA
 
         RB::EndRenderPass(recordState.commandBuffer);
 
+        auto & gpuProfiler = LogicalDevice::Instance->GetGpuProfiler();
+        gpuProfiler.EndScope(recordState, mProfilerScope);
+        gpuProfiler.EndStatistics(recordState);
+        mProfilerScope = GpuProfiler::InvalidScope;
+
         auto const presentQueueFamily = LogicalDevice::Instance->GetPresentQueueFamily();
         auto const graphicQueueFamily = LogicalDevice::Instance->GetGraphicQueueFamily();
 
@@ -2,12 +2,14 @@
 
 #include "render_resource/DepthRenderResource.hpp"
 #include "RenderPass.hpp"
+#include "GpuProfiler.hpp"
 #include "render_resource/MSAA_RenderResource.hpp"
 #include "render_resource/SwapChainRenderResource.hpp"
 
 #include <glm/glm.hpp>
 
 #include <memory>
+#include <span>
 
 namespace MFA
 {
@@ -31,14 +33,35 @@ namespace MFA
         [[nodiscard]]
         VkRenderPass GetVkRenderPass() override;
 
-        void Begin(RT::CommandRecordState & recordState)
+        // With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS every draw has to be recorded through BeginSecondary
+        void Begin(
+            RT::CommandRecordState & recordState,
+            VkSubpassContents subpassContents = VK_SUBPASS_CONTENTS_INLINE
+        )
         {
-            Begin(recordState, glm::vec4{0.1f, 0.1f, 0.1f, 1.0f});
+            Begin(recordState, glm::vec4{0.1f, 0.1f, 0.1f, 1.0f}, subpassContents);
         }
 
-        void Begin(RT::CommandRecordState & recordState, glm::vec4 backgroundColor);
+        void Begin(
+            RT::CommandRecordState & recordState,
+            glm::vec4 backgroundColor,
+            VkSubpassContents subpassContents = VK_SUBPASS_CONTENTS_INLINE
+        );
 
         void End(RT::CommandRecordState & recordState);
+
+        // Returns a record state of a secondary command buffer that continues the active render pass.
+        // It can be recorded from any thread while the primary one waits for it.
+        [[nodiscard]]
+        RT::CommandRecordState BeginSecondary(RT::CommandRecordState const & primaryRecordState);
+
+        void EndSecondary(RT::CommandRecordState & secondaryRecordState);
+
+        // Executes the secondary command buffers in the given order
+        void ExecuteSecondaries(
+            RT::CommandRecordState & primaryRecordState,
+            std::span<RT::CommandRecordState const> secondaryRecordStates
+        );
         
         void NotifyDepthImageLayoutIsSet();
         
@@ -69,6 +92,8 @@ namespace MFA
 
         bool mIsDepthImageUndefined = true;
 
+        GpuProfiler::ScopeId mProfilerScope = GpuProfiler::InvalidScope;
+
         std::shared_ptr<SwapChainRenderResource> mSwapChain{};
         std::shared_ptr<DepthRenderResource> mDepth {};
         std::shared_ptr<MSSAA_RenderResource> mMSAA {};
@@ -23,7 +23,7 @@ namespace MFA
         auto const vertexBuffer = RB::CreateVertexBufferGroup(
             device->GetVkDevice(), 
             device->GetPhysicalDevice(), 
-            maxCharCount * sizeof(TextOverlayPipeline::Vertex),
+            maxCharCount * 4 * sizeof(TextOverlayPipeline::Vertex),
             LogicalDevice::Instance->GetMaxFramePerFlight()
         );
 
@@ -61,7 +61,12 @@ namespace MFA
 
         int letterRange = inOutData.letterRange.empty() == false ? inOutData.letterRange.back() : 0;
         
-        auto * mapped = &reinterpret_cast<TextOverlayPipeline::Vertex*>(inOutData.vertexData->Data())[letterRange * 4];
+        // Only the letters of this text are uploaded
+        auto const maxLetterCount = std::max(inOutData.maxLetterCount - letterRange, 0);
+        auto * mapped = reinterpret_cast<TextOverlayPipeline::Vertex*>(inOutData.vertexData->Data(
+            letterRange * 4 * sizeof(TextOverlayPipeline::Vertex),
+            std::min(static_cast<int>(text.size()), maxLetterCount) * 4 * sizeof(TextOverlayPipeline::Vertex)
+        ));
         
         const float charW = 1.5f * params.scale / windowWidth;
         const float charH = 1.5f * params.scale / windowHeight;
@@ -179,8 +184,6 @@ namespace MFA
 
     void ConsolasFontRenderer::CreateFontTextureBuffer()
     {
-        auto const device = LogicalDevice::Instance;
-
         auto const fontWidth = STB_FONT_consolas_24_latin1_BITMAP_WIDTH;
         auto const fontHeight = STB_FONT_consolas_24_latin1_BITMAP_HEIGHT;
 
@@ -204,26 +207,9 @@ namespace MFA
             sizeof(font24pixels)
         );
 
-        auto commandBuffer = RB::BeginSingleTimeCommand(
-            device->GetVkDevice(), 
-            device->GetGraphicCommandPool()
-        );
-        
-        auto [fontTexture, stageBuffer] = RB::CreateTexture(
-            cpuTexture,         
-            device->GetVkDevice(),
-            device->GetPhysicalDevice(),
-            commandBuffer
-        );
+        auto [fontTexture, uploadToken] = UploadQueue::Instance->CreateTexture(cpuTexture);
         MFA_ASSERT(fontTexture != nullptr);
         _fontTexture = std::move(fontTexture);
-        
-        RB::EndAndSubmitSingleTimeCommand(
-            device->GetVkDevice(), 
-            device->GetGraphicCommandPool(),
-            device->GetGraphicQueue(),
-            commandBuffer
-        );
     }
     
     //------------------------------------------------------------------
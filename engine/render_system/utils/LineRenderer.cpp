@@ -5,145 +5,102 @@
 #include "BedrockMath.hpp"
 #include "BufferTracker.hpp"
 
+#include <algorithm>
+
 namespace MFA
 {
 
 	//-------------------------------------------------------------------------------------------------
 
-	LineRenderer::LineRenderer(std::shared_ptr<MFA::LinePipeline> linePipeline)
+	LineRenderer::LineRenderer(
+		std::shared_ptr<MFA::LinePipeline> linePipeline,
+		int const lineCapacity
+	)
 		: _linePipeline(std::move(linePipeline))
 	{
 		using namespace MFA;
 
-		{
-			auto const vector = _endPos - _startPos;
-			_length = glm::length(vector);
-			_direction = vector / _length;
-			_center = (_endPos + _startPos) * 0.5f;
-		}
-
-		std::vector<glm::vec3> vertices{
-			_startPos,
-			_endPos,
-		};
-		std::vector<uint16_t> indices{ 0, 1 };
-
-		Alias const verticesAlias{ vertices.data(), vertices.size() };
-		Alias const indicesAlias{ indices.data(), indices.size() };
-
 		auto* device = LogicalDevice::Instance;
 
-		auto commandBuffer = RB::BeginSingleTimeCommand(
-			device->GetVkDevice(),
-			device->GetGraphicCommandPool()
-		);
-		auto vertexStageBuffer = RB::CreateStageBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			verticesAlias.Len(),
-			1
-		);
-		_vertexBuffer = RB::CreateVertexBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			commandBuffer,
-			*vertexStageBuffer->buffers[0],
-			verticesAlias
-		);
-		auto indexStageBuffer = RB::CreateStageBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			indicesAlias.Len(),
-			1
-		);
-		_indexBuffer = RB::CreateIndexBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			commandBuffer,
-			*indexStageBuffer->buffers[0],
-			indicesAlias
-		);
-		RB::EndAndSubmitSingleTimeCommand(
-			device->GetVkDevice(),
-			device->GetGraphicCommandPool(),
-			device->GetGraphicQueue(),
-			commandBuffer
-		);
+		_vertices.reserve(lineCapacity * 2);
 
-		_indexCount = indices.size();
+		_vertexBuffers.resize(device->GetMaxFramePerFlight());
+		for (auto& vertexBuffer : _vertexBuffers)
+		{
+			vertexBuffer = RB::CreateBuffer(
+				device->GetVkDevice(),
+				device->GetPhysicalDevice(),
+				lineCapacity * 2 * sizeof(LinePipeline::Vertex),
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			);
+		}
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	void LineRenderer::Draw(
-		MFA::RT::CommandRecordState& recordState,
-		glm::vec3 const& from0,
-		glm::vec3 const& to0,
+	void LineRenderer::AddLine(
+		glm::vec3 const& from,
+		glm::vec3 const& to,
 		glm::vec4 const& color
-	) const
+	)
 	{
-		using namespace MFA;
+		_vertices.emplace_back(LinePipeline::Vertex{ .position = from, .color = color });
+		_vertices.emplace_back(LinePipeline::Vertex{ .position = to, .color = color });
+	}
 
-		_linePipeline->BindPipeline(recordState);
+	//-------------------------------------------------------------------------------------------------
 
-		auto from = from0;
-		auto to = to0;
+	void LineRenderer::Render(MFA::RT::CommandRecordState& recordState)
+	{
+		using namespace MFA;
 
-		if (to.x < from.x)
+		if (_vertices.empty() == true)
 		{
-			auto temp = from;
-			from = to;
-			to = temp;
+			return;
 		}
 
-		glm::vec3 const targetVector = to - from;
-		float const targetLength = glm::length(targetVector);
+		auto const device = LogicalDevice::Instance->GetVkDevice();
+		auto const dataSize = _vertices.size() * sizeof(LinePipeline::Vertex);
 
-		if (targetLength > 0.0f)
+		// The previous use of this frame's buffer has finished on the gpu, so it can be replaced right away
+		auto& vertexBuffer = _vertexBuffers[recordState.frameIndex];
+		if (vertexBuffer->size < dataSize)
 		{
-			float const scale = targetLength / _length;
-			glm::vec3 const targetCenter = (from + to) * 0.5f;
-
-			auto const targetDirection = targetVector / targetLength;
-
-			auto const rotation = Math::FindRotation(_direction, targetDirection);
-			auto const rotationMat = glm::toMat4(rotation);
-			auto const translateMat = Math::Translate(targetCenter - _center);
-			auto const scaleMat = Math::Scale(glm::vec3{ scale, 1.0f, 1.0f });
-
-			glm::mat4 matrix = translateMat
-				* rotationMat
-				* scaleMat;
-
-			_linePipeline->SetPushConstants(
-				recordState,
-				LinePipeline::PushConstants{
-					.model = matrix,
-					.color = color
-				}
+			vertexBuffer = RB::CreateBuffer(
+				device,
+				LogicalDevice::Instance->GetPhysicalDevice(),
+				std::max<VkDeviceSize>(dataSize, vertexBuffer->size * 2),
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
 			);
+		}
 
-			RB::BindIndexBuffer(
-				recordState,
-				*_indexBuffer,
-				0,
-				VK_INDEX_TYPE_UINT16
-			);
+		{
+			void* mappedMemory = nullptr;
+			RB::MapHostVisibleMemory(device, *vertexBuffer, 0, dataSize, &mappedMemory);
+			std::memcpy(mappedMemory, _vertices.data(), dataSize);
+			RB::UnMapHostVisibleMemory(device, *vertexBuffer, 0, dataSize);
+		}
 
-			RB::BindVertexBuffer(
-				recordState,
-				*_vertexBuffer,
-				0,
-				0
-			);
+		_linePipeline->BindPipeline(recordState);
 
-			RB::DrawIndexed(
-				recordState,
-				_indexCount
-			);
-		}
+		RB::BindVertexBuffer(recordState, *vertexBuffer, 0, 0);
+
+		// Vertices are already in world space and carry their own color
+		_linePipeline->SetPushConstants(
+			recordState,
+			LinePipeline::PushConstants{
+				.model = glm::identity<glm::mat4>()
+			}
+		);
+
+		RB::Draw(recordState, static_cast<uint32_t>(_vertices.size()), 1, 0, 0);
+
+		// Keeps the capacity for the next frame
+		_vertices.clear();
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-}
\ No newline at end of file
+}
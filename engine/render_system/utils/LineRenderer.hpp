@@ -6,28 +6,32 @@
 namespace MFA
 {
 
+    // Immediate mode line batch. Lines are collected during the frame and all of them are recorded by a single draw.
     class LineRenderer
     {
     public:
 
-        explicit LineRenderer(std::shared_ptr<MFA::LinePipeline> linePipeline);
+        // The vertex buffer of a frame grows when the lines of that frame do not fit in lineCapacity
+        explicit LineRenderer(
+            std::shared_ptr<MFA::LinePipeline> linePipeline,
+            int lineCapacity = 16384
+        );
 
-        void Draw(
-            MFA::RT::CommandRecordState& recordState,
+        void AddLine(
             glm::vec3 const& from,
             glm::vec3 const& to,
             glm::vec4 const& color = { 0.0f, 1.0f, 0.0f, 1.0f }
-        ) const;
+        );
+
+        // Writes the lines into the vertex buffer of the active frame and draws them. Clears the batch afterward.
+        void Render(MFA::RT::CommandRecordState& recordState);
+
+    private:
 
         std::shared_ptr<MFA::LinePipeline> _linePipeline{};
-        std::shared_ptr<MFA::RT::BufferAndMemory> _vertexBuffer{};
-        std::shared_ptr<MFA::RT::BufferAndMemory> _indexBuffer{};
-        glm::vec3 _startPos{ -0.5f, 0.0f, 0.0f };
-        glm::vec3 _endPos{ 0.5f, 0.0f, 0.0f };
-        glm::vec3 _direction{};
-        glm::vec3 _center{};
-        float _length{};
-        int _indexCount{};
+        // One buffer per frame in flight, so we never write into the vertices that the gpu is still reading
+        std::vector<std::shared_ptr<MFA::RT::BufferAndMemory>> _vertexBuffers{};
+        std::vector<LinePipeline::Vertex> _vertices{};
     };
 
-}
\ No newline at end of file
+}
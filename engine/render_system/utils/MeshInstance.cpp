@@ -1,5 +1,7 @@
 #include "MeshInstance.hpp"
 
+#include "BedrockAssert.hpp"
+#include "BedrockLog.hpp"
 #include "Transform.hpp"
 #include "utils/MeshRenderer.hpp"
 
@@ -8,45 +10,50 @@ namespace MFA
 
 	//-------------------------------------------------------------------------------------------------
 
-	MeshInstance::MeshInstance() = default;
+	MeshInstance::MeshInstance(MeshRenderer const& meshRenderer, Transform * transform)
+		: _meshRenderer(&meshRenderer)
+		, _transform(transform)
+	{}
 
 	//-------------------------------------------------------------------------------------------------
 
-	MeshInstance::MeshInstance(MeshRenderer const& meshRenderer)
+	int MeshInstance::FindNode(std::string const& name) const
 	{
-		auto const & nodes = meshRenderer.GetNodes();
-		_nodes = nodes;
-		for (int i = 0; i < _nodes.size(); ++i)
-		{
-			auto const & otherT = nodes[i].transform;
-			Transform myT{};
-			myT.SetLocalPosition(otherT.GetLocalPosition());
-			myT.SetLocalRotation(otherT.GetLocalRotation());
-			myT.SetLocalScale(otherT.GetLocalScale());
-			_nodes[i].transform = myT;
-		}
-		for (int i = 0; i < nodes.size(); ++i)
+		return _meshRenderer->FindFlatNode(name);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void MeshInstance::SetNodeLocalTransform(int const flatNodeIdx, glm::mat4 const& localTransform)
+	{
+		MFA_ASSERT(flatNodeIdx >= 0 && flatNodeIdx < static_cast<int>(_meshRenderer->GetFlatNodes().size()));
+		for (int i = 0; i < _localTransformOverrideCount; ++i)
 		{
-			if (nodes[i].HasParent() == true)
-			{
-				_nodes[i].transform.SetParent(&_nodes[nodes[i].parent].transform);
-			}
-			else
+			auto & [nodeIdx, transform] = _localTransformOverrides[i];
+			if (nodeIdx == flatNodeIdx)
 			{
-				_nodes[i].transform.SetParent(&_transform);
+				transform = localTransform;
+				return;
 			}
 		}
+		if (_localTransformOverrideCount >= MaxLocalTransformOverrides)
+		{
+			MFA_LOG_WARN("Mesh instance can override at most %d nodes", MaxLocalTransformOverrides);
+			return;
+		}
+		_localTransformOverrides[_localTransformOverrideCount++] = {flatNodeIdx, localTransform};
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	MeshInstance::Node* MeshInstance::FindNode(std::string const& name)
+	glm::mat4 const* MeshInstance::FindNodeLocalTransform(int const flatNodeIdx) const
 	{
-		for (auto & node : _nodes)
+		for (int i = 0; i < _localTransformOverrideCount; ++i)
 		{
-			if (node.name == name)
+			auto const & [nodeIdx, transform] = _localTransformOverrides[i];
+			if (nodeIdx == flatNodeIdx)
 			{
-				return &node;
+				return &transform;
 			}
 		}
 		return nullptr;
@@ -54,23 +61,38 @@ namespace MFA
 
 	//-------------------------------------------------------------------------------------------------
 
-	std::vector<Asset::GLTF::Node> & MeshInstance::GetNodes()
+	glm::mat4 MeshInstance::NodeGlobalTransform(int const flatNodeIdx)
 	{
-		return _nodes;
+		auto const & flatNodes = _meshRenderer->GetFlatNodes();
+		auto const & localTransforms = _meshRenderer->GetFlatLocalTransforms();
+		MFA_ASSERT(flatNodeIdx >= 0 && flatNodeIdx < static_cast<int>(flatNodes.size()));
+
+		glm::mat4 result = glm::identity<glm::mat4>();
+		for (int nodeIdx = flatNodeIdx; nodeIdx >= 0; nodeIdx = flatNodes[nodeIdx].parentIndex)
+		{
+			auto const * localOverride = FindNodeLocalTransform(nodeIdx);
+			result = (localOverride != nullptr ? *localOverride : localTransforms[nodeIdx]) * result;
+		}
+		if (_transform != nullptr)
+		{
+			_transform->UpdateNow();
+		}
+		return GetTransform() * result;
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	Transform & MeshInstance::GetTransform()
+	glm::mat4 const & MeshInstance::GetTransform() const
 	{
-		return _transform;
+		return _transform != nullptr ? _transform->GlobalTransform() : _rootTransform;
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	void MeshInstance::SetTransform(const Transform& transform)
+	void MeshInstance::SetTransform(glm::mat4 const& transform)
 	{
-		_transform = transform;
+		MFA_ASSERT(_transform == nullptr);
+		_rootTransform = transform;
 	}
 
 	//-------------------------------------------------------------------------------------------------
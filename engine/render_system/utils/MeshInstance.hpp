@@ -3,37 +3,58 @@
 #include "AssetGLTF_Mesh.hpp"
 #include "Transform.hpp"
 
+#include <array>
+#include <utility>
+
 namespace MFA
 {
 
     class MeshRenderer;
 
+    // Node hierarchy is shared with the renderer and is immutable. Instances only store the local transforms that are overridden.
+    // Creating an instance does not allocate and does not register a TransformSystem node.
     class MeshInstance
     {
     public:
-        // TODO: Handle caching for parent and child
-        using Node = Asset::GLTF::Node;
 
-        explicit MeshInstance();
+        static constexpr int MaxLocalTransformOverrides = 4;
+
+        // Moving instances pass their own transform, the caller keeps it alive for the lifetime of the instance.
+        // Static instances pass nullptr and set their root matrix with SetTransform.
+        explicit MeshInstance(MeshRenderer const & meshRenderer, Transform * transform = nullptr);
+
+        // Returns the flat node index or -1 if the node does not exist
+        [[nodiscard]]
+        int FindNode(std::string const & name) const;
 
-        explicit MeshInstance(MeshRenderer const & meshRenderer);
+        // At most MaxLocalTransformOverrides nodes can be overridden
+        void SetNodeLocalTransform(int flatNodeIdx, glm::mat4 const & localTransform);
 
+        // Returns nullptr if the node uses the renderer's local transform
         [[nodiscard]]
-        Node* FindNode(std::string const & name);
+        glm::mat4 const * FindNodeLocalTransform(int flatNodeIdx) const;
 
+        // Walks up the hierarchy, use it for occasional gameplay queries. Rendering computes all nodes in one pass.
         [[nodiscard]]
-        std::vector<Asset::GLTF::Node> & GetNodes();
+        glm::mat4 NodeGlobalTransform(int flatNodeIdx);
 
+        // Root matrix of the instance, safe to call from the render jobs
         [[nodiscard]]
-        Transform & GetTransform();
+        glm::mat4 const & GetTransform() const;
 
-        void SetTransform(const Transform& transform);
+        // Only for instances that were created without a transform
+        void SetTransform(glm::mat4 const & transform);
 
     private:
 
-        Transform _transform{};
+        MeshRenderer const * _meshRenderer = nullptr;
+
+        Transform * _transform = nullptr;
+
+        glm::mat4 _rootTransform = glm::identity<glm::mat4>();
+
+        std::array<std::pair<int, glm::mat4>, MaxLocalTransformOverrides> _localTransformOverrides{};
+        int _localTransformOverrideCount = 0;
 
-        std::vector<Node> _nodes{};
-    
     };
 }
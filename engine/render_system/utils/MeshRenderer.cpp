@@ -1,11 +1,21 @@
 #include "MeshRenderer.hpp"
 
+#include "BedrockAssert.hpp"
 #include "LogicalDevice.hpp"
 #include "MeshInstance.hpp"
 
+#include <algorithm>
+
 namespace MFA
 {
 
+	// Scratch memory for global transforms, laid out as [flatNodeIdx * instanceCount + instanceIdx].
+	// It is per thread so the same renderer can record from multiple jobs at once.
+	static thread_local std::vector<glm::mat4> GlobalTransforms{};
+
+	// Used by Render when the caller does not provide a queue of its own
+	static thread_local RenderQueue RenderSingleQueue{};
+
 	//-------------------------------------------------------------------------------------------------
 
 	MeshRenderer::MeshRenderer(
@@ -27,110 +37,210 @@ namespace MFA
 			model->mesh->CenterMesh();
 		}
 
-		const auto device = LogicalDevice::Instance;
-
-		const auto commandBuffer = RB::BeginSingleTimeCommand(
-			device->GetVkDevice(),
-			device->GetGraphicCommandPool()
-		);
-
-		auto vertexStageBuffer = GenerateVertexBuffer(commandBuffer, *model);
+		GenerateVertexBuffer(*model);
 
-		auto indexStageBuffer = GenerateIndexBuffer(commandBuffer, *model);
+		GenerateIndexBuffer(*model);
 
-		auto textureStageBuffer = GenerateTextures(commandBuffer, *model);
+		GenerateTextures(*model);
 
-		auto materialStageBuffer = CreateMaterials(commandBuffer);
+		CreateMaterials();
 
-		CreateDescriptorSets();
+		CreateFlatNodes();
 
 		_vertexCount = model->mesh->GetVertexCount();
 		_vertices = model->mesh->GetVertexData();
 
 		_indexCount = model->mesh->GetIndexCount();
 		_indices = model->mesh->GetIndexData();
-		
-		RB::EndAndSubmitSingleTimeCommand(
-			device->GetVkDevice(),
-			device->GetGraphicCommandPool(),
-			device->GetGraphicQueue(),
-			commandBuffer
-		);
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	void MeshRenderer::Render(RT::CommandRecordState& recordState, std::vector<glm::mat4> const& models)
+	UploadQueue::Token MeshRenderer::GetUploadToken() const noexcept
 	{
-		_pipeline->BindPipeline(recordState);
+		return _uploadToken;
+	}
 
-		RB::BindIndexBuffer(
-			recordState,
-			*_indicesBuffer,
-			0,
-			VK_INDEX_TYPE_UINT32
-		);
+	//-------------------------------------------------------------------------------------------------
 
-		RB::BindVertexBuffer(
-			recordState,
-			*_verticesBuffer,
-			0,
-			0
-		);
-		for (auto const& model : models)
+	void MeshRenderer::Render(RT::CommandRecordState& recordState, std::span<glm::mat4 const> const models) const
+	{
+		RenderSingleQueue.Reset(glm::mat4{1.0f});
+		Submit(RenderSingleQueue, models);
+		RenderSingleQueue.Sort();
+		RenderSingleQueue.Flush(recordState);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void MeshRenderer::Render(RT::CommandRecordState& recordState, std::span<MeshInstance * const> const instances) const
+	{
+		RenderSingleQueue.Reset(glm::mat4{1.0f});
+		Submit(RenderSingleQueue, instances);
+		RenderSingleQueue.Sort();
+		RenderSingleQueue.Flush(recordState);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void MeshRenderer::Submit(RenderQueue& renderQueue, std::span<glm::mat4 const> const models) const
+	{
+		auto const instanceCount = static_cast<int>(models.size());
+		if (instanceCount == 0)
+		{
+			return;
+		}
+
+		auto const nodeCount = static_cast<int>(_flatNodes.size());
+		GlobalTransforms.resize(nodeCount * instanceCount);
+
+		// Parents are always computed before their children so a single linear pass is enough
+		for (int i = 0; i < nodeCount; ++i)
 		{
-			auto const & rootNodes = _meshData->rootNodes;
-			auto & nodes = _meshData->nodes;
-			for (auto & rootNode : rootNodes)
+			auto const & flatNode = _flatNodes[i];
+			auto const & localTransform = _flatLocalTransforms[i];
+			auto * globalTransforms = &GlobalTransforms[i * instanceCount];
+			if (flatNode.parentIndex < 0)
 			{
-				auto & node = nodes[rootNode];
-				DrawNode(
-					recordState, 
-					node, 
-					model
-				);
+				for (int j = 0; j < instanceCount; ++j)
+				{
+					globalTransforms[j] = models[j] * localTransform;
+				}
+			}
+			else
+			{
+				auto const * parentTransforms = &GlobalTransforms[flatNode.parentIndex * instanceCount];
+				for (int j = 0; j < instanceCount; ++j)
+				{
+					globalTransforms[j] = parentTransforms[j] * localTransform;
+				}
 			}
 		}
+
+		SubmitFlatNodes(renderQueue, GlobalTransforms, instanceCount);
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	void MeshRenderer::Render(RT::CommandRecordState& recordState, std::vector<MeshInstance*> const& instances) const
+	void MeshRenderer::Submit(RenderQueue& renderQueue, std::span<MeshInstance * const> const instances) const
 	{
-		_pipeline->BindPipeline(recordState);
+		auto const instanceCount = static_cast<int>(instances.size());
+		if (instanceCount == 0)
+		{
+			return;
+		}
 
-		RB::BindIndexBuffer(
-			recordState,
-			*_indicesBuffer,
-			0,
-			VK_INDEX_TYPE_UINT32
-		);
+		auto const nodeCount = static_cast<int>(_flatNodes.size());
+		GlobalTransforms.resize(nodeCount * instanceCount);
 
-		RB::BindVertexBuffer(
-			recordState,
-			*_verticesBuffer,
-			0,
-			0
-		);
-		for (auto & instance : instances)
+		for (int i = 0; i < nodeCount; ++i)
 		{
-			auto const& rootNodes = _meshData->rootNodes;
-			auto & nodes = instance->GetNodes();
-			for (auto& rootNode : rootNodes)
+			auto const & flatNode = _flatNodes[i];
+			auto const & localTransform = _flatLocalTransforms[i];
+			auto * globalTransforms = &GlobalTransforms[i * instanceCount];
+			if (flatNode.parentIndex < 0)
 			{
-				auto& node = nodes[rootNode];
-				DrawNode(
-					recordState,
-					node,
-					nodes
-				);
+				for (int j = 0; j < instanceCount; ++j)
+				{
+					auto * instance = instances[j];
+					auto const * localOverride = instance->FindNodeLocalTransform(i);
+					globalTransforms[j] = instance->GetTransform() *
+						(localOverride != nullptr ? *localOverride : localTransform);
+				}
+			}
+			else
+			{
+				auto const * parentTransforms = &GlobalTransforms[flatNode.parentIndex * instanceCount];
+				for (int j = 0; j < instanceCount; ++j)
+				{
+					auto const * localOverride = instances[j]->FindNodeLocalTransform(i);
+					globalTransforms[j] = parentTransforms[j] *
+						(localOverride != nullptr ? *localOverride : localTransform);
+				}
 			}
 		}
+
+		SubmitFlatNodes(renderQueue, GlobalTransforms, instanceCount);
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	std::shared_ptr<RT::BufferGroup> MeshRenderer::GenerateVertexBuffer(VkCommandBuffer cb, AS::GLTF::Model const& model)
+	void MeshRenderer::SubmitFlatNodes(
+		RenderQueue& renderQueue,
+		std::vector<glm::mat4> const& globalTransforms,
+		int const instanceCount
+	) const
+	{
+		auto const nodeCount = static_cast<int>(_flatNodes.size());
+		for (int j = 0; j < instanceCount; ++j)
+		{
+			for (int i = 0; i < nodeCount; ++i)
+			{
+				auto const subMeshIndex = _flatNodes[i].subMeshIndex;
+				if (subMeshIndex < 0)
+				{
+					continue;
+				}
+
+				auto const & primitives = _meshData->subMeshes[subMeshIndex].primitives;
+				auto const & materialIndices = _materialIndices[subMeshIndex];
+				for (int k = 0; k < static_cast<int>(primitives.size()); ++k)
+				{
+					renderQueue.Submit(RenderQueue::DrawPacket{
+						.pipeline = _pipeline.get(),
+						.materialIndex = materialIndices[k],
+						.vertexBuffer = _verticesBuffer.get(),
+						.indexBuffer = _indicesBuffer.get(),
+						.indexCount = primitives[k].indicesCount,
+						.firstIndex = primitives[k].indicesStartingIndex,
+						.model = globalTransforms[i * instanceCount + j]
+					});
+				}
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void MeshRenderer::CreateFlatNodes()
+	{
+		auto & nodes = _meshData->nodes;
+
+		_flatNodes.clear();
+		_flatLocalTransforms.clear();
+
+		for (auto const rootNode : _meshData->rootNodes)
+		{
+			_flatNodes.emplace_back(FlatNode{
+				.nodeIndex = static_cast<int>(rootNode),
+				.subMeshIndex = nodes[rootNode].subMeshIndex,
+				.parentIndex = -1
+			});
+		}
+
+		// Breadth first, the list grows while we iterate over it
+		for (int i = 0; i < static_cast<int>(_flatNodes.size()); ++i)
+		{
+			auto const nodeIndex = _flatNodes[i].nodeIndex;
+			for (auto const child : nodes[nodeIndex].children)
+			{
+				_flatNodes.emplace_back(FlatNode{
+					.nodeIndex = child,
+					.subMeshIndex = nodes[child].subMeshIndex,
+					.parentIndex = i
+				});
+			}
+		}
+
+		for (auto const & flatNode : _flatNodes)
+		{
+			_flatLocalTransforms.emplace_back(nodes[flatNode.nodeIndex].transform.LocalTransform());
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void MeshRenderer::GenerateVertexBuffer(AS::GLTF::Model const& model)
 	{
 		auto& mesh = model.mesh;
 
@@ -152,246 +262,80 @@ namespace MFA
 
 		auto alias = Alias(cpuVertices.data(), cpuVertices.size());
 
-		auto* device = LogicalDevice::Instance;
-
-		auto const stageBuffer = RB::CreateStageBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			alias.Len(),
-			1
+		auto [vertexBuffer, token] = UploadQueue::Instance->CreateBuffer(
+			alias,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
 		);
-
-		_verticesBuffer = RB::CreateVertexBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			cb,
-			*stageBuffer->buffers[0],
-			alias
-		);
-
-		return stageBuffer;
+		_verticesBuffer = vertexBuffer;
+		_uploadToken = (std::max)(_uploadToken, token);
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	std::shared_ptr<RT::BufferGroup> MeshRenderer::GenerateIndexBuffer(
-		VkCommandBuffer cb,
-		AS::GLTF::Model const& model
-	)
+	void MeshRenderer::GenerateIndexBuffer(AS::GLTF::Model const& model)
 	{
 		auto& mesh = model.mesh;
 
 		auto const gltfIndices = mesh->GetIndexData();
 
-		auto* device = LogicalDevice::Instance;
-
-		auto const indexStageBuffer = RB::CreateStageBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			gltfIndices->Len(),
-			1
+		auto [indexBuffer, token] = UploadQueue::Instance->CreateBuffer(
+			*gltfIndices,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT
 		);
-
-		_indicesBuffer = RB::CreateIndexBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			cb,
-			*indexStageBuffer->buffers[0],
-			*gltfIndices
-		);
-
-		return indexStageBuffer;
+		_indicesBuffer = indexBuffer;
+		_uploadToken = (std::max)(_uploadToken, token);
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	std::vector<std::shared_ptr<RT::BufferAndMemory>> MeshRenderer::GenerateTextures(VkCommandBuffer cb,
-		AS::GLTF::Model const& model)
+	void MeshRenderer::GenerateTextures(AS::GLTF::Model const& model)
 	{
-		std::vector<std::shared_ptr<RT::BufferAndMemory>> stagingBuffers{};
-
 		_textures.clear();
 
-		auto* device = LogicalDevice::Instance;
+		auto * streamingQueue = StreamingQueue::Instance;
+		MFA_ASSERT(streamingQueue != nullptr);
 
 		for (auto& cpuTexture : model.textures)
 		{
-			auto [gpuTexture, stageBuffer] = RB::CreateTexture(
-				*cpuTexture,
-				device->GetVkDevice(),
-				device->GetPhysicalDevice(),
-				cb
-			);
-			_textures.emplace_back(gpuTexture);
-			stagingBuffers.emplace_back(stageBuffer);
+			// The texture is already decoded, the streaming thread only stages and uploads it
+			_textures.emplace_back(streamingQueue->StreamTexture([cpuTexture]()->std::shared_ptr<AS::Texture>
+			{
+				return cpuTexture;
+			}));
 		}
-
-		return stagingBuffers;
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	std::vector<std::shared_ptr<RT::BufferGroup>> MeshRenderer::CreateMaterials(VkCommandBuffer cb)
+	void MeshRenderer::CreateMaterials()
 	{
-		std::vector<std::shared_ptr<RT::BufferGroup>> stagingBuffers{};
-
-		_materials.clear();
-
-		auto* device = LogicalDevice::Instance;
+		_materialIndices.clear();
 
+		// Equal materials of different renderers share one entry of the material table
 		for (auto const& subMesh : _meshData->subMeshes)
 		{
+			auto & materialIndices = _materialIndices.emplace_back();
+
 			for (auto const& primitive : subMesh.primitives)
 			{
-				FlatShadingPipeline::Material data{
+				auto const textureIndex = primitive.hasBaseColorTexture == true
+					? _pipeline->AddTexture(_textures[primitive.baseColorTextureIndex])
+					: _pipeline->AddTexture(_errorTexture);
+
+				auto const [materialIndex, token] = _pipeline->AddMaterial(FlatShadingPipeline::Material{
 					.color = _hasOverrideColor == false ? glm::vec4{
 						primitive.baseColorFactor[0],
 						primitive.baseColorFactor[1],
 						primitive.baseColorFactor[2],
 						primitive.baseColorFactor[3]
 					} : _overrideColor,
-					.hasBaseColorTexture = primitive.hasBaseColorTexture ? 1 : 0
-				};
-
-				auto materialBuffer = RB::CreateLocalUniformBuffer(
-					device->GetVkDevice(),
-					device->GetPhysicalDevice(),
-					sizeof(data),
-					1
-				);
-
-				auto stageBuffer = RB::CreateStageBuffer(
-					device->GetVkDevice(),
-					device->GetPhysicalDevice(),
-					sizeof(data),
-					1
-				);
-
-				RB::UpdateHostVisibleBuffer(
-					device->GetVkDevice(),
-					*stageBuffer->buffers[0],
-					Alias(data)
-				);
-
-				RB::UpdateLocalBuffer(
-					cb,
-					*materialBuffer->buffers[0],
-					*stageBuffer->buffers[0]
-				);
-
-				stagingBuffers.emplace_back(stageBuffer);
-				_materials.emplace_back(materialBuffer);
-			}
-		}
-
-		return stagingBuffers;
-	}
-
-	//-------------------------------------------------------------------------------------------------
+					.hasBaseColorTexture = primitive.hasBaseColorTexture ? 1 : 0,
+					.textureIndex = textureIndex
+				});
+				_uploadToken = (std::max)(_uploadToken, token);
 
-	void MeshRenderer::CreateDescriptorSets()
-	{
-		int nextMaterialIdx = 0;
-
-		_descriptorSets.clear();
-
-		for (auto const& subMesh : _meshData->subMeshes)
-		{
-			_descriptorSets.emplace_back();
-			auto & descriptorSets = _descriptorSets.back();
-
-			for (auto const& primitive : subMesh.primitives)
-			{
-				auto const* gpuTexture = _errorTexture.get();
-
-				if (primitive.hasBaseColorTexture == true)
-				{
-					gpuTexture = _textures[primitive.baseColorTextureIndex].get();
-				}
-
-				descriptorSets.emplace_back(
-					_pipeline->CreatePerGeometryDescriptorSetGroup(
-						*_materials[nextMaterialIdx]->buffers[0],
-						*gpuTexture
-					)
-				);
-
-				++nextMaterialIdx;
-			}
-		}
-	}
-
-	//-------------------------------------------------------------------------------------------------
-
-	void MeshRenderer::DrawSubMesh(
-		RT::CommandRecordState& recordState,
-		int const subMeshIdx,
-		glm::mat4 const& transform
-	) const
-	{
-		auto const& subMesh = _meshData->subMeshes[subMeshIdx];
-		auto const& descriptorSets = _descriptorSets[subMeshIdx];
-
-		_pipeline->SetPushConstants(
-			recordState,
-			FlatShadingPipeline::PushConstants{
-				.model = transform
+				materialIndices.emplace_back(materialIndex);
 			}
-		);
-
-		for (int i = 0; i < static_cast<int>(subMesh.primitives.size()); ++i)
-		{
-			auto const& primitive = subMesh.primitives[i];
-			RB::AutoBindDescriptorSet(
-				recordState,
-				RB::UpdateFrequency::PerGeometry,
-				descriptorSets[i].descriptorSets[0]
-			);
-
-			RB::DrawIndexed(
-				recordState,
-				primitive.indicesCount,
-				1,
-				primitive.indicesStartingIndex
-			);
-		}
-	}
-
-	//-------------------------------------------------------------------------------------------------
-
-	void MeshRenderer::DrawNode(
-		RT::CommandRecordState& recordState, 
-		Asset::GLTF::Node & node,
-		glm::mat4 const & model
-	) const
-	{
-		if (node.hasSubMesh())
-		{
-			DrawSubMesh(recordState, node.subMeshIndex, model * node.transform.GlobalTransform());
-		}
-
-		for (auto const child : node.children)
-		{
-			DrawNode(recordState, _meshData->nodes[child], model);
-		}
-	}
-
-	//-------------------------------------------------------------------------------------------------
-
-	void MeshRenderer::DrawNode(
-		RT::CommandRecordState& recordState,
-		Asset::GLTF::Node & node,
-		std::vector<Asset::GLTF::Node> & nodes
-	) const
-	{
-		if(node.hasSubMesh())
-		{
-			DrawSubMesh(recordState, node.subMeshIndex, node.transform.GlobalTransform());
-		}
-
-		for(auto const child : node.children)
-		{
-			DrawNode(recordState, nodes[child], nodes);
 		}
 	}
 
@@ -446,4 +390,32 @@ namespace MFA
 
 	//-------------------------------------------------------------------------------------------------
 
+	std::vector<MeshRenderer::FlatNode> const& MeshRenderer::GetFlatNodes() const noexcept
+	{
+		return _flatNodes;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	std::vector<glm::mat4> const& MeshRenderer::GetFlatLocalTransforms() const noexcept
+	{
+		return _flatLocalTransforms;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	int MeshRenderer::FindFlatNode(std::string const& name) const noexcept
+	{
+		for (int i = 0; i < static_cast<int>(_flatNodes.size()); ++i)
+		{
+			if (_meshData->nodes[_flatNodes[i].nodeIndex].name == name)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
 }
@@ -3,9 +3,13 @@
 #include "pipeline/FlatShadingPipeline.hpp"
 #include "RenderBackend.hpp"
 #include "RenderTypes.hpp"
+#include "UploadQueue.hpp"
+#include "StreamingQueue.hpp"
 #include "ImportGLTF.hpp"
+#include "RenderQueue.hpp"
 
 #include <memory>
+#include <span>
 
 namespace MFA
 {
@@ -16,6 +20,14 @@ namespace MFA
     {
     public:
 
+        // Nodes are stored in topological order so parents always come before their children
+        struct FlatNode
+        {
+            int nodeIndex = -1;
+            int subMeshIndex = -1;
+            int parentIndex = -1;           // Index inside the flat node list, -1 for root nodes
+        };
+
         explicit MeshRenderer(
             std::shared_ptr<FlatShadingPipeline> pipeline,
             std::shared_ptr<AS::GLTF::Model> const& model,
@@ -24,9 +36,15 @@ namespace MFA
             glm::vec4 overrideColor = {}
         );
 
-        void Render(RT::CommandRecordState& recordState, std::vector<glm::mat4> const& models);
+        // Spans let callers pass frame arena vectors as well as std::vector
+        void Render(RT::CommandRecordState& recordState, std::span<glm::mat4 const> models) const;
+
+        void Render(RT::CommandRecordState& recordState, std::span<MeshInstance * const> instances) const;
+
+        // Adds one draw packet per primitive, the queue decides the recording order
+        void Submit(RenderQueue& renderQueue, std::span<glm::mat4 const> models) const;
 
-        void Render(RT::CommandRecordState& recordState, std::vector<MeshInstance*> const& instances) const;
+        void Submit(RenderQueue& renderQueue, std::span<MeshInstance * const> instances) const;
         
         [[nodiscard]]
         std::vector<glm::vec3> GetVertices(glm::mat4 const& model) const noexcept;
@@ -35,34 +53,36 @@ namespace MFA
 
         std::vector<Asset::GLTF::Node> const & GetNodes() const noexcept;
 
-    private:
+        [[nodiscard]]
+        std::vector<FlatNode> const & GetFlatNodes() const noexcept;
 
-        std::shared_ptr<RT::BufferGroup> GenerateVertexBuffer(VkCommandBuffer cb, AS::GLTF::Model const& model);
+        [[nodiscard]]
+        std::vector<glm::mat4> const & GetFlatLocalTransforms() const noexcept;
 
-        std::shared_ptr<RT::BufferGroup> GenerateIndexBuffer(VkCommandBuffer cb, AS::GLTF::Model const& model);
+        // Returns the flat node index or -1 if there is no node with this name
+        [[nodiscard]]
+        int FindFlatNode(std::string const & name) const noexcept;
 
-        std::vector<std::shared_ptr<RT::BufferAndMemory>> GenerateTextures(VkCommandBuffer cb, AS::GLTF::Model const& model);
+        // Token of the last upload batch that contains the buffers and materials of this mesh, textures are streamed
+        [[nodiscard]]
+        UploadQueue::Token GetUploadToken() const noexcept;
 
-        std::vector<std::shared_ptr<RT::BufferGroup>> CreateMaterials(VkCommandBuffer cb);
+    private:
 
-        void CreateDescriptorSets();
-        
-        void DrawSubMesh(
-            RT::CommandRecordState& recordState,
-            int subMeshIdx,
-            glm::mat4 const & transform
-        ) const;
+        void CreateFlatNodes();
 
-        void DrawNode(
-            RT::CommandRecordState& recordState,
-            Asset::GLTF::Node & node,
-            glm::mat4 const & model
-        ) const;
+        void GenerateVertexBuffer(AS::GLTF::Model const& model);
+
+        void GenerateIndexBuffer(AS::GLTF::Model const& model);
 
-        void DrawNode(
-            RT::CommandRecordState& recordState,
-            Asset::GLTF::Node & node,
-            std::vector<Asset::GLTF::Node> & nodes
+        void GenerateTextures(AS::GLTF::Model const& model);
+
+        void CreateMaterials();
+        
+        void SubmitFlatNodes(
+            RenderQueue& renderQueue,
+            std::vector<glm::mat4> const& globalTransforms,
+            int instanceCount
         ) const;
 
         std::shared_ptr<FlatShadingPipeline> _pipeline{};
@@ -73,9 +93,13 @@ namespace MFA
 
         std::shared_ptr<RT::BufferAndMemory> _verticesBuffer{};
         std::shared_ptr<RT::BufferAndMemory> _indicesBuffer{};
-        std::vector<std::shared_ptr<RT::GpuTexture>> _textures{};
-        std::vector<std::shared_ptr<RT::BufferGroup>> _materials{};
-        std::vector<std::vector<RT::DescriptorSetGroup>> _descriptorSets;
+        // Textures are streamed, primitives show the default texture of the pipeline until theirs is ready
+        std::vector<std::shared_ptr<StreamingQueue::TextureRequest>> _textures{};
+        // Index in the material table of the pipeline for every primitive of every sub mesh
+        std::vector<std::vector<int>> _materialIndices{};
+
+        std::vector<FlatNode> _flatNodes{};
+        std::vector<glm::mat4> _flatLocalTransforms{};
         
         int _vertexCount{};
         std::shared_ptr<Blob> _vertices{};
@@ -83,6 +107,8 @@ namespace MFA
         int _indexCount{};
         std::shared_ptr<Blob> _indices{};
 
+        UploadQueue::Token _uploadToken{};
+
         bool _hasOverrideColor{};
         glm::vec4 _overrideColor{};
     };
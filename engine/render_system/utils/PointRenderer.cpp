@@ -5,108 +5,101 @@
 #include "BedrockMath.hpp"
 #include "BufferTracker.hpp"
 
+#include <algorithm>
+
 namespace MFA
 {
 
 	//-------------------------------------------------------------------------------------------------
 
-	PointRenderer::PointRenderer(std::shared_ptr<MFA::PointPipeline> pointPipeline)
+	PointRenderer::PointRenderer(
+		std::shared_ptr<MFA::PointPipeline> pointPipeline,
+		int const pointCapacity
+	)
 		: _pointPipeline(std::move(pointPipeline))
 	{
 		using namespace MFA;
 
-		std::vector<glm::vec3> vertices{ {0.0f, 0.0f, 0.0f} };
-		std::vector<uint16_t> indices{ 0 };
-
-		Alias const verticesAlias{ vertices.data(), vertices.size() };
-		Alias const indicesAlias{ indices.data(), indices.size() };
-
 		auto* device = LogicalDevice::Instance;
 
-		auto commandBuffer = RB::BeginSingleTimeCommand(
-			device->GetVkDevice(),
-			device->GetGraphicCommandPool()
-		);
-		auto const vertexStageBuffer = RB::CreateStageBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			verticesAlias.Len(),
-			1
-		);
-		_vertexBuffer = RB::CreateVertexBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			commandBuffer,
-			*vertexStageBuffer->buffers[0],
-			verticesAlias
-		);
-		auto const indexStageBuffer = RB::CreateStageBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			indicesAlias.Len(),
-			1
-		);
-		_indexBuffer = RB::CreateIndexBuffer(
-			device->GetVkDevice(),
-			device->GetPhysicalDevice(),
-			commandBuffer,
-			*indexStageBuffer->buffers[0],
-			indicesAlias
-		);
-		RB::EndAndSubmitSingleTimeCommand(
-			device->GetVkDevice(),
-			device->GetGraphicCommandPool(),
-			device->GetGraphicQueue(),
-			commandBuffer
-		);
-
-		_indexCount = indices.size();
+		_vertices.reserve(pointCapacity);
+
+		_vertexBuffers.resize(device->GetMaxFramePerFlight());
+		for (auto& vertexBuffer : _vertexBuffers)
+		{
+			vertexBuffer = RB::CreateBuffer(
+				device->GetVkDevice(),
+				device->GetPhysicalDevice(),
+				pointCapacity * sizeof(PointPipeline::Vertex),
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			);
+		}
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-	void PointRenderer::Draw(
-		MFA::RT::CommandRecordState& recordState,
+	void PointRenderer::AddPoint(
 		glm::vec3 const& position,
 		glm::vec4 const& color,
-		float pointSize
-	) const
+		float const pointSize
+	)
+	{
+		_vertices.emplace_back(PointPipeline::Vertex{ .position = position, .color = color, .pointSize = pointSize });
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void PointRenderer::Render(MFA::RT::CommandRecordState& recordState)
 	{
 		using namespace MFA;
 
+		if (_vertices.empty() == true)
+		{
+			return;
+		}
+
+		auto const device = LogicalDevice::Instance->GetVkDevice();
+		auto const dataSize = _vertices.size() * sizeof(PointPipeline::Vertex);
+
+		// The previous use of this frame's buffer has finished on the gpu, so it can be replaced right away
+		auto& vertexBuffer = _vertexBuffers[recordState.frameIndex];
+		if (vertexBuffer->size < dataSize)
+		{
+			vertexBuffer = RB::CreateBuffer(
+				device,
+				LogicalDevice::Instance->GetPhysicalDevice(),
+				std::max<VkDeviceSize>(dataSize, vertexBuffer->size * 2),
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			);
+		}
+
+		{
+			void* mappedMemory = nullptr;
+			RB::MapHostVisibleMemory(device, *vertexBuffer, 0, dataSize, &mappedMemory);
+			std::memcpy(mappedMemory, _vertices.data(), dataSize);
+			RB::UnMapHostVisibleMemory(device, *vertexBuffer, 0, dataSize);
+		}
+
 		_pointPipeline->BindPipeline(recordState);
 
-		glm::mat4 matrix = Math::Translate(position);
+		RB::BindVertexBuffer(recordState, *vertexBuffer, 0, 0);
 
+		// Vertices are already in world space and carry their own color and size
 		_pointPipeline->SetPushConstants(
 			recordState,
 			PointPipeline::PushConstants{
-				.model = matrix,
-				.color = color,
-				.pointSize = pointSize
+				.model = glm::identity<glm::mat4>()
 			}
 		);
 
-		RB::BindIndexBuffer(
-			recordState,
-			*_indexBuffer,
-			0,
-			VK_INDEX_TYPE_UINT16
-		);
+		RB::Draw(recordState, static_cast<uint32_t>(_vertices.size()), 1, 0, 0);
 
-		RB::BindVertexBuffer(
-			recordState,
-			*_vertexBuffer,
-			0,
-			0
-		);
-
-		RB::DrawIndexed(
-			recordState,
-			_indexCount
-		);
+		// Keeps the capacity for the next frame
+		_vertices.clear();
 	}
 
 	//-------------------------------------------------------------------------------------------------
 
-}
\ No newline at end of file
+}
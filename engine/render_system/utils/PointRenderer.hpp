@@ -5,22 +5,31 @@
 
 namespace MFA
 {
+    // Immediate mode point batch. Points are collected during the frame and all of them are recorded by a single draw.
     class PointRenderer
     {
     public:
 
-        explicit PointRenderer(std::shared_ptr<MFA::PointPipeline> pointPipeline);
+        // The vertex buffer of a frame grows when the points of that frame do not fit in pointCapacity
+        explicit PointRenderer(
+            std::shared_ptr<MFA::PointPipeline> pointPipeline,
+            int pointCapacity = 16384
+        );
 
-        void Draw(
-            MFA::RT::CommandRecordState& recordState,
+        void AddPoint(
             glm::vec3 const& position,
             glm::vec4 const& color = { 1.0f, 0.0f, 0.0f, 1.0f },
             float pointSize = 10.0f
-        ) const;
+        );
+
+        // Writes the points into the vertex buffer of the active frame and draws them. Clears the batch afterward.
+        void Render(MFA::RT::CommandRecordState& recordState);
+
+    private:
 
         std::shared_ptr<MFA::PointPipeline> _pointPipeline{};
-        std::shared_ptr<MFA::RT::BufferAndMemory> _vertexBuffer{};
-        std::shared_ptr<MFA::RT::BufferAndMemory> _indexBuffer{};
-        int _indexCount{};
+        // One buffer per frame in flight, so we never write into the vertices that the gpu is still reading
+        std::vector<std::shared_ptr<MFA::RT::BufferAndMemory>> _vertexBuffers{};
+        std::vector<PointPipeline::Vertex> _vertices{};
     };
 }
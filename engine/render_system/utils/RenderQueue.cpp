@@ -0,0 +1,175 @@
+#include "RenderQueue.hpp"
+
+#include "BedrockAssert.hpp"
+#include "RenderBackend.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace MFA
+{
+
+	//-------------------------------------------------------------------------------------------------
+
+	// Fibonacci hashing, equal pointers always map to the same bits
+	static uint64_t HashPointer(void const * pointer, int const bitCount)
+	{
+		return (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer)) * 11400714819323198485ull) >> (64 - bitCount);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void RenderQueue::Reset(glm::mat4 const & viewProjection)
+	{
+		_viewProjection = viewProjection;
+		_packets.clear();
+		_sorted.clear();
+		_isSorted = false;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void RenderQueue::Submit(DrawPacket const & packet)
+	{
+		MFA_ASSERT(packet.pipeline != nullptr);
+		MFA_ASSERT(packet.vertexBuffer != nullptr);
+		MFA_ASSERT(packet.indexBuffer != nullptr);
+
+		auto & newPacket = _packets.emplace_back(packet);
+		newPacket.sortKey = ComputeSortKey(packet);
+		_isSorted = false;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void RenderQueue::Append(RenderQueue & other)
+	{
+		_packets.insert(_packets.end(), other._packets.begin(), other._packets.end());
+		other._packets.clear();
+		other._isSorted = false;
+		_isSorted = false;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void RenderQueue::Sort()
+	{
+		auto const count = _packets.size();
+		_sorted.resize(count);
+		_sortScratch.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			_sorted[i] = SortEntry {.key = _packets[i].sortKey, .packetIndex = static_cast<uint32_t>(i)};
+		}
+
+		// Least significant digit first, every pass is stable
+		for (int shift = 0; shift < 64 && count > 1; shift += 8)
+		{
+			std::array<size_t, 256> offsets {};
+			for (auto const & entry : _sorted)
+			{
+				++offsets[(entry.key >> shift) & 0xFF];
+			}
+
+			// All keys share this digit, the pass would not change the order
+			if (offsets[(_sorted[0].key >> shift) & 0xFF] == count)
+			{
+				continue;
+			}
+
+			size_t sum = 0;
+			for (auto & offset : offsets)
+			{
+				auto const digitCount = offset;
+				offset = sum;
+				sum += digitCount;
+			}
+
+			for (auto const & entry : _sorted)
+			{
+				_sortScratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+			}
+			std::swap(_sorted, _sortScratch);
+		}
+
+		_isSorted = true;
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	size_t RenderQueue::PacketCount() const noexcept
+	{
+		return _packets.size();
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void RenderQueue::Flush(RT::CommandRecordState & recordState, size_t const begin, size_t const end) const
+	{
+		MFA_ASSERT(_isSorted == true);
+		MFA_ASSERT(begin <= end && end <= _sorted.size());
+
+		FlatShadingPipeline const * pipeline = nullptr;
+		RT::BufferAndMemory const * vertexBuffer = nullptr;
+		RT::BufferAndMemory const * indexBuffer = nullptr;
+
+		// Materials are indexed from the push constants, the pipeline binds the only descriptor set
+		for (size_t i = begin; i < end; ++i)
+		{
+			auto const & packet = _packets[_sorted[i].packetIndex];
+
+			if (packet.pipeline != pipeline)
+			{
+				packet.pipeline->BindPipeline(recordState);
+				pipeline = packet.pipeline;
+			}
+
+			if (packet.indexBuffer != indexBuffer)
+			{
+				RB::BindIndexBuffer(recordState, *packet.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+				indexBuffer = packet.indexBuffer;
+			}
+
+			if (packet.vertexBuffer != vertexBuffer)
+			{
+				RB::BindVertexBuffer(recordState, *packet.vertexBuffer, 0, 0);
+				vertexBuffer = packet.vertexBuffer;
+			}
+
+			packet.pipeline->SetPushConstants(
+				recordState,
+				FlatShadingPipeline::PushConstants{
+					.model = packet.model,
+					.materialIndex = packet.materialIndex
+				}
+			);
+
+			RB::DrawIndexed(recordState, packet.indexCount, 1, packet.firstIndex);
+		}
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	void RenderQueue::Flush(RT::CommandRecordState & recordState) const
+	{
+		Flush(recordState, 0, _sorted.size());
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+	uint64_t RenderQueue::ComputeSortKey(DrawPacket const & packet) const
+	{
+		// Positive floats keep their order when compared as integers, w is the view depth for perspective projections
+		auto const clipPosition = _viewProjection * packet.model[3];
+		auto const depth = std::bit_cast<uint32_t>(std::max(clipPosition.w, 0.0f));
+
+		return HashPointer(packet.pipeline, 8) << 56 |
+			HashPointer(packet.vertexBuffer, 16) << 40 |
+			(static_cast<uint64_t>(packet.materialIndex) & 0xFFFFF) << 20 |
+			static_cast<uint64_t>(depth >> 11);
+	}
+
+	//-------------------------------------------------------------------------------------------------
+
+}
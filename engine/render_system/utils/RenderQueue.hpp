@@ -0,0 +1,72 @@
+#pragma once
+
+#include "pipeline/FlatShadingPipeline.hpp"
+#include "RenderTypes.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace MFA
+{
+	// Collects draws of a frame, sorts them by state and records them with the minimum number of binds.
+	// Key layout from the most significant bit: pipeline (8) | mesh buffers (16) | material (20) | depth (20).
+	// Materials only change a push constant, so they rank below the buffer binds.
+	// Pipeline and mesh ids are hashed from the handles, so queues that are filled on different threads produce compatible keys.
+	class RenderQueue
+	{
+	public:
+
+		struct DrawPacket
+		{
+			uint64_t sortKey = 0;
+			FlatShadingPipeline const * pipeline = nullptr;
+			int materialIndex = 0;
+			RT::BufferAndMemory const * vertexBuffer = nullptr;
+			RT::BufferAndMemory const * indexBuffer = nullptr;
+			uint32_t indexCount = 0;
+			uint32_t firstIndex = 0;
+			glm::mat4 model {};
+		};
+
+		RenderQueue() = default;
+
+		// Removes the packets of the previous frame, depth is computed with the given view projection
+		void Reset(glm::mat4 const & viewProjection);
+
+		// The sort key is computed from the packet content
+		void Submit(DrawPacket const & packet);
+
+		// Moves the packets of the other queue to the end of this one
+		void Append(RenderQueue & other);
+
+		// Radix sort on the keys, opaque draws end up front to back inside the same state
+		void Sort();
+
+		[[nodiscard]]
+		size_t PacketCount() const noexcept;
+
+		// Records the sorted packets in [begin, end). Ranges can be recorded into different command buffers in parallel.
+		void Flush(RT::CommandRecordState & recordState, size_t begin, size_t end) const;
+
+		void Flush(RT::CommandRecordState & recordState) const;
+
+	private:
+
+		struct SortEntry
+		{
+			uint64_t key = 0;
+			uint32_t packetIndex = 0;
+		};
+
+		[[nodiscard]]
+		uint64_t ComputeSortKey(DrawPacket const & packet) const;
+
+		glm::mat4 _viewProjection {1.0f};
+
+		std::vector<DrawPacket> _packets {};
+		std::vector<SortEntry> _sorted {};
+		std::vector<SortEntry> _sortScratch {};
+		bool _isSorted = false;
+	};
+}
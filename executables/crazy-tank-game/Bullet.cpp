@@ -4,6 +4,8 @@
 #include "Layers.hpp"
 #include "utils/MeshInstance.hpp"
 
+#include <array>
+
 using namespace MFA;
 
 //=============================================================================
@@ -55,11 +57,12 @@ void Bullet::Update(float deltaTimeSec)
     bool hitWall = true;
     bool destroyBullet = false;
 
-	std::set<Physics2D::EntityID> excludeIds{_physicsId};
+	std::array<Physics2D::EntityID, 2> const excludeIdArray{_physicsId, _ownerId};
+	std::span<Physics2D::EntityID const> excludeIds{excludeIdArray.data(), 1};
 	if (_noFriendlyFireRemainingTime > 0.0f)
 	{
 		_noFriendlyFireRemainingTime -= deltaTimeSec;
-		excludeIds.emplace(_ownerId);
+		excludeIds = excludeIdArray;
 	}
 
 	{// TODO: This sometimes fails
@@ -1,22 +1,34 @@
 #include "CrazyTankGameApp.hpp"
 
 #include "ImportTexture.hpp"
+#include "BedrockFrameArena.hpp"
 #include "BedrockMath.hpp"
 #include "Layers.hpp"
 #include "Tank.hpp"
+#include "TransformSystem.hpp"
+#include "ScopeProfiler.hpp"
 
-#include <omp.h>
 
 using namespace MFA;
 
 //------------------------------------------------------------------------------------------------------
 
+// Large instance lists are split so that every worker records a part of them
+static int RecordChunkCount(int const instanceCount)
+{
+	static constexpr int MinInstancesPerChunk = 64;
+	auto const maxChunkCount = std::max(JobSystem::Instance->NumberOfAvailableThreads(), 1);
+	return std::clamp(instanceCount / MinInstancesPerChunk, 1, maxChunkCount);
+}
+
+//------------------------------------------------------------------------------------------------------
+
 CrazyTankGameApp::CrazyTankGameApp()
 {
 	// TODO: Move to multiple functions
     MFA_LOG_DEBUG("Loading...");
-    omp_set_num_threads(static_cast<int>(static_cast<float>(std::thread::hardware_concurrency()) * 0.8f));
-	MFA_LOG_INFO("Number of available workers are: %d", omp_get_max_threads());
+    // Workers leave a core to the main thread, parallel loops of the engine run on them as well
+    jobSystem = JobSystem::Instantiate();
 
     path = Path::Instantiate();
 
@@ -90,36 +102,17 @@ CrazyTankGameApp::CrazyTankGameApp()
     );
 
     {// Error texture
-		auto const* device = LogicalDevice::Instance;
-
-		auto const commandBuffer = RB::BeginSingleTimeCommand(
-			device->GetVkDevice(),
-			device->GetGraphicCommandPool()
-		);
-
 		auto const cpuTexture = Importer::ErrorTexture();
 
-		auto [gpuTexture, stagingBuffer] = RB::CreateTexture(
-			*cpuTexture,
-			LogicalDevice::Instance->GetVkDevice(),
-			LogicalDevice::Instance->GetPhysicalDevice(),
-			commandBuffer
-		);
-
-		RB::EndAndSubmitSingleTimeCommand(
-			device->GetVkDevice(),
-			device->GetGraphicCommandPool(),
-			device->GetGraphicQueue(),
-			commandBuffer
-		);
+		auto [gpuTexture, uploadToken] = UploadQueue::Instance->CreateTexture(*cpuTexture);
 
 		errorTexture = gpuTexture;
     }
 
-	pointPipeline = std::make_shared<PointPipeline>(displayRenderPass, cameraBuffer, 10000);
+	pointPipeline = std::make_shared<PointPipeline>(displayRenderPass, cameraBuffer);
 	pointRenderer = std::make_shared<PointRenderer>(pointPipeline);
 
-	linePipeline = std::make_shared<LinePipeline>(displayRenderPass, cameraBuffer, 10000);
+	linePipeline = std::make_shared<LinePipeline>(displayRenderPass, cameraBuffer);
 	lineRenderer = std::make_shared<LineRenderer>(linePipeline);
 
 	PrepareInGameText();
@@ -130,7 +123,13 @@ CrazyTankGameApp::CrazyTankGameApp()
 
 	InitPathFinder();
 
-	auto const tankModel = Importer::GLTF_Model(Path::Instance->Get("models/enemy_tank.glb"));
+	// The tank and the bullet are imported in parallel on the workers
+	std::vector<Task<std::shared_ptr<Importer::Model>>> modelTasks{};
+	modelTasks.emplace_back(Importer::GLTF_ModelAsync(Path::Instance->Get("models/enemy_tank.glb")));
+	modelTasks.emplace_back(Importer::GLTF_ModelAsync(Path::Instance->Get("models/test/cube.glb")));
+	auto const models = jobSystem->SyncWait(WhenAll(std::move(modelTasks)));
+	auto const & tankModel = models[0];
+	auto const & bulletModel = models[1];
 
 	playerTankRenderer = std::make_unique<MeshRenderer>(
 		shadingPipeline,
@@ -152,7 +151,7 @@ CrazyTankGameApp::CrazyTankGameApp()
 		bulletParams = std::make_shared<Bullet::Params>();
 		bulletRenderer = std::make_unique<MFA::MeshRenderer>(
 			shadingPipeline,
-			MFA::Importer::GLTF_Model(MFA::Path::Instance->Get("models/test/cube.glb")),
+			bulletModel,
 			errorTexture,
 			true,
 			glm::vec4{ 0.0f, 0.25f, 0.0f, 1.0f }
@@ -189,12 +188,14 @@ CrazyTankGameApp::CrazyTankGameApp()
 		enemyTanks.back()->Teleport(pathFinder->NodePosition(enemySpawnPositions[0]).xz());
 	}
 
+	InitUpdateGraph();
 }
 
 //------------------------------------------------------------------------------------------------------
 
 CrazyTankGameApp::~CrazyTankGameApp()
 {
+	updateGraph.reset();
 	physics2D.reset();
 	lineRenderer.reset();
 	linePipeline.reset();
@@ -223,6 +224,7 @@ CrazyTankGameApp::~CrazyTankGameApp()
 	swapChainResource.reset();
 	device.reset();
 	path.reset();
+	jobSystem.reset();
 }
 
 //------------------------------------------------------------------------------------------------------
@@ -257,6 +259,10 @@ void CrazyTankGameApp::Run()
 			Render(recordState);
 		}
 
+		FrameProfiler::Instance().EndFrame();
+		// Every job of the frame is done, so the transient memory of all threads can be reused
+		FrameArena::Instance().EndFrame();
+
 		time->Update();
 	}
 
@@ -269,6 +275,10 @@ void CrazyTankGameApp::Run()
 
 void CrazyTankGameApp::Update(float deltaTimeSec)
 {
+	SCOPE_Profiler("Update")
+
+	shadingPipeline->Update();
+
 	if (useDebugCamera == true)
 	{
 		debugCamera->Update(deltaTimeSec);
@@ -284,21 +294,68 @@ void CrazyTankGameApp::Update(float deltaTimeSec)
 
 	ui->Update();
 
-	UpdateInGameText(deltaTimeSec);
+	updateDeltaTimeSec = deltaTimeSec;
+	updateGraph->Run();
+}
+
+//------------------------------------------------------------------------------------------------------
 
-	physics2D->Update();
+void CrazyTankGameApp::InitUpdateGraph()
+{
+	// Stages that move objects share the physics world and the transform system, so they run one after another.
+	// Path finding only reads copied positions and overlaps the bullets, the text is independent of the gameplay.
+	updateGraph = jobSystem->CreateTaskGraph();
 
-	UpdateBullets(deltaTimeSec);
+	updateGraph->AddNode("Text", [this]()->void
+	{
+		UpdateInGameText(updateDeltaTimeSec);
+	});
 
-	UpdatePlayer(deltaTimeSec);
+	auto const physics = updateGraph->AddNode("Physics", [this]()->void
+	{
+		physics2D->Update();
+	});
+	auto const player = updateGraph->AddNode("Player", [this]()->void
+	{
+		UpdatePlayer(updateDeltaTimeSec);
+	});
+	auto const enemyTargets = updateGraph->AddNode("Enemy targets", [this]()->void
+	{
+		GatherEnemyTargets();
+	});
+	auto const bullets = updateGraph->AddNode("Bullets", [this]()->void
+	{
+		UpdateBullets(updateDeltaTimeSec);
+	});
+	auto const enemyPaths = updateGraph->AddNode("Enemy paths", [this]()->void
+	{
+		FindEnemyPaths();
+	});
+	auto const enemies = updateGraph->AddNode("Enemies", [this]()->void
+	{
+		UpdateEnemies(updateDeltaTimeSec);
+	});
+	// World matrices of everything that moved this frame are recomputed in one pass before rendering
+	auto const transforms = updateGraph->AddNode("Transforms", []()->void
+	{
+		TransformSystem::Instance().Update();
+	});
 
-	UpdateEnemies(deltaTimeSec);
+	updateGraph->AddEdge(physics, player);
+	updateGraph->AddEdge(player, enemyTargets);
+	updateGraph->AddEdge(enemyTargets, bullets);
+	updateGraph->AddEdge(enemyTargets, enemyPaths);
+	updateGraph->AddEdge(bullets, enemies);
+	updateGraph->AddEdge(enemyPaths, enemies);
+	updateGraph->AddEdge(enemies, transforms);
 }
 
 //------------------------------------------------------------------------------------------------------
 
 void CrazyTankGameApp::Render(RT::CommandRecordState& recordState)
 {
+	SCOPE_Profiler("Render")
+
 	device->BeginCommandBuffer(
 		recordState,
 		RT::CommandBufferType::Compute
@@ -314,47 +371,153 @@ void CrazyTankGameApp::Render(RT::CommandRecordState& recordState)
 
 	lightSourceBufferTracker->Update(recordState);
 
+	shadingPipeline->Update(recordState);
+
 	textData->vertexData->Update(recordState);
 
-	displayRenderPass->Begin(recordState);
-	
+	displayRenderPass->Begin(recordState, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+	auto const & viewProjection = useDebugCamera == true ? debugCamera->ViewProjection() : gameCamera->ViewProjection();
+
+	// Draws are gathered in parallel, each job fills its own queue. Transforms were resolved in Update so the jobs only read them.
+	// Temporary lists of the frame come from the frame arena of the thread that builds them.
+	auto & frameArena = FrameArena::Instance();
+	auto submitJobs = frameArena.Vector<std::function<void(RenderQueue &)>>(16);
+
 	if (renderPlayer == true)
 	{
 		// Rendering player tank
-		playerTankRenderer->Render(recordState, {playerTank->MeshInstance()});
-		
-		{// Rendering enemy tank
-			std::vector<MeshInstance *> instances{};
-			for (auto & enemyTank : enemyTanks)
-			{	
-				instances.emplace_back(enemyTank->MeshInstance());
-			}
-			enemyTankRenderer->Render(recordState, instances);
+		submitJobs.emplace_back([this](RenderQueue & submitQueue)->void
+		{
+			auto * playerInstance = playerTank->MeshInstance();
+			playerTankRenderer->Submit(submitQueue, std::span{&playerInstance, 1});
+		});
+
+		// Rendering enemy tank
+		auto const enemyCount = static_cast<int>(enemyTanks.size());
+		auto const chunkCount = RecordChunkCount(enemyCount);
+		for (int chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+		{
+			submitJobs.emplace_back([this, enemyCount, chunkIndex, chunkCount](RenderQueue & submitQueue)->void
+			{
+				auto const begin = enemyCount * chunkIndex / chunkCount;
+				auto const end = enemyCount * (chunkIndex + 1) / chunkCount;
+				auto instances = FrameArena::Instance().Vector<MeshInstance *>(end - begin);
+				for (int i = begin; i < end; ++i)
+				{
+					instances.emplace_back(enemyTanks[i]->MeshInstance());
+				}
+				enemyTankRenderer->Submit(submitQueue, instances);
+			});
 		}
 	}
 
-	{// Rendering bullets
-		std::vector<glm::mat4> bulletTransforms{};
+	// Rendering bullets
+	submitJobs.emplace_back([this](RenderQueue & submitQueue)->void
+	{
+		auto bulletTransforms = FrameArena::Instance().Vector<glm::mat4>(bullets.size());
 		for (auto & bullet : bullets)
 		{
 			bulletTransforms.emplace_back(bullet->Transform().GlobalTransform());
 		}
-		bulletRenderer->Render(recordState, bulletTransforms);
-	}
+		bulletRenderer->Submit(submitQueue, bulletTransforms);
+	});
 
 	if (renderMap == true)
 	{
-		map->Render(recordState);
+		auto const chunkCount = RecordChunkCount(map->WallCount());
+		for (int chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
+		{
+			submitJobs.emplace_back([this, chunkIndex, chunkCount](RenderQueue & submitQueue)->void
+			{
+				map->Submit(submitQueue, chunkIndex, chunkCount);
+			});
+		}
+	}
+
+	if (submitQueues.size() < submitJobs.size())
+	{
+		submitQueues.resize(submitJobs.size());
+	}
+
+	{// The main thread runs submit jobs as well while it waits
+		auto submitGroup = jobSystem->CreateTaskGroup();
+		for (size_t i = 0; i < submitJobs.size(); ++i)
+		{
+			submitQueues[i].Reset(viewProjection);
+			submitGroup.Run([&, i]()->void
+			{
+				SCOPE_Profiler("Submit draws")
+				submitJobs[i](submitQueues[i]);
+			});
+		}
+		submitGroup.Wait();
+	}
+
+	renderQueue.Reset(viewProjection);
+	for (size_t i = 0; i < submitJobs.size(); ++i)
+	{
+		renderQueue.Append(submitQueues[i]);
+	}
+	// A single sort over the whole frame so binds are shared between renderers
+	renderQueue.Sort();
+
+	// Every job records a contiguous range of the sorted draws into its own secondary command buffer
+	auto recordJobs = frameArena.Vector<std::function<void(RT::CommandRecordState &)>>(16);
+
+	auto const packetCount = renderQueue.PacketCount();
+	auto const rangeCount = RecordChunkCount(static_cast<int>(packetCount));
+	for (int rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex)
+	{
+		auto const begin = packetCount * rangeIndex / rangeCount;
+		auto const end = packetCount * (rangeIndex + 1) / rangeCount;
+		recordJobs.emplace_back([this, begin, end](RT::CommandRecordState & secondaryState)->void
+		{
+			SCOPE_GpuProfiler(secondaryState, "Meshes")
+			renderQueue.Flush(secondaryState, begin, end);
+		});
 	}
 
 	if (renderPhysics == true)
 	{
-		Physics2D::Instance->Render(recordState);
+		recordJobs.emplace_back([](RT::CommandRecordState & secondaryState)->void
+		{
+			SCOPE_GpuProfiler(secondaryState, "Physics")
+			Physics2D::Instance->Render(secondaryState);
+		});
+	}
+
+	// The last one belongs to the main thread
+	auto secondaryStates = frameArena.Vector<RT::CommandRecordState>();
+	secondaryStates.resize(recordJobs.size() + 1);
+	auto recordGroup = jobSystem->CreateTaskGroup();
+	for (size_t i = 0; i < recordJobs.size(); ++i)
+	{
+		recordGroup.Run([&, i]()->void
+		{
+			SCOPE_Profiler("Record draws")
+			auto secondaryState = displayRenderPass->BeginSecondary(recordState);
+			recordJobs[i](secondaryState);
+			displayRenderPass->EndSecondary(secondaryState);
+			secondaryStates[i] = std::move(secondaryState);
+		});
 	}
 
-	fontRenderer->Draw(recordState,*textData);
+	{// Text and imgui are recorded on the main thread while the workers are busy
+		auto & secondaryState = secondaryStates.back();
+		secondaryState = displayRenderPass->BeginSecondary(recordState);
+		{
+			SCOPE_GpuProfiler(secondaryState, "Text")
+			fontRenderer->Draw(secondaryState, *textData);
+		}
+		ui->Render(secondaryState, Time::DeltaTimeSec());
+		displayRenderPass->EndSecondary(secondaryState);
+	}
+
+	// Remaining record jobs can run on the main thread, every thread records into its own command pool
+	recordGroup.Wait();
 
-	ui->Render(recordState, Time::DeltaTimeSec());
+	displayRenderPass->ExecuteSecondaries(recordState, secondaryStates);
 
 	displayRenderPass->End(recordState);
 	device->EndCommandBuffer(recordState);
@@ -365,6 +528,29 @@ void CrazyTankGameApp::Render(RT::CommandRecordState& recordState)
 
 //------------------------------------------------------------------------------------------------------
 
+static void DrawProfilerNode(FrameProfiler::Frame const & frame, int const nodeIndex)
+{
+	auto const & node = frame.nodes[nodeIndex];
+	auto const flags = node.children.empty() ? ImGuiTreeNodeFlags_Leaf : ImGuiTreeNodeFlags_None;
+	if (ImGui::TreeNodeEx(
+		reinterpret_cast<void *>(static_cast<intptr_t>(nodeIndex)),
+		flags,
+		"%s: %.3f ms (%u)",
+		node.name,
+		static_cast<double>(node.totalNs) / 1'000'000.0,
+		node.callCount
+	))
+	{
+		for (auto const childIndex : node.children)
+		{
+			DrawProfilerNode(frame, childIndex);
+		}
+		ImGui::TreePop();
+	}
+}
+
+//------------------------------------------------------------------------------------------------------
+
 void CrazyTankGameApp::DebugUI(float deltaTimeSec)
 {
 	ui->BeginWindow("Window");
@@ -408,6 +594,79 @@ void CrazyTankGameApp::DebugUI(float deltaTimeSec)
 		gameCamera->DebugUI();
 		ImGui::TreePop();
 	}
+	if (ImGui::TreeNode("Gpu memory"))
+	{
+		auto const stats = device->GetMemoryAllocator().GetStats();
+		ImGui::Text("Blocks: %d, Dedicated: %d, Allocations: %d", stats.blockCount, stats.dedicatedAllocationCount, stats.allocationCount);
+		ImGui::Text("Reserved: %.2f MB", static_cast<float>(stats.reservedBytes) / (1024.0f * 1024.0f));
+		ImGui::Text("Used: %.2f MB", static_cast<float>(stats.usedBytes) / (1024.0f * 1024.0f));
+		ImGui::Text("Internal fragmentation: %.2f%%", stats.InternalFragmentation() * 100.0f);
+		ImGui::Text("External fragmentation: %.2f%%", stats.ExternalFragmentation() * 100.0f);
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Cpu profiler"))
+	{
+		ImGui::Text("Frame arena: %.1f KB", static_cast<double>(FrameArena::Instance().Capacity()) / 1024.0);
+		auto & frameProfiler = FrameProfiler::Instance();
+		bool enabled = frameProfiler.IsEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled))
+		{
+			frameProfiler.SetEnabled(enabled);
+		}
+		auto const frame = frameProfiler.GetLastFrame();
+		if (frame != nullptr)
+		{
+			ImGui::Text("Frame: %.3f ms", static_cast<double>(frame->endNs - frame->startNs) / 1'000'000.0);
+			auto const threadNames = frameProfiler.GetThreadNames();
+			for (size_t i = 0; i < frame->roots.size() && i < threadNames.size(); ++i)
+			{
+				auto const & root = frame->nodes[frame->roots[i]];
+				if (root.children.empty())
+				{
+					continue;
+				}
+				if (ImGui::TreeNode(threadNames[i].c_str(), "%s: %.3f ms", threadNames[i].c_str(), static_cast<double>(root.totalNs) / 1'000'000.0))
+				{
+					for (auto const childIndex : root.children)
+					{
+						DrawProfilerNode(*frame, childIndex);
+					}
+					ImGui::TreePop();
+				}
+			}
+		}
+		if (ImGui::Button("Export trace"))
+		{
+			frameProfiler.ExportChromeTrace("cpu_trace.json");
+		}
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Gpu profiler"))
+	{
+		auto & gpuProfiler = device->GetGpuProfiler();
+		bool enabled = gpuProfiler.IsEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled))
+		{
+			gpuProfiler.SetEnabled(enabled);
+		}
+		for (auto const & timing : gpuProfiler.GetTimings())
+		{
+			ImGui::Text("%s: %.3f ms, Average: %.3f ms, Max: %.3f ms", timing.name.c_str(), timing.lastMs, timing.averageMs, timing.maxMs);
+		}
+		if (gpuProfiler.IsStatisticsSupported())
+		{
+			auto const statistics = gpuProfiler.GetStatistics();
+			ImGui::Text("Vertices: %llu, Primitives: %llu", static_cast<unsigned long long>(statistics.inputAssemblyVertices), static_cast<unsigned long long>(statistics.inputAssemblyPrimitives));
+			ImGui::Text("Vertex invocations: %llu", static_cast<unsigned long long>(statistics.vertexShaderInvocations));
+			ImGui::Text("Clipped primitives: %llu", static_cast<unsigned long long>(statistics.clippingPrimitives));
+			ImGui::Text("Fragment invocations: %llu", static_cast<unsigned long long>(statistics.fragmentShaderInvocations));
+		}
+		if (ImGui::Button("Export csv"))
+		{
+			gpuProfiler.ExportCsv("gpu_profile.csv");
+		}
+		ImGui::TreePop();
+	}
 	if (ImGui::TreeNode("Light source"))
 	{
 		bool changed = false;
@@ -893,24 +1152,61 @@ void CrazyTankGameApp::UpdatePlayer(float deltaTimeSec)
 
 //------------------------------------------------------------------------------------------------------
 
+void CrazyTankGameApp::GatherEnemyTargets()
+{
+	enemyTargetPosition = playerTank->Transform().GlobalPosition();
+	enemyPositions.resize(enemyTanks.size());
+	for (size_t i = 0; i < enemyTanks.size(); ++i)
+	{
+		enemyPositions[i] = enemyTanks[i]->Transform().GlobalPosition();
+	}
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void CrazyTankGameApp::FindEnemyPaths()
+{
+	static constexpr int EnemiesPerRange = 8;
+
+	auto const playerNode = pathFinder->FindNearestNode(enemyTargetPosition);
+	enemyMoveDirections.resize(enemyPositions.size());
+	jobSystem->ParallelFor(0, static_cast<int>(enemyPositions.size()), [this, playerNode](int const rangeBegin, int const rangeEnd)->void
+	{
+		for (int i = rangeBegin; i < rangeEnd; ++i)
+		{
+			auto const & currentPosition = enemyPositions[i];
+			auto const enemyNode = pathFinder->FindNearestNode(currentPosition);
+			MFA_ASSERT(enemyNode >= 0);
+			auto const [success, nextNode] = pathFinder->FindNextNode(enemyNode, playerNode);
+			MFA_ASSERT(success == true && nextNode >= 0);
+
+			auto const nextNodePosition = pathFinder->NodePosition(nextNode);
+			auto const vector = nextNodePosition - currentPosition;
+			auto const magnitude = glm::length(vector);
+			if (magnitude > glm::epsilon<float>())
+			{
+				auto const direction = vector / magnitude;
+				enemyMoveDirections[i] = glm::vec2 {direction.x, direction.z};
+			}
+			else
+			{
+				enemyMoveDirections[i] = glm::vec2 {0.0f, 0.0f};
+			}
+		}
+	}, EnemiesPerRange);
+}
+
+//------------------------------------------------------------------------------------------------------
+
 void CrazyTankGameApp::UpdateEnemies(float deltaTimeSec)
 {
-	auto const playerNode = pathFinder->FindNearestNode(playerTank->Transform().GlobalPosition());
-	for (auto & enemyTank : enemyTanks)
-	{
-		auto const enemyNode = pathFinder->FindNearestNode(enemyTank->Transform().GlobalPosition());
-		MFA_ASSERT(enemyNode >= 0);
-		auto const [success, nextNode] = pathFinder->FindNextNode(enemyNode, playerNode);
-		MFA_ASSERT(success == true && nextNode >= 0);
-
-		auto const & currentPosition = enemyTank->Transform().GlobalPosition();
-		auto const nextNodePosition = pathFinder->NodePosition(nextNode);
-		auto const vector = nextNodePosition - currentPosition;
-		auto const magnitude = glm::length(vector);
-		if (magnitude > glm::epsilon<float>())
+	MFA_ASSERT(enemyMoveDirections.size() == enemyTanks.size());
+	for (size_t i = 0; i < enemyTanks.size(); ++i)
+	{
+		auto const & direction = enemyMoveDirections[i];
+		if (direction.x != 0.0f || direction.y != 0.0f)
 		{
-			auto const direction = vector / magnitude;
-			enemyTank->Move(glm::vec2 {direction.x, direction.z}, deltaTimeSec);
+			enemyTanks[i]->Move(direction, deltaTimeSec);
 		}
 	}
 
@@ -7,6 +7,7 @@
 #include "camera/PerspectiveCamera.hpp"
 #include "utils/MeshRenderer.hpp"
 #include "utils/MeshInstance.hpp"
+#include "utils/RenderQueue.hpp"
 #include "Map.hpp"
 #include "pipeline/PointPipeline.hpp"
 #include "utils/LineRenderer.hpp"
@@ -18,6 +19,7 @@
 #include "FollowCamera.hpp"
 #include "camera/ArcballCamera.hpp"
 #include "PathFinder.hpp"
+#include "JobSystem.hpp"
 
 #include <memory>
 #include <thread>
@@ -60,6 +62,12 @@ private:
 
     void UpdatePlayer(float deltaTimeSec);
 
+    void InitUpdateGraph();
+
+    void GatherEnemyTargets();
+
+    void FindEnemyPaths();
+
     void UpdateEnemies(float deltaTimeSec);
     
     static constexpr int EmptyCode = 0;
@@ -67,6 +75,12 @@ private:
 	static constexpr int EnemySpawnCode = 2;
 	static constexpr int PlayerSpawnCode = 3;
 
+    std::unique_ptr<MFA::JobSystem> jobSystem{};
+
+    // Gameplay stages of Update, built once and run every frame
+    std::unique_ptr<MFA::TaskGraph> updateGraph{};
+    float updateDeltaTimeSec = 0.0f;
+
     // Render parameters
 	std::unique_ptr<MFA::Path> path{};
 	std::unique_ptr<MFA::LogicalDevice> device{};
@@ -119,6 +133,10 @@ private:
     std::unique_ptr<MFA::MeshRenderer> enemyTankRenderer{};
     std::shared_ptr<Tank::Params> enemyTankParams{};
 	std::vector<std::unique_ptr<Tank>> enemyTanks{};
+    // Positions are copied before the paths are searched, so the search does not touch transforms while bullets move
+    glm::vec3 enemyTargetPosition{};
+    std::vector<glm::vec3> enemyPositions{};
+    std::vector<glm::vec2> enemyMoveDirections{};
 
     // TODO: Some kind of memory pool is needed
     std::unique_ptr<MFA::MeshRenderer> bulletRenderer{};
@@ -127,6 +145,10 @@ private:
 
     float passedTime = 0.0f;
 
+    // Draws of the frame, merged from one queue per submit job and sorted by state
+    MFA::RenderQueue renderQueue{};
+    std::vector<MFA::RenderQueue> submitQueues{};
+
     std::unique_ptr<MFA::ConsolasFontRenderer> fontRenderer{};
     std::shared_ptr<MFA::RT::SamplerGroup> fontSampler{};
     std::unique_ptr<MFA::ConsolasFontRenderer::TextData> textData{};
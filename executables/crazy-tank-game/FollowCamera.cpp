@@ -69,6 +69,13 @@ void FollowCamera::NotifyEnabled()
 
 //---------------------------------------------------------------------
 
+glm::mat4 const & FollowCamera::ViewProjection() const
+{
+    return _observerCamera->ViewProjection();
+}
+
+//---------------------------------------------------------------------
+
 void FollowCamera::UpdatePosition(float const deltaTimeSec, bool const resetPosition)
 {
     // TODO: It needs to move like a spring
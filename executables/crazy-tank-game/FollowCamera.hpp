@@ -39,6 +39,9 @@ public:
 
     void NotifyEnabled();
 
+    [[nodiscard]]
+    glm::mat4 const & ViewProjection() const;
+
 private:
 
     void UpdatePosition(float deltaTime, bool resetPosition = false);
@@ -27,7 +27,11 @@ struct BulletEntity {
 
 	BulletEntity(MFA::MeshRenderer const& meshRenderer, const glm::vec3& initPos = {}, float initBA = 0.f, float initScale = 0.1f);
 
-	void UpdateMI() { _meshInstance->GetTransform() = GetTransform(position, angle, scale); }
+	void UpdateMI() {
+		auto transform = GetTransform(position, angle, scale);
+		transform.UpdateNow();
+		_meshInstance->SetTransform(transform.GlobalTransform());
+	}
 
 	static MFA::Transform GetTransform(glm::vec3 pos, float bAngl, float scl);
 
@@ -4,6 +4,8 @@
 #include "Layers.hpp"
 #include "Physics2D.hpp"
 #include "BedrockAssert.hpp"
+#include "BedrockFrameArena.hpp"
+#include "BedrockMath.hpp"
 
 #include <map>
 #include <queue>
@@ -33,9 +35,10 @@ Map::Map(
     
     {
         _groundInstance = std::make_unique<MeshInstance>(*_groundRenderer);
-        auto& transform = _groundInstance->GetTransform();
-        transform.SetLocalScale(glm::vec3{ mapWidth * 0.5f, 0.1f, mapHeight * 0.5f });
-        transform.SetLocalPosition(glm::vec3{ 0.0f, -0.3f, 0.0f });
+        _groundInstance->SetTransform(
+            Math::Translate(glm::vec3{ 0.0f, -0.3f, 0.0f }) *
+            Math::Scale(glm::vec3{ mapWidth * 0.5f, 0.1f, mapHeight * 0.5f })
+        );
     }
 
     _wallRenderer = std::make_unique<MeshRenderer>(
@@ -62,10 +65,10 @@ Map::Map(
 		        {
                     _wallInstances.emplace_back(std::make_unique<MeshInstance>(*_wallRenderer));
                     auto & wallInstance = _wallInstances.back();
-                    auto & transform = wallInstance->GetTransform();
-                    transform.SetLocalScale(glm::vec3{ halfWallWidth, 0.5f, halfWallHeight });
-                    // transform.SetLocalPosition(glm::vec3{ static_cast<float>(j) * _wallWidth + startX, 0.3f, static_cast<float>(i) * _wallHeight + startY });
-                    transform.SetLocalPosition(CalcPosition(j, i));
+                    // Walls never move, a plain matrix is enough
+                    auto const transform = Math::Translate(CalcPosition(j, i)) *
+                        Math::Scale(glm::vec3{ halfWallWidth, 0.5f, halfWallHeight });
+                    wallInstance->SetTransform(transform);
 
                     auto colliderId = Physics2D::Instance->Register(
                         Physics2D::Type::AABB,
@@ -74,10 +77,10 @@ Map::Map(
                         nullptr
                     );
 
-                    auto const v04 = transform.GlobalTransform() * glm::vec4{ -1.0f, 0.0f, -1.0f, 1.0f };
-                    auto const v14 = transform.GlobalTransform() * glm::vec4{ -1.0f, 0.0f, 1.0f, 1.0f };
-                    auto const v24 = transform.GlobalTransform() * glm::vec4{ 1.0f, 0.0f, 1.0f, 1.0f };
-                    auto const v34 = transform.GlobalTransform() * glm::vec4{ 1.0f, 0.0f, -1.0f, 1.0f };
+                    auto const v04 = transform * glm::vec4{ -1.0f, 0.0f, -1.0f, 1.0f };
+                    auto const v14 = transform * glm::vec4{ -1.0f, 0.0f, 1.0f, 1.0f };
+                    auto const v24 = transform * glm::vec4{ 1.0f, 0.0f, 1.0f, 1.0f };
+                    auto const v34 = transform * glm::vec4{ 1.0f, 0.0f, -1.0f, 1.0f };
 
                     auto const v0 = v04.xz();// glm::vec2{ v04.x, v04.z };
                     auto const v1 = v14.xz();//glm::vec2{ v14.x, v14.z };
@@ -110,14 +113,42 @@ Map::Map(
 
 void Map::Render(RT::CommandRecordState& recordState)
 {
-    _groundRenderer->Render(recordState, { _groundInstance.get() });
+    RenderQueue renderQueue{};
+    renderQueue.Reset(glm::mat4{1.0f});
+    Submit(renderQueue, 0, 1);
+    renderQueue.Sort();
+    renderQueue.Flush(recordState);
+}
+
+//-----------------------------------------------------------------------
+
+void Map::Submit(RenderQueue& renderQueue, int const chunkIndex, int const chunkCount) const
+{
+    MFA_ASSERT(chunkIndex >= 0 && chunkIndex < chunkCount);
+
+    if (chunkIndex == 0)
+    {
+        auto * groundInstance = _groundInstance.get();
+        _groundRenderer->Submit(renderQueue, std::span{ &groundInstance, 1 });
+    }
+
+    auto const wallCount = static_cast<int>(_wallInstances.size());
+    auto const begin = wallCount * chunkIndex / chunkCount;
+    auto const end = wallCount * (chunkIndex + 1) / chunkCount;
 
-    std::vector<MeshInstance*> wallInstances{};
-    for (auto & instance : _wallInstances)
+    auto wallInstances = FrameArena::Instance().Vector<MeshInstance*>(end - begin);
+    for (int i = begin; i < end; ++i)
     {
-        wallInstances.emplace_back(instance.get());
+        wallInstances.emplace_back(_wallInstances[i].get());
     }
-    _wallRenderer->Render(recordState, wallInstances);
+    _wallRenderer->Submit(renderQueue, wallInstances);
+}
+
+//-----------------------------------------------------------------------
+
+int Map::WallCount() const noexcept
+{
+    return static_cast<int>(_wallInstances.size());
 }
 
 //glm::vec2 Map::CellPosition(Coord const& c) const {
@@ -22,6 +22,12 @@ public:
      
     void Render(MFA::RT::CommandRecordState& recordState);
 
+    // Submits one of chunkCount parts of the map, chunks can be submitted in parallel
+    void Submit(MFA::RenderQueue& renderQueue, int chunkIndex, int chunkCount) const;
+
+    [[nodiscard]]
+    int WallCount() const noexcept;
+
     [[nodiscard]]
     std::vector<int> const & GetWalls();
 
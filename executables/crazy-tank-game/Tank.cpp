@@ -5,6 +5,8 @@
 #include "Time.hpp"
 #include "utils/MeshInstance.hpp"
 
+#include <array>
+
 using namespace MFA;
 
 //==================================================================
@@ -13,12 +15,10 @@ Tank::Tank(
 	MeshRenderer const & meshRenderer, 
 	std::shared_ptr<Params> params
 )
-	: _meshInstance(std::make_unique<MFA::MeshInstance>(meshRenderer))
+	: _meshInstance(std::make_unique<MFA::MeshInstance>(meshRenderer, &_transform))
 	, _params(std::move(params))
 {
 
-	_transform = &_meshInstance->GetTransform();
-
 	_physicsId = Physics2D::Instance->Register(
 		Physics2D::Type::AABB,
 		Layer::Tank,
@@ -26,9 +26,10 @@ Tank::Tank(
 		[this](auto layer)->void {OnHit(layer);}
 	);
 
-	_shootTransform = &_meshInstance->FindNode("Shoot")->transform;
+	_shootNodeIdx = _meshInstance->FindNode("Shoot");
+	MFA_ASSERT(_shootNodeIdx >= 0);
 
-	Teleport(_transform->GetLocalPosition().xz());
+	Teleport(_transform.GetLocalPosition().xz());
 
 	_isAlive == true;
 }
@@ -58,7 +59,7 @@ bool Tank::Move(glm::vec2 const & direction, float const deltaTimeSec)
 	auto const moveVector = glm::vec3{direction.x, 0.0, direction.y} * deltaTimeSec * _params->moveSpeed;
 		
 	{// Position
-		auto const startPos3d = _transform->GetLocalPosition();
+		auto const startPos3d = _transform.GetLocalPosition();
 		glm::vec2 remMoveVector = moveVector.xz();
 		do
 		{
@@ -68,7 +69,7 @@ bool Tank::Move(glm::vec2 const & direction, float const deltaTimeSec)
 			auto const startV1 = glm::vec2{ startV2.x, startV0.y };
 			auto const startV3 = glm::vec2{ startV0.x, startV2.y };
 
-			std::vector<glm::vec2> startPoses{startV0, startV1, startV2, startV3};
+			std::array<glm::vec2, 4> const startPoses{startV0, startV1, startV2, startV3};
 
 			auto const moveMag = glm::length(remMoveVector);
 
@@ -88,7 +89,7 @@ bool Tank::Move(glm::vec2 const & direction, float const deltaTimeSec)
 				Physics2D::HitInfo hitInfo{};
 				auto const localHit = Physics2D::Instance->Raycast(
 					Layer::Wall | Layer::Tank,
-					{_physicsId},
+					std::span{&_physicsId, 1},
 					Physics2D::Ray {startPoses[i], moveDir},
 					moveMag,
 					hitInfo
@@ -136,7 +137,7 @@ bool Tank::Move(glm::vec2 const & direction, float const deltaTimeSec)
 			);
 			if(success == true)
 			{
-				_transform->SetLocalPosition(glm::vec3 {targetPos2d.x, startPos3d.y, targetPos2d.y});
+				_transform.SetLocalPosition(glm::vec3 {targetPos2d.x, startPos3d.y, targetPos2d.y});
 			}
 			else
 			{
@@ -145,7 +146,7 @@ bool Tank::Move(glm::vec2 const & direction, float const deltaTimeSec)
 		} while (true);
 	}
 
-	auto const finalPos3d = _transform->GetLocalPosition();
+	auto const finalPos3d = _transform.GetLocalPosition();
 
 	{// Rotation
 		auto const magnitude = glm::length(moveVector);
@@ -156,9 +157,9 @@ bool Tank::Move(glm::vec2 const & direction, float const deltaTimeSec)
 			auto const targetQuaternion = glm::quatLookAt(direction, Math::UpVec3);
 
 			auto const maxDegreesDelta = deltaTimeSec * _params->rotationSpeed;
-			_transform->SetLocalQuaternion(
+			_transform.SetLocalQuaternion(
 				Math::RotateTowards(
-					_transform->GetLocalRotation().GetQuaternion(),
+					_transform.GetLocalRotation().GetQuaternion(),
 					targetQuaternion,
 					maxDegreesDelta
 				)
@@ -173,10 +174,10 @@ bool Tank::Move(glm::vec2 const & direction, float const deltaTimeSec)
 
 void Tank::Teleport(glm::vec2 const & pos2d)
 {
-	glm::vec3 pos3d = _transform->GetLocalPosition();
+	glm::vec3 pos3d = _transform.GetLocalPosition();
 	pos3d.x = pos2d.x;
 	pos3d.z = pos2d.y;
-	_transform->SetLocalPosition(pos3d);
+	_transform.SetLocalPosition(pos3d);
 	auto const canMove = Physics2D::Instance->MoveAABB(
 		_physicsId,
 		pos2d - _params->halfColliderExtent,
@@ -197,11 +198,15 @@ std::unique_ptr<Bullet> Tank::Shoot(std::shared_ptr<Bullet::Params> params)
 		return nullptr;
 	}
 
+	auto const shootTransform = _meshInstance->NodeGlobalTransform(_shootNodeIdx);
+	glm::vec3 const shootPosition = shootTransform * glm::vec4{0.0f, 0.0f, 0.0f, 1.0f};
+	glm::vec3 const shootForward = glm::normalize(shootTransform * Math::ForwardVec4W0);
+
 	auto bullet = std::make_unique<Bullet>(std::move(params), _physicsId);
 	auto & transform = bullet->Transform();
-	transform.SetLocalRotation(_shootTransform->GlobalRotation());
+	transform.SetLocalRotation(Rotation(glm::quatLookAt(shootForward, Math::UpVec3)));
 	transform.SetLocalScale(glm::one<glm::vec3>() * 0.25f);
-	transform.SetLocalPosition(_shootTransform->GlobalPosition() - _shootTransform->Forward() * 1.0f);
+	transform.SetLocalPosition(shootPosition - shootForward * 1.0f);
 	_shootCooldownEndTime = Time::NowSec() + _params->shootCooldown;
 
 	return bullet;
@@ -218,7 +223,7 @@ MeshInstance* Tank::MeshInstance() const
 
 Transform & Tank::Transform()
 {
-	return *_transform;
+	return _transform;
 }
 
 //==================================================================
@@ -44,11 +44,11 @@ public:
 
 private:
 
+	MFA::Transform _transform{};
 	std::unique_ptr<MFA::MeshInstance> _meshInstance{};
-	MFA::Transform * _transform = nullptr;
 	std::shared_ptr<Params> _params{};
 	Physics2D::EntityID _physicsId{};
-	MFA::Transform * _shootTransform = nullptr;
+	int _shootNodeIdx = -1;
 
 	float _shootCooldownEndTime = -1000.0f;
 
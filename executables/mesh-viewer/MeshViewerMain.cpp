@@ -1,3 +1,4 @@
+#include "BedrockFrameArena.hpp"
 #include "BedrockLog.hpp"
 #include "BedrockPath.hpp"
 #include "LogicalDevice.hpp"
@@ -79,28 +80,9 @@ void UI_Loop(VarTracker<glm::vec3> &lightDir)
 
 std::shared_ptr<RT::GpuTexture> CreateErrorTexture()
 {
-	auto const* device = LogicalDevice::Instance;
-
-	auto const commandBuffer = RB::BeginSingleTimeCommand(
-		device->GetVkDevice(),
-		device->GetGraphicCommandPool()
-	);
-
 	auto const cpuTexture = Importer::ErrorTexture();
 
-	auto [gpuTexture, stagingBuffer] = RB::CreateTexture(
-		*cpuTexture,
-		LogicalDevice::Instance->GetVkDevice(),
-		LogicalDevice::Instance->GetPhysicalDevice(),
-		commandBuffer
-	);
-
-	RB::EndAndSubmitSingleTimeCommand(
-		device->GetVkDevice(),
-		device->GetGraphicCommandPool(),
-		device->GetGraphicQueue(),
-		commandBuffer
-	);
+	auto [gpuTexture, uploadToken] = UploadQueue::Instance->CreateTexture(*cpuTexture);
 
 	return gpuTexture;
 }
@@ -176,7 +158,6 @@ int main()
 			defaultSampler,
                         lightDirBuffer,
 			FlatShadingPipeline::Params{
-				.maxSets = 100,
 				.cullModeFlags = VK_CULL_MODE_BACK_BIT,
 			}
 		);
@@ -187,7 +168,6 @@ int main()
 			defaultSampler,
                         lightDirBuffer,
 			FlatShadingPipeline::Params{
-				.maxSets = 100,
 				.cullModeFlags = VK_CULL_MODE_FRONT_BIT,
 			}
 		);
@@ -198,16 +178,15 @@ int main()
                 defaultSampler,
                 lightDirBuffer,
 			FlatShadingPipeline::Params{
-				.maxSets = 100,
 				.cullModeFlags = VK_CULL_MODE_NONE,
 				.polygonMode = VK_POLYGON_MODE_LINE
 			}
 		);
 
-		auto const pointPipeline = std::make_shared<PointPipeline>(displayRenderPass, cameraBuffer, 10000);
+		auto const pointPipeline = std::make_shared<PointPipeline>(displayRenderPass, cameraBuffer);
 		auto pointRenderer = std::make_shared<PointRenderer>(pointPipeline);
 
-		auto const linePipeline = std::make_shared<LinePipeline>(displayRenderPass, cameraBuffer, 10000);
+		auto const linePipeline = std::make_shared<LinePipeline>(displayRenderPass, cameraBuffer);
 		auto lineRenderer = std::make_shared<LineRenderer>(linePipeline);
 
 		ui->UpdateSignal.Register([&lightDir]()->void { UI_Loop(lightDir); });
@@ -290,16 +269,22 @@ int main()
 
 				cameraBufferTracker->Update(recordState);
                 lightDirBufferTracker->Update(recordState);
+				shadingPipeline1->Update(recordState);
+				shadingPipeline2->Update(recordState);
+				wireFramePipeline->Update(recordState);
 
 				displayRenderPass->Begin(recordState, backgroundColor);
 
-				if (displayWireframe == true)
 				{
-					submarineWireFrameRenderer->Render(recordState, { submarineModelMat });
-				}
-				else
-				{
-					submarineRenderer->Render(recordState, { submarineModelMat });
+					SCOPE_GpuProfiler(recordState, "Submarine")
+					if (displayWireframe == true)
+					{
+						submarineWireFrameRenderer->Render(recordState, std::span{&submarineModelMat, 1});
+					}
+					else
+					{
+						submarineRenderer->Render(recordState, std::span{&submarineModelMat, 1});
+					}
 				}
 				
 				ui->Render(recordState, deltaTimeSec);
@@ -311,6 +296,8 @@ int main()
 				device->Present(recordState, swapChainResource->GetSwapChainImages().swapChain);
 			}
 
+			FrameArena::Instance().EndFrame();
+
 			deltaTimeMs = SDL_GetTicks() - startTime;
 			if (MinDeltaTimeMs > deltaTimeMs)
 			{